@@ -869,6 +869,31 @@ static bool onTouchEvent_native(JNIEnv *env, jobject javaGameActivity,
     return result;
 }
 
+static bool onTouchEventBuffer_native(JNIEnv *env, jobject javaGameActivity,
+                                      jlong handle, jobject buffer,
+                                      jint size) {
+    if (handle == 0) return false;
+    NativeCode *code = (NativeCode *)handle;
+    if (code->callbacks.onTouchEvent == nullptr) return false;
+
+    const void *data = env->GetDirectBufferAddress(buffer);
+    if (data == nullptr) return false;
+    static GameActivityMotionEvent c_event;
+    if (!GameActivityMotionEvent_fromPacked(data, size, &c_event)) {
+        ALOGE("Invalid packed motion event of %d bytes", size);
+        return false;
+    }
+    auto result = code->callbacks.onTouchEvent(code, &c_event);
+    GameActivityMotionEvent_destroy(&c_event);
+    return result;
+}
+
+static jobject getEnabledAxes_native(JNIEnv *env, jobject javaGameActivity) {
+    return env->NewDirectByteBuffer(
+        const_cast<uint64_t *>(GameActivityPointerAxes_getEnabledAxesMask()),
+        sizeof(uint64_t));
+}
+
 static bool onKeyUp_native(JNIEnv *env, jobject javaGameActivity, jlong handle,
                            jobject keyEvent) {
     if (handle == 0) return false;
@@ -986,6 +1011,10 @@ static const JNINativeMethod g_methods[] = {
     {"onSurfaceDestroyedNative", "(J)V", (void *)onSurfaceDestroyed_native},
     {"onTouchEventNative", "(JLandroid/view/MotionEvent;IIIIIJJIIIIIIFF)Z",
      (void *)onTouchEvent_native},
+    {"onTouchEventBufferNative", "(JLjava/nio/ByteBuffer;I)Z",
+     (void *)onTouchEventBuffer_native},
+    {"getEnabledAxesNative", "()Ljava/nio/ByteBuffer;",
+     (void *)getEnabledAxes_native},
     {"onKeyDownNative", "(JLandroid/view/KeyEvent;)Z",
      (void *)onKeyDown_native},
     {"onKeyUpNative", "(JLandroid/view/KeyEvent;)Z", (void *)onKeyUp_native},
@@ -16,8 +16,10 @@
 
 #include "GameActivityEvents.h"
 
+#include <string.h>
 #include <sys/system_properties.h>
 
+#include <algorithm>
 #include <string>
 
 #include "GameActivityLog.h"
@@ -30,12 +32,21 @@ static bool enabledAxes[GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT] = {
     // `GameActivityPointerAxes_enableAxis`).
     false};
 
+// The same as enabledAxes, as a bit mask that can be shared with Java.
+static uint64_t enabledAxesMask =
+    (1ull << AMOTION_EVENT_AXIS_X) | (1ull << AMOTION_EVENT_AXIS_Y);
+
 extern "C" void GameActivityPointerAxes_enableAxis(int32_t axis) {
     if (axis < 0 || axis >= GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT) {
         return;
     }
 
     enabledAxes[axis] = true;
+    enabledAxesMask |= 1ull << axis;
+}
+
+extern "C" const uint64_t *GameActivityPointerAxes_getEnabledAxesMask() {
+    return &enabledAxesMask;
 }
 
 float GameActivityPointerAxes_getAxisValue(
@@ -58,6 +69,7 @@ extern "C" void GameActivityPointerAxes_disableAxis(int32_t axis) {
     }
 
     enabledAxes[axis] = false;
+    enabledAxesMask &= ~(1ull << axis);
 }
 
 float GameActivityMotionEvent_getHistoricalAxisValue(
@@ -110,9 +122,9 @@ static struct {
 
 extern "C" void GameActivityMotionEvent_destroy(
     GameActivityMotionEvent *c_event) {
-    delete c_event->historicalAxisValues;
-    delete c_event->historicalEventTimesMillis;
-    delete c_event->historicalEventTimesNanos;
+    delete[] c_event->historicalAxisValues;
+    delete[] c_event->historicalEventTimesMillis;
+    delete[] c_event->historicalEventTimesNanos;
 }
 
 static void initMotionEvents(JNIEnv *env) {
@@ -267,6 +279,283 @@ extern "C" void GameActivityMotionEvent_fromJava(
     out_event->precisionY = precisionY;
 }
 
+// Reads a value from a possibly unaligned position in a packed event.
+template <typename T>
+static T readPacked(const uint8_t *data, size_t offset) {
+    T value;
+    memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+extern "C" bool GameActivityMotionEvent_fromPacked(
+    const void *data, size_t size, GameActivityMotionEvent *out_event) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    if (size < GAME_ACTIVITY_PACKED_MOTION_EVENT_HEADER_SIZE) return false;
+    int32_t packedPointerCount = readPacked<int32_t>(
+        bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_POINTER_COUNT);
+    int32_t historySize = readPacked<int32_t>(
+        bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_HISTORY_SIZE);
+    uint64_t axesMask = readPacked<uint64_t>(
+        bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_AXES_MASK);
+    if (packedPointerCount < 0 || historySize < 0) return false;
+
+    // Axes past the end of axisValues are packed but not kept.
+    int axes[64];
+    int axisCount = 0;
+    for (uint64_t bits = axesMask; bits != 0; bits &= bits - 1) {
+        axes[axisCount++] = __builtin_ctzll(bits);
+    }
+    const size_t pointerSize = 4 * sizeof(int32_t) + axisCount * sizeof(float);
+    const size_t timesOffset = GAME_ACTIVITY_PACKED_MOTION_EVENT_HEADER_SIZE;
+    const size_t pointersOffset = timesOffset + historySize * sizeof(int64_t);
+    const size_t historyOffset =
+        pointersOffset + packedPointerCount * pointerSize;
+    const size_t historyEntrySize =
+        packedPointerCount * axisCount * sizeof(float);
+    if (size < historyOffset + historySize * historyEntrySize) return false;
+
+    int pointerCount = std::min(packedPointerCount,
+                                GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT);
+    out_event->pointerCount = pointerCount;
+    for (int i = 0; i < pointerCount; ++i) {
+        size_t offset = pointersOffset + i * pointerSize;
+        GameActivityPointerAxes &pointer = out_event->pointers[i];
+        pointer.id = readPacked<int32_t>(bytes, offset);
+        pointer.toolType = readPacked<int32_t>(bytes, offset + 4);
+        pointer.rawX = readPacked<float>(bytes, offset + 8);
+        pointer.rawY = readPacked<float>(bytes, offset + 12);
+        memset(pointer.axisValues, 0, sizeof(pointer.axisValues));
+        offset += 16;
+        for (int a = 0; a < axisCount; ++a, offset += sizeof(float)) {
+            if (axes[a] < GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT) {
+                pointer.axisValues[axes[a]] = readPacked<float>(bytes, offset);
+            }
+        }
+    }
+
+    out_event->historySize = historySize;
+    out_event->historicalAxisValues =
+        new float[historySize * pointerCount *
+                  GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT]();
+    out_event->historicalEventTimesMillis = new long[historySize];
+    out_event->historicalEventTimesNanos = new long[historySize];
+    for (int historyIndex = 0; historyIndex < historySize; historyIndex++) {
+        out_event->historicalEventTimesMillis[historyIndex] =
+            readPacked<int64_t>(bytes,
+                                timesOffset + historyIndex * sizeof(int64_t));
+        out_event->historicalEventTimesNanos[historyIndex] =
+            out_event->historicalEventTimesMillis[historyIndex] * 1000000;
+        for (int i = 0; i < pointerCount; ++i) {
+            float *axisValues =
+                &out_event->historicalAxisValues
+                     [(historyIndex * pointerCount + i) *
+                      GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT];
+            size_t offset = historyOffset + historyIndex * historyEntrySize +
+                            i * axisCount * sizeof(float);
+            for (int a = 0; a < axisCount; ++a, offset += sizeof(float)) {
+                if (axes[a] < GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT) {
+                    axisValues[axes[a]] = readPacked<float>(bytes, offset);
+                }
+            }
+        }
+    }
+
+    out_event->deviceId = readPacked<int32_t>(
+        bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_DEVICE_ID);
+    out_event->source =
+        readPacked<int32_t>(bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_SOURCE);
+    out_event->action =
+        readPacked<int32_t>(bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_ACTION);
+
+    out_event->eventTime = readPacked<int64_t>(
+        bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_EVENT_TIME);
+    out_event->downTime = readPacked<int64_t>(
+        bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_DOWN_TIME);
+
+    out_event->flags =
+        readPacked<int32_t>(bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_FLAGS);
+    out_event->metaState = readPacked<int32_t>(
+        bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_META_STATE);
+
+    out_event->actionButton = readPacked<int32_t>(
+        bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_ACTION_BUTTON);
+    out_event->buttonState = readPacked<int32_t>(
+        bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_BUTTON_STATE);
+    out_event->classification = readPacked<int32_t>(
+        bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_CLASSIFICATION);
+    out_event->edgeFlags = readPacked<int32_t>(
+        bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_EDGE_FLAGS);
+
+    out_event->precisionX = readPacked<float>(
+        bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_PRECISION_X);
+    out_event->precisionY = readPacked<float>(
+        bytes, GAME_ACTIVITY_PACKED_MOTION_EVENT_PRECISION_Y);
+    return true;
+}
+
+extern "C" void GameActivityMotionEvent_copy(
+    const GameActivityMotionEvent *event, GameActivityMotionEvent *out_event) {
+    *out_event = *event;
+    int historySize = event->historySize;
+    int valueCount = historySize * event->pointerCount *
+                     GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+    out_event->historicalAxisValues = new float[valueCount];
+    out_event->historicalEventTimesMillis = new long[historySize];
+    out_event->historicalEventTimesNanos = new long[historySize];
+    std::copy_n(event->historicalAxisValues, valueCount,
+                out_event->historicalAxisValues);
+    std::copy_n(event->historicalEventTimesMillis, historySize,
+                out_event->historicalEventTimesMillis);
+    std::copy_n(event->historicalEventTimesNanos, historySize,
+                out_event->historicalEventTimesNanos);
+}
+
+// Samples closer together than this aren't extrapolated from.
+static const int64_t kResampleMinDeltaNanos = 2000000;
+// The furthest positions are extrapolated beyond the latest sample.
+static const int64_t kResampleMaxPredictionNanos = 8000000;
+
+static bool isMove(const GameActivityMotionEvent &event) {
+    return (event.action & AMOTION_EVENT_ACTION_MASK) ==
+           AMOTION_EVENT_ACTION_MOVE;
+}
+
+static bool canMergeMoves(const GameActivityMotionEvent &a,
+                          const GameActivityMotionEvent &b) {
+    if (!isMove(a) || !isMove(b) || a.deviceId != b.deviceId ||
+        a.source != b.source || a.pointerCount != b.pointerCount) {
+        return false;
+    }
+    for (uint32_t i = 0; i < a.pointerCount; ++i) {
+        if (a.pointers[i].id != b.pointers[i].id) return false;
+    }
+    return true;
+}
+
+// Samples of an event are numbered oldest first: its history entries, then
+// the current values at index historySize.
+static int64_t sampleTimeNanos(const GameActivityMotionEvent &event,
+                               int sample) {
+    return sample < event.historySize
+               ? event.historicalEventTimesNanos[sample]
+               : event.eventTime * 1000000;
+}
+
+static const float *sampleAxisValues(const GameActivityMotionEvent &event,
+                                     int sample, int pointerIndex) {
+    return sample < event.historySize
+               ? &event.historicalAxisValues
+                      [(sample * event.pointerCount + pointerIndex) *
+                       GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT]
+               : event.pointers[pointerIndex].axisValues;
+}
+
+// Merges run[0..count-1] into run[count - 1], destroying the others.
+static void mergeMoves(GameActivityMotionEvent *run, int count) {
+    GameActivityMotionEvent &last = run[count - 1];
+    int historySize = 0;
+    for (int i = 0; i < count; ++i) historySize += run[i].historySize + 1;
+    --historySize;  // The current values of the last event.
+
+    const int pointerValueCount =
+        last.pointerCount * GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+    float *axisValues = new float[historySize * pointerValueCount];
+    long *timesMillis = new long[historySize];
+    long *timesNanos = new long[historySize];
+    int h = 0;
+    for (int i = 0; i < count; ++i) {
+        const GameActivityMotionEvent &event = run[i];
+        int samples = i < count - 1 ? event.historySize + 1 : event.historySize;
+        for (int sample = 0; sample < samples; ++sample, ++h) {
+            timesNanos[h] = sampleTimeNanos(event, sample);
+            timesMillis[h] = sample < event.historySize
+                                 ? event.historicalEventTimesMillis[sample]
+                                 : event.eventTime;
+            float *values = &axisValues[h * pointerValueCount];
+            for (uint32_t p = 0; p < event.pointerCount; ++p) {
+                std::copy_n(sampleAxisValues(event, sample, p),
+                            GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT,
+                            &values[p * GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT]);
+            }
+        }
+    }
+    for (int i = 0; i < count; ++i) GameActivityMotionEvent_destroy(&run[i]);
+    last.historySize = historySize;
+    last.historicalAxisValues = axisValues;
+    last.historicalEventTimesMillis = timesMillis;
+    last.historicalEventTimesNanos = timesNanos;
+}
+
+static void resampleMove(GameActivityMotionEvent &event, int64_t timeNanos) {
+    int latest = event.historySize;
+    if (latest == 0) return;
+    int64_t latestTimeNanos = sampleTimeNanos(event, latest);
+    int a, b;
+    if (timeNanos >= latestTimeNanos) {
+        a = latest - 1;
+        b = latest;
+        int64_t delta = latestTimeNanos - sampleTimeNanos(event, a);
+        if (delta < kResampleMinDeltaNanos) return;
+        timeNanos = std::min(
+            timeNanos, latestTimeNanos +
+                           std::min(delta / 2, kResampleMaxPredictionNanos));
+    } else {
+        b = latest;
+        while (b > 0 && sampleTimeNanos(event, b - 1) > timeNanos) --b;
+        if (b == 0) return;  // Before the first sample.
+        a = b - 1;
+    }
+    int64_t timeA = sampleTimeNanos(event, a);
+    float alpha = static_cast<float>(timeNanos - timeA) /
+                  static_cast<float>(sampleTimeNanos(event, b) - timeA);
+    for (uint32_t p = 0; p < event.pointerCount; ++p) {
+        const float *valuesA = sampleAxisValues(event, a, p);
+        const float *valuesB = sampleAxisValues(event, b, p);
+        float x = valuesA[AMOTION_EVENT_AXIS_X] +
+                  (valuesB[AMOTION_EVENT_AXIS_X] -
+                   valuesA[AMOTION_EVENT_AXIS_X]) *
+                      alpha;
+        float y = valuesA[AMOTION_EVENT_AXIS_Y] +
+                  (valuesB[AMOTION_EVENT_AXIS_Y] -
+                   valuesA[AMOTION_EVENT_AXIS_Y]) *
+                      alpha;
+        GameActivityPointerAxes &pointer = event.pointers[p];
+        pointer.rawX += x - pointer.axisValues[AMOTION_EVENT_AXIS_X];
+        pointer.rawY += y - pointer.axisValues[AMOTION_EVENT_AXIS_Y];
+        pointer.axisValues[AMOTION_EVENT_AXIS_X] = x;
+        pointer.axisValues[AMOTION_EVENT_AXIS_Y] = y;
+    }
+    event.eventTime = timeNanos / 1000000;
+}
+
+extern "C" int GameActivityMotionEvent_coalesceMoves(
+    GameActivityMotionEvent *events, int count, int64_t resampleTimeNanos) {
+    int out = 0;
+    for (int i = 0; i < count;) {
+        int end = i + 1;
+        while (end < count && canMergeMoves(events[end - 1], events[end])) {
+            ++end;
+        }
+        if (end - i > 1) mergeMoves(&events[i], end - i);
+        if (out != end - 1) events[out] = events[end - 1];
+        ++out;
+        i = end;
+    }
+    if (resampleTimeNanos == 0) return out;
+
+    // Only the latest state of each device is worth resampling.
+    for (int i = out - 1; i >= 0; --i) {
+        if (!isMove(events[i])) continue;
+        bool followed = false;
+        for (int j = i + 1; j < out && !followed; ++j) {
+            followed = events[j].deviceId == events[i].deviceId &&
+                       events[j].source == events[i].source;
+        }
+        if (!followed) resampleMove(events[i], resampleTimeNanos);
+    }
+    return out;
+}
+
 static struct {
     jmethodID getDeviceId;
     jmethodID getSource;
@@ -302,6 +302,104 @@ void GameActivityMotionEvent_fromJava(
     int actionButton, int buttonState, int classification, int edgeFlags,
     float precisionX, float precisionY);
 
+/**
+ * \brief Byte offsets of the fields of a motion event packed into a buffer by
+ * the Java GameActivity, in native byte order.
+ *
+ * The fixed size header is followed by:
+ * - `historySize` 64-bit historical event times, in milliseconds.
+ * - For each of the `pointerCount` pointers, its id, tool type, raw X and raw
+ *   Y, then the value of each axis set in the axes mask, in increasing order.
+ * - For each history entry and each pointer, the historical value of each axis
+ *   set in the axes mask.
+ *
+ * Events are packed this way so that converting one costs a single JNI call,
+ * rather than one or more calls per pointer, axis and history entry.
+ */
+enum GameActivityPackedMotionEventLayout {
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_POINTER_COUNT = 0,
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_HISTORY_SIZE = 4,
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_DEVICE_ID = 8,
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_SOURCE = 12,
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_ACTION = 16,
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_FLAGS = 20,
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_META_STATE = 24,
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_ACTION_BUTTON = 28,
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_BUTTON_STATE = 32,
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_CLASSIFICATION = 36,
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_EDGE_FLAGS = 40,
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_PRECISION_X = 44,
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_PRECISION_Y = 48,
+    /* 4 bytes of padding */
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_EVENT_TIME = 56,
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_DOWN_TIME = 64,
+    /** Bit i is set if axis i was packed. */
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_AXES_MASK = 72,
+    GAME_ACTIVITY_PACKED_MOTION_EVENT_HEADER_SIZE = 80
+};
+
+/**
+ * \brief Get a bit mask of the enabled axes, with bit i set if axis i is
+ * enabled.
+ *
+ * The mask is updated in place when an axis is enabled or disabled, so the
+ * Java side can read it through a direct `ByteBuffer` without a JNI call.
+ */
+const uint64_t* GameActivityPointerAxes_getEnabledAxesMask();
+
+/**
+ * \brief Convert a motion event packed by the Java GameActivity into a
+ * `GameActivityMotionEvent`.
+ *
+ * See `GameActivityPackedMotionEventLayout` for the layout of the data. The
+ * result is the same as from `GameActivityMotionEvent_fromJava`, and must be
+ * freed with `GameActivityMotionEvent_destroy`.
+ * Ownership of out_event is maintained by the caller.
+ *
+ * @return false, leaving out_event untouched, if size is too small for the
+ * data.
+ */
+bool GameActivityMotionEvent_fromPacked(const void* data, size_t size,
+                                        GameActivityMotionEvent* out_event);
+
+/**
+ * \brief Copy a motion event, including its history.
+ *
+ * The copy must be freed with `GameActivityMotionEvent_destroy`.
+ * Ownership of out_event is maintained by the caller.
+ */
+void GameActivityMotionEvent_copy(const GameActivityMotionEvent* event,
+                                  GameActivityMotionEvent* out_event);
+
+/**
+ * \brief Merge each run of consecutive ACTION_MOVE events in `events` into a
+ * single event, and optionally resample pointer positions to a given time.
+ *
+ * Moves are merged if they come from the same device and source and have the
+ * same pointer ids in the same order. The merged event is the last move of
+ * the run, with the samples of the earlier moves, in order, prepended to its
+ * history. The events must own their history, as returned by
+ * `GameActivityMotionEvent_fromPacked` or `GameActivityMotionEvent_copy`:
+ * merged events are destroyed, and the rest of the array is moved down over
+ * them.
+ *
+ * If `resampleTimeNanos` is not 0, the X and Y axes (and the raw X and Y) of
+ * the last move from each device and source, if no other event from that
+ * device and source follows it, are set to their values at that time, and
+ * its `eventTime` to the time used. Positions are interpolated between the
+ * two samples around that time or, if it is after the latest sample,
+ * extrapolated from the last two samples. Extrapolation is limited to half the
+ * time between those samples and at most 8ms, and samples less than 2ms apart
+ * aren't extrapolated from. `resampleTimeNanos` uses the same clock as
+ * `eventTime`: a game would usually pass the time at which the frame it is
+ * about to render is expected to be presented.
+ *
+ * @return The number of events left in `events`.
+ */
+int GameActivityMotionEvent_coalesceMoves(GameActivityMotionEvent* events,
+                                          int count,
+                                          int64_t resampleTimeNanos);
+
 /**
  * \brief Describe a key event that happened on the GameActivity SurfaceView.
  *
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// The event ring used by android_native_app_glue.c for its input ring. This
+// header is internal to the glue and is C only.
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A bounded queue of fixed-size events, written by the main thread and read by
+// the app thread. Each slot has a sequence number: the slot for the event at
+// position pos has seq pos while it is free, pos + 1 once the event has been
+// published and pos + capacity once the event has been read, which frees it
+// for position pos + capacity. While an unread event is being replaced or
+// read, its seq is RING_SLOT_WRITING or RING_SLOT_READING. The main thread
+// claims unread events with a compare-and-swap in order to drop or replace
+// them, so it never has to wait for the app thread to make room.
+#define RING_SLOT_WRITING UINT64_MAX
+#define RING_SLOT_READING (UINT64_MAX - 1)
+
+struct android_event_ring {
+    uint8_t* events;
+    _Atomic uint64_t* seqs;
+    size_t eventSize;
+    uint64_t capacity;  // A power of 2.
+    uint64_t writePos;  // Only used on the main thread.
+    uint64_t readPos;   // Only used on the app thread.
+    // Called on events that are dropped or replaced, if not NULL.
+    void (*discard)(void* event);
+};
+
+static inline void event_ring_free(struct android_event_ring* ring) {
+    free(ring->events);
+    free(ring->seqs);
+}
+
+static inline bool event_ring_init(struct android_event_ring* ring,
+                                   uint32_t capacity, size_t eventSize) {
+    uint64_t size = 1;
+    while (size < capacity) size <<= 1;
+    ring->events = (uint8_t*)malloc(size * eventSize);
+    ring->seqs = (_Atomic uint64_t*)malloc(size * sizeof(_Atomic uint64_t));
+    if (ring->events == NULL || ring->seqs == NULL) {
+        event_ring_free(ring);
+        return false;
+    }
+    for (uint64_t i = 0; i < size; ++i) atomic_init(&ring->seqs[i], i);
+    ring->eventSize = eventSize;
+    ring->capacity = size;
+    ring->writePos = 0;
+    ring->readPos = 0;
+    ring->discard = NULL;
+    return true;
+}
+
+static inline void* event_ring_slot(const struct android_event_ring* ring,
+                                    uint64_t pos) {
+    return ring->events + (pos & (ring->capacity - 1)) * ring->eventSize;
+}
+
+static inline _Atomic uint64_t* event_ring_seq(
+    const struct android_event_ring* ring, uint64_t pos) {
+    return &ring->seqs[pos & (ring->capacity - 1)];
+}
+
+// Main thread only.
+static inline bool event_ring_full(const struct android_event_ring* ring) {
+    return atomic_load_explicit(event_ring_seq(ring, ring->writePos),
+                                memory_order_acquire) != ring->writePos;
+}
+
+// Main thread only. Adds the event, dropping the oldest unread event if the
+// ring is full. Returns false if an event was dropped.
+static inline bool event_ring_push(struct android_event_ring* ring,
+                                   const void* event) {
+    uint64_t pos = ring->writePos;
+    _Atomic uint64_t* seq = event_ring_seq(ring, pos);
+    // The seq of the unread event that is still in the slot, if any.
+    uint64_t unread = pos - ring->capacity + 1;
+    bool dropped = false;
+    uint64_t expected = atomic_load_explicit(seq, memory_order_acquire);
+    while (expected != pos) {
+        if (expected == unread) {
+            if (atomic_compare_exchange_weak_explicit(
+                    seq, &expected, RING_SLOT_WRITING, memory_order_acquire,
+                    memory_order_acquire)) {
+                dropped = true;
+                break;
+            }
+        } else {
+            // The app thread is copying the oldest event out, which frees
+            // the slot.
+            sched_yield();
+            expected = atomic_load_explicit(seq, memory_order_acquire);
+        }
+    }
+    void* slot = event_ring_slot(ring, pos);
+    if (dropped && ring->discard != NULL) ring->discard(slot);
+    memcpy(slot, event, ring->eventSize);
+    atomic_store_explicit(seq, pos + 1, memory_order_release);
+    ring->writePos = pos + 1;
+    return !dropped;
+}
+
+// Main thread only. Overwrites the newest event with the new one, if the
+// newest event hasn't been read yet and can_replace(newest, event) is true.
+static inline bool event_ring_replace_newest(
+    struct android_event_ring* ring, const void* event,
+    bool (*can_replace)(const void* newest, const void* event)) {
+    if (ring->writePos == 0) return false;
+    uint64_t pos = ring->writePos - 1;
+    _Atomic uint64_t* seq = event_ring_seq(ring, pos);
+    uint64_t expected = pos + 1;
+    if (!atomic_compare_exchange_strong_explicit(seq, &expected,
+                                                 RING_SLOT_WRITING,
+                                                 memory_order_acquire,
+                                                 memory_order_relaxed)) {
+        return false;
+    }
+    void* newest = event_ring_slot(ring, pos);
+    bool replace = can_replace(newest, event);
+    if (replace) {
+        if (ring->discard != NULL) ring->discard(newest);
+        memcpy(newest, event, ring->eventSize);
+    }
+    atomic_store_explicit(seq, pos + 1, memory_order_release);
+    return replace;
+}
+
+// App thread only. Copies the oldest unread event to out and frees its slot.
+// Returns false if there are no events.
+static inline bool event_ring_pop(struct android_event_ring* ring,
+                                  void* out) {
+    for (;;) {
+        uint64_t pos = ring->readPos;
+        _Atomic uint64_t* seq = event_ring_seq(ring, pos);
+        uint64_t expected = atomic_load_explicit(seq, memory_order_acquire);
+        if (expected == pos) return false;
+        if (expected == pos + 1) {
+            if (atomic_compare_exchange_weak_explicit(
+                    seq, &expected, RING_SLOT_READING, memory_order_acquire,
+                    memory_order_relaxed)) {
+                memcpy(out, event_ring_slot(ring, pos), ring->eventSize);
+                atomic_store_explicit(seq, pos + ring->capacity,
+                                      memory_order_release);
+                ring->readPos = pos + 1;
+                return true;
+            }
+        } else if (expected == RING_SLOT_WRITING) {
+            // The main thread is dropping or replacing this event.
+            sched_yield();
+        } else {
+            // The event was dropped and the slot reused for a later one.
+            ring->readPos = pos + 1;
+        }
+    }
+}
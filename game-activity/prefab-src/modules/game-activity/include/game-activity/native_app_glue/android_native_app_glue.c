@@ -19,11 +19,15 @@
 #include <android/log.h>
 #include <errno.h>
 #include <jni.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "android_event_ring.h"
+
 #define NATIVE_APP_GLUE_MOTION_EVENTS_DEFAULT_BUF_SIZE 16
 #define NATIVE_APP_GLUE_KEY_EVENTS_DEFAULT_BUF_SIZE 4
 
@@ -51,6 +55,109 @@
 #define LOGV(...) ((void)0)
 #endif
 
+// --------------------------------------------------------------------
+// Input ring
+// --------------------------------------------------------------------
+
+struct android_input_ring {
+    struct android_event_ring motion;
+    struct android_event_ring key;
+    enum NativeAppGlueInputOverflowPolicy policy;
+    _Atomic uint64_t motionEventsDropped;
+    _Atomic uint64_t motionEventsCoalesced;
+    _Atomic uint64_t keyEventsDropped;
+};
+
+static void discard_motion_event(void* event) {
+    GameActivityMotionEvent_destroy((GameActivityMotionEvent*)event);
+}
+
+static bool is_motion_event_move(const GameActivityMotionEvent* event) {
+    return (event->action & AMOTION_EVENT_ACTION_MASK) ==
+           AMOTION_EVENT_ACTION_MOVE;
+}
+
+static bool can_coalesce_motion_events(const void* newest, const void* event) {
+    const GameActivityMotionEvent* a = (const GameActivityMotionEvent*)newest;
+    const GameActivityMotionEvent* b = (const GameActivityMotionEvent*)event;
+    if (!is_motion_event_move(a) || !is_motion_event_move(b) ||
+        a->deviceId != b->deviceId || a->source != b->source ||
+        a->pointerCount != b->pointerCount) {
+        return false;
+    }
+    for (uint32_t i = 0; i < a->pointerCount; ++i) {
+        if (a->pointers[i].id != b->pointers[i].id) return false;
+    }
+    return true;
+}
+
+static struct android_input_ring* android_app_get_input_ring(
+    struct android_app* android_app) {
+    return __atomic_load_n(&android_app->inputRing, __ATOMIC_ACQUIRE);
+}
+
+static void input_ring_free(struct android_input_ring* ring) {
+    GameActivityMotionEvent event;
+    while (event_ring_pop(&ring->motion, &event)) {
+        GameActivityMotionEvent_destroy(&event);
+    }
+    event_ring_free(&ring->motion);
+    event_ring_free(&ring->key);
+    free(ring);
+}
+
+bool android_app_enable_input_ring(
+    struct android_app* app, uint32_t motionEventCapacity,
+    uint32_t keyEventCapacity, enum NativeAppGlueInputOverflowPolicy policy) {
+    if (app->inputRing != NULL) {
+        LOGW("android_app_enable_input_ring: already enabled");
+        return false;
+    }
+    if (motionEventCapacity == 0 || keyEventCapacity == 0) return false;
+
+    struct android_input_ring* ring =
+        (struct android_input_ring*)calloc(1, sizeof(struct android_input_ring));
+    if (ring == NULL) return false;
+    if (!event_ring_init(&ring->motion, motionEventCapacity,
+                         sizeof(GameActivityMotionEvent))) {
+        free(ring);
+        return false;
+    }
+    if (!event_ring_init(&ring->key, keyEventCapacity,
+                         sizeof(GameActivityKeyEvent))) {
+        event_ring_free(&ring->motion);
+        free(ring);
+        return false;
+    }
+    ring->motion.discard = discard_motion_event;
+    ring->policy = policy;
+    atomic_init(&ring->motionEventsDropped, 0);
+    atomic_init(&ring->motionEventsCoalesced, 0);
+    atomic_init(&ring->keyEventsDropped, 0);
+
+    // Events that are already in the current input buffer are kept: the app
+    // thread appends the ring's events to them.
+    pthread_mutex_lock(&app->mutex);
+    __atomic_store_n(&app->inputRing, ring, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&app->mutex);
+    return true;
+}
+
+void android_app_get_input_ring_stats(struct android_app* app,
+                                      struct android_input_ring_stats* stats) {
+    struct android_input_ring* ring = android_app_get_input_ring(app);
+    if (ring == NULL) {
+        memset(stats, 0, sizeof(struct android_input_ring_stats));
+        return;
+    }
+    stats->motionEventsDropped = atomic_load_explicit(
+        &ring->motionEventsDropped, memory_order_relaxed);
+    stats->motionEventsCoalesced = atomic_load_explicit(
+        &ring->motionEventsCoalesced, memory_order_relaxed);
+    stats->keyEventsDropped =
+        atomic_load_explicit(&ring->keyEventsDropped, memory_order_relaxed);
+}
+
 static void free_saved_state(struct android_app* android_app) {
     pthread_mutex_lock(&android_app->mutex);
     if (android_app->savedState != NULL) {
@@ -361,9 +468,11 @@ static void android_app_free(struct android_app* android_app) {
     for (input_buf_idx = 0; input_buf_idx < NATIVE_APP_GLUE_MAX_INPUT_BUFFERS; input_buf_idx++) {
         struct android_input_buffer *buf = &android_app->inputBuffers[input_buf_idx];
 
+        android_app_clear_motion_events(buf);
         free(buf->motionEvents);
         free(buf->keyEvents);
     }
+    if (android_app->inputRing != NULL) input_ring_free(android_app->inputRing);
 
     close(android_app->msgread);
     close(android_app->msgwrite);
@@ -472,14 +581,62 @@ static void onNativeWindowResized(GameActivity* activity, ANativeWindow* window,
 void android_app_set_motion_event_filter(struct android_app* app,
                                          android_motion_event_filter filter) {
     pthread_mutex_lock(&app->mutex);
-    app->motionEventFilter = filter;
+    // Also read without the mutex when the input ring is enabled.
+    __atomic_store_n(&app->motionEventFilter, filter, __ATOMIC_RELAXED);
     pthread_mutex_unlock(&app->mutex);
 }
 
+static bool queue_motion_event(struct android_app* android_app,
+                               struct android_input_ring* ring,
+                               const GameActivityMotionEvent* event) {
+    android_motion_event_filter filter =
+        __atomic_load_n(&android_app->motionEventFilter, __ATOMIC_RELAXED);
+    if (filter != NULL && !filter(event)) return false;
+
+    // The history belongs to GameActivity, which frees it on return.
+    GameActivityMotionEvent copy;
+    GameActivityMotionEvent_copy(event, &copy);
+    if (ring->policy == NATIVE_APP_GLUE_INPUT_OVERFLOW_COALESCE_MOVES &&
+        event_ring_full(&ring->motion) &&
+        event_ring_replace_newest(&ring->motion, &copy,
+                                  can_coalesce_motion_events)) {
+        atomic_fetch_add_explicit(&ring->motionEventsCoalesced, 1,
+                                  memory_order_relaxed);
+        return true;
+    }
+    if (!event_ring_push(&ring->motion, &copy)) {
+        atomic_fetch_add_explicit(&ring->motionEventsDropped, 1,
+                                  memory_order_relaxed);
+    }
+    return true;
+}
+
+static bool queue_key_event(struct android_app* android_app,
+                            struct android_input_ring* ring,
+                            const GameActivityKeyEvent* event) {
+    android_key_event_filter filter =
+        __atomic_load_n(&android_app->keyEventFilter, __ATOMIC_RELAXED);
+    if (filter != NULL && !filter(event)) return false;
+
+    if (!event_ring_push(&ring->key, event)) {
+        atomic_fetch_add_explicit(&ring->keyEventsDropped, 1,
+                                  memory_order_relaxed);
+    }
+    return true;
+}
+
 static bool onTouchEvent(GameActivity* activity,
                          const GameActivityMotionEvent* event) {
     struct android_app* android_app = ToApp(activity);
+    struct android_input_ring* ring = android_app_get_input_ring(android_app);
+    if (ring != NULL) return queue_motion_event(android_app, ring, event);
+
     pthread_mutex_lock(&android_app->mutex);
+    if (android_app->inputRing != NULL) {
+        // The ring was enabled since the check above.
+        pthread_mutex_unlock(&android_app->mutex);
+        return queue_motion_event(android_app, android_app->inputRing, event);
+    }
 
     if (android_app->motionEventFilter != NULL &&
         !android_app->motionEventFilter(event)) {
@@ -502,16 +659,85 @@ static bool onTouchEvent(GameActivity* activity,
         }
     }
 
+    // The history belongs to GameActivity, which frees it on return.
     int new_ix = inputBuffer->motionEventsCount;
-    memcpy(&inputBuffer->motionEvents[new_ix], event, sizeof(GameActivityMotionEvent));
+    GameActivityMotionEvent_copy(event, &inputBuffer->motionEvents[new_ix]);
     ++inputBuffer->motionEventsCount;
 
     pthread_mutex_unlock(&android_app->mutex);
     return true;
 }
 
+// Moves the events in the input ring to the end of inputBuffer. Only called on
+// the app thread, which owns the input buffers once the ring is enabled.
+static void drain_input_ring(struct android_input_ring* ring,
+                             struct android_input_buffer* inputBuffer) {
+    for (;;) {
+        if (inputBuffer->motionEventsCount >=
+            inputBuffer->motionEventsBufferSize) {
+            inputBuffer->motionEventsBufferSize *= 2;
+            inputBuffer->motionEvents = (GameActivityMotionEvent *) realloc(inputBuffer->motionEvents,
+                sizeof(GameActivityMotionEvent) * inputBuffer->motionEventsBufferSize);
+
+            if (inputBuffer->motionEvents == NULL) {
+                LOGE("drain_input_ring: out of memory");
+                abort();
+            }
+        }
+        if (!event_ring_pop(
+                &ring->motion,
+                &inputBuffer->motionEvents[inputBuffer->motionEventsCount])) {
+            break;
+        }
+        ++inputBuffer->motionEventsCount;
+    }
+    for (;;) {
+        if (inputBuffer->keyEventsCount >= inputBuffer->keyEventsBufferSize) {
+            inputBuffer->keyEventsBufferSize *= 2;
+            inputBuffer->keyEvents = (GameActivityKeyEvent *) realloc(inputBuffer->keyEvents,
+                sizeof(GameActivityKeyEvent) * inputBuffer->keyEventsBufferSize);
+
+            if (inputBuffer->keyEvents == NULL) {
+                LOGE("drain_input_ring: out of memory");
+                abort();
+            }
+        }
+        if (!event_ring_pop(
+                &ring->key,
+                &inputBuffer->keyEvents[inputBuffer->keyEventsCount])) {
+            break;
+        }
+        ++inputBuffer->keyEventsCount;
+    }
+}
+
+// Called on the app thread with a buffer the main thread no longer writes to.
+static void coalesce_motion_events(struct android_app* android_app,
+                                   struct android_input_buffer* inputBuffer) {
+    if (!android_app->coalesceMotionEvents) return;
+    inputBuffer->motionEventsCount = GameActivityMotionEvent_coalesceMoves(
+        inputBuffer->motionEvents, (int)inputBuffer->motionEventsCount,
+        android_app->motionEventResampleTimeNanos);
+}
+
 struct android_input_buffer* android_app_swap_input_buffers(
     struct android_app* android_app) {
+    struct android_input_ring* ring = android_app_get_input_ring(android_app);
+    if (ring != NULL) {
+        struct android_input_buffer* inputBuffer =
+            &android_app->inputBuffers[android_app->currentInputBuffer];
+        drain_input_ring(ring, inputBuffer);
+        if (inputBuffer->motionEventsCount == 0 &&
+            inputBuffer->keyEventsCount == 0) {
+            return NULL;
+        }
+        android_app->currentInputBuffer =
+            (android_app->currentInputBuffer + 1) %
+            NATIVE_APP_GLUE_MAX_INPUT_BUFFERS;
+        coalesce_motion_events(android_app, inputBuffer);
+        return inputBuffer;
+    }
+
     pthread_mutex_lock(&android_app->mutex);
 
     struct android_input_buffer* inputBuffer =
@@ -528,23 +754,46 @@ struct android_input_buffer* android_app_swap_input_buffers(
 
     pthread_mutex_unlock(&android_app->mutex);
 
+    if (inputBuffer != NULL) coalesce_motion_events(android_app, inputBuffer);
     return inputBuffer;
 }
 
 void android_app_clear_motion_events(struct android_input_buffer* inputBuffer) {
+    for (uint64_t i = 0; i < inputBuffer->motionEventsCount; ++i) {
+        GameActivityMotionEvent_destroy(&inputBuffer->motionEvents[i]);
+    }
     inputBuffer->motionEventsCount = 0;
 }
 
+void android_app_set_motion_event_coalescing(struct android_app* app,
+                                             bool enabled) {
+    app->coalesceMotionEvents = enabled;
+}
+
+void android_app_set_motion_event_resample_time(struct android_app* app,
+                                                int64_t resampleTimeNanos) {
+    app->motionEventResampleTimeNanos = resampleTimeNanos;
+}
+
 void android_app_set_key_event_filter(struct android_app* app,
                                       android_key_event_filter filter) {
     pthread_mutex_lock(&app->mutex);
-    app->keyEventFilter = filter;
+    // Also read without the mutex when the input ring is enabled.
+    __atomic_store_n(&app->keyEventFilter, filter, __ATOMIC_RELAXED);
     pthread_mutex_unlock(&app->mutex);
 }
 
 static bool onKey(GameActivity* activity, const GameActivityKeyEvent* event) {
     struct android_app* android_app = ToApp(activity);
+    struct android_input_ring* ring = android_app_get_input_ring(android_app);
+    if (ring != NULL) return queue_key_event(android_app, ring, event);
+
     pthread_mutex_lock(&android_app->mutex);
+    if (android_app->inputRing != NULL) {
+        // The ring was enabled since the check above.
+        pthread_mutex_unlock(&android_app->mutex);
+        return queue_key_event(android_app, android_app->inputRing, event);
+    }
 
     if (android_app->keyEventFilter != NULL &&
         !android_app->keyEventFilter(event)) {
@@ -103,6 +103,8 @@ struct android_poll_source {
                     struct android_poll_source* source);
 };
 
+struct android_input_ring;
+
 struct android_input_buffer {
     /**
      * Pointer to a read-only array of GameActivityMotionEvent.
@@ -263,6 +265,11 @@ struct android_app {
     android_key_event_filter keyEventFilter;
     android_motion_event_filter motionEventFilter;
 
+    struct android_input_ring* inputRing;
+
+    bool coalesceMotionEvents;
+    int64_t motionEventResampleTimeNanos;
+
     /** @endcond */
 };
 
@@ -431,7 +438,7 @@ struct android_input_buffer* android_app_swap_input_buffers(
 
 /**
  * Clear the array of motion events that were waiting to be handled, and release
- * each of them.
+ * each of them, including their history.
  *
  * This method should be called after you have processed the motion events in
  * your game loop. You should handle events at each iteration of your game loop.
@@ -475,6 +482,94 @@ void android_app_set_key_event_filter(struct android_app* app,
 void android_app_set_motion_event_filter(struct android_app* app,
                                          android_motion_event_filter filter);
 
+/**
+ * Merge consecutive ACTION_MOVE events for the same pointers into a single
+ * event when android_app_swap_input_buffers() is called, so that the game
+ * gets at most one move per frame for each set of pointers rather than one
+ * per input sample. The samples of the merged events are kept in the history
+ * of the resulting event. See GameActivityMotionEvent_coalesceMoves().
+ *
+ * Coalescing is disabled by default. This must be called on the app thread.
+ */
+void android_app_set_motion_event_coalescing(struct android_app* app,
+                                             bool enabled);
+
+/**
+ * When motion event coalescing is enabled, resample the pointer positions of
+ * the latest move from each device to this time, usually the time at which
+ * the next frame is expected to be presented, from the event history. Pass 0
+ * to not resample, which is the default. The time uses the same clock as
+ * `GameActivityMotionEvent::eventTime` (CLOCK_MONOTONIC), in nanoseconds.
+ *
+ * This must be called on the app thread, before
+ * android_app_swap_input_buffers().
+ */
+void android_app_set_motion_event_resample_time(struct android_app* app,
+                                                int64_t resampleTimeNanos);
+
+/**
+ * What to do with a new input event when the input ring is full.
+ * See android_app_enable_input_ring().
+ */
+enum NativeAppGlueInputOverflowPolicy {
+    /**
+     * Discard the oldest event that hasn't been read by the app thread.
+     */
+    NATIVE_APP_GLUE_INPUT_OVERFLOW_DROP_OLDEST,
+
+    /**
+     * If the new event and the newest unread event are both ACTION_MOVE
+     * events from the same device and source, for the same pointers, replace
+     * the unread event with the new one. Otherwise discard the oldest unread
+     * event, as for NATIVE_APP_GLUE_INPUT_OVERFLOW_DROP_OLDEST.
+     *
+     * Key events are always handled as for
+     * NATIVE_APP_GLUE_INPUT_OVERFLOW_DROP_OLDEST.
+     */
+    NATIVE_APP_GLUE_INPUT_OVERFLOW_COALESCE_MOVES,
+};
+
+/**
+ * Counters for events that didn't fit in the input ring.
+ */
+struct android_input_ring_stats {
+    /** Motion events discarded because the ring was full. */
+    uint64_t motionEventsDropped;
+
+    /** Motion events that replaced an unread ACTION_MOVE event. */
+    uint64_t motionEventsCoalesced;
+
+    /** Key events discarded because the ring was full. */
+    uint64_t keyEventsDropped;
+};
+
+/**
+ * Queue input events in lock-free rings of fixed-size slots, rather than in
+ * the input buffers.
+ *
+ * By default, the main thread takes `android_app->mutex` for each input event
+ * and grows the current input buffer as needed, so it can be held up by the
+ * app thread swapping the buffers. With the input ring enabled, the main
+ * thread only ever copies events into preallocated slots, and
+ * android_app_swap_input_buffers() moves them from the rings into the input
+ * buffers on the app thread. When a ring is full, new events are handled as
+ * given by `policy`.
+ *
+ * Capacities are rounded up to a power of 2. This must be called on the app
+ * thread, and once only: the rings can't be resized or disabled.
+ * Returns false if the rings couldn't be allocated or are already enabled.
+ */
+bool android_app_enable_input_ring(
+    struct android_app* app, uint32_t motionEventCapacity,
+    uint32_t keyEventCapacity, enum NativeAppGlueInputOverflowPolicy policy);
+
+/**
+ * Get the counts of events dropped or coalesced by the input ring since it was
+ * enabled. All counts are 0 if the input ring isn't enabled.
+ */
+void android_app_get_input_ring_stats(struct android_app* app,
+                                      struct android_input_ring_stats* stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -56,6 +56,8 @@ import com.google.androidgamesdk.gametextinput.Settings;
 import com.google.androidgamesdk.gametextinput.State;
 import dalvik.system.BaseDexClassLoader;
 import java.io.File;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 
 public class GameActivity
     extends AppCompatActivity
@@ -86,15 +88,92 @@ public class GameActivity
    */
   protected InputEnabledSurfaceView mSurfaceView;
 
+  // Offsets into a packed motion event: see GameActivityPackedMotionEventLayout in
+  // GameActivityEvents.h.
+  private static final int PACKED_POINTER_COUNT = 0;
+  private static final int PACKED_HISTORY_SIZE = 4;
+  private static final int PACKED_DEVICE_ID = 8;
+  private static final int PACKED_SOURCE = 12;
+  private static final int PACKED_ACTION = 16;
+  private static final int PACKED_FLAGS = 20;
+  private static final int PACKED_META_STATE = 24;
+  private static final int PACKED_ACTION_BUTTON = 28;
+  private static final int PACKED_BUTTON_STATE = 32;
+  private static final int PACKED_CLASSIFICATION = 36;
+  private static final int PACKED_EDGE_FLAGS = 40;
+  private static final int PACKED_PRECISION_X = 44;
+  private static final int PACKED_PRECISION_Y = 48;
+  private static final int PACKED_EVENT_TIME = 56;
+  private static final int PACKED_DOWN_TIME = 64;
+  private static final int PACKED_AXES_MASK = 72;
+  private static final int PACKED_HEADER_SIZE = 80;
+
+  // The mask of axes enabled on the native side, shared with it.
+  private ByteBuffer mEnabledAxes;
+  // Reused for each motion event and grown as needed.
+  private ByteBuffer mPackedMotionEvent;
+
   protected boolean processMotionEvent(MotionEvent event) {
-      int action = (Build.VERSION.SDK_INT >= Build.VERSION_CODES.M) ? event.getActionButton() : 0;
-      int cls = (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) ? event.getClassification() : 0;
+      if (mEnabledAxes == null) {
+          mEnabledAxes = getEnabledAxesNative().order(ByteOrder.nativeOrder());
+      }
+      long axesMask = mEnabledAxes.getLong(0);
+      int axisCount = Long.bitCount(axesMask);
+      int pointerCount = event.getPointerCount();
+      int historySize = event.getHistorySize();
+      int size = PACKED_HEADER_SIZE + historySize * 8 + pointerCount * (16 + axisCount * 4)
+          + historySize * pointerCount * axisCount * 4;
+      if (mPackedMotionEvent == null || mPackedMotionEvent.capacity() < size) {
+          int capacity = mPackedMotionEvent == null ? 0 : mPackedMotionEvent.capacity();
+          mPackedMotionEvent = ByteBuffer.allocateDirect(Math.max(size, capacity * 2))
+              .order(ByteOrder.nativeOrder());
+      }
+      ByteBuffer b = mPackedMotionEvent;
+
+      b.putInt(PACKED_POINTER_COUNT, pointerCount);
+      b.putInt(PACKED_HISTORY_SIZE, historySize);
+      b.putInt(PACKED_DEVICE_ID, event.getDeviceId());
+      b.putInt(PACKED_SOURCE, event.getSource());
+      b.putInt(PACKED_ACTION, event.getAction());
+      b.putInt(PACKED_FLAGS, event.getFlags());
+      b.putInt(PACKED_META_STATE, event.getMetaState());
+      b.putInt(PACKED_ACTION_BUTTON,
+          (Build.VERSION.SDK_INT >= Build.VERSION_CODES.M) ? event.getActionButton() : 0);
+      b.putInt(PACKED_BUTTON_STATE, event.getButtonState());
+      b.putInt(PACKED_CLASSIFICATION,
+          (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) ? event.getClassification() : 0);
+      b.putInt(PACKED_EDGE_FLAGS, event.getEdgeFlags());
+      b.putFloat(PACKED_PRECISION_X, event.getXPrecision());
+      b.putFloat(PACKED_PRECISION_Y, event.getYPrecision());
+      b.putLong(PACKED_EVENT_TIME, event.getEventTime());
+      b.putLong(PACKED_DOWN_TIME, event.getDownTime());
+      b.putLong(PACKED_AXES_MASK, axesMask);
+
+      int pos = PACKED_HEADER_SIZE;
+      for (int h = 0; h < historySize; ++h, pos += 8) {
+          b.putLong(pos, event.getHistoricalEventTime(h));
+      }
+      boolean hasRaw = Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q;
+      for (int p = 0; p < pointerCount; ++p) {
+          b.putInt(pos, event.getPointerId(p));
+          b.putInt(pos + 4, event.getToolType(p));
+          b.putFloat(pos + 8, hasRaw ? event.getRawX(p) : 0);
+          b.putFloat(pos + 12, hasRaw ? event.getRawY(p) : 0);
+          pos += 16;
+          for (long bits = axesMask; bits != 0; bits &= bits - 1, pos += 4) {
+              b.putFloat(pos, event.getAxisValue(Long.numberOfTrailingZeros(bits), p));
+          }
+      }
+      for (int h = 0; h < historySize; ++h) {
+          for (int p = 0; p < pointerCount; ++p) {
+              for (long bits = axesMask; bits != 0; bits &= bits - 1, pos += 4) {
+                  b.putFloat(pos,
+                      event.getHistoricalAxisValue(Long.numberOfTrailingZeros(bits), p, h));
+              }
+          }
+      }
 
-      return onTouchEventNative(mNativeHandle, event, event.getPointerCount(),
-          event.getHistorySize(), event.getDeviceId(), event.getSource(), event.getAction(),
-          event.getEventTime(), event.getDownTime(), event.getFlags(), event.getMetaState(), action,
-          event.getButtonState(), cls, event.getEdgeFlags(), event.getXPrecision(),
-          event.getYPrecision());
+      return onTouchEventBufferNative(mNativeHandle, b, size);
   }
 
   @Override
@@ -220,6 +299,10 @@ public class GameActivity
       long downTime, int flags, int metaState, int actionButton, int buttonState,
       int classification, int edgeFlags, float precisionX, float precisionY);
 
+  protected native boolean onTouchEventBufferNative(long handle, ByteBuffer packedEvent, int size);
+
+  protected native ByteBuffer getEnabledAxesNative();
+
   protected native boolean onKeyDownNative(long handle, KeyEvent keyEvent);
 
   protected native boolean onKeyUpNative(long handle, KeyEvent keyEvent);
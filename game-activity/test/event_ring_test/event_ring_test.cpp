@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "test_event_ring.h"
+
+namespace event_ring_test {
+
+class EventRingTest : public ::testing::Test {
+   protected:
+    void TearDown() override {
+        if (ring_ != nullptr) test_event_ring_destroy(ring_);
+    }
+    void Create(uint32_t capacity) {
+        ring_ = test_event_ring_create(capacity);
+        ASSERT_NE(ring_, nullptr);
+    }
+    bool Push(int32_t id, int32_t group = 0) {
+        TestEvent event = {id, group};
+        return test_event_ring_push(ring_, &event);
+    }
+    bool ReplaceNewest(int32_t id, int32_t group = 0) {
+        TestEvent event = {id, group};
+        return test_event_ring_replace_newest(ring_, &event);
+    }
+    // Pops all the events and returns their ids.
+    std::vector<int32_t> PopAll() {
+        std::vector<int32_t> ids;
+        TestEvent event;
+        while (test_event_ring_pop(ring_, &event)) ids.push_back(event.id);
+        return ids;
+    }
+
+    android_event_ring* ring_ = nullptr;
+};
+
+TEST_F(EventRingTest, PopsEventsInOrder) {
+    Create(4);
+    TestEvent event;
+    EXPECT_FALSE(test_event_ring_pop(ring_, &event));
+    EXPECT_TRUE(Push(1));
+    EXPECT_TRUE(Push(2));
+    EXPECT_TRUE(Push(3));
+    EXPECT_EQ(PopAll(), (std::vector<int32_t>{1, 2, 3}));
+    EXPECT_EQ(PopAll(), std::vector<int32_t>{});
+    EXPECT_EQ(test_event_ring_discarded(), 0u);
+}
+
+TEST_F(EventRingTest, RoundsCapacityUpToAPowerOf2) {
+    Create(3);
+    for (int32_t id = 0; id < 4; ++id) EXPECT_TRUE(Push(id));
+    EXPECT_TRUE(test_event_ring_full(ring_));
+    EXPECT_EQ(PopAll(), (std::vector<int32_t>{0, 1, 2, 3}));
+    EXPECT_FALSE(test_event_ring_full(ring_));
+}
+
+TEST_F(EventRingTest, FullRingDropsOldest) {
+    Create(4);
+    for (int32_t id = 0; id < 4; ++id) EXPECT_TRUE(Push(id));
+    EXPECT_FALSE(Push(4));
+    EXPECT_FALSE(Push(5));
+    EXPECT_EQ(test_event_ring_discarded(), 2u);
+    EXPECT_EQ(PopAll(), (std::vector<int32_t>{2, 3, 4, 5}));
+
+    // Once some events have been read, only the unread ones are dropped.
+    for (int32_t id = 6; id < 10; ++id) EXPECT_TRUE(Push(id));
+    TestEvent event;
+    ASSERT_TRUE(test_event_ring_pop(ring_, &event));
+    EXPECT_EQ(event.id, 6);
+    EXPECT_TRUE(Push(10));
+    EXPECT_FALSE(Push(11));
+    EXPECT_EQ(test_event_ring_discarded(), 3u);
+    EXPECT_EQ(PopAll(), (std::vector<int32_t>{8, 9, 10, 11}));
+}
+
+TEST_F(EventRingTest, DropsMoreThanACapacityOfEvents) {
+    Create(4);
+    for (int32_t id = 0; id < 11; ++id) Push(id);
+    EXPECT_EQ(test_event_ring_discarded(), 7u);
+    EXPECT_EQ(PopAll(), (std::vector<int32_t>{7, 8, 9, 10}));
+}
+
+TEST_F(EventRingTest, ReplacesTheNewestUnreadEvent) {
+    Create(4);
+    EXPECT_FALSE(ReplaceNewest(0));
+    EXPECT_TRUE(Push(0, 1));
+    EXPECT_TRUE(Push(1, 2));
+    EXPECT_TRUE(ReplaceNewest(2, 2));
+    EXPECT_TRUE(ReplaceNewest(3, 2));
+    // Only the newest event can be replaced.
+    EXPECT_FALSE(ReplaceNewest(4, 1));
+    EXPECT_EQ(test_event_ring_discarded(), 2u);
+    EXPECT_EQ(PopAll(), (std::vector<int32_t>{0, 3}));
+
+    // The newest event has been read.
+    EXPECT_FALSE(ReplaceNewest(5, 2));
+    EXPECT_EQ(PopAll(), std::vector<int32_t>{});
+}
+
+TEST_F(EventRingTest, ReplacesInAFullRing) {
+    Create(2);
+    EXPECT_TRUE(Push(0, 1));
+    EXPECT_TRUE(Push(1, 1));
+    EXPECT_TRUE(test_event_ring_full(ring_));
+    EXPECT_TRUE(ReplaceNewest(2, 1));
+    EXPECT_TRUE(test_event_ring_full(ring_));
+    EXPECT_EQ(test_event_ring_discarded(), 1u);
+    EXPECT_EQ(PopAll(), (std::vector<int32_t>{0, 2}));
+}
+
+TEST_F(EventRingTest, WrapsAround) {
+    Create(4);
+    int32_t next = 0;
+    for (int round = 0; round < 100; ++round) {
+        // Leave the read and write positions at a different slot each round.
+        std::vector<int32_t> expected;
+        for (int i = 0; i < 1 + round % 4; ++i) {
+            expected.push_back(next);
+            EXPECT_TRUE(Push(next++));
+        }
+        ASSERT_EQ(PopAll(), expected) << "round " << round;
+    }
+    // Drop and replace across the end of the buffer.
+    for (int32_t id = 0; id < 6; ++id) Push(next + id, id);
+    EXPECT_TRUE(ReplaceNewest(next + 6, 5));
+    EXPECT_EQ(PopAll(),
+              (std::vector<int32_t>{next + 2, next + 3, next + 4, next + 6}));
+    EXPECT_EQ(test_event_ring_discarded(), 3u);
+}
+
+// One thread pushes while another pops, as the main and app threads do.
+TEST_F(EventRingTest, ConcurrentProducerAndConsumer) {
+    constexpr int32_t kNumEvents = 200000;
+    Create(8);
+    std::atomic<bool> done(false);
+    uint64_t dropped = 0;
+    uint64_t replaced = 0;
+    std::thread producer([&] {
+        for (int32_t id = 0; id < kNumEvents; ++id) {
+            // Runs of 4 events can replace each other.
+            int32_t group = id / 4;
+            if (id % 2 == 1 && ReplaceNewest(id, group)) {
+                ++replaced;
+            } else if (!Push(id, group)) {
+                ++dropped;
+            }
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    std::vector<int32_t> ids;
+    TestEvent event;
+    for (;;) {
+        bool finished = done.load(std::memory_order_acquire);
+        while (test_event_ring_pop(ring_, &event)) ids.push_back(event.id);
+        if (finished) break;
+        std::this_thread::yield();
+    }
+    producer.join();
+
+    ASSERT_FALSE(ids.empty());
+    for (size_t i = 1; i < ids.size(); ++i) {
+        ASSERT_LT(ids[i - 1], ids[i]) << "at " << i;
+    }
+    EXPECT_EQ(ids.back(), kNumEvents - 1);
+    // Every event was either read, dropped or replaced.
+    EXPECT_EQ(test_event_ring_discarded(), dropped + replaced);
+    EXPECT_EQ(ids.size() + dropped + replaced,
+              static_cast<uint64_t>(kNumEvents));
+}
+
+}  // namespace event_ring_test
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "test_event_ring.h"
+
+#include "game-activity/native_app_glue/android_event_ring.h"
+
+// Only changed on the thread that pushes events.
+static uint64_t discarded = 0;
+
+static void count_discarded(void* event) {
+    (void)event;
+    ++discarded;
+}
+
+static bool same_group(const void* newest, const void* event) {
+    return ((const struct TestEvent*)newest)->group ==
+           ((const struct TestEvent*)event)->group;
+}
+
+struct android_event_ring* test_event_ring_create(uint32_t capacity) {
+    struct android_event_ring* ring =
+        (struct android_event_ring*)malloc(sizeof(struct android_event_ring));
+    if (ring == NULL) return NULL;
+    if (!event_ring_init(ring, capacity, sizeof(struct TestEvent))) {
+        free(ring);
+        return NULL;
+    }
+    ring->discard = count_discarded;
+    discarded = 0;
+    return ring;
+}
+
+void test_event_ring_destroy(struct android_event_ring* ring) {
+    event_ring_free(ring);
+    free(ring);
+}
+
+bool test_event_ring_full(const struct android_event_ring* ring) {
+    return event_ring_full(ring);
+}
+
+bool test_event_ring_push(struct android_event_ring* ring,
+                          const struct TestEvent* event) {
+    return event_ring_push(ring, event);
+}
+
+bool test_event_ring_replace_newest(struct android_event_ring* ring,
+                                    const struct TestEvent* event) {
+    return event_ring_replace_newest(ring, event, same_group);
+}
+
+bool test_event_ring_pop(struct android_event_ring* ring,
+                         struct TestEvent* out) {
+    return event_ring_pop(ring, out);
+}
+
+uint64_t test_event_ring_discarded(void) { return discarded; }
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+// C wrappers around the glue's event ring, which uses C11 atomics and so
+// can't be included from the C++ test directly. The ring holds TestEvents.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct android_event_ring;
+
+struct TestEvent {
+    int32_t id;
+    // Only events with the same group can replace each other.
+    int32_t group;
+};
+
+struct android_event_ring* test_event_ring_create(uint32_t capacity);
+void test_event_ring_destroy(struct android_event_ring* ring);
+bool test_event_ring_full(const struct android_event_ring* ring);
+bool test_event_ring_push(struct android_event_ring* ring,
+                          const struct TestEvent* event);
+bool test_event_ring_replace_newest(struct android_event_ring* ring,
+                                    const struct TestEvent* event);
+bool test_event_ring_pop(struct android_event_ring* ring,
+                         struct TestEvent* out);
+// The number of events that were dropped or replaced since the ring was
+// created.
+uint64_t test_event_ring_discarded(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Logging to stderr in place of the NDK's android/log.h, for host builds
+// only.
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+enum {
+    ANDROID_LOG_VERBOSE = 2,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+};
+
+#define __android_log_print(prio, tag, ...) \
+    (fprintf(stderr, __VA_ARGS__), fprintf(stderr, "\n"))
+#define __android_log_assert(cond, tag, ...) \
+    (fprintf(stderr, __VA_ARGS__), fprintf(stderr, "\n"), abort())
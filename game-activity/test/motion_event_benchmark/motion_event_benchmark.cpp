@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host benchmark for GameActivityMotionEvent_fromPacked. Synthetic events are
+// packed the way GameActivity.processMotionEvent does, decoded, checked and
+// timed. For comparison, the number of JNI calls that
+// GameActivityMotionEvent_fromJava makes for the same event is printed too.
+//
+// Usage: motion_event_benchmark [reps]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "game-activity/GameActivityEvents.h"
+#include "system_utils.h"
+
+namespace gamesdk {
+int GetSystemPropAsInt(const char*, int default_value) {
+    return default_value;
+}
+}  // namespace gamesdk
+
+namespace {
+
+struct EventShape {
+    const char* name;
+    int pointerCount;
+    int historySize;
+    std::vector<int> extraAxes;
+};
+
+// Values are a function of their position so that they can be checked.
+float AxisValue(int history, int pointer, int axis) {
+    return history * 10000.0f + pointer * 100.0f + axis;
+}
+
+template <typename T>
+void Put(std::vector<uint8_t>& buffer, size_t offset, T value) {
+    memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+// Packs an event in the same layout as GameActivity.processMotionEvent.
+std::vector<uint8_t> Pack(const EventShape& shape, uint64_t axesMask) {
+    int axisCount = __builtin_popcountll(axesMask);
+    size_t size = GAME_ACTIVITY_PACKED_MOTION_EVENT_HEADER_SIZE +
+                  shape.historySize * 8 +
+                  shape.pointerCount * (16 + axisCount * 4) +
+                  shape.historySize * shape.pointerCount * axisCount * 4;
+    std::vector<uint8_t> b(size);
+    Put<int32_t>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_POINTER_COUNT,
+                 shape.pointerCount);
+    Put<int32_t>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_HISTORY_SIZE,
+                 shape.historySize);
+    Put<int32_t>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_DEVICE_ID, 3);
+    Put<int32_t>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_SOURCE, 0x1002);
+    Put<int32_t>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_ACTION, 2);
+    Put<int32_t>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_FLAGS, 4);
+    Put<int32_t>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_META_STATE, 5);
+    Put<int32_t>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_ACTION_BUTTON, 6);
+    Put<int32_t>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_BUTTON_STATE, 7);
+    Put<int32_t>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_CLASSIFICATION, 8);
+    Put<int32_t>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_EDGE_FLAGS, 9);
+    Put<float>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_PRECISION_X, 1.5f);
+    Put<float>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_PRECISION_Y, 2.5f);
+    Put<int64_t>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_EVENT_TIME, 123456);
+    Put<int64_t>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_DOWN_TIME, 123000);
+    Put<uint64_t>(b, GAME_ACTIVITY_PACKED_MOTION_EVENT_AXES_MASK, axesMask);
+    size_t pos = GAME_ACTIVITY_PACKED_MOTION_EVENT_HEADER_SIZE;
+    for (int h = 0; h < shape.historySize; ++h, pos += 8) {
+        Put<int64_t>(b, pos, 123000 + h);
+    }
+    for (int p = 0; p < shape.pointerCount; ++p) {
+        Put<int32_t>(b, pos, p + 20);
+        Put<int32_t>(b, pos + 4, 1);
+        Put<float>(b, pos + 8, p * 2.0f);
+        Put<float>(b, pos + 12, p * 3.0f);
+        pos += 16;
+        for (uint64_t bits = axesMask; bits != 0; bits &= bits - 1, pos += 4) {
+            Put<float>(b, pos,
+                       AxisValue(shape.historySize, p, __builtin_ctzll(bits)));
+        }
+    }
+    for (int h = 0; h < shape.historySize; ++h) {
+        for (int p = 0; p < shape.pointerCount; ++p) {
+            for (uint64_t bits = axesMask; bits != 0;
+                 bits &= bits - 1, pos += 4) {
+                Put<float>(b, pos, AxisValue(h, p, __builtin_ctzll(bits)));
+            }
+        }
+    }
+    return b;
+}
+
+bool Check(const EventShape& shape, uint64_t axesMask,
+           const GameActivityMotionEvent& e) {
+    int pointerCount = std::min(shape.pointerCount,
+                                GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT);
+    bool ok = e.deviceId == 3 && e.source == 0x1002 && e.action == 2 &&
+              e.flags == 4 && e.metaState == 5 && e.actionButton == 6 &&
+              e.buttonState == 7 && e.classification == 8 &&
+              e.edgeFlags == 9 && e.precisionX == 1.5f &&
+              e.precisionY == 2.5f && e.eventTime == 123456 &&
+              e.downTime == 123000 && (int)e.pointerCount == pointerCount &&
+              e.historySize == shape.historySize;
+    for (int p = 0; ok && p < pointerCount; ++p) {
+        const GameActivityPointerAxes& pointer = e.pointers[p];
+        ok = pointer.id == p + 20 && pointer.toolType == 1 &&
+             pointer.rawX == p * 2.0f && pointer.rawY == p * 3.0f;
+        for (int a = 0; ok && a < GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT; ++a) {
+            float expected = (axesMask & (1ull << a))
+                                 ? AxisValue(shape.historySize, p, a)
+                                 : 0;
+            ok = pointer.axisValues[a] == expected;
+        }
+    }
+    for (int h = 0; ok && h < shape.historySize; ++h) {
+        ok = e.historicalEventTimesMillis[h] == 123000 + h &&
+             e.historicalEventTimesNanos[h] == (123000 + h) * 1000000L;
+        for (int p = 0; ok && p < pointerCount; ++p) {
+            const float* values =
+                &e.historicalAxisValues[(h * pointerCount + p) *
+                                        GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT];
+            for (uint64_t bits = axesMask; ok && bits != 0; bits &= bits - 1) {
+                int a = __builtin_ctzll(bits);
+                ok = values[a] == AxisValue(h, p, a);
+            }
+        }
+    }
+    return ok;
+}
+
+// The number of JNI calls GameActivityMotionEvent_fromJava makes for an
+// event, with the raw X/Y getters available.
+int JniCallsFromJava(const EventShape& shape, int axisCount) {
+    int pointerCount = std::min(shape.pointerCount,
+                                GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT);
+    return pointerCount * (4 + axisCount) +
+           shape.historySize * (1 + pointerCount * axisCount);
+}
+
+bool Run(const EventShape& shape, int reps) {
+    uint64_t axesMask =
+        (1ull << AMOTION_EVENT_AXIS_X) | (1ull << AMOTION_EVENT_AXIS_Y);
+    for (int axis : shape.extraAxes) axesMask |= 1ull << axis;
+    std::vector<uint8_t> packed = Pack(shape, axesMask);
+
+    GameActivityMotionEvent event;
+    if (!GameActivityMotionEvent_fromPacked(packed.data(), packed.size(),
+                                            &event) ||
+        !Check(shape, axesMask, event)) {
+        fprintf(stderr, "%s: decoded event doesn't match\n", shape.name);
+        return false;
+    }
+    GameActivityMotionEvent_destroy(&event);
+    if (GameActivityMotionEvent_fromPacked(packed.data(), packed.size() - 1,
+                                           &event)) {
+        fprintf(stderr, "%s: truncated event was accepted\n", shape.name);
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; ++i) {
+        GameActivityMotionEvent_fromPacked(packed.data(), packed.size(),
+                                           &event);
+        GameActivityMotionEvent_destroy(&event);
+    }
+    std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::steady_clock::now() - start;
+    printf("%s: %zu bytes, decode %.3f us, replaces %d JNI calls\n",
+           shape.name, packed.size(), elapsed.count() / reps,
+           JniCallsFromJava(shape, __builtin_popcountll(axesMask)));
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int reps = argc > 1 ? atoi(argv[1]) : 100000;
+    std::vector<EventShape> shapes = {
+        {"1 pointer, X/Y", 1, 0, {}},
+        {"2 pointers, 4 axes, 5 history", 2, 5, {2, 3}},
+        {"8 pointers, 6 axes, 20 history", 8, 20, {2, 3, 4, 5}},
+        {"10 pointers, 6 axes, 20 history", 10, 20, {2, 3, 4, 5}},
+    };
+    bool ok = true;
+    for (const auto& shape : shapes) ok = Run(shape, reps) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <vector>
+
+#include "game-activity/GameActivityEvents.h"
+
+namespace gamesdk {
+int GetSystemPropAsInt(const char*, int default_value) {
+    return default_value;
+}
+}  // namespace gamesdk
+
+namespace coalesce_test {
+
+constexpr int32_t kTouchscreen = 0x1002;
+constexpr int64_t kMillis = 1000000;
+
+// A sample of a synthetic event: pointer i is at (x + 100 * i, 2 * x) at
+// timeMillis.
+struct Sample {
+    int64_t timeMillis;
+    float x;
+};
+
+float PointerX(float x, int pointerIndex) { return x + 100 * pointerIndex; }
+float PointerY(float x) { return 2 * x; }
+
+// Makes an event that owns its history, like GameActivityMotionEvent_copy
+// does. samples holds the history, oldest first, then the current values.
+GameActivityMotionEvent MakeEvent(int32_t action,
+                                  const std::vector<int32_t>& pointerIds,
+                                  const std::vector<Sample>& samples,
+                                  int32_t deviceId = 1) {
+    GameActivityMotionEvent event;
+    memset(&event, 0, sizeof(event));
+    event.deviceId = deviceId;
+    event.source = kTouchscreen;
+    event.action = action;
+    event.pointerCount = pointerIds.size();
+    const Sample& current = samples.back();
+    event.eventTime = current.timeMillis;
+    for (size_t p = 0; p < pointerIds.size(); ++p) {
+        GameActivityPointerAxes& pointer = event.pointers[p];
+        pointer.id = pointerIds[p];
+        pointer.axisValues[AMOTION_EVENT_AXIS_X] = PointerX(current.x, p);
+        pointer.axisValues[AMOTION_EVENT_AXIS_Y] = PointerY(current.x);
+        pointer.rawX = pointer.axisValues[AMOTION_EVENT_AXIS_X] + 1000;
+        pointer.rawY = pointer.axisValues[AMOTION_EVENT_AXIS_Y] + 1000;
+    }
+    int historySize = samples.size() - 1;
+    int pointerValueCount =
+        pointerIds.size() * GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+    event.historySize = historySize;
+    event.historicalEventTimesMillis = new long[historySize];
+    event.historicalEventTimesNanos = new long[historySize];
+    event.historicalAxisValues = new float[historySize * pointerValueCount]();
+    for (int h = 0; h < historySize; ++h) {
+        event.historicalEventTimesMillis[h] = samples[h].timeMillis;
+        event.historicalEventTimesNanos[h] = samples[h].timeMillis * kMillis;
+        float* entry = &event.historicalAxisValues[h * pointerValueCount];
+        for (size_t p = 0; p < pointerIds.size(); ++p) {
+            float* values = &entry[p * GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT];
+            values[AMOTION_EVENT_AXIS_X] = PointerX(samples[h].x, p);
+            values[AMOTION_EVENT_AXIS_Y] = PointerY(samples[h].x);
+        }
+    }
+    return event;
+}
+
+GameActivityMotionEvent MakeMove(const std::vector<Sample>& samples,
+                                 int32_t deviceId = 1) {
+    return MakeEvent(AMOTION_EVENT_ACTION_MOVE, {0}, samples, deviceId);
+}
+
+float HistoricalX(const GameActivityMotionEvent& event, int h,
+                  int pointerIndex) {
+    return event.historicalAxisValues
+        [(h * event.pointerCount + pointerIndex) *
+             GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT +
+         AMOTION_EVENT_AXIS_X];
+}
+
+float CurrentX(const GameActivityMotionEvent& event, int pointerIndex = 0) {
+    return event.pointers[pointerIndex].axisValues[AMOTION_EVENT_AXIS_X];
+}
+
+class CoalesceTest : public ::testing::Test {
+   protected:
+    void TearDown() override {
+        for (int i = 0; i < count_; ++i) {
+            GameActivityMotionEvent_destroy(&events_[i]);
+        }
+    }
+    int Coalesce(int64_t resampleTimeNanos = 0) {
+        count_ = GameActivityMotionEvent_coalesceMoves(
+            events_.data(), events_.size(), resampleTimeNanos);
+        return count_;
+    }
+
+    std::vector<GameActivityMotionEvent> events_;
+    int count_ = 0;
+};
+
+TEST_F(CoalesceTest, MergesConsecutiveMoves) {
+    events_.push_back(MakeEvent(AMOTION_EVENT_ACTION_DOWN, {0}, {{7, 0}}));
+    events_.push_back(MakeMove({{8, 1}, {9, 2}, {10, 3}}));
+    events_.push_back(MakeMove({{11, 4}, {12, 5}}));
+    events_.push_back(MakeMove({{13, 6}}));
+    ASSERT_EQ(Coalesce(), 2);
+
+    EXPECT_EQ(events_[0].action, AMOTION_EVENT_ACTION_DOWN);
+    const GameActivityMotionEvent& move = events_[1];
+    EXPECT_EQ(move.eventTime, 13);
+    EXPECT_EQ(CurrentX(move), 6);
+    ASSERT_EQ(move.historySize, 5);
+    for (int h = 0; h < 5; ++h) {
+        EXPECT_EQ(move.historicalEventTimesMillis[h], 8 + h);
+        EXPECT_EQ(move.historicalEventTimesNanos[h], (8 + h) * kMillis);
+        EXPECT_EQ(HistoricalX(move, h, 0), 1 + h);
+    }
+}
+
+TEST_F(CoalesceTest, MergesMultiplePointers) {
+    events_.push_back(MakeEvent(AMOTION_EVENT_ACTION_MOVE, {3, 5}, {{8, 1}}));
+    events_.push_back(
+        MakeEvent(AMOTION_EVENT_ACTION_MOVE, {3, 5}, {{9, 2}, {10, 3}}));
+    ASSERT_EQ(Coalesce(), 1);
+
+    const GameActivityMotionEvent& move = events_[0];
+    ASSERT_EQ(move.historySize, 2);
+    for (int h = 0; h < 2; ++h) {
+        EXPECT_EQ(HistoricalX(move, h, 0), PointerX(1 + h, 0));
+        EXPECT_EQ(HistoricalX(move, h, 1), PointerX(1 + h, 1));
+    }
+    EXPECT_EQ(CurrentX(move, 1), PointerX(3, 1));
+}
+
+TEST_F(CoalesceTest, KeepsMovesForDifferentPointersOrDevices) {
+    events_.push_back(MakeMove({{8, 1}}));
+    // Another pointer went down in between.
+    int32_t pointerDown = AMOTION_EVENT_ACTION_POINTER_DOWN |
+                          (1 << AMOTION_EVENT_ACTION_POINTER_INDEX_SHIFT);
+    events_.push_back(MakeEvent(pointerDown, {0, 1}, {{9, 2}}));
+    events_.push_back(MakeEvent(AMOTION_EVENT_ACTION_MOVE, {0, 1}, {{10, 3}}));
+    events_.push_back(MakeEvent(AMOTION_EVENT_ACTION_MOVE, {1, 0}, {{11, 4}}));
+    events_.push_back(MakeMove({{12, 5}}, 2));
+    events_.push_back(MakeMove({{13, 6}}, 1));
+    ASSERT_EQ(Coalesce(), 6);
+    for (int i = 0; i < 6; ++i) EXPECT_EQ(events_[i].historySize, 0);
+}
+
+TEST_F(CoalesceTest, InterpolatesBetweenSamples) {
+    events_.push_back(MakeMove({{10, 0}, {14, 4}}));
+    events_.push_back(MakeMove({{18, 8}}));
+    ASSERT_EQ(Coalesce(12 * kMillis), 1);
+
+    const GameActivityMotionEvent& move = events_[0];
+    EXPECT_EQ(move.eventTime, 12);
+    EXPECT_FLOAT_EQ(CurrentX(move), 2);
+    EXPECT_FLOAT_EQ(move.pointers[0].axisValues[AMOTION_EVENT_AXIS_Y], 4);
+    EXPECT_FLOAT_EQ(move.pointers[0].rawX, 1002);
+    EXPECT_FLOAT_EQ(move.pointers[0].rawY, 1004);
+    // The history is left as it is.
+    ASSERT_EQ(move.historySize, 2);
+    EXPECT_EQ(HistoricalX(move, 1, 0), 4);
+}
+
+TEST_F(CoalesceTest, ExtrapolatesHalfTheSampleInterval) {
+    events_.push_back(MakeMove({{10, 0}, {14, 40}}));
+    ASSERT_EQ(Coalesce(100 * kMillis), 1);
+    EXPECT_EQ(events_[0].eventTime, 16);
+    EXPECT_FLOAT_EQ(CurrentX(events_[0]), 60);
+    EXPECT_FLOAT_EQ(events_[0].pointers[0].rawX, 1060);
+}
+
+TEST_F(CoalesceTest, ExtrapolatesAtMost8ms) {
+    events_.push_back(MakeMove({{0, 0}, {20, 20}}));
+    ASSERT_EQ(Coalesce(100 * kMillis), 1);
+    EXPECT_EQ(events_[0].eventTime, 28);
+    EXPECT_FLOAT_EQ(CurrentX(events_[0]), 28);
+}
+
+TEST_F(CoalesceTest, ExtrapolatesToTimesBeforeTheLimit) {
+    events_.push_back(MakeMove({{0, 0}, {20, 20}}));
+    ASSERT_EQ(Coalesce(23 * kMillis), 1);
+    EXPECT_EQ(events_[0].eventTime, 23);
+    EXPECT_FLOAT_EQ(CurrentX(events_[0]), 23);
+}
+
+TEST_F(CoalesceTest, DoesNotExtrapolateFromCloseSamples) {
+    events_.push_back(MakeMove({{10, 0}, {11, 40}}));
+    ASSERT_EQ(Coalesce(12 * kMillis), 1);
+    EXPECT_EQ(events_[0].eventTime, 11);
+    EXPECT_FLOAT_EQ(CurrentX(events_[0]), 40);
+}
+
+TEST_F(CoalesceTest, DoesNotResampleBeforeFirstSample) {
+    events_.push_back(MakeMove({{10, 0}, {14, 40}}));
+    ASSERT_EQ(Coalesce(5 * kMillis), 1);
+    EXPECT_EQ(events_[0].eventTime, 14);
+    EXPECT_FLOAT_EQ(CurrentX(events_[0]), 40);
+}
+
+TEST_F(CoalesceTest, DoesNotResampleWithoutHistory) {
+    events_.push_back(MakeMove({{10, 5}}));
+    ASSERT_EQ(Coalesce(12 * kMillis), 1);
+    EXPECT_EQ(events_[0].eventTime, 10);
+    EXPECT_FLOAT_EQ(CurrentX(events_[0]), 5);
+}
+
+TEST_F(CoalesceTest, ResamplesOnlyTheLatestMovePerDevice) {
+    events_.push_back(MakeMove({{10, 0}, {14, 4}}, 1));
+    events_.push_back(MakeEvent(AMOTION_EVENT_ACTION_UP, {0}, {{15, 5}}, 1));
+    events_.push_back(MakeMove({{10, 0}, {14, 4}}, 2));
+    events_.push_back(MakeMove({{10, 0}, {14, 4}}, 3));
+    events_.push_back(MakeEvent(AMOTION_EVENT_ACTION_DOWN, {0}, {{15, 5}}, 4));
+    ASSERT_EQ(Coalesce(12 * kMillis), 5);
+    // Device 1 has lifted its pointer since the move.
+    EXPECT_FLOAT_EQ(CurrentX(events_[0]), 4);
+    EXPECT_FLOAT_EQ(CurrentX(events_[1]), 5);
+    EXPECT_FLOAT_EQ(CurrentX(events_[2]), 2);
+    EXPECT_FLOAT_EQ(CurrentX(events_[3]), 2);
+    EXPECT_FLOAT_EQ(CurrentX(events_[4]), 5);
+}
+
+TEST(CopyTest, CopiesHistory) {
+    GameActivityMotionEvent event = MakeEvent(
+        AMOTION_EVENT_ACTION_MOVE, {0, 1}, {{8, 1}, {9, 2}, {10, 3}});
+    GameActivityMotionEvent copy;
+    GameActivityMotionEvent_copy(&event, &copy);
+    EXPECT_NE(copy.historicalAxisValues, event.historicalAxisValues);
+    EXPECT_NE(copy.historicalEventTimesNanos, event.historicalEventTimesNanos);
+    ASSERT_EQ(copy.historySize, 2);
+    for (int h = 0; h < 2; ++h) {
+        EXPECT_EQ(copy.historicalEventTimesMillis[h], 8 + h);
+        EXPECT_EQ(copy.historicalEventTimesNanos[h], (8 + h) * kMillis);
+        EXPECT_EQ(HistoricalX(copy, h, 1), PointerX(1 + h, 1));
+    }
+    EXPECT_EQ(CurrentX(copy, 1), PointerX(3, 1));
+    GameActivityMotionEvent_destroy(&event);
+    GameActivityMotionEvent_destroy(&copy);
+}
+
+}  // namespace coalesce_test
@@ -18,7 +18,9 @@
 
 #define LOG_TAG "ChoreographerFilter"
 
+#include <errno.h>
 #include <sched.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <deque>
@@ -113,13 +115,15 @@ namespace swappy {
 ChoreographerFilter::ChoreographerFilter(std::chrono::nanoseconds refreshPeriod,
                                          std::chrono::nanoseconds appToSfDelay,
                                          Worker doWork)
-    : mRefreshPeriod(refreshPeriod),
+    : mVsyncPredictor(refreshPeriod),
+      mRefreshPeriod(refreshPeriod),
       mAppToSfDelay(appToSfDelay),
       mDoWork(doWork) {
     Settings::getInstance()->addListener([this]() { onSettingsChanged(); });
 
     std::lock_guard<std::mutex> lock(mThreadPoolMutex);
     mUseAffinity = Settings::getInstance()->getUseAffinity();
+    mUseSingleThread = Settings::getInstance()->getUseSingleFilterThread();
     launchThreadsLocked();
 }
 
@@ -132,6 +136,9 @@ void ChoreographerFilter::onChoreographer() {
     std::lock_guard<std::mutex> lock(mMutex);
     mLastTimestamp = std::chrono::steady_clock::now();
     ++mSequenceNumber;
+    if (mPredictVsync) {
+        mVsyncPredictor.addTimestamp(mLastTimestamp);
+    }
     mCondition.notify_all();
 }
 
@@ -139,6 +146,14 @@ void ChoreographerFilter::launchThreadsLocked() {
     {
         std::lock_guard<std::mutex> lock(mMutex);
         mIsRunning = true;
+        mPredictVsync = mUseSingleThread;
+        mVsyncPredictor.setNominalPeriod(mRefreshPeriod);
+    }
+
+    if (mUseSingleThread) {
+        mThreadPool.push_back(
+            Thread([this]() { singleThreadMain(mUseAffinity); }));
+        return;
     }
 
     const int32_t numThreads = getNumCpus() > 2 ? 2 : 1;
@@ -163,16 +178,33 @@ void ChoreographerFilter::terminateThreadsLocked() {
 
 void ChoreographerFilter::onSettingsChanged() {
     const bool useAffinity = Settings::getInstance()->getUseAffinity();
+    const bool useSingleThread =
+        Settings::getInstance()->getUseSingleFilterThread();
     const Settings::DisplayTimings& displayTimings =
         Settings::getInstance()->getDisplayTimings();
     std::lock_guard<std::mutex> lock(mThreadPoolMutex);
-    if (useAffinity == mUseAffinity &&
+    if (useAffinity == mUseAffinity && useSingleThread == mUseSingleThread &&
         mRefreshPeriod == displayTimings.refreshPeriod) {
         return;
     }
 
+    if (useAffinity == mUseAffinity && useSingleThread == mUseSingleThread &&
+        mUseSingleThread) {
+        // The single thread reads the timings each time it wakes, so there is
+        // no need to restart it.
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRefreshPeriod = displayTimings.refreshPeriod;
+        mAppToSfDelay = displayTimings.sfOffset - displayTimings.appOffset;
+        mVsyncPredictor.setNominalPeriod(mRefreshPeriod);
+        mCondition.notify_all();
+        SWAPPY_LOGV("onSettingsChanged(): refreshPeriod=%lld",
+                    (long long)displayTimings.refreshPeriod.count());
+        return;
+    }
+
     terminateThreadsLocked();
     mUseAffinity = useAffinity;
+    mUseSingleThread = useSingleThread;
     mRefreshPeriod = displayTimings.refreshPeriod;
     mAppToSfDelay = displayTimings.sfOffset - displayTimings.appOffset;
     SWAPPY_LOGV(
@@ -236,4 +268,69 @@ void ChoreographerFilter::threadMain(bool useAffinity, int32_t thread) {
     }
 }
 
+static void sleepUntil(time_point time) {
+    // steady_clock is CLOCK_MONOTONIC, and an absolute deadline doesn't drift
+    // with the time spent setting up the sleep or by being interrupted.
+    const auto sinceEpoch = time.time_since_epoch();
+    const auto seconds =
+        std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch);
+    timespec deadline;
+    deadline.tv_sec = seconds.count();
+    deadline.tv_nsec = (sinceEpoch - seconds).count();
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline,
+                           nullptr) == EINTR) {
+    }
+}
+
+void ChoreographerFilter::singleThreadMain(bool useAffinity) {
+    if (useAffinity) {
+        int cpu = getNumCpus() - 1;
+        if (cpu >= 0) {
+            setAffinity(cpu);
+        }
+    }
+    pthread_setname_np(pthread_self(), "Filter");
+
+    time_point lastWakeTime;
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (mIsRunning) {
+        // Stop when choreographer callbacks stop, e.g. when the app is in the
+        // background, until a fresh one comes.
+        const auto now = std::chrono::steady_clock::now();
+        if (mVsyncPredictor.getSampleCount() == 0 ||
+            now - mLastTimestamp > mRefreshPeriod * 5) {
+            const int64_t sequenceNumber = mSequenceNumber;
+            mCondition.wait(lock, [&]() {
+                return !mIsRunning || mSequenceNumber != sequenceNumber;
+            });
+            continue;
+        }
+
+        // As in Timer::sleep, wake the work duration ahead of the app-to-SF
+        // adjusted vsync, unless the work takes too long to make that useful.
+        std::chrono::nanoseconds offset = -mWorkDuration;
+        if (offset < -(mRefreshPeriod / 2) || offset > mRefreshPeriod / 2) {
+            offset = 0ms;
+        }
+        offset += mAppToSfDelay;
+        // Work once per vsync, even if waking early.
+        const time_point earliest =
+            std::max(now, lastWakeTime + mRefreshPeriod / 2);
+        const time_point wakeTime =
+            mVsyncPredictor.getNextVsync(earliest - offset) + offset;
+        lock.unlock();
+
+        sleepUntil(wakeTime);
+        lastWakeTime = wakeTime;
+        std::chrono::nanoseconds workDuration;
+        {
+            gamesdk::ScopedTrace trace("doWork");
+            workDuration = mDoWork();
+        }
+
+        lock.lock();
+        mWorkDuration = workDuration;
+    }
+}
+
 }  // namespace swappy
@@ -22,9 +22,15 @@
 
 #include "Settings.h"
 #include "Thread.h"
+#include "VsyncPredictor.h"
 
 namespace swappy {
 
+// Calls doWork once per refresh period, just ahead of vsync, from the
+// choreographer callbacks passed to onChoreographer. By default two threads,
+// pinned to the last CPUs, each keep their own vsync model and race to do the
+// work. With Settings::setUseSingleFilterThread a single thread predicts vsync
+// with a VsyncPredictor and sleeps until then with an absolute timer instead.
 class ChoreographerFilter {
    public:
     using Worker = std::function<std::chrono::nanoseconds()>;
@@ -43,9 +49,11 @@ class ChoreographerFilter {
     void onSettingsChanged();
 
     void threadMain(bool useAffinity, int32_t thread);
+    void singleThreadMain(bool useAffinity);
 
     std::mutex mThreadPoolMutex;
     bool mUseAffinity = true;
+    bool mUseSingleThread = false;
     std::vector<Thread> mThreadPool;
 
     std::mutex mMutex;
@@ -53,6 +61,9 @@ class ChoreographerFilter {
     bool mIsRunning = true;
     int64_t mSequenceNumber = 0;
     std::chrono::steady_clock::time_point mLastTimestamp;
+    // Only fed while the single thread is running.
+    bool mPredictVsync = false;
+    VsyncPredictor mVsyncPredictor;
 
     std::mutex mWorkMutex;
     std::chrono::steady_clock::time_point mLastWorkRun;
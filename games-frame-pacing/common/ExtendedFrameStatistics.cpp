@@ -0,0 +1,173 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ExtendedFrameStatistics.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace swappy {
+
+using std::chrono::nanoseconds;
+
+// NB These are only needed for C++14
+constexpr uint32_t ExtendedFrameStatistics::DEFAULT_BUCKET_WIDTH_MICROS;
+constexpr uint32_t ExtendedFrameStatistics::DEFAULT_BUCKET_COUNT;
+
+namespace {
+
+void getCounts(const std::atomic<uint32_t>* counts, uint32_t bucketCount,
+               SwappyDurationHistogram* histogram) {
+    for (uint32_t i = 0; i < SWAPPY_EXTENDED_STATS_MAX_BUCKETS; ++i) {
+        histogram->counts[i] =
+            i < bucketCount ? counts[i].load(std::memory_order_relaxed) : 0;
+    }
+}
+
+int64_t getPercentile(const SwappyDurationHistogram& histogram,
+                      uint32_t bucketCount, int64_t bucketWidth,
+                      uint64_t total, int percent) {
+    if (total == 0) return 0;
+    // The percentile is in the first bucket that brings the count up to rank.
+    const uint64_t rank = std::max<uint64_t>(1, (total * percent + 99) / 100);
+    uint64_t count = 0;
+    for (uint32_t i = 0; i + 1 < bucketCount; ++i) {
+        count += histogram.counts[i];
+        if (count >= rank) return i * bucketWidth + bucketWidth / 2;
+    }
+    return (bucketCount - 1) * bucketWidth;
+}
+
+void setPercentiles(uint32_t bucketCount, int64_t bucketWidth,
+                    SwappyDurationHistogram* histogram) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < bucketCount; ++i) {
+        total += histogram->counts[i];
+    }
+    histogram->p50Nanos =
+        getPercentile(*histogram, bucketCount, bucketWidth, total, 50);
+    histogram->p95Nanos =
+        getPercentile(*histogram, bucketCount, bucketWidth, total, 95);
+    histogram->p99Nanos =
+        getPercentile(*histogram, bucketCount, bucketWidth, total, 99);
+}
+
+}  // anonymous namespace
+
+ExtendedFrameStatistics::ExtendedFrameStatistics()
+    : mBucketWidthMicros(DEFAULT_BUCKET_WIDTH_MICROS),
+      mBucketCount(DEFAULT_BUCKET_COUNT) {
+    clearCounts();
+}
+
+void ExtendedFrameStatistics::setConfig(
+    const SwappyExtendedStatsConfig& config) {
+    beginChange();
+    mBucketWidthMicros.store(std::max<uint32_t>(1, config.bucketWidthMicros),
+                             std::memory_order_relaxed);
+    mBucketCount.store(
+        std::max<uint32_t>(1, std::min<uint32_t>(
+                                  config.bucketCount,
+                                  SWAPPY_EXTENDED_STATS_MAX_BUCKETS)),
+        std::memory_order_relaxed);
+    clearCounts();
+    endChange();
+}
+
+void ExtendedFrameStatistics::clear() {
+    beginChange();
+    clearCounts();
+    endChange();
+}
+
+void ExtendedFrameStatistics::add(nanoseconds idle, nanoseconds late,
+                                  nanoseconds offset, nanoseconds latency) {
+    beginChange();
+    mTotalFrames.store(mTotalFrames.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+    addTo(&mIdle, idle);
+    addTo(&mLate, late);
+    if (offset >= nanoseconds(0)) addTo(&mOffset, offset);
+    addTo(&mLatency, latency);
+    endChange();
+}
+
+void ExtendedFrameStatistics::get(SwappyExtendedStats* stats) const {
+    while (true) {
+        const uint32_t sequence = mSequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        stats->totalFrames = mTotalFrames.load(std::memory_order_relaxed);
+        stats->config.bucketWidthMicros =
+            mBucketWidthMicros.load(std::memory_order_relaxed);
+        stats->config.bucketCount =
+            mBucketCount.load(std::memory_order_relaxed);
+        const uint32_t bucketCount = stats->config.bucketCount;
+        getCounts(mIdle.counts, bucketCount, &stats->idle);
+        getCounts(mLate.counts, bucketCount, &stats->late);
+        getCounts(mOffset.counts, bucketCount,
+                  &stats->offsetFromPreviousFrame);
+        getCounts(mLatency.counts, bucketCount, &stats->latency);
+        // Order the reads above before checking nothing changed under them.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (mSequence.load(std::memory_order_relaxed) == sequence) break;
+    }
+
+    const uint32_t bucketCount = stats->config.bucketCount;
+    const int64_t bucketWidth = stats->config.bucketWidthMicros * 1000LL;
+    setPercentiles(bucketCount, bucketWidth, &stats->idle);
+    setPercentiles(bucketCount, bucketWidth, &stats->late);
+    setPercentiles(bucketCount, bucketWidth, &stats->offsetFromPreviousFrame);
+    setPercentiles(bucketCount, bucketWidth, &stats->latency);
+}
+
+void ExtendedFrameStatistics::beginChange() {
+    mSequence.store(mSequence.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+    // Order the odd sequence number before the changes that follow.
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void ExtendedFrameStatistics::endChange() {
+    mSequence.store(mSequence.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+}
+
+void ExtendedFrameStatistics::clearCounts() {
+    mTotalFrames.store(0, std::memory_order_relaxed);
+    for (Histogram* histogram : {&mIdle, &mLate, &mOffset, &mLatency}) {
+        for (auto& count : histogram->counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void ExtendedFrameStatistics::addTo(Histogram* histogram,
+                                    nanoseconds duration) {
+    const int64_t bucketWidth =
+        mBucketWidthMicros.load(std::memory_order_relaxed) * 1000LL;
+    const int64_t lastBucket =
+        mBucketCount.load(std::memory_order_relaxed) - 1;
+    const int64_t bucket = std::max<int64_t>(
+        0, std::min<int64_t>(duration.count() / bucketWidth, lastBucket));
+    auto& count = histogram->counts[bucket];
+    count.store(count.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+}
+
+}  // namespace swappy
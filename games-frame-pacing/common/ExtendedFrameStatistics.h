@@ -0,0 +1,75 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <swappy/swappy_common.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace swappy {
+
+// Histograms of idle, late, frame-to-frame and latency times in configurable
+// microsecond buckets, as returned by SwappyGL_getExtendedStats and
+// SwappyVk_getExtendedStats.
+//
+// Changes must be serialized by the caller, but get() can be called from any
+// thread at any time without locking: the counts are published with a
+// sequence lock, and a read that overlaps a change is retried.
+class ExtendedFrameStatistics {
+   public:
+    static constexpr uint32_t DEFAULT_BUCKET_WIDTH_MICROS = 500;
+    static constexpr uint32_t DEFAULT_BUCKET_COUNT =
+        SWAPPY_EXTENDED_STATS_MAX_BUCKETS;
+
+    ExtendedFrameStatistics();
+
+    // Clears the histograms. Out of range values are clamped.
+    void setConfig(const SwappyExtendedStatsConfig& config);
+    void clear();
+
+    // Negative durations count as 0. A negative offset means there was no
+    // previous frame, so none is counted.
+    void add(std::chrono::nanoseconds idle, std::chrono::nanoseconds late,
+             std::chrono::nanoseconds offset,
+             std::chrono::nanoseconds latency);
+
+    void get(SwappyExtendedStats* stats) const;
+
+   private:
+    struct Histogram {
+        std::atomic<uint32_t> counts[SWAPPY_EXTENDED_STATS_MAX_BUCKETS];
+    };
+
+    void beginChange();
+    void endChange();
+    void clearCounts();
+    void addTo(Histogram* histogram, std::chrono::nanoseconds duration);
+
+    // Odd while a change is in progress.
+    std::atomic<uint32_t> mSequence = {0};
+    std::atomic<uint32_t> mBucketWidthMicros;
+    std::atomic<uint32_t> mBucketCount;
+    std::atomic<uint64_t> mTotalFrames = {0};
+    Histogram mIdle;
+    Histogram mLate;
+    Histogram mOffset;
+    Histogram mLatency;
+};
+
+}  // namespace swappy
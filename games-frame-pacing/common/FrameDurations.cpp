@@ -0,0 +1,133 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameDurations.h"
+
+#include <cmath>
+
+namespace swappy {
+
+using std::chrono::nanoseconds;
+
+// NB These are only needed for C++14
+constexpr nanoseconds FrameDuration::FRAME_MARGIN;
+constexpr nanoseconds FrameDuration::MAX_DURATION;
+constexpr nanoseconds DurationHistogram::BUCKET_WIDTH;
+constexpr int DurationHistogram::BUCKET_COUNT;
+constexpr int FrameDurations::CAPACITY;
+constexpr nanoseconds FrameDurations::FRAME_DURATION_SAMPLE_SECONDS;
+
+void DurationHistogram::change(nanoseconds duration, int change) {
+    const int bucket = std::max<int>(
+        0, std::min<int>(duration / BUCKET_WIDTH, BUCKET_COUNT - 1));
+    mBuckets[bucket] += change;
+    mCount += change;
+    if (bucket < mP50.bucket) mP50.countBelow += change;
+    if (bucket < mP95.bucket) mP95.countBelow += change;
+}
+
+void DurationHistogram::clear() {
+    mBuckets.fill(0);
+    mCount = 0;
+    mP50.bucket = mP50.countBelow = 0;
+    mP95.bucket = mP95.countBelow = 0;
+}
+
+nanoseconds DurationHistogram::getValue(Percentile* percentile) const {
+    if (mCount == 0) return 0ns;
+
+    // The percentile is in the first bucket that brings the count up to rank.
+    const int rank = std::max(1, (mCount * percentile->percent + 99) / 100);
+    while (percentile->countBelow + mBuckets[percentile->bucket] < rank) {
+        percentile->countBelow += mBuckets[percentile->bucket];
+        percentile->bucket++;
+    }
+    while (percentile->countBelow >= rank) {
+        percentile->bucket--;
+        percentile->countBelow -= mBuckets[percentile->bucket];
+    }
+    return percentile->bucket * BUCKET_WIDTH + BUCKET_WIDTH / 2;
+}
+
+void FrameDurations::add(std::chrono::steady_clock::time_point now,
+                         FrameDuration frameDuration) {
+    if (mSize == CAPACITY) {
+        removeFirst();
+    }
+    mFrames[(mFirst + mSize) % CAPACITY] = {now, frameDuration};
+    mSize++;
+    mFrameDurationsSum += frameDuration;
+    if (frameDuration.frameMiss()) {
+        mMissedFrameCount++;
+    }
+    mCpuTimes.add(frameDuration.getCpuTime());
+    mGpuTimes.add(frameDuration.getGpuTime());
+
+    while (mSize >= 2 && now - at(1).time > FRAME_DURATION_SAMPLE_SECONDS) {
+        removeFirst();
+    }
+}
+
+void FrameDurations::removeFirst() {
+    const FrameDuration& first = mFrames[mFirst].duration;
+    mFrameDurationsSum -= first;
+    if (first.frameMiss()) {
+        mMissedFrameCount--;
+    }
+    mCpuTimes.remove(first.getCpuTime());
+    mGpuTimes.remove(first.getGpuTime());
+    mFirst = (mFirst + 1) % CAPACITY;
+    mSize--;
+}
+
+bool FrameDurations::hasEnoughSamples() const {
+    // A full ring is plenty of samples, even if it spans less time.
+    return mSize == CAPACITY ||
+           (mSize > 0 &&
+            at(mSize - 1).time - at(0).time > FRAME_DURATION_SAMPLE_SECONDS);
+}
+
+FrameDuration FrameDurations::getAverageFrameTime() const {
+    if (hasEnoughSamples()) {
+        return mFrameDurationsSum / mSize;
+    }
+
+    return {};
+}
+
+int FrameDurations::getMissedFramePercent() const {
+    return round(mMissedFrameCount * 100.0f / mSize);
+}
+
+void FrameDurations::getPercentiles(
+    SwappyFrameDurationPercentiles* percentiles) const {
+    percentiles->frameCount = mSize;
+    percentiles->cpuTimeP50Nanos = mCpuTimes.getP50().count();
+    percentiles->cpuTimeP95Nanos = mCpuTimes.getP95().count();
+    percentiles->gpuTimeP50Nanos = mGpuTimes.getP50().count();
+    percentiles->gpuTimeP95Nanos = mGpuTimes.getP95().count();
+}
+
+void FrameDurations::clear() {
+    mFirst = 0;
+    mSize = 0;
+    mFrameDurationsSum = {};
+    mMissedFrameCount = 0;
+    mCpuTimes.clear();
+    mGpuTimes.clear();
+}
+
+}  // namespace swappy
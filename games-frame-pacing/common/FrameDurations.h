@@ -0,0 +1,167 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <swappy/swappy_common.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace swappy {
+
+using namespace std::chrono_literals;
+
+enum class PipelineMode { Off, On };
+
+class FrameDuration {
+   public:
+    static constexpr std::chrono::nanoseconds FRAME_MARGIN = 1ms;
+    static constexpr std::chrono::nanoseconds MAX_DURATION =
+        std::chrono::milliseconds(100);
+
+    FrameDuration() = default;
+
+    FrameDuration(std::chrono::nanoseconds cpuTime,
+                  std::chrono::nanoseconds gpuTime, bool frameMissedDeadline)
+        : mCpuTime(cpuTime),
+          mGpuTime(gpuTime),
+          mFrameMissedDeadline(frameMissedDeadline) {
+        mCpuTime = std::min(mCpuTime, MAX_DURATION);
+        mGpuTime = std::min(mGpuTime, MAX_DURATION);
+    }
+
+    std::chrono::nanoseconds getCpuTime() const { return mCpuTime; }
+    std::chrono::nanoseconds getGpuTime() const { return mGpuTime; }
+
+    bool frameMiss() const { return mFrameMissedDeadline; }
+
+    std::chrono::nanoseconds getTime(PipelineMode pipeline) const {
+        if (mCpuTime == 0ns && mGpuTime == 0ns) {
+            return 0ns;
+        }
+
+        if (pipeline == PipelineMode::On) {
+            return std::max(mCpuTime, mGpuTime) + FRAME_MARGIN;
+        }
+
+        return mCpuTime + mGpuTime + FRAME_MARGIN;
+    }
+
+    FrameDuration& operator+=(const FrameDuration& other) {
+        mCpuTime += other.mCpuTime;
+        mGpuTime += other.mGpuTime;
+        return *this;
+    }
+
+    FrameDuration& operator-=(const FrameDuration& other) {
+        mCpuTime -= other.mCpuTime;
+        mGpuTime -= other.mGpuTime;
+        return *this;
+    }
+
+    friend FrameDuration operator/(FrameDuration lhs, int rhs) {
+        lhs.mCpuTime /= rhs;
+        lhs.mGpuTime /= rhs;
+        return lhs;
+    }
+
+   private:
+    std::chrono::nanoseconds mCpuTime = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds mGpuTime = std::chrono::nanoseconds(0);
+    bool mFrameMissedDeadline = false;
+};
+
+// Counts of durations in fixed buckets, that keeps track of the bucket the
+// median and 95th percentile fall in. Adding and removing durations is O(1).
+// The tracked buckets are moved when read, usually by a bucket or two, rather
+// than back and forth on every add and remove.
+class DurationHistogram {
+   public:
+    static constexpr std::chrono::nanoseconds BUCKET_WIDTH = 250us;
+    // Durations of MAX_DURATION or more all go in the last bucket.
+    static constexpr int BUCKET_COUNT =
+        FrameDuration::MAX_DURATION / BUCKET_WIDTH + 1;
+
+    void add(std::chrono::nanoseconds duration) { change(duration, 1); }
+    void remove(std::chrono::nanoseconds duration) { change(duration, -1); }
+    void clear();
+
+    int getCount() const { return mCount; }
+
+    // The middle of the bucket the percentile falls in, or 0 if empty.
+    std::chrono::nanoseconds getP50() const { return getValue(&mP50); }
+    std::chrono::nanoseconds getP95() const { return getValue(&mP95); }
+
+   private:
+    struct Percentile {
+        int percent;
+        // The bucket holding the percentile, and the durations below it.
+        int bucket;
+        int countBelow;
+    };
+
+    void change(std::chrono::nanoseconds duration, int change);
+    std::chrono::nanoseconds getValue(Percentile* percentile) const;
+
+    std::array<uint16_t, BUCKET_COUNT> mBuckets = {};
+    int mCount = 0;
+    // Only a cache of where the percentiles are, hence mutable.
+    mutable Percentile mP50 = {50, 0, 0};
+    mutable Percentile mP95 = {95, 0, 0};
+};
+
+// The durations of the frames in the last FRAME_DURATION_SAMPLE_SECONDS, with
+// their running mean, missed frame count and CPU and GPU percentiles. Frames
+// are kept in a fixed ring, so adding one doesn't allocate.
+class FrameDurations {
+   public:
+    // Enough for FRAME_DURATION_SAMPLE_SECONDS at 240Hz. At higher frame rates
+    // the oldest frames are dropped early.
+    static constexpr int CAPACITY = 512;
+
+    void add(std::chrono::steady_clock::time_point time,
+             FrameDuration frameDuration);
+    bool hasEnoughSamples() const;
+    FrameDuration getAverageFrameTime() const;
+    int getMissedFramePercent() const;
+    void getPercentiles(SwappyFrameDurationPercentiles* percentiles) const;
+    void clear();
+
+   private:
+    static constexpr std::chrono::nanoseconds FRAME_DURATION_SAMPLE_SECONDS =
+        2s;
+
+    struct Frame {
+        std::chrono::steady_clock::time_point time;
+        FrameDuration duration;
+    };
+
+    const Frame& at(int i) const { return mFrames[(mFirst + i) % CAPACITY]; }
+    void removeFirst();
+
+    std::array<Frame, CAPACITY> mFrames;
+    int mFirst = 0;
+    int mSize = 0;
+    FrameDuration mFrameDurationsSum = {};
+    int mMissedFrameCount = 0;
+    DurationHistogram mCpuTimes;
+    DurationHistogram mGpuTimes;
+};
+
+}  // namespace swappy
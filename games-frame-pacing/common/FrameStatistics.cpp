@@ -44,6 +44,13 @@ void FrameStatistics::clearStats() {
         mStats.offsetFromPreviousFrame[i] = 0;
         mStats.latencyFrames[i] = 0;
     }
+    mExtendedStats.clear();
+}
+
+void FrameStatistics::setExtendedStatsConfig(
+    const SwappyExtendedStatsConfig& config) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mExtendedStats.setConfig(config);
 }
 
 void FrameStatistics::invalidateLastFrame() { mLast = {0, 0, 0, 0}; }
@@ -76,7 +83,23 @@ void FrameStatistics::updateFrameStats(FrameTimings current,
             mStats.offsetFromPreviousFrame[offset]++;
         }
 
+        // The same times again, without rounding to refresh periods.
+        const auto signedDelta = [](uint64_t end, uint64_t start) {
+            return std::chrono::nanoseconds(static_cast<int64_t>(end - start));
+        };
+        mExtendedStats.add(
+            std::chrono::nanoseconds(current.presentMargin),
+            signedDelta(current.actualPresentTime, current.desiredPresentTime),
+            mLast.actualPresentTime
+                ? signedDelta(current.actualPresentTime,
+                              mLast.actualPresentTime)
+                : std::chrono::nanoseconds(-1),
+            signedDelta(current.actualPresentTime, current.startFrameTime));
+
+#if ENABLE_SWAPPY_LOGGING
+        // Only build the log messages if they will be logged.
         logFrames();
+#endif
     }
 
     mLastLatency = latency;
@@ -22,6 +22,7 @@
 #include <chrono>
 #include <mutex>
 
+#include "ExtendedFrameStatistics.h"
 #include "Thread.h"
 
 using namespace std::chrono_literals;
@@ -48,6 +49,11 @@ class FrameStatistics {
                           uint64_t refreshPeriod);
     SwappyStats getStats();
     void clearStats();
+    void setExtendedStatsConfig(const SwappyExtendedStatsConfig& config);
+    // Doesn't lock, so can be called from any thread.
+    void getExtendedStats(SwappyExtendedStats* stats) const {
+        mExtendedStats.get(stats);
+    }
     void invalidateLastFrame();
 
     int32_t lastLatencyRecorded() { return mLastLatency; }
@@ -60,6 +66,8 @@ class FrameStatistics {
 
     std::mutex mMutex;
     SwappyStats mStats GUARDED_BY(mMutex) = {};
+    // Changed with mMutex held, but read without it.
+    ExtendedFrameStatistics mExtendedStats;
     std::atomic<int32_t> mLastLatency = {0};
     FrameTimings mLast;
 
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameTimeline.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#define LOG_TAG "FrameTimeline"
+#include "SwappyLog.h"
+
+namespace swappy {
+
+// NB This is only needed for C++14
+constexpr uint32_t FrameTimeline::CAPACITY;
+
+FrameTimeline::~FrameTimeline() { delete[] mSlots.load(); }
+
+void FrameTimeline::setEnabled(bool enabled) {
+    if (enabled && mSlots.load(std::memory_order_acquire) == nullptr) {
+        std::lock_guard<std::mutex> lock(mReadMutex);
+        if (mSlots.load(std::memory_order_relaxed) == nullptr) {
+            mSlots.store(new Slot[CAPACITY](), std::memory_order_release);
+        }
+    }
+    mEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void FrameTimeline::record(const SwappyFrameRecord& record) {
+    if (!isEnabled()) return;
+    Slot* slots = mSlots.load(std::memory_order_acquire);
+    if (slots == nullptr) return;
+
+    uint64_t words[RECORD_WORDS];
+    memcpy(words, &record, sizeof(words));
+
+    const uint64_t pos = mWritePos.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots[pos % CAPACITY];
+    slot.seq.store(2 * pos + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < RECORD_WORDS; ++i) {
+        slot.words[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.seq.store(2 * pos + 2, std::memory_order_release);
+}
+
+void FrameTimeline::recordPresent(int64_t startFrameTimeNanos,
+                                  int64_t desiredPresentTimeNanos,
+                                  int64_t actualPresentTimeNanos) {
+    if (!isEnabled()) return;
+    SwappyFrameRecord record = {};
+    record.type = SWAPPY_FRAME_RECORD_PRESENT;
+    record.startFrameTimeNanos = startFrameTimeNanos;
+    record.desiredPresentTimeNanos = desiredPresentTimeNanos;
+    record.actualPresentTimeNanos = actualPresentTimeNanos;
+    this->record(record);
+}
+
+int FrameTimeline::drain(SwappyFrameRecord* records, int maxRecords,
+                         uint64_t* droppedRecords) {
+    std::lock_guard<std::mutex> lock(mReadMutex);
+    Slot* slots = mSlots.load(std::memory_order_acquire);
+    const uint64_t writePos = mWritePos.load(std::memory_order_acquire);
+    if (writePos > mReadPos + CAPACITY) {
+        mDropped += writePos - CAPACITY - mReadPos;
+        mReadPos = writePos - CAPACITY;
+    }
+
+    int count = 0;
+    while (slots != nullptr && count < maxRecords && mReadPos < writePos) {
+        Slot& slot = slots[mReadPos % CAPACITY];
+        const uint64_t expected = 2 * mReadPos + 2;
+        const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        // The record is still being written: stop here to keep the order.
+        if (seq < expected) break;
+
+        uint64_t words[RECORD_WORDS];
+        for (size_t i = 0; i < RECORD_WORDS; ++i) {
+            words[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq == expected &&
+            slot.seq.load(std::memory_order_relaxed) == expected) {
+            memcpy(&records[count++], words, sizeof(words));
+        } else {
+            // A writer lapped us while we were reading.
+            ++mDropped;
+        }
+        ++mReadPos;
+    }
+
+    if (droppedRecords != nullptr) {
+        *droppedRecords = mDropped;
+        mDropped = 0;
+    }
+    return count;
+}
+
+static bool writeAll(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+int FrameTimeline::dump(int fd, std::chrono::nanoseconds refreshPeriod) {
+    std::vector<SwappyFrameRecord> records(CAPACITY);
+    uint64_t dropped = 0;
+    const int count = drain(records.data(), records.size(), &dropped);
+
+    SwappyFrameTimelineHeader header = {};
+    header.magic = SWAPPY_FRAME_TIMELINE_MAGIC;
+    header.version = SWAPPY_FRAME_TIMELINE_VERSION;
+    header.recordSize = sizeof(SwappyFrameRecord);
+    header.refreshPeriodNanos = refreshPeriod.count();
+    header.droppedRecords = dropped;
+    header.recordCount = count;
+    if (!writeAll(fd, &header, sizeof(header)) ||
+        !writeAll(fd, records.data(), count * sizeof(SwappyFrameRecord))) {
+        SWAPPY_LOGE("Error writing frame timeline: %s", strerror(errno));
+        return -1;
+    }
+    return count;
+}
+
+}  // namespace swappy
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <swappy/swappy_common.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include "Thread.h"
+
+namespace swappy {
+
+// A fixed-size ring of per-frame records. Recording never blocks or
+// allocates: when the ring is full the oldest records are overwritten and
+// counted as dropped. The ring is only allocated the first time recording is
+// enabled, and while disabled the cost of recording is one relaxed load.
+//
+// Each slot is guarded by a sequence number, 2 * position + 1 while the record
+// at that position is being written and 2 * position + 2 once it is complete,
+// so that readers can tell complete, pending and overwritten records apart.
+// Records may be written from more than one thread, as long as no writer
+// stalls for a whole lap of the ring.
+class FrameTimeline {
+   public:
+    static constexpr uint32_t CAPACITY = 1024;
+
+    FrameTimeline() = default;
+    ~FrameTimeline();
+    FrameTimeline(const FrameTimeline&) = delete;
+    FrameTimeline& operator=(const FrameTimeline&) = delete;
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+    void record(const SwappyFrameRecord& record);
+    void recordPresent(int64_t startFrameTimeNanos,
+                       int64_t desiredPresentTimeNanos,
+                       int64_t actualPresentTimeNanos);
+
+    // Moves up to maxRecords of the oldest complete records into records and
+    // returns how many were moved. If droppedRecords isn't null, it is set to
+    // the number of records overwritten since the last drain.
+    int drain(SwappyFrameRecord* records, int maxRecords,
+              uint64_t* droppedRecords);
+
+    // Drains all complete records to fd, in the format described by
+    // SwappyFrameTimelineHeader. Returns the number of records written, or -1
+    // if writing failed.
+    int dump(int fd, std::chrono::nanoseconds refreshPeriod);
+
+   private:
+    static constexpr size_t RECORD_WORDS =
+        sizeof(SwappyFrameRecord) / sizeof(uint64_t);
+    static_assert(sizeof(SwappyFrameRecord) % sizeof(uint64_t) == 0,
+                  "records are copied as 64-bit words");
+
+    struct Slot {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<uint64_t> words[RECORD_WORDS];
+    };
+
+    std::atomic<bool> mEnabled{false};
+    std::atomic<Slot*> mSlots{nullptr};
+    std::atomic<uint64_t> mWritePos{0};
+
+    std::mutex mReadMutex;
+    uint64_t mReadPos GUARDED_BY(mReadMutex) = 0;
+    uint64_t mDropped GUARDED_BY(mReadMutex) = 0;
+};
+
+}  // namespace swappy
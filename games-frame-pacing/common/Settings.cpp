@@ -60,6 +60,15 @@ void Settings::setUseAffinity(bool tf) {
     notifyListeners();
 }
 
+void Settings::setUseSingleFilterThread(bool tf) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mUseSingleFilterThread = tf;
+    }
+    // Notify the listeners without the lock held
+    notifyListeners();
+}
+
 const Settings::DisplayTimings& Settings::getDisplayTimings() const {
     std::lock_guard<std::mutex> lock(mMutex);
     return mDisplayTimings;
@@ -75,6 +84,11 @@ bool Settings::getUseAffinity() const {
     return mUseAffinity;
 }
 
+bool Settings::getUseSingleFilterThread() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mUseSingleFilterThread;
+}
+
 void Settings::notifyListeners() {
     // Grab a local copy of the listeners
     std::vector<Listener> listeners;
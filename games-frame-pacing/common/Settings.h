@@ -53,10 +53,12 @@ class Settings {
     void setDisplayTimings(const DisplayTimings& displayTimings);
     void setSwapDuration(uint64_t swapNs);
     void setUseAffinity(bool);
+    void setUseSingleFilterThread(bool);
 
     const DisplayTimings& getDisplayTimings() const;
     std::chrono::nanoseconds getSwapDuration() const;
     bool getUseAffinity() const;
+    bool getUseSingleFilterThread() const;
 
    private:
     void notifyListeners();
@@ -70,6 +72,7 @@ class Settings {
     std::chrono::nanoseconds mSwapDuration GUARDED_BY(mMutex) =
         std::chrono::nanoseconds(16'666'667L);
     bool mUseAffinity GUARDED_BY(mMutex) = true;
+    bool mUseSingleFilterThread GUARDED_BY(mMutex) = false;
 };
 
 }  // namespace swappy
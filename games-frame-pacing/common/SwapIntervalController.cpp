@@ -0,0 +1,397 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SwapIntervalController.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#define LOG_TAG "SwapIntervalController"
+#include "SwappyLog.h"
+
+namespace swappy {
+
+using std::chrono::nanoseconds;
+
+// NB These are only needed for C++14
+constexpr nanoseconds AverageSwapIntervalController::DURATION_ROUNDING_MARGIN;
+constexpr int AverageSwapIntervalController::NON_PIPELINE_PERCENT;
+constexpr int AverageSwapIntervalController::FRAME_DROP_THRESHOLD;
+constexpr int PredictiveSwapIntervalController::WINDOW;
+constexpr nanoseconds PredictiveSwapIntervalController::RISE_TIME_CONSTANT;
+constexpr nanoseconds PredictiveSwapIntervalController::FALL_TIME_CONSTANT;
+constexpr nanoseconds PredictiveSwapIntervalController::FASTER_HOLD_TIME;
+
+static constexpr nanoseconds REFRESH_RATE_MARGIN = 500ns;
+
+int calculateSwapInterval(nanoseconds frameTime, nanoseconds refreshPeriod) {
+    if (frameTime < refreshPeriod) {
+        return 1;
+    }
+
+    auto div_result = div(frameTime.count(), refreshPeriod.count());
+    auto framesPerRefresh = div_result.quot;
+    auto framesPerRefreshRemainder = div_result.rem;
+
+    return (framesPerRefresh +
+            (framesPerRefreshRemainder > REFRESH_RATE_MARGIN.count() ? 1 : 0));
+}
+
+std::unique_ptr<SwapIntervalController> SwapIntervalController::create(
+    SwappySwapIntervalController type) {
+    switch (type) {
+        case SWAPPY_SWAP_INTERVAL_CONTROLLER_PREDICTIVE:
+            return std::make_unique<PredictiveSwapIntervalController>();
+        case SWAPPY_SWAP_INTERVAL_CONTROLLER_AVERAGE:
+        default:
+            return std::make_unique<AverageSwapIntervalController>();
+    }
+}
+
+void AverageSwapIntervalController::addFrame(
+    std::chrono::steady_clock::time_point time, const FrameDuration& duration) {
+    mFrameDurations.add(time, duration);
+}
+
+nanoseconds AverageSwapIntervalController::getFrameTime() const {
+    return mFrameDurations.getAverageFrameTime().getTime(PipelineMode::On);
+}
+
+bool AverageSwapIntervalController::swapSlower(
+    const Limits& limits, const FrameDuration& averageFrameTime,
+    nanoseconds upperBound, int newSwapInterval, Config* config) {
+    bool swappedSlower = false;
+    SWAPPY_LOGV("Rendering takes too much time for the given config");
+
+    const auto frameFitsUpperBound =
+        averageFrameTime.getTime(PipelineMode::On) <= upperBound;
+    const auto swapDurationWithinThreshold =
+        limits.refreshPeriod * config->swapInterval <=
+        limits.maxAutoSwapDuration + FrameDuration::FRAME_MARGIN;
+
+    // Check if turning on pipeline is not enough
+    if ((config->pipelineMode == PipelineMode::On || !frameFitsUpperBound) &&
+        swapDurationWithinThreshold) {
+        int originalAutoSwapInterval = config->swapInterval;
+        if (newSwapInterval > config->swapInterval) {
+            config->swapInterval = newSwapInterval;
+        } else {
+            config->swapInterval++;
+        }
+        if (config->swapInterval != originalAutoSwapInterval) {
+            SWAPPY_LOGV("Changing Swap interval to %d from %d",
+                        config->swapInterval, originalAutoSwapInterval);
+            swappedSlower = true;
+        }
+    }
+
+    if (config->pipelineMode == PipelineMode::Off) {
+        SWAPPY_LOGV("turning on pipelining");
+        config->pipelineMode = PipelineMode::On;
+    }
+
+    return swappedSlower;
+}
+
+static bool swapFasterCondition(const SwapIntervalController::Limits& limits,
+                                int swapInterval, nanoseconds margin) {
+    return limits.swapDuration <=
+           limits.refreshPeriod * (swapInterval - 1) + margin;
+}
+
+bool AverageSwapIntervalController::swapFaster(const Limits& limits,
+                                               int newSwapInterval,
+                                               Config* config) {
+    bool swappedFaster = false;
+    int originalAutoSwapInterval = config->swapInterval;
+    while (newSwapInterval < config->swapInterval &&
+           swapFasterCondition(limits, config->swapInterval,
+                               DURATION_ROUNDING_MARGIN)) {
+        config->swapInterval--;
+    }
+
+    if (config->swapInterval != originalAutoSwapInterval) {
+        SWAPPY_LOGV("Rendering is much shorter for the given config");
+        SWAPPY_LOGV("Changing Swap interval to %d from %d",
+                    config->swapInterval, originalAutoSwapInterval);
+        // since we changed the swap interval, we may need to turn on pipeline
+        // mode
+        SWAPPY_LOGV("Turning on pipelining");
+        config->pipelineMode = PipelineMode::On;
+        swappedFaster = true;
+    }
+
+    return swappedFaster;
+}
+
+bool AverageSwapIntervalController::update(const Limits& limits,
+                                           Config* config,
+                                           nanoseconds* preferredFrameTime) {
+    *preferredFrameTime = 0ns;
+    if (!mFrameDurations.hasEnoughSamples()) return false;
+
+    const auto averageFrameTime = mFrameDurations.getAverageFrameTime();
+    const auto pipelineFrameTime = averageFrameTime.getTime(PipelineMode::On);
+    const auto nonPipelineFrameTime =
+        averageFrameTime.getTime(PipelineMode::Off);
+
+    // calculate the new swap interval based on average frame time assume we are
+    // in pipeline mode (prefer higher swap interval rather than turning off
+    // pipeline mode)
+    const int newSwapInterval =
+        calculateSwapInterval(pipelineFrameTime, limits.refreshPeriod);
+
+    // Define upper and lower bounds based on the swap duration
+    const nanoseconds upperBoundForThisRefresh =
+        limits.refreshPeriod * config->swapInterval;
+    const nanoseconds lowerBoundForThisRefresh =
+        limits.refreshPeriod * (config->swapInterval - 1) -
+        FrameDuration::FRAME_MARGIN;
+
+    const int missedFramesPercent = mFrameDurations.getMissedFramePercent();
+
+    SWAPPY_LOGV("mPipelineMode = %d", static_cast<int>(config->pipelineMode));
+    SWAPPY_LOGV("Average cpu frame time = %.2f",
+                (averageFrameTime.getCpuTime().count()) / 1e6f);
+    SWAPPY_LOGV("Average gpu frame time = %.2f",
+                (averageFrameTime.getGpuTime().count()) / 1e6f);
+    SWAPPY_LOGV("upperBound = %.2f", upperBoundForThisRefresh.count() / 1e6f);
+    SWAPPY_LOGV("lowerBound = %.2f", lowerBoundForThisRefresh.count() / 1e6f);
+    SWAPPY_LOGV("frame missed = %d%%", missedFramesPercent);
+#if ENABLE_SWAPPY_LOGGING
+    // The percentiles are only needed for the log.
+    SwappyFrameDurationPercentiles percentiles;
+    mFrameDurations.getPercentiles(&percentiles);
+    SWAPPY_LOGV("cpu frame time p50 = %.2f, p95 = %.2f",
+                percentiles.cpuTimeP50Nanos / 1e6f,
+                percentiles.cpuTimeP95Nanos / 1e6f);
+    SWAPPY_LOGV("gpu frame time p50 = %.2f, p95 = %.2f",
+                percentiles.gpuTimeP50Nanos / 1e6f,
+                percentiles.gpuTimeP95Nanos / 1e6f);
+#endif
+
+    bool configChanged = false;
+    SWAPPY_LOGV("pipelineFrameTime = %.2f", pipelineFrameTime.count() / 1e6f);
+    const auto nonPipelinePercent = (100.f + NON_PIPELINE_PERCENT) / 100.f;
+
+    // Make sure the frame time fits in the current config to avoid missing
+    // frames
+    if (missedFramesPercent > FRAME_DROP_THRESHOLD) {
+        if (swapSlower(limits, averageFrameTime, upperBoundForThisRefresh,
+                       newSwapInterval, config))
+            configChanged = true;
+    }
+
+    // So we shouldn't miss any frames with this config but maybe we can go
+    // faster ? we check the pipeline frame time here as we prefer lower swap
+    // interval than no pipelining
+    else if (missedFramesPercent == 0 &&
+             swapFasterCondition(limits, config->swapInterval,
+                                 DURATION_ROUNDING_MARGIN) &&
+             pipelineFrameTime < lowerBoundForThisRefresh) {
+        if (swapFaster(limits, newSwapInterval, config)) configChanged = true;
+    }
+
+    // If we reached to this condition it means that we fit into the boundaries.
+    // However we might be in pipeline mode and we could turn it off if we still
+    // fit. To be very conservative, switch to non-pipeline if frame time * 50%
+    // fits
+    else if (limits.autoPipelineMode &&
+             config->pipelineMode == PipelineMode::On &&
+             nonPipelineFrameTime * nonPipelinePercent <
+                 upperBoundForThisRefresh) {
+        SWAPPY_LOGV(
+            "Rendering time fits the current swap interval without pipelining");
+        config->pipelineMode = PipelineMode::Off;
+        configChanged = true;
+    }
+
+    if (configChanged) {
+        mFrameDurations.clear();
+    }
+
+    *preferredFrameTime = pipelineFrameTime;
+
+    return configChanged;
+}
+
+PredictiveSwapIntervalController::PredictiveSwapIntervalController() = default;
+
+void PredictiveSwapIntervalController::smooth(float* estimate,
+                                              nanoseconds sample,
+                                              nanoseconds elapsed) {
+    const nanoseconds timeConstant =
+        sample.count() > *estimate ? RISE_TIME_CONSTANT : FALL_TIME_CONSTANT;
+    const float alpha = 1.f - std::exp(-static_cast<float>(elapsed.count()) /
+                                       timeConstant.count());
+    *estimate += alpha * (sample.count() - *estimate);
+}
+
+void PredictiveSwapIntervalController::addFrame(
+    std::chrono::steady_clock::time_point time, const FrameDuration& duration) {
+    if (mFrameCount == WINDOW && mFrames[mNextFrame].frameMiss()) {
+        mMissedFrameCount--;
+    }
+    mFrames[mNextFrame] = duration;
+    mNextFrame = (mNextFrame + 1) % WINDOW;
+    mFrameCount = std::min(mFrameCount + 1, WINDOW);
+    if (duration.frameMiss()) {
+        mMissedFrameCount++;
+    }
+
+    nanoseconds pipelineTimes[WINDOW];
+    nanoseconds nonPipelineTimes[WINDOW];
+    for (int i = 0; i < mFrameCount; ++i) {
+        pipelineTimes[i] = mFrames[i].getTime(PipelineMode::On);
+        nonPipelineTimes[i] = mFrames[i].getTime(PipelineMode::Off);
+    }
+    const int rank = (mFrameCount - 1) * PERCENTILE / 100;
+    std::nth_element(pipelineTimes, pipelineTimes + rank,
+                     pipelineTimes + mFrameCount);
+    std::nth_element(nonPipelineTimes, nonPipelineTimes + rank,
+                     nonPipelineTimes + mFrameCount);
+
+    if (mFrameCount == 1) {
+        mPipelineEstimate = pipelineTimes[rank].count();
+        mNonPipelineEstimate = nonPipelineTimes[rank].count();
+    } else {
+        const nanoseconds elapsed =
+            std::min<nanoseconds>(time - mLastFrameTime, 1s);
+        smooth(&mPipelineEstimate, pipelineTimes[rank], elapsed);
+        smooth(&mNonPipelineEstimate, nonPipelineTimes[rank], elapsed);
+    }
+    mLastFrameTime = time;
+}
+
+nanoseconds PredictiveSwapIntervalController::getFrameTime() const {
+    if (mFrameCount < MIN_FRAMES) return 0ns;
+    return nanoseconds(static_cast<int64_t>(mPipelineEstimate));
+}
+
+void PredictiveSwapIntervalController::clearMissedFrames() {
+    for (int i = 0; i < mFrameCount; ++i) {
+        mFrames[i] = FrameDuration(mFrames[i].getCpuTime(),
+                                   mFrames[i].getGpuTime(), false);
+    }
+    mMissedFrameCount = 0;
+    mFasterFitsSince = {};
+    mNonPipelineFitsSince = {};
+}
+
+void PredictiveSwapIntervalController::onSettingsChanged() {
+    // The predictions don't depend on the refresh period, but whether frames
+    // were missed does.
+    clearMissedFrames();
+}
+
+void PredictiveSwapIntervalController::getFrameDurationPercentiles(
+    SwappyFrameDurationPercentiles* percentiles) const {
+    // Only queried now and then, so sort a copy of the window rather than
+    // keeping histograms up to date.
+    int64_t cpuTimes[WINDOW];
+    int64_t gpuTimes[WINDOW];
+    for (int i = 0; i < mFrameCount; ++i) {
+        cpuTimes[i] = mFrames[i].getCpuTime().count();
+        gpuTimes[i] = mFrames[i].getGpuTime().count();
+    }
+    std::sort(cpuTimes, cpuTimes + mFrameCount);
+    std::sort(gpuTimes, gpuTimes + mFrameCount);
+    const int p50 = (mFrameCount - 1) * 50 / 100;
+    const int p95 = (mFrameCount - 1) * 95 / 100;
+    percentiles->frameCount = mFrameCount;
+    percentiles->cpuTimeP50Nanos = mFrameCount ? cpuTimes[p50] : 0;
+    percentiles->cpuTimeP95Nanos = mFrameCount ? cpuTimes[p95] : 0;
+    percentiles->gpuTimeP50Nanos = mFrameCount ? gpuTimes[p50] : 0;
+    percentiles->gpuTimeP95Nanos = mFrameCount ? gpuTimes[p95] : 0;
+}
+
+bool PredictiveSwapIntervalController::update(const Limits& limits,
+                                              Config* config,
+                                              nanoseconds* preferredFrameTime) {
+    *preferredFrameTime = getFrameTime();
+    if (*preferredFrameTime == 0ns) return false;
+
+    const nanoseconds pipelineFrameTime = *preferredFrameTime;
+    const nanoseconds nonPipelineFrameTime(
+        static_cast<int64_t>(mNonPipelineEstimate));
+    const nanoseconds upperBound = limits.refreshPeriod * config->swapInterval;
+    const nanoseconds frameTime = config->pipelineMode == PipelineMode::On
+                                      ? pipelineFrameTime
+                                      : nonPipelineFrameTime;
+    const Config original = *config;
+
+    if (frameTime > upperBound ||
+        mMissedFrameCount >= MISSED_FRAMES_THRESHOLD) {
+        // Pipelining may be enough, otherwise slow down as far as needed.
+        if (config->pipelineMode == PipelineMode::Off &&
+            pipelineFrameTime <= upperBound) {
+            SWAPPY_LOGV("Turning on pipelining");
+        } else if (upperBound <= limits.maxAutoSwapDuration +
+                                     FrameDuration::FRAME_MARGIN) {
+            config->swapInterval = std::max(
+                config->swapInterval + 1,
+                calculateSwapInterval(pipelineFrameTime, limits.refreshPeriod));
+        }
+        config->pipelineMode = PipelineMode::On;
+        mFasterFitsSince = {};
+        mNonPipelineFitsSince = {};
+    } else {
+        const nanoseconds frameTimeWithHeadroom =
+            pipelineFrameTime * (100 + FASTER_HEADROOM_PERCENT) / 100;
+        const int fasterSwapInterval = std::max(
+            calculateSwapInterval(frameTimeWithHeadroom, limits.refreshPeriod),
+            calculateSwapInterval(limits.swapDuration, limits.refreshPeriod));
+        if (fasterSwapInterval < config->swapInterval) {
+            if (mFasterFitsSince == TimePoint()) {
+                mFasterFitsSince = mLastFrameTime;
+            } else if (mLastFrameTime - mFasterFitsSince >= FASTER_HOLD_TIME) {
+                config->swapInterval = fasterSwapInterval;
+                config->pipelineMode = PipelineMode::On;
+            }
+        } else {
+            mFasterFitsSince = {};
+        }
+
+        const auto nonPipelinePercent = (100.f + NON_PIPELINE_PERCENT) / 100.f;
+        if (limits.autoPipelineMode &&
+            config->pipelineMode == PipelineMode::On &&
+            config->swapInterval == original.swapInterval &&
+            nonPipelineFrameTime * nonPipelinePercent < upperBound) {
+            if (mNonPipelineFitsSince == TimePoint()) {
+                mNonPipelineFitsSince = mLastFrameTime;
+            } else if (mLastFrameTime - mNonPipelineFitsSince >=
+                       FASTER_HOLD_TIME) {
+                SWAPPY_LOGV("Turning off pipelining");
+                config->pipelineMode = PipelineMode::Off;
+            }
+        } else {
+            mNonPipelineFitsSince = {};
+        }
+    }
+
+    const bool configChanged = config->swapInterval != original.swapInterval ||
+                               config->pipelineMode != original.pipelineMode;
+    if (configChanged) {
+        SWAPPY_LOGV("Changing swap interval to %d from %d, pipelining %s",
+                    config->swapInterval, original.swapInterval,
+                    config->pipelineMode == PipelineMode::On ? "on" : "off");
+        clearMissedFrames();
+    }
+    return configChanged;
+}
+
+}  // namespace swappy
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <swappy/swappy_common.h>
+
+#include <chrono>
+#include <memory>
+
+#include "FrameDurations.h"
+
+namespace swappy {
+
+// The number of refresh periods needed to show frames of the given duration.
+int calculateSwapInterval(std::chrono::nanoseconds frameTime,
+                          std::chrono::nanoseconds refreshPeriod);
+
+// Decides the swap interval and pipeline mode from the durations of recent
+// frames. SwappyCommon owns one controller at a time, chosen with
+// SwappyGL_setSwapIntervalController or SwappyVk_setSwapIntervalController,
+// and calls it from the swapping thread with its mutex held.
+class SwapIntervalController {
+   public:
+    // The bounds the controller must keep to.
+    struct Limits {
+        std::chrono::nanoseconds refreshPeriod;
+        // The swap duration set by the app. Frames are never swapped faster.
+        std::chrono::nanoseconds swapDuration;
+        // The swap interval isn't raised once frames take longer than this.
+        std::chrono::nanoseconds maxAutoSwapDuration;
+        // Whether pipelining may be turned off.
+        bool autoPipelineMode;
+    };
+
+    struct Config {
+        int32_t swapInterval;
+        PipelineMode pipelineMode;
+    };
+
+    static std::unique_ptr<SwapIntervalController> create(
+        SwappySwapIntervalController type);
+
+    virtual ~SwapIntervalController() = default;
+
+    virtual SwappySwapIntervalController getType() const = 0;
+
+    virtual void addFrame(std::chrono::steady_clock::time_point time,
+                          const FrameDuration& duration) = 0;
+
+    // Updates config for the frames added so far and returns whether it
+    // changed. preferredFrameTime is set to the frame time the display refresh
+    // rate should be chosen for, or to 0 if there are too few frames to tell.
+    virtual bool update(const Limits& limits, Config* config,
+                        std::chrono::nanoseconds* preferredFrameTime) = 0;
+
+    // The expected frame time in pipeline mode, or 0 if it isn't known yet.
+    virtual std::chrono::nanoseconds getFrameTime() const = 0;
+
+    // Called when the refresh period or swap duration changes.
+    virtual void onSettingsChanged() = 0;
+
+    // The CPU and GPU time percentiles of the frames the controller is
+    // currently basing its decisions on.
+    virtual void getFrameDurationPercentiles(
+        SwappyFrameDurationPercentiles* percentiles) const = 0;
+};
+
+// Compares the mean frame time over the last 2 seconds, and the percentage of
+// frames that missed their deadline, to fixed thresholds. History is
+// discarded after each change.
+class AverageSwapIntervalController : public SwapIntervalController {
+   public:
+    SwappySwapIntervalController getType() const override {
+        return SWAPPY_SWAP_INTERVAL_CONTROLLER_AVERAGE;
+    }
+    void addFrame(std::chrono::steady_clock::time_point time,
+                  const FrameDuration& duration) override;
+    bool update(const Limits& limits, Config* config,
+                std::chrono::nanoseconds* preferredFrameTime) override;
+    std::chrono::nanoseconds getFrameTime() const override;
+    void onSettingsChanged() override { mFrameDurations.clear(); }
+    void getFrameDurationPercentiles(
+        SwappyFrameDurationPercentiles* percentiles) const override {
+        mFrameDurations.getPercentiles(percentiles);
+    }
+
+   private:
+    bool swapFaster(const Limits& limits, int newSwapInterval,
+                    Config* config);
+    bool swapSlower(const Limits& limits, const FrameDuration& averageFrameTime,
+                    std::chrono::nanoseconds upperBound, int newSwapInterval,
+                    Config* config);
+
+    static constexpr std::chrono::nanoseconds DURATION_ROUNDING_MARGIN = 1us;
+    static constexpr int NON_PIPELINE_PERCENT = 50;  // 50%
+    static constexpr int FRAME_DROP_THRESHOLD = 10;  // 10%
+
+    FrameDurations mFrameDurations;
+};
+
+// Predicts the next frame times from the 90th percentile of the last frames,
+// smoothed so that the prediction rises quickly when frames get slower and
+// falls slowly when they get faster. The swap interval is raised as soon as the
+// prediction no longer fits, and only lowered once the prediction has fitted
+// the lower interval with some headroom for a while. History is kept across
+// changes, as the prediction doesn't depend on the current config.
+class PredictiveSwapIntervalController : public SwapIntervalController {
+   public:
+    PredictiveSwapIntervalController();
+
+    SwappySwapIntervalController getType() const override {
+        return SWAPPY_SWAP_INTERVAL_CONTROLLER_PREDICTIVE;
+    }
+    void addFrame(std::chrono::steady_clock::time_point time,
+                  const FrameDuration& duration) override;
+    bool update(const Limits& limits, Config* config,
+                std::chrono::nanoseconds* preferredFrameTime) override;
+    std::chrono::nanoseconds getFrameTime() const override;
+    void onSettingsChanged() override;
+    void getFrameDurationPercentiles(
+        SwappyFrameDurationPercentiles* percentiles) const override;
+
+   private:
+    static constexpr int WINDOW = 32;
+    static constexpr int PERCENTILE = 90;
+    // Frames needed before the first change.
+    static constexpr int MIN_FRAMES = 16;
+    // Missed frames in the window that force a slower config, even if the
+    // prediction fits.
+    static constexpr int MISSED_FRAMES_THRESHOLD = 3;
+    static constexpr std::chrono::nanoseconds RISE_TIME_CONSTANT = 50ms;
+    static constexpr std::chrono::nanoseconds FALL_TIME_CONSTANT = 1s;
+    // How long a faster config must be predicted to fit before switching.
+    static constexpr std::chrono::nanoseconds FASTER_HOLD_TIME = 2s;
+    // The headroom, in percent of the prediction, a faster config must have.
+    static constexpr int FASTER_HEADROOM_PERCENT = 10;
+    // As for the average controller, be conservative when turning pipelining
+    // off.
+    static constexpr int NON_PIPELINE_PERCENT = 50;
+
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    static void smooth(float* estimate, std::chrono::nanoseconds sample,
+                       std::chrono::nanoseconds elapsed);
+    void clearMissedFrames();
+
+    FrameDuration mFrames[WINDOW];
+    int mFrameCount = 0;
+    int mNextFrame = 0;
+    int mMissedFrameCount = 0;
+    TimePoint mLastFrameTime;
+
+    // Predicted frame times, in nanoseconds.
+    float mPipelineEstimate = 0;
+    float mNonPipelineEstimate = 0;
+
+    // When faster configs started to fit, or TimePoint() if they don't.
+    TimePoint mFasterFitsSince;
+    TimePoint mNonPipelineFitsSince;
+};
+
+}  // namespace swappy
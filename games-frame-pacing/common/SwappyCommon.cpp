@@ -33,14 +33,12 @@ using std::chrono::milliseconds;
 using std::chrono::nanoseconds;
 
 // NB These are only needed for C++14
-constexpr nanoseconds SwappyCommon::FrameDuration::MAX_DURATION;
 constexpr nanoseconds SwappyCommon::FRAME_MARGIN;
-constexpr nanoseconds SwappyCommon::DURATION_ROUNDING_MARGIN;
-constexpr nanoseconds SwappyCommon::REFRESH_RATE_MARGIN;
-constexpr int SwappyCommon::NON_PIPELINE_PERCENT;
-constexpr int SwappyCommon::FRAME_DROP_THRESHOLD;
-constexpr std::chrono::nanoseconds
-    SwappyCommon::FrameDurations::FRAME_DURATION_SAMPLE_SECONDS;
+
+static int64_t toNanos(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<nanoseconds>(t.time_since_epoch())
+        .count();
+}
 
 #if __ANDROID_API__ < 30
 // Define ANATIVEWINDOW_FRAME_RATE_COMPATIBILITY_* to allow compilation on older
@@ -261,6 +259,7 @@ void SwappyCommon::onRefreshRateChanged() {
 nanoseconds SwappyCommon::wakeClient() {
     std::lock_guard<std::mutex> lock(mWaitingMutex);
     ++mCurrentFrame;
+    mChoreographerTime = std::chrono::steady_clock::now();
 
     // We're attempting to align with SurfaceFlinger's vsync, but it's always
     // better to be a little late than a little early (since a little early
@@ -302,6 +301,12 @@ bool SwappyCommon::waitForNextFrame(const SwapHandlers& h) {
             : std::chrono::steady_clock::now() - mStartFrameTime;
     mCPUTracer.endTrace();
 
+    const bool recordTimeline = mFrameTimeline.isEnabled();
+    if (recordTimeline) {
+        mFrameRecord.preWaitTimeNanos =
+            toNanos(std::chrono::steady_clock::now());
+    }
+
     preWaitCallbacks();
 
     // if we are running slower than the threshold (if auto swap interval is
@@ -327,6 +332,15 @@ bool SwappyCommon::waitForNextFrame(const SwapHandlers& h) {
     const nanoseconds gpuTime = h.getPrevFrameGpuTime();
     addFrameDuration({cpuTime, gpuTime, mCurrentFrame > mTargetFrame});
 
+    if (recordTimeline) {
+        mFrameRecord.postWaitTimeNanos =
+            toNanos(std::chrono::steady_clock::now());
+        mFrameRecord.cpuTimeNanos = cpuTime.count();
+        mFrameRecord.gpuTimeNanos = gpuTime.count();
+        mFrameRecord.lateFrames = lateFrames;
+        mFrameRecord.desiredPresentTimeNanos = toNanos(mPresentationTime);
+    }
+
     postWaitCallbacks(cpuTime, gpuTime);
 
     return presentationTimeIsNeeded;
@@ -359,8 +373,7 @@ void SwappyCommon::updateDisplayTimings() {
     mWindowChanged = false;
     mCommonSettings.refreshPeriod = mNextTimingSettings.refreshPeriod;
 
-    const auto pipelineFrameTime =
-        mFrameDurations.getAverageFrameTime().getTime(PipelineMode::On);
+    const auto pipelineFrameTime = mSwapIntervalController->getFrameTime();
     const auto swapDuration =
         pipelineFrameTime != 0ns ? pipelineFrameTime : mSwapDuration;
     mAutoSwapInterval =
@@ -386,7 +399,7 @@ void SwappyCommon::updateDisplayTimings() {
         setPreferredRefreshPeriod(mSwapDuration);
     }
 
-    mFrameDurations.clear();
+    mSwapIntervalController->onSettingsChanged();
 
     TRACE_INT("mSwapDuration", int(mSwapDuration.count()));
     TRACE_INT("mAutoSwapInterval", mAutoSwapInterval);
@@ -431,6 +444,13 @@ void SwappyCommon::onPostSwap(const SwapHandlers& h) {
 
     updateDisplayTimings();
 
+    // Frames started before the timeline was enabled aren't recorded.
+    if (mFrameTimeline.isEnabled() && mFrameRecord.startFrameTimeNanos != 0) {
+        mFrameRecord.swapTimeNanos = toNanos(mSwapTime);
+        mFrameTimeline.record(mFrameRecord);
+    }
+    mFrameRecord = {};
+
     startFrame();
 }
 
@@ -455,187 +475,34 @@ nanoseconds SwappyCommon::getSwapDuration() {
     return mAutoSwapInterval * mCommonSettings.refreshPeriod;
 };
 
-void SwappyCommon::FrameDurations::add(FrameDuration frameDuration) {
-    const auto now = std::chrono::steady_clock::now();
-    mFrames.push_back({now, frameDuration});
-    mFrameDurationsSum += frameDuration;
-    if (frameDuration.frameMiss()) {
-        mMissedFrameCount++;
-    }
-
-    while (mFrames.size() >= 2 &&
-           now - (mFrames.begin() + 1)->first > FRAME_DURATION_SAMPLE_SECONDS) {
-        mFrameDurationsSum -= mFrames.front().second;
-        if (mFrames.front().second.frameMiss()) {
-            mMissedFrameCount--;
-        }
-        mFrames.pop_front();
-    }
-}
-
-bool SwappyCommon::FrameDurations::hasEnoughSamples() const {
-    return (!mFrames.empty()) && (mFrames.back().first - mFrames.front().first >
-                                  FRAME_DURATION_SAMPLE_SECONDS);
-}
-
-SwappyCommon::FrameDuration SwappyCommon::FrameDurations::getAverageFrameTime()
-    const {
-    if (hasEnoughSamples()) {
-        return mFrameDurationsSum / mFrames.size();
-    }
-
-    return {};
-}
-
-int SwappyCommon::FrameDurations::getMissedFramePercent() const {
-    return round(mMissedFrameCount * 100.0f / mFrames.size());
-}
-
-void SwappyCommon::FrameDurations::clear() {
-    mFrames.clear();
-    mFrameDurationsSum = {};
-    mMissedFrameCount = 0;
-}
-
 void SwappyCommon::addFrameDuration(FrameDuration duration) {
     SWAPPY_LOGV("cpuTime = %.2f", duration.getCpuTime().count() / 1e6f);
     SWAPPY_LOGV("gpuTime = %.2f", duration.getGpuTime().count() / 1e6f);
     SWAPPY_LOGV("frame %s", duration.frameMiss() ? "MISS" : "on time");
 
     std::lock_guard<std::mutex> lock(mMutex);
-    mFrameDurations.add(duration);
-}
-
-bool SwappyCommon::swapSlower(const FrameDuration& averageFrameTime,
-                              const nanoseconds& upperBound,
-                              int newSwapInterval) {
-    bool swappedSlower = false;
-    SWAPPY_LOGV("Rendering takes too much time for the given config");
-
-    const auto frameFitsUpperBound =
-        averageFrameTime.getTime(PipelineMode::On) <= upperBound;
-    const auto swapDurationWithinThreshold =
-        mCommonSettings.refreshPeriod * mAutoSwapInterval <=
-        mAutoSwapIntervalThreshold.load() + FRAME_MARGIN;
-
-    // Check if turning on pipeline is not enough
-    if ((mPipelineMode == PipelineMode::On || !frameFitsUpperBound) &&
-        swapDurationWithinThreshold) {
-        int originalAutoSwapInterval = mAutoSwapInterval;
-        if (newSwapInterval > mAutoSwapInterval) {
-            mAutoSwapInterval = newSwapInterval;
-        } else {
-            mAutoSwapInterval++;
-        }
-        if (mAutoSwapInterval != originalAutoSwapInterval) {
-            SWAPPY_LOGV("Changing Swap interval to %d from %d",
-                        mAutoSwapInterval, originalAutoSwapInterval);
-            swappedSlower = true;
-        }
-    }
-
-    if (mPipelineMode == PipelineMode::Off) {
-        SWAPPY_LOGV("turning on pipelining");
-        mPipelineMode = PipelineMode::On;
-    }
-
-    return swappedSlower;
-}
-
-bool SwappyCommon::swapFaster(int newSwapInterval) {
-    bool swappedFaster = false;
-    int originalAutoSwapInterval = mAutoSwapInterval;
-    while (newSwapInterval < mAutoSwapInterval && swapFasterCondition()) {
-        mAutoSwapInterval--;
-    }
-
-    if (mAutoSwapInterval != originalAutoSwapInterval) {
-        SWAPPY_LOGV("Rendering is much shorter for the given config");
-        SWAPPY_LOGV("Changing Swap interval to %d from %d", mAutoSwapInterval,
-                    originalAutoSwapInterval);
-        // since we changed the swap interval, we may need to turn on pipeline
-        // mode
-        SWAPPY_LOGV("Turning on pipelining");
-        mPipelineMode = PipelineMode::On;
-        swappedFaster = true;
-    }
-
-    return swappedFaster;
+    mSwapIntervalController->addFrame(std::chrono::steady_clock::now(),
+                                      duration);
 }
 
 bool SwappyCommon::updateSwapInterval() {
     std::lock_guard<std::mutex> lock(mMutex);
     if (!mAutoSwapIntervalEnabled) return false;
 
-    if (!mFrameDurations.hasEnoughSamples()) return false;
-
-    const auto averageFrameTime = mFrameDurations.getAverageFrameTime();
-    const auto pipelineFrameTime = averageFrameTime.getTime(PipelineMode::On);
-    const auto nonPipelineFrameTime =
-        averageFrameTime.getTime(PipelineMode::Off);
-
-    // calculate the new swap interval based on average frame time assume we are
-    // in pipeline mode (prefer higher swap interval rather than turning off
-    // pipeline mode)
-    const int newSwapInterval =
-        calculateSwapInterval(pipelineFrameTime, mCommonSettings.refreshPeriod);
-
-    // Define upper and lower bounds based on the swap duration
-    const nanoseconds upperBoundForThisRefresh =
-        mCommonSettings.refreshPeriod * mAutoSwapInterval;
-    const nanoseconds lowerBoundForThisRefresh =
-        mCommonSettings.refreshPeriod * (mAutoSwapInterval - 1) - FRAME_MARGIN;
-
-    const int missedFramesPercent = mFrameDurations.getMissedFramePercent();
-
-    SWAPPY_LOGV("mPipelineMode = %d", static_cast<int>(mPipelineMode));
-    SWAPPY_LOGV("Average cpu frame time = %.2f",
-                (averageFrameTime.getCpuTime().count()) / 1e6f);
-    SWAPPY_LOGV("Average gpu frame time = %.2f",
-                (averageFrameTime.getGpuTime().count()) / 1e6f);
-    SWAPPY_LOGV("upperBound = %.2f", upperBoundForThisRefresh.count() / 1e6f);
-    SWAPPY_LOGV("lowerBound = %.2f", lowerBoundForThisRefresh.count() / 1e6f);
-    SWAPPY_LOGV("frame missed = %d%%", missedFramesPercent);
-
-    bool configChanged = false;
-    SWAPPY_LOGV("pipelineFrameTime = %.2f", pipelineFrameTime.count() / 1e6f);
-    const auto nonPipelinePercent = (100.f + NON_PIPELINE_PERCENT) / 100.f;
-
-    // Make sure the frame time fits in the current config to avoid missing
-    // frames
-    if (missedFramesPercent > FRAME_DROP_THRESHOLD) {
-        if (swapSlower(averageFrameTime, upperBoundForThisRefresh,
-                       newSwapInterval))
-            configChanged = true;
-    }
-
-    // So we shouldn't miss any frames with this config but maybe we can go
-    // faster ? we check the pipeline frame time here as we prefer lower swap
-    // interval than no pipelining
-    else if (missedFramesPercent == 0 && swapFasterCondition() &&
-             pipelineFrameTime < lowerBoundForThisRefresh) {
-        if (swapFaster(newSwapInterval)) configChanged = true;
-    }
-
-    // If we reached to this condition it means that we fit into the boundaries.
-    // However we might be in pipeline mode and we could turn it off if we still
-    // fit. To be very conservative, switch to non-pipeline if frame time * 50%
-    // fits
-    else if (mPipelineModeAutoMode && mPipelineMode == PipelineMode::On &&
-             nonPipelineFrameTime * nonPipelinePercent <
-                 upperBoundForThisRefresh) {
-        SWAPPY_LOGV(
-            "Rendering time fits the current swap interval without pipelining");
-        mPipelineMode = PipelineMode::Off;
-        configChanged = true;
-    }
+    const SwapIntervalController::Limits limits = {
+        mCommonSettings.refreshPeriod, mSwapDuration,
+        mAutoSwapIntervalThreshold.load(), mPipelineModeAutoMode};
+    SwapIntervalController::Config config = {mAutoSwapInterval, mPipelineMode};
+    nanoseconds preferredFrameTime;
+    const bool configChanged =
+        mSwapIntervalController->update(limits, &config, &preferredFrameTime);
+    mAutoSwapInterval = config.swapInterval;
+    mPipelineMode = config.pipelineMode;
 
-    if (configChanged) {
-        mFrameDurations.clear();
+    if (preferredFrameTime != 0ns) {
+        setPreferredRefreshPeriod(preferredFrameTime);
     }
 
-    setPreferredRefreshPeriod(pipelineFrameTime);
-
     return configChanged;
 }
 
@@ -736,6 +603,19 @@ void SwappyCommon::setAutoPipelineMode(bool enabled) {
     }
 }
 
+void SwappyCommon::setSwapIntervalController(
+    SwappySwapIntervalController type) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mSwapIntervalController->getType() == type) return;
+    mSwapIntervalController = SwapIntervalController::create(type);
+}
+
+void SwappyCommon::getFrameDurationPercentiles(
+    SwappyFrameDurationPercentiles* percentiles) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSwapIntervalController->getFrameDurationPercentiles(percentiles);
+}
+
 void SwappyCommon::setPreferredDisplayModeId(int modeId) {
     if (!mDisplayManager || modeId < 0 || mNextModeId == modeId) {
         return;
@@ -746,20 +626,6 @@ void SwappyCommon::setPreferredDisplayModeId(int modeId) {
     SWAPPY_LOGV("setPreferredDisplayModeId set to %d", modeId);
 }
 
-int SwappyCommon::calculateSwapInterval(nanoseconds frameTime,
-                                        nanoseconds refreshPeriod) {
-    if (frameTime < refreshPeriod) {
-        return 1;
-    }
-
-    auto div_result = div(frameTime.count(), refreshPeriod.count());
-    auto framesPerRefresh = div_result.quot;
-    auto framesPerRefreshRemainder = div_result.rem;
-
-    return (framesPerRefresh +
-            (framesPerRefreshRemainder > REFRESH_RATE_MARGIN.count() ? 1 : 0));
-}
-
 void SwappyCommon::setPreferredRefreshPeriod(nanoseconds frameTime) {
     if (mANativeWindow_setFrameRate && mWindow) {
         auto frameRate = 1e9f / frameTime.count();
@@ -835,10 +701,12 @@ void SwappyCommon::startFrame() {
 
     int32_t currentFrame;
     std::chrono::steady_clock::time_point currentFrameTimestamp;
+    std::chrono::steady_clock::time_point choreographerTime;
     {
         std::unique_lock<std::mutex> lock(mWaitingMutex);
         currentFrame = mCurrentFrame;
         currentFrameTimestamp = mCurrentFrameTimestamp;
+        choreographerTime = mChoreographerTime;
     }
 
     // Whether to add a wait to fix buffer stuffing.
@@ -880,6 +748,15 @@ void SwappyCommon::startFrame() {
     mStartFrameTime = std::chrono::steady_clock::now();
     mCPUTracer.startTrace();
 
+    if (mFrameTimeline.isEnabled()) {
+        mFrameRecord.type = SWAPPY_FRAME_RECORD_FRAME;
+        mFrameRecord.swapInterval = mAutoSwapInterval;
+        mFrameRecord.pipelineMode = mPipelineMode == PipelineMode::On;
+        mFrameRecord.choreographerTimeNanos = toNanos(choreographerTime);
+        mFrameRecord.startFrameTimeNanos = toNanos(mStartFrameTime);
+        mFrameRecord.desiredPresentTimeNanos = toNanos(mPresentationTime);
+    }
+
     startFrameCallbacks();
 }
 
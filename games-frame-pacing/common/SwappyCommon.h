@@ -28,6 +28,8 @@
 #include "CPUTracer.h"
 #include "ChoreographerFilter.h"
 #include "ChoreographerThread.h"
+#include "FrameTimeline.h"
+#include "SwapIntervalController.h"
 #include "SwappyDisplayManager.h"
 #include "Thread.h"
 #include "swappy/swappyGL.h"
@@ -60,7 +62,7 @@ struct SwappyCommonSettings {
 // Common part between OpenGL and Vulkan implementations.
 class SwappyCommon {
    public:
-    enum class PipelineMode { Off, On };
+    using PipelineMode = swappy::PipelineMode;
 
     // callbacks to be called during pre/post swap
     struct SwapHandlers {
@@ -96,6 +98,9 @@ class SwappyCommon {
 
     void setAutoSwapInterval(bool enabled);
     void setAutoPipelineMode(bool enabled);
+    void setSwapIntervalController(SwappySwapIntervalController type);
+    void getFrameDurationPercentiles(
+        SwappyFrameDurationPercentiles* percentiles);
 
     void setMaxAutoSwapDuration(std::chrono::nanoseconds swapDuration) {
         mAutoSwapIntervalThreshold = swapDuration;
@@ -128,77 +133,16 @@ class SwappyCommon {
         mLastLatencyRecorded = callback;
     }
 
+    FrameTimeline& getFrameTimeline() { return mFrameTimeline; }
+
    protected:
     // Used for testing
     SwappyCommon(const SwappyCommonSettings& settings);
 
    private:
-    class FrameDuration {
-       public:
-        FrameDuration() = default;
-
-        FrameDuration(std::chrono::nanoseconds cpuTime,
-                      std::chrono::nanoseconds gpuTime,
-                      bool frameMissedDeadline)
-            : mCpuTime(cpuTime),
-              mGpuTime(gpuTime),
-              mFrameMissedDeadline(frameMissedDeadline) {
-            mCpuTime = std::min(mCpuTime, MAX_DURATION);
-            mGpuTime = std::min(mGpuTime, MAX_DURATION);
-        }
-
-        std::chrono::nanoseconds getCpuTime() const { return mCpuTime; }
-        std::chrono::nanoseconds getGpuTime() const { return mGpuTime; }
-
-        bool frameMiss() const { return mFrameMissedDeadline; }
-
-        std::chrono::nanoseconds getTime(PipelineMode pipeline) const {
-            if (mCpuTime == 0ns && mGpuTime == 0ns) {
-                return 0ns;
-            }
-
-            if (pipeline == PipelineMode::On) {
-                return std::max(mCpuTime, mGpuTime) + FRAME_MARGIN;
-            }
-
-            return mCpuTime + mGpuTime + FRAME_MARGIN;
-        }
-
-        FrameDuration& operator+=(const FrameDuration& other) {
-            mCpuTime += other.mCpuTime;
-            mGpuTime += other.mGpuTime;
-            return *this;
-        }
-
-        FrameDuration& operator-=(const FrameDuration& other) {
-            mCpuTime -= other.mCpuTime;
-            mGpuTime -= other.mGpuTime;
-            return *this;
-        }
-
-        friend FrameDuration operator/(FrameDuration lhs, int rhs) {
-            lhs.mCpuTime /= rhs;
-            lhs.mGpuTime /= rhs;
-            return lhs;
-        }
-
-       private:
-        std::chrono::nanoseconds mCpuTime = std::chrono::nanoseconds(0);
-        std::chrono::nanoseconds mGpuTime = std::chrono::nanoseconds(0);
-        bool mFrameMissedDeadline = false;
-
-        static constexpr std::chrono::nanoseconds MAX_DURATION =
-            std::chrono::milliseconds(100);
-    };
-
     void addFrameDuration(FrameDuration duration);
     std::chrono::nanoseconds wakeClient();
 
-    bool swapFaster(int newSwapInterval) REQUIRES(mMutex);
-
-    bool swapSlower(const FrameDuration& averageFrameTime,
-                    const std::chrono::nanoseconds& upperBound,
-                    int newSwapInterval) REQUIRES(mMutex);
     bool updateSwapInterval();
     void preSwapBuffersCallbacks();
     void postSwapBuffersCallbacks();
@@ -216,8 +160,6 @@ class SwappyCommon {
     void setPreferredDisplayModeId(int index);
     void setPreferredRefreshPeriod(std::chrono::nanoseconds frameTime)
         REQUIRES(mMutex);
-    int calculateSwapInterval(std::chrono::nanoseconds frameTime,
-                              std::chrono::nanoseconds refreshPeriod);
     void updateDisplayTimings();
 
     // Waits for the next frame, considering both Choreographer and the prior
@@ -226,12 +168,6 @@ class SwappyCommon {
 
     void onRefreshRateChanged();
 
-    inline bool swapFasterCondition() {
-        return mSwapDuration <=
-               mCommonSettings.refreshPeriod * (mAutoSwapInterval - 1) +
-                   DURATION_ROUNDING_MARGIN;
-    }
-
     const jobject mJactivity;
     void* mLibAndroid = nullptr;
     PFN_ANativeWindow_setFrameRate mANativeWindow_setFrameRate = nullptr;
@@ -250,45 +186,26 @@ class SwappyCommon {
     std::chrono::steady_clock::time_point mCurrentFrameTimestamp =
         std::chrono::steady_clock::now();
     int32_t mCurrentFrame = 0;
+    std::chrono::steady_clock::time_point mChoreographerTime;
     std::atomic<std::chrono::nanoseconds> mMeasuredSwapDuration;
 
     std::chrono::steady_clock::time_point mSwapTime;
 
     std::mutex mMutex;
-    class FrameDurations {
-       public:
-        void add(FrameDuration frameDuration);
-        bool hasEnoughSamples() const;
-        FrameDuration getAverageFrameTime() const;
-        int getMissedFramePercent() const;
-        void clear();
-
-       private:
-        static constexpr std::chrono::nanoseconds
-            FRAME_DURATION_SAMPLE_SECONDS = 2s;
-
-        std::deque<std::pair<std::chrono::time_point<std::chrono::steady_clock>,
-                             FrameDuration>>
-            mFrames;
-        FrameDuration mFrameDurationsSum = {};
-        int mMissedFrameCount = 0;
-    };
-
-    FrameDurations mFrameDurations GUARDED_BY(mMutex);
+    std::unique_ptr<SwapIntervalController> mSwapIntervalController
+        GUARDED_BY(mMutex) = SwapIntervalController::create(
+            SWAPPY_SWAP_INTERVAL_CONTROLLER_AVERAGE);
 
     bool mAutoSwapIntervalEnabled GUARDED_BY(mMutex) = true;
     bool mPipelineModeAutoMode GUARDED_BY(mMutex) = true;
 
-    static constexpr std::chrono::nanoseconds FRAME_MARGIN = 1ms;
-    static constexpr std::chrono::nanoseconds DURATION_ROUNDING_MARGIN = 1us;
-    static constexpr int NON_PIPELINE_PERCENT = 50;  // 50%
-    static constexpr int FRAME_DROP_THRESHOLD = 10;  // 10%
+    static constexpr std::chrono::nanoseconds FRAME_MARGIN =
+        FrameDuration::FRAME_MARGIN;
 
     std::chrono::nanoseconds mSwapDuration = 0ns;
     int32_t mAutoSwapInterval;
     std::atomic<std::chrono::nanoseconds> mAutoSwapIntervalThreshold = {
         50ms};  // 20FPS
-    static constexpr std::chrono::nanoseconds REFRESH_RATE_MARGIN = 500ns;
 
     std::chrono::steady_clock::time_point mStartFrameTime;
 
@@ -366,6 +283,11 @@ class SwappyCommon {
     // Counts the number of consecutive missed frames (as judged by expected
     // latency).
     int mMissedFrameCounter = 0;
+
+    FrameTimeline mFrameTimeline;
+    // The record of the current frame, filled in while the timeline is
+    // enabled and added to it when the frame is swapped.
+    SwappyFrameRecord mFrameRecord = {};
 };
 
 }  // namespace swappy
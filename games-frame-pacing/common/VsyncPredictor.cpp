@@ -0,0 +1,165 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "VsyncPredictor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace swappy {
+
+using std::chrono::nanoseconds;
+
+// NB These are only needed for C++14
+constexpr int VsyncPredictor::WINDOW;
+constexpr int VsyncPredictor::MIN_SAMPLES;
+constexpr nanoseconds VsyncPredictor::MAX_GAP;
+constexpr int VsyncPredictor::MAX_PERIOD_ERROR_PERCENT;
+constexpr int VsyncPredictor::OUTLIER_PERCENT;
+
+VsyncPredictor::VsyncPredictor(nanoseconds nominalPeriod)
+    : mNominalPeriod(nominalPeriod) {
+    reset();
+}
+
+void VsyncPredictor::setNominalPeriod(nanoseconds nominalPeriod) {
+    mNominalPeriod = nominalPeriod;
+    reset();
+}
+
+void VsyncPredictor::reset() {
+    mCount = 0;
+    mLast = 0;
+    mPhase = 0;
+    mPeriod = mNominalPeriod.count();
+}
+
+void VsyncPredictor::addTimestamp(TimePoint timestamp) {
+    const double offset = (timestamp - mBase).count();
+    if (mCount > 0 && offset - mOffsets[mLast] > MAX_GAP.count()) {
+        reset();
+    }
+    if (mCount == 0) {
+        mBase = timestamp;
+        mVsyncs[0] = 0;
+        mOffsets[0] = 0;
+        mCount = 1;
+        return;
+    }
+
+    const int64_t vsync = std::llround((offset - mPhase) / mPeriod);
+    if (vsync <= mVsyncs[mLast]) {
+        // A second callback for the same vsync. Callbacks are only ever late,
+        // so keep the earliest.
+        if (vsync == mVsyncs[mLast] && offset < mOffsets[mLast]) {
+            mOffsets[mLast] = offset;
+            fit();
+        }
+        return;
+    }
+
+    mLast = (mLast + 1) % WINDOW;
+    mVsyncs[mLast] = vsync;
+    mOffsets[mLast] = offset;
+    if (mCount < WINDOW) mCount++;
+    fit();
+}
+
+bool VsyncPredictor::fitLine(const bool* use, double* period,
+                             double* phase) const {
+    // Least squares, relative to the means to keep precision.
+    int count = 0;
+    double meanVsync = 0;
+    double meanOffset = 0;
+    for (int i = 0; i < mCount; ++i) {
+        if (!use[i]) continue;
+        count++;
+        meanVsync += mVsyncs[i];
+        meanOffset += mOffsets[i];
+    }
+    if (count < MIN_SAMPLES) return false;
+    meanVsync /= count;
+    meanOffset /= count;
+    double covariance = 0;
+    double variance = 0;
+    for (int i = 0; i < mCount; ++i) {
+        if (!use[i]) continue;
+        const double dv = mVsyncs[i] - meanVsync;
+        covariance += dv * (mOffsets[i] - meanOffset);
+        variance += dv * dv;
+    }
+    if (variance == 0) return false;
+    *period = covariance / variance;
+    *phase = meanOffset - *period * meanVsync;
+    return true;
+}
+
+void VsyncPredictor::fit() {
+    if (mCount < MIN_SAMPLES) {
+        // Line up with the last callback until there are enough to fit.
+        mPeriod = mNominalPeriod.count();
+        mPhase = mOffsets[mLast] - mVsyncs[mLast] * mPeriod;
+        return;
+    }
+
+    bool use[WINDOW];
+    std::fill(use, use + mCount, true);
+    double period = 0;
+    double phase = 0;
+    fitLine(use, &period, &phase);
+
+    // Callbacks are never early, but now and then very late, which would pull
+    // the line. Fit again without the ones well above the median.
+    double residuals[WINDOW];
+    for (int i = 0; i < mCount; ++i) {
+        residuals[i] = mOffsets[i] - (phase + mVsyncs[i] * period);
+    }
+    double sorted[WINDOW];
+    std::copy(residuals, residuals + mCount, sorted);
+    std::nth_element(sorted, sorted + mCount / 2, sorted + mCount);
+    const double limit =
+        sorted[mCount / 2] + mNominalPeriod.count() * OUTLIER_PERCENT / 100;
+    for (int i = 0; i < mCount; ++i) {
+        use[i] = residuals[i] <= limit;
+    }
+    fitLine(use, &period, &phase);
+
+    const double nominal = mNominalPeriod.count();
+    if (std::abs(period - nominal) > nominal * MAX_PERIOD_ERROR_PERCENT / 100) {
+        // Most likely callbacks were numbered wrongly. Start again from the
+        // last one.
+        const TimePoint last =
+            mBase + nanoseconds(std::llround(mOffsets[mLast]));
+        reset();
+        addTimestamp(last);
+        return;
+    }
+    mPeriod = period;
+    mPhase = phase;
+}
+
+nanoseconds VsyncPredictor::getPeriod() const {
+    return nanoseconds(std::llround(mPeriod));
+}
+
+VsyncPredictor::TimePoint VsyncPredictor::getNextVsync(TimePoint time) const {
+    if (mCount == 0) return time;
+    const double offset = (time - mBase).count();
+    const double vsync = std::ceil((offset - mPhase) / mPeriod);
+    return mBase + nanoseconds(std::llround(mPhase + vsync * mPeriod));
+}
+
+}  // namespace swappy
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace swappy {
+
+// Estimates the phase and period of vsync from the times of choreographer
+// callbacks. Each callback is numbered with the vsync it is most likely for,
+// which copes with missed callbacks, and a least squares line is fitted through
+// the last WINDOW of them, leaving out any that were very late. Until there are
+// enough callbacks, or if the fitted period is far from the nominal one, the
+// nominal period is used.
+class VsyncPredictor {
+   public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    static constexpr int WINDOW = 32;
+    static constexpr int MIN_SAMPLES = 6;
+
+    explicit VsyncPredictor(std::chrono::nanoseconds nominalPeriod);
+
+    // Forgets all callbacks, as the display refresh rate has changed.
+    void setNominalPeriod(std::chrono::nanoseconds nominalPeriod);
+    void reset();
+
+    void addTimestamp(TimePoint timestamp);
+
+    int getSampleCount() const { return mCount; }
+    std::chrono::nanoseconds getPeriod() const;
+
+    // The first predicted vsync at or after time, or time itself if there
+    // have been no callbacks yet.
+    TimePoint getNextVsync(TimePoint time) const;
+
+   private:
+    // Callbacks this far apart restart the fit, as vsync numbers can't be
+    // trusted over the gap.
+    static constexpr std::chrono::nanoseconds MAX_GAP = std::chrono::seconds(1);
+    // How far, in percent, the fitted period may be from the nominal one.
+    static constexpr int MAX_PERIOD_ERROR_PERCENT = 10;
+    // Callbacks later than the median by this percent of a period are left
+    // out of the fit.
+    static constexpr int OUTLIER_PERCENT = 15;
+
+    // Fits a line through the callbacks marked in use, if there are enough.
+    bool fitLine(const bool* use, double* period, double* phase) const;
+    void fit();
+
+    std::chrono::nanoseconds mNominalPeriod;
+
+    // Vsync numbers and times, in nanoseconds since mBase, of the callbacks.
+    int64_t mVsyncs[WINDOW];
+    double mOffsets[WINDOW];
+    int mCount = 0;
+    int mLast = 0;
+    TimePoint mBase;
+
+    // The fitted line: vsync n is at mBase + mPhase + n * mPeriod.
+    double mPhase = 0;
+    double mPeriod = 0;
+};
+
+}  // namespace swappy
@@ -19,7 +19,7 @@
 #include <Trace.h>
 #include <dlfcn.h>
 
-#include <vector>
+#include <algorithm>
 
 #define LOG_TAG "Swappy::EGL"
 
@@ -49,6 +49,27 @@ std::unique_ptr<EGL> EGL::create(std::chrono::nanoseconds fenceTimeout) {
         return nullptr;
     }
 
+    auto egl = create(fenceTimeout, eglGetProcAddress, eglSwapBuffers);
+    if (egl) {
+        egl->eglLib = eglLib;
+    }
+    return egl;
+}
+
+std::unique_ptr<EGL> EGL::create(std::chrono::nanoseconds fenceTimeout,
+                                 eglGetProcAddress_type getProcAddress) {
+    auto eglSwapBuffers = reinterpret_cast<eglSwapBuffers_type>(
+        getProcAddress("eglSwapBuffers"));
+    if (eglSwapBuffers == nullptr) {
+        SWAPPY_LOGE("Failed to load eglSwapBuffers");
+        return nullptr;
+    }
+    return create(fenceTimeout, getProcAddress, eglSwapBuffers);
+}
+
+std::unique_ptr<EGL> EGL::create(std::chrono::nanoseconds fenceTimeout,
+                                 eglGetProcAddress_type eglGetProcAddress,
+                                 eglSwapBuffers_type eglSwapBuffers) {
     auto eglPresentationTimeANDROID =
         reinterpret_cast<eglPresentationTimeANDROID_type>(
             eglGetProcAddress("eglPresentationTimeANDROID"));
@@ -64,6 +85,7 @@ std::unique_ptr<EGL> EGL::create(std::chrono::nanoseconds fenceTimeout) {
         return nullptr;
     }
 
+    // The fence waiter loads its own copies of these.
     auto eglDestroySyncKHR = reinterpret_cast<eglDestroySyncKHR_type>(
         eglGetProcAddress("eglDestroySyncKHR"));
     if (eglDestroySyncKHR == nullptr) {
@@ -109,13 +131,10 @@ std::unique_ptr<EGL> EGL::create(std::chrono::nanoseconds fenceTimeout) {
 
     auto egl = std::make_unique<EGL>(fenceTimeout, eglGetProcAddress,
                                      ConstructorTag{});
-    egl->eglLib = eglLib;
     egl->eglSwapBuffers = eglSwapBuffers;
     egl->eglGetProcAddress = eglGetProcAddress;
     egl->eglPresentationTimeANDROID = eglPresentationTimeANDROID;
     egl->eglCreateSyncKHR = eglCreateSyncKHR;
-    egl->eglDestroySyncKHR = eglDestroySyncKHR;
-    egl->eglGetSyncAttribKHR = eglGetSyncAttribKHR;
     egl->eglGetError = eglGetError;
     egl->eglSurfaceAttrib = eglSurfaceAttrib;
     egl->eglGetNextFrameIdANDROID = eglGetNextFrameIdANDROID;
@@ -129,49 +148,19 @@ EGL::~EGL() {
     }
 }
 void EGL::resetSyncFence(EGLDisplay display) {
-    std::lock_guard<std::mutex> lock(mSyncFenceMutex);
+    EGLSyncKHR syncFence =
+        eglCreateSyncKHR(display, EGL_SYNC_FENCE_KHR, nullptr);
 
-    if (mFenceWaiter.waitForIdle() && mSyncFence != EGL_NO_SYNC_KHR) {
-        EGLBoolean result = eglDestroySyncKHR(display, mSyncFence);
-        if (result == EGL_FALSE) {
-            SWAPPY_LOGE("Failed to destroy sync fence");
-        }
-    }
-
-    mSyncFence = eglCreateSyncKHR(display, EGL_SYNC_FENCE_KHR, nullptr);
-
-    if (mSyncFence != EGL_NO_SYNC_KHR) {
+    if (syncFence != EGL_NO_SYNC_KHR) {
         // kick of the thread work to wait for the fence and measure its time
-        mFenceWaiter.onFenceCreation(display, mSyncFence);
+        mFenceWaiter.onFenceCreation(display, syncFence);
     } else {
         SWAPPY_LOGE("Failed to create sync fence");
     }
 }
 
-bool EGL::lastFrameIsComplete(EGLDisplay display) {
-    std::lock_guard<std::mutex> lock(mSyncFenceMutex);
-
-    // This will be the case on the first frame
-    if (mSyncFence == EGL_NO_SYNC_KHR) {
-        return true;
-    }
-
-    EGLint status = 0;
-    EGLBoolean result =
-        eglGetSyncAttribKHR(display, mSyncFence, EGL_SYNC_STATUS_KHR, &status);
-    if (result == EGL_FALSE) {
-        SWAPPY_LOGE("Failed to get sync status");
-        return true;
-    }
-
-    if (status == EGL_SIGNALED_KHR) {
-        return true;
-    } else if (status == EGL_UNSIGNALED_KHR) {
-        return false;
-    } else {
-        SWAPPY_LOGE("Unexpected sync status: %d", status);
-        return true;
-    }
+bool EGL::lastFrameIsComplete(EGLDisplay) {
+    return mFenceWaiter.lastFenceIsComplete();
 }
 
 bool EGL::setPresentationTime(EGLDisplay display, EGLSurface surface,
@@ -203,25 +192,31 @@ std::pair<bool, EGLuint64KHR> EGL::getNextFrameId(EGLDisplay dpy,
     return {true, frameId};
 }
 
-std::unique_ptr<EGL::FrameTimestamps> EGL::getFrameTimestamps(
-    EGLDisplay dpy, EGLSurface surface, EGLuint64KHR frameId) const {
+#if (not defined ANDROID_NDK_VERSION) || ANDROID_NDK_VERSION >= 15
+// The timestamps queried for each frame, in the order of FrameTimestamps.
+static const EGLint FRAME_TIMESTAMP_NAMES[] = {
+    EGL_REQUESTED_PRESENT_TIME_ANDROID,
+    EGL_RENDERING_COMPLETE_TIME_ANDROID,
+    EGL_COMPOSITION_LATCH_TIME_ANDROID,
+    EGL_DISPLAY_PRESENT_TIME_ANDROID,
+};
+static constexpr int FRAME_TIMESTAMP_COUNT =
+    sizeof(FRAME_TIMESTAMP_NAMES) / sizeof(FRAME_TIMESTAMP_NAMES[0]);
+#endif
+
+bool EGL::getFrameTimestamps(EGLDisplay dpy, EGLSurface surface,
+                             EGLuint64KHR frameId,
+                             FrameTimestamps *timestamps) const {
 #if (not defined ANDROID_NDK_VERSION) || ANDROID_NDK_VERSION >= 15
     if (eglGetFrameTimestampsANDROID == nullptr) {
         SWAPPY_LOGE("stats are not supported on this platform");
-        return nullptr;
+        return false;
     }
-    const std::vector<EGLint> timestamps = {
-        EGL_REQUESTED_PRESENT_TIME_ANDROID,
-        EGL_RENDERING_COMPLETE_TIME_ANDROID,
-        EGL_COMPOSITION_LATCH_TIME_ANDROID,
-        EGL_DISPLAY_PRESENT_TIME_ANDROID,
-    };
-
-    std::vector<EGLnsecsANDROID> values(timestamps.size());
-
-    EGLBoolean result =
-        eglGetFrameTimestampsANDROID(dpy, surface, frameId, timestamps.size(),
-                                     timestamps.data(), values.data());
+
+    EGLnsecsANDROID values[FRAME_TIMESTAMP_COUNT];
+    EGLBoolean result = eglGetFrameTimestampsANDROID(
+        dpy, surface, frameId, FRAME_TIMESTAMP_COUNT, FRAME_TIMESTAMP_NAMES,
+        values);
     if (result == EGL_FALSE) {
         EGLint reason = eglGetError();
         if (reason == EGL_BAD_SURFACE) {
@@ -230,24 +225,21 @@ std::unique_ptr<EGL::FrameTimestamps> EGL::getFrameTimestamps(
             SWAPPY_LOGE_ONCE("Failed to get timestamps for frame %llu",
                              (unsigned long long)frameId);
         }
-        return nullptr;
+        return false;
     }
 
     // try again if we got some pending stats
     for (auto i : values) {
-        if (i == EGL_TIMESTAMP_PENDING_ANDROID) return nullptr;
+        if (i == EGL_TIMESTAMP_PENDING_ANDROID) return false;
     }
 
-    std::unique_ptr<EGL::FrameTimestamps> frameTimestamps =
-        std::make_unique<EGL::FrameTimestamps>();
-    frameTimestamps->requested = values[0];
-    frameTimestamps->renderingCompleted = values[1];
-    frameTimestamps->compositionLatched = values[2];
-    frameTimestamps->presented = values[3];
-
-    return frameTimestamps;
+    timestamps->requested = values[0];
+    timestamps->renderingCompleted = values[1];
+    timestamps->compositionLatched = values[2];
+    timestamps->presented = values[3];
+    return true;
 #else
-    return nullptr;
+    return false;
 #endif
 }
 
@@ -264,6 +256,10 @@ EGL::FenceWaiter::FenceWaiter(std::chrono::nanoseconds fenceTimeout,
         getProcAddress("eglDestroySyncKHR"));
     if (eglDestroySyncKHR == nullptr)
         SWAPPY_LOGE("Failed to load eglDestroySyncKHR");
+    eglGetSyncAttribKHR = reinterpret_cast<eglGetSyncAttribKHR_type>(
+        getProcAddress("eglGetSyncAttribKHR"));
+    if (eglGetSyncAttribKHR == nullptr)
+        SWAPPY_LOGE("Failed to load eglGetSyncAttribKHR");
 
     mFenceWaiter = Thread([this]() { threadMain(); });
 }
@@ -275,42 +271,102 @@ EGL::FenceWaiter::~FenceWaiter() {
         mFenceWaiterCondition.notify_all();
     }
     mFenceWaiter.join();
-}
 
-bool EGL::FenceWaiter::waitForIdle() {
+    // Destroy the fences that the thread didn't get to.
     std::lock_guard<std::mutex> lock(mFenceWaiterLock);
-    mFenceWaiterCondition.wait(
-        mFenceWaiterLock,
-        [this]() REQUIRES(mFenceWaiterLock) { return !mFenceWaiterPending; });
-    return mSyncFence != EGL_NO_SYNC_KHR;
+    for (; mPendingFenceCount > 0; mPendingFenceCount--) {
+        const Fence &fence = mPendingFences[mFirstPendingFence];
+        if (eglDestroySyncKHR(fence.display, fence.sync) == EGL_FALSE) {
+            SWAPPY_LOGE("Failed to destroy sync fence");
+        }
+        mFirstPendingFence = (mFirstPendingFence + 1) % MAX_FENCES_IN_FLIGHT;
+    }
 }
 
 void EGL::FenceWaiter::onFenceCreation(EGLDisplay display,
                                        EGLSyncKHR syncFence) {
+    const auto creationTime = std::chrono::steady_clock::now();
     std::lock_guard<std::mutex> lock(mFenceWaiterLock);
-    mDisplay = display;
-    mSyncFence = syncFence;
-    mFenceWaiterPending = true;
+    mFenceWaiterCondition.wait(
+        mFenceWaiterLock, [this]() REQUIRES(mFenceWaiterLock) {
+            return mPendingFenceCount < mMaxFencesInFlight;
+        });
+    const int index =
+        (mFirstPendingFence + mPendingFenceCount) % MAX_FENCES_IN_FLIGHT;
+    mPendingFences[index] = {display, syncFence, creationTime};
+    mPendingFenceCount++;
     mFenceWaiterCondition.notify_all();
 }
 
+bool EGL::FenceWaiter::lastFenceIsComplete() {
+    std::lock_guard<std::mutex> lock(mFenceWaiterLock);
+
+    // Fences are destroyed once they have been waited for, so the most recent
+    // one is complete if none are pending. This is also the first frame case.
+    if (mPendingFenceCount == 0) {
+        return true;
+    }
+
+    const Fence &fence =
+        mPendingFences[(mFirstPendingFence + mPendingFenceCount - 1) %
+                       MAX_FENCES_IN_FLIGHT];
+    EGLint status = 0;
+    EGLBoolean result = eglGetSyncAttribKHR(fence.display, fence.sync,
+                                            EGL_SYNC_STATUS_KHR, &status);
+    if (result == EGL_FALSE) {
+        SWAPPY_LOGE("Failed to get sync status");
+        return true;
+    }
+
+    if (status == EGL_SIGNALED_KHR) {
+        return true;
+    } else if (status == EGL_UNSIGNALED_KHR) {
+        return false;
+    } else {
+        SWAPPY_LOGE("Unexpected sync status: %d", status);
+        return true;
+    }
+}
+
+void EGL::FenceWaiter::setMaxFencesInFlight(int count) {
+    std::lock_guard<std::mutex> lock(mFenceWaiterLock);
+    mMaxFencesInFlight =
+        std::max(1, std::min(count, static_cast<int>(MAX_FENCES_IN_FLIGHT)));
+    mFenceWaiterCondition.notify_all();
+}
+
+int EGL::FenceWaiter::getMaxFencesInFlight() const {
+    std::lock_guard<std::mutex> lock(mFenceWaiterLock);
+    return mMaxFencesInFlight;
+}
+
 void EGL::FenceWaiter::threadMain() {
+    // When the previous fence was signalled, and so when the GPU could start
+    // on the work of the next one if it was already submitted.
+    std::chrono::steady_clock::time_point lastCompletionTime;
+
     std::lock_guard<std::mutex> lock(mFenceWaiterLock);
     while (mFenceWaiterRunning) {
         // wait for new fence object
         mFenceWaiterCondition.wait(
             mFenceWaiterLock, [this]() REQUIRES(mFenceWaiterLock) {
-                return mFenceWaiterPending || !mFenceWaiterRunning;
+                return mPendingFenceCount > 0 || !mFenceWaiterRunning;
             });
 
         if (!mFenceWaiterRunning) {
             break;
         }
 
-        gamesdk::ScopedTrace tracer("Swappy: GPU frame time");
-        const auto startTime = std::chrono::steady_clock::now();
-        EGLBoolean result = eglClientWaitSyncKHR(mDisplay, mSyncFence, 0,
-                                                 mFenceTimeout.count());
+        const Fence fence = mPendingFences[mFirstPendingFence];
+        // Don't hold the lock while waiting, so that more fences can be added.
+        mFenceWaiterLock.unlock();
+        EGLBoolean result;
+        {
+            gamesdk::ScopedTrace tracer("Swappy: GPU frame time");
+            result = eglClientWaitSyncKHR(fence.display, fence.sync, 0,
+                                          mFenceTimeout.count());
+        }
+        const auto completionTime = std::chrono::steady_clock::now();
         switch (result) {
             case EGL_FALSE:
                 SWAPPY_LOGE("Failed to wait sync");
@@ -319,17 +375,19 @@ void EGL::FenceWaiter::threadMain() {
                 SWAPPY_LOGE("Timeout waiting for fence");
                 break;
         }
-        if (result != EGL_CONDITION_SATISFIED_KHR) {
-            result = eglDestroySyncKHR(mDisplay, mSyncFence);
-            if (result == EGL_FALSE) {
-                SWAPPY_LOGE("Failed to destroy sync fence");
-            }
-            mSyncFence = EGL_NO_SYNC_KHR;
-        }
 
-        mFencePendingTime = std::chrono::steady_clock::now() - startTime;
+        // The GPU can't have started on this frame before it was submitted or
+        // before it finished the previous one.
+        mFencePendingTime =
+            completionTime - std::max(fence.creationTime, lastCompletionTime);
+        lastCompletionTime = completionTime;
 
-        mFenceWaiterPending = false;
+        mFenceWaiterLock.lock();
+        if (eglDestroySyncKHR(fence.display, fence.sync) == EGL_FALSE) {
+            SWAPPY_LOGE("Failed to destroy sync fence");
+        }
+        mFirstPendingFence = (mFirstPendingFence + 1) % MAX_FENCES_IN_FLIGHT;
+        mPendingFenceCount--;
         mFenceWaiterCondition.notify_all();
     }
 }
@@ -19,6 +19,7 @@
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
@@ -51,9 +52,21 @@ class EGL {
         : mFenceWaiter(fenceTimeout, getProcAddress) {}
     ~EGL();
     static std::unique_ptr<EGL> create(std::chrono::nanoseconds fenceTimeout);
+    // Loads every function, eglSwapBuffers included, with getProcAddress
+    // rather than from libEGL.so, so that tests can provide fakes.
+    static std::unique_ptr<EGL> create(std::chrono::nanoseconds fenceTimeout,
+                                       eglGetProcAddress_type getProcAddress);
 
+    // Creates a sync fence for this frame, waiting first if the GPU is already
+    // the maximum number of fences behind.
     void resetSyncFence(EGLDisplay display);
     bool lastFrameIsComplete(EGLDisplay display);
+    void setMaxFencesInFlight(int count) {
+        mFenceWaiter.setMaxFencesInFlight(count);
+    }
+    int getMaxFencesInFlight() const {
+        return mFenceWaiter.getMaxFencesInFlight();
+    }
     bool setPresentationTime(EGLDisplay display, EGLSurface surface,
                              std::chrono::steady_clock::time_point time);
     std::chrono::nanoseconds getFencePendingTime() const {
@@ -64,16 +77,23 @@ class EGL {
     bool statsSupported();
     std::pair<bool, EGLuint64KHR> getNextFrameId(EGLDisplay dpy,
                                                  EGLSurface surface) const;
-    std::unique_ptr<FrameTimestamps> getFrameTimestamps(
-        EGLDisplay dpy, EGLSurface surface, EGLuint64KHR frameId) const;
+    // Returns false if the timestamps are not all available yet.
+    bool getFrameTimestamps(EGLDisplay dpy, EGLSurface surface,
+                            EGLuint64KHR frameId,
+                            FrameTimestamps *timestamps) const;
     EGLBoolean swapBuffers(EGLDisplay dpy, EGLSurface surface) {
         return this->eglSwapBuffers(dpy, surface);
     }
 
    private:
+    using eglSwapBuffers_type = EGLBoolean (*)(EGLDisplay, EGLSurface);
+
+    static std::unique_ptr<EGL> create(std::chrono::nanoseconds fenceTimeout,
+                                       eglGetProcAddress_type getProcAddress,
+                                       eglSwapBuffers_type swapBuffers);
+
     void *eglLib = nullptr;
     eglGetProcAddress_type eglGetProcAddress = nullptr;
-    using eglSwapBuffers_type = EGLBoolean (*)(EGLDisplay, EGLSurface);
     eglSwapBuffers_type eglSwapBuffers = nullptr;
     using eglPresentationTimeANDROID_type = EGLBoolean (*)(EGLDisplay,
                                                            EGLSurface,
@@ -83,10 +103,8 @@ class EGL {
                                                  const EGLint *);
     eglCreateSyncKHR_type eglCreateSyncKHR = nullptr;
     using eglDestroySyncKHR_type = EGLBoolean (*)(EGLDisplay, EGLSyncKHR);
-    eglDestroySyncKHR_type eglDestroySyncKHR = nullptr;
     using eglGetSyncAttribKHR_type = EGLBoolean (*)(EGLDisplay, EGLSyncKHR,
                                                     EGLint, EGLint *);
-    eglGetSyncAttribKHR_type eglGetSyncAttribKHR = nullptr;
 
     using eglGetError_type = EGLint (*)(void);
     eglGetError_type eglGetError = nullptr;
@@ -101,37 +119,55 @@ class EGL {
                        const EGLint *, EGLnsecsANDROID *);
     eglGetFrameTimestampsANDROID_type eglGetFrameTimestampsANDROID = nullptr;
 
-    std::mutex mSyncFenceMutex;
-    EGLSyncKHR mSyncFence = EGL_NO_SYNC_KHR;
-
+    // Waits for the sync fences of frames on its own thread, so that the app
+    // thread only blocks when the GPU is too many frames behind.
     class FenceWaiter {
        public:
+        static constexpr int MAX_FENCES_IN_FLIGHT = 4;
+        static constexpr int DEFAULT_FENCES_IN_FLIGHT = 2;
+
         FenceWaiter(std::chrono::nanoseconds fenceTimeout,
                     EGL::eglGetProcAddress_type getProcAddress);
         ~FenceWaiter();
 
+        // Takes ownership of the fence, which is destroyed once it has been
+        // waited for. Blocks while the maximum number of fences are pending.
         void onFenceCreation(EGLDisplay display, EGLSyncKHR syncFence);
-        // Wait and return true if the fence was signalled.
-        // The fence will NOT be destroyed in this case.
-        bool waitForIdle();
+        // Returns true if the most recent fence, if any, was signalled.
+        bool lastFenceIsComplete();
         std::chrono::nanoseconds getFencePendingTime() const;
+        // Clamped to [1, MAX_FENCES_IN_FLIGHT].
+        void setMaxFencesInFlight(int count);
+        int getMaxFencesInFlight() const;
 
        private:
+        struct Fence {
+            EGLDisplay display;
+            EGLSyncKHR sync;
+            std::chrono::steady_clock::time_point creationTime;
+        };
+
         using eglClientWaitSyncKHR_type = EGLBoolean (*)(EGLDisplay, EGLSyncKHR,
                                                          EGLint, EGLTimeKHR);
         eglClientWaitSyncKHR_type eglClientWaitSyncKHR = nullptr;
-        using eglDestroySyncKHR_type = EGLBoolean (*)(EGLDisplay, EGLSyncKHR);
         eglDestroySyncKHR_type eglDestroySyncKHR = nullptr;
+        eglGetSyncAttribKHR_type eglGetSyncAttribKHR = nullptr;
 
         void threadMain();
         Thread mFenceWaiter GUARDED_BY(mFenceWaiterLock);
-        std::mutex mFenceWaiterLock;
+        mutable std::mutex mFenceWaiterLock;
         std::condition_variable_any mFenceWaiterCondition;
         bool mFenceWaiterRunning GUARDED_BY(mFenceWaiterLock) = true;
-        bool mFenceWaiterPending GUARDED_BY(mFenceWaiterLock) = false;
         std::atomic<std::chrono::nanoseconds> mFencePendingTime;
-        EGLDisplay mDisplay GUARDED_BY(mFenceWaiterLock);
-        EGLSyncKHR mSyncFence GUARDED_BY(mFenceWaiterLock) = EGL_NO_SYNC_KHR;
+        // Fences not yet waited for, oldest first. Only the waiter thread
+        // removes them, so the oldest stays put while it is being waited for
+        // without the lock held.
+        std::array<Fence, MAX_FENCES_IN_FLIGHT> mPendingFences
+            GUARDED_BY(mFenceWaiterLock);
+        int mFirstPendingFence GUARDED_BY(mFenceWaiterLock) = 0;
+        int mPendingFenceCount GUARDED_BY(mFenceWaiterLock) = 0;
+        int mMaxFencesInFlight GUARDED_BY(mFenceWaiterLock) =
+            DEFAULT_FENCES_IN_FLIGHT;
         std::chrono::nanoseconds mFenceTimeout;
     };
 
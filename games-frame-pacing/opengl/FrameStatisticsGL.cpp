@@ -28,62 +28,76 @@
 namespace swappy {
 
 FrameStatisticsGL::FrameStatisticsGL(const EGL& egl,
-                                     const SwappyCommon& swappyCommon)
-    : mEgl(egl), mSwappyCommon(swappyCommon) {
-    mPendingFrames.reserve(MAX_FRAME_LAG + 1);
+                                     SwappyCommon& swappyCommon)
+    : mEgl(egl), mSwappyCommon(swappyCommon) {}
+
+void FrameStatisticsGL::pushPendingFrame(const EGLFrame& frame) {
+    if (mPendingFrameCount == MAX_PENDING_FRAMES) {
+        // Only if frame ids went backwards, e.g. with a new surface.
+        popPendingFrame();
+    }
+    mPendingFrames[(mFirstPendingFrame + mPendingFrameCount) %
+                   MAX_PENDING_FRAMES] = frame;
+    mPendingFrameCount++;
+}
+
+void FrameStatisticsGL::popPendingFrame() {
+    mFirstPendingFrame = (mFirstPendingFrame + 1) % MAX_PENDING_FRAMES;
+    mPendingFrameCount--;
 }
 
-FrameStatisticsGL::ThisFrame FrameStatisticsGL::getThisFrame(
-    EGLDisplay dpy, EGLSurface surface) {
+bool FrameStatisticsGL::getThisFrame(EGLDisplay dpy, EGLSurface surface,
+                                     TimePoint* startTime,
+                                     EGL::FrameTimestamps* timestamps) {
     const TimePoint frameStartTime = std::chrono::steady_clock::now();
 
     // first get the next frame id
     std::pair<bool, EGLuint64KHR> nextFrameId =
         mEgl.getNextFrameId(dpy, surface);
     if (nextFrameId.first) {
-        mPendingFrames.push_back(
-            {dpy, surface, nextFrameId.second, frameStartTime});
-    }
-
-    if (mPendingFrames.empty()) {
-        return {};
+        // make sure we don't lag behind the stats too much
+        if (mPendingFrameCount > 0 &&
+            nextFrameId.second - mPendingFrames[mFirstPendingFrame].id >
+                MAX_FRAME_LAG) {
+            mPendingFrameCount = 0;
+            mFrameStatsCommon.invalidateLastFrame();
+        }
+        pushPendingFrame({dpy, surface, nextFrameId.second, frameStartTime});
     }
 
-    EGLFrame frame = mPendingFrames.front();
-    // make sure we don't lag behind the stats too much
-    if (nextFrameId.first && nextFrameId.second - frame.id > MAX_FRAME_LAG) {
-        while (mPendingFrames.size() > 1)
-            mPendingFrames.erase(mPendingFrames.begin());
-        mFrameStatsCommon.invalidateLastFrame();
-        frame = mPendingFrames.front();
+    if (mPendingFrameCount == 0) {
+        return false;
     }
-    std::unique_ptr<EGL::FrameTimestamps> frameStats =
-        mEgl.getFrameTimestamps(frame.dpy, frame.surface, frame.id);
 
-    if (!frameStats) {
-        return {frame.startFrameTime};
+    const EGLFrame& frame = mPendingFrames[mFirstPendingFrame];
+    if (!mEgl.getFrameTimestamps(frame.dpy, frame.surface, frame.id,
+                                 timestamps)) {
+        return false;
     }
 
-    mPendingFrames.erase(mPendingFrames.begin());
-
-    return {frame.startFrameTime, std::move(frameStats)};
+    *startTime = frame.startFrameTime;
+    popPendingFrame();
+    return true;
 }
 
 // called once per swap
 void FrameStatisticsGL::capture(EGLDisplay dpy, EGLSurface surface) {
-    auto frame = getThisFrame(dpy, surface);
-
-    if (!frame.stats) return;
+    TimePoint startTime;
+    EGL::FrameTimestamps timestamps;
+    if (!getThisFrame(dpy, surface, &startTime, &timestamps)) return;
 
     FrameTimings current = {
-        static_cast<uint64_t>(frame.startTime.time_since_epoch().count()),
-        static_cast<uint64_t>(frame.stats->requested),
-        static_cast<uint64_t>(frame.stats->presented),
-        static_cast<uint64_t>(frame.stats->compositionLatched -
-                              frame.stats->renderingCompleted)};
+        static_cast<uint64_t>(startTime.time_since_epoch().count()),
+        static_cast<uint64_t>(timestamps.requested),
+        static_cast<uint64_t>(timestamps.presented),
+        static_cast<uint64_t>(timestamps.compositionLatched -
+                              timestamps.renderingCompleted)};
 
     mFrameStatsCommon.updateFrameStats(
         current, mSwappyCommon.getRefreshPeriod().count());
+    mSwappyCommon.getFrameTimeline().recordPresent(
+        current.startFrameTime, current.desiredPresentTime,
+        current.actualPresentTime);
 }
 
 void FrameStatisticsGL::enableStats(bool enabled) {
@@ -96,6 +110,15 @@ SwappyStats FrameStatisticsGL::getStats() {
 
 void FrameStatisticsGL::clearStats() { mFrameStatsCommon.clearStats(); }
 
+void FrameStatisticsGL::setExtendedStatsConfig(
+    const SwappyExtendedStatsConfig& config) {
+    mFrameStatsCommon.setExtendedStatsConfig(config);
+}
+
+void FrameStatisticsGL::getExtendedStats(SwappyExtendedStats* stats) const {
+    mFrameStatsCommon.getExtendedStats(stats);
+}
+
 int32_t FrameStatisticsGL::lastLatencyRecorded() {
     return mFrameStatsCommon.lastLatencyRecorded();
 }
@@ -19,7 +19,6 @@
 #include <array>
 #include <atomic>
 #include <map>
-#include <vector>
 
 #include "EGL.h"
 #include "FrameStatistics.h"
@@ -33,26 +32,28 @@ namespace swappy {
 
 class FrameStatisticsGL {
    public:
-    FrameStatisticsGL(const EGL& egl, const SwappyCommon& swappyCommon);
+    FrameStatisticsGL(const EGL& egl, SwappyCommon& swappyCommon);
     ~FrameStatisticsGL() = default;
 
     void enableStats(bool enabled);
     void capture(EGLDisplay dpy, EGLSurface surface);
     SwappyStats getStats();
     void clearStats();
+    void setExtendedStatsConfig(const SwappyExtendedStatsConfig& config);
+    void getExtendedStats(SwappyExtendedStats* stats) const;
 
     int32_t lastLatencyRecorded();
 
    protected:
     static constexpr int MAX_FRAME_LAG = 10;
-    struct ThisFrame {
-        TimePoint startTime;
-        std::unique_ptr<EGL::FrameTimestamps> stats;
-    };
-    ThisFrame getThisFrame(EGLDisplay dpy, EGLSurface surface);
+    static constexpr int MAX_PENDING_FRAMES = MAX_FRAME_LAG + 1;
+    // Returns true if the oldest pending frame's timestamps were available,
+    // in which case it is no longer pending.
+    bool getThisFrame(EGLDisplay dpy, EGLSurface surface, TimePoint* startTime,
+                      EGL::FrameTimestamps* timestamps);
 
     const EGL& mEgl;
-    const SwappyCommon& mSwappyCommon;
+    SwappyCommon& mSwappyCommon;
 
     struct EGLFrame {
         EGLDisplay dpy;
@@ -60,7 +61,15 @@ class FrameStatisticsGL {
         EGLuint64KHR id;
         TimePoint startFrameTime;
     };
-    std::vector<EGLFrame> mPendingFrames;
+    void pushPendingFrame(const EGLFrame& frame);
+    void popPendingFrame();
+
+    // Frames waiting for their timestamps, oldest first, in a ring. Frames
+    // more than MAX_FRAME_LAG behind the newest are dropped, so it never
+    // needs to grow.
+    std::array<EGLFrame, MAX_PENDING_FRAMES> mPendingFrames;
+    int mFirstPendingFrame = 0;
+    int mPendingFrameCount = 0;
     FrameStatistics mFrameStatsCommon;
 };
 
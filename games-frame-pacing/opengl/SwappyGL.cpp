@@ -165,6 +165,25 @@ void SwappyGL::setAutoPipelineMode(bool enabled) {
     if (swappy->enabled()) swappy->mCommonBase.setAutoPipelineMode(enabled);
 }
 
+void SwappyGL::setSwapIntervalController(SwappySwapIntervalController type) {
+    SwappyGL *swappy = getInstance();
+    if (!swappy) {
+        return;
+    }
+    if (swappy->enabled())
+        swappy->mCommonBase.setSwapIntervalController(type);
+}
+
+void SwappyGL::getFrameDurationPercentiles(
+    SwappyFrameDurationPercentiles *percentiles) {
+    SwappyGL *swappy = getInstance();
+    if (!swappy) {
+        return;
+    }
+    if (swappy->enabled())
+        swappy->mCommonBase.getFrameDurationPercentiles(percentiles);
+}
+
 void SwappyGL::setMaxAutoSwapDuration(std::chrono::nanoseconds maxDuration) {
     SwappyGL *swappy = getInstance();
     if (!swappy) {
@@ -217,6 +236,53 @@ void SwappyGL::clearStats() {
     }
 }
 
+void SwappyGL::setExtendedStatsConfig(const SwappyExtendedStatsConfig *config) {
+    SwappyGL *swappy = getInstance();
+    if (!swappy) {
+        return;
+    }
+    if (swappy->mFrameStatistics) {
+        swappy->mFrameStatistics->setExtendedStatsConfig(*config);
+    }
+}
+
+void SwappyGL::getExtendedStats(SwappyExtendedStats *stats) {
+    SwappyGL *swappy = getInstance();
+    if (!swappy) {
+        return;
+    }
+    if (swappy->mFrameStatistics) {
+        swappy->mFrameStatistics->getExtendedStats(stats);
+    }
+}
+
+void SwappyGL::enableFrameTimeline(bool enabled) {
+    SwappyGL *swappy = getInstance();
+    if (!swappy) {
+        return;
+    }
+    swappy->mCommonBase.getFrameTimeline().setEnabled(enabled);
+}
+
+int SwappyGL::drainFrameTimeline(SwappyFrameRecord *records, int maxRecords,
+                                 uint64_t *droppedRecords) {
+    SwappyGL *swappy = getInstance();
+    if (!swappy) {
+        return 0;
+    }
+    return swappy->mCommonBase.getFrameTimeline().drain(records, maxRecords,
+                                                        droppedRecords);
+}
+
+int SwappyGL::dumpFrameTimeline(int fd) {
+    SwappyGL *swappy = getInstance();
+    if (!swappy) {
+        return -1;
+    }
+    return swappy->mCommonBase.getFrameTimeline().dump(
+        fd, swappy->mCommonBase.getRefreshPeriod());
+}
+
 SwappyGL *SwappyGL::getInstance() {
     std::lock_guard<std::mutex> lock(sInstanceMutex);
     return sInstance.get();
@@ -254,6 +320,22 @@ std::chrono::nanoseconds SwappyGL::getFenceTimeout() {
     return swappy->mCommonBase.getFenceTimeout();
 }
 
+void SwappyGL::setMaxFencesInFlight(int count) {
+    SwappyGL *swappy = getInstance();
+    if (!swappy || !swappy->enabled()) {
+        return;
+    }
+    swappy->getEgl()->setMaxFencesInFlight(count);
+}
+
+int SwappyGL::getMaxFencesInFlight() {
+    SwappyGL *swappy = getInstance();
+    if (!swappy || !swappy->enabled()) {
+        return 0;
+    }
+    return swappy->getEgl()->getMaxFencesInFlight();
+}
+
 EGL *SwappyGL::getEgl() {
     static thread_local EGL *egl = nullptr;
     if (!egl) {
@@ -62,12 +62,24 @@ class SwappyGL {
 
     static void setAutoPipelineMode(bool enabled);
 
+    static void setSwapIntervalController(SwappySwapIntervalController type);
+    static void getFrameDurationPercentiles(
+        SwappyFrameDurationPercentiles *percentiles);
+
     static void setMaxAutoSwapDuration(std::chrono::nanoseconds maxDuration);
 
     static void enableStats(bool enabled);
     static void recordFrameStart(EGLDisplay display, EGLSurface surface);
     static void getStats(SwappyStats *stats);
     static void clearStats();
+    static void setExtendedStatsConfig(
+        const SwappyExtendedStatsConfig *config);
+    static void getExtendedStats(SwappyExtendedStats *stats);
+
+    static void enableFrameTimeline(bool enabled);
+    static int drainFrameTimeline(SwappyFrameRecord *records, int maxRecords,
+                                  uint64_t *droppedRecords);
+    static int dumpFrameTimeline(int fd);
 
     static bool isEnabled();
     static void destroyInstance();
@@ -75,6 +87,9 @@ class SwappyGL {
     static void setFenceTimeout(std::chrono::nanoseconds t);
     static std::chrono::nanoseconds getFenceTimeout();
 
+    static void setMaxFencesInFlight(int count);
+    static int getMaxFencesInFlight();
+
     static void setBufferStuffingFixWait(int32_t n_frames);
 
     static int getSupportedRefreshPeriodsNS(uint64_t *out_refreshrates,
@@ -91,8 +106,8 @@ class SwappyGL {
 
     bool lastFrameIsComplete(EGLDisplay display);
 
-    // Destroys the previous sync fence (if any) and creates a new one for this
-    // frame
+    // Creates a sync fence for this frame, waiting first if too many earlier
+    // ones are still pending
     void resetSyncFence(EGLDisplay display);
 
     // Computes the desired presentation time based on the swap interval and
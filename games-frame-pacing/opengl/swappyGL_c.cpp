@@ -16,7 +16,9 @@
 
 // API entry points
 
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 
 #include "Settings.h"
 #include "SwappyGL.h"
@@ -63,6 +65,10 @@ void SwappyGL_setUseAffinity(bool tf) {
     Settings::getInstance()->setUseAffinity(tf);
 }
 
+void SwappyGL_setUseSingleFilterThread(bool tf) {
+    Settings::getInstance()->setUseSingleFilterThread(tf);
+}
+
 void SwappyGL_setSwapIntervalNS(uint64_t swap_ns) {
     Settings::getInstance()->setSwapDuration(swap_ns);
 }
@@ -93,6 +99,16 @@ void SwappyGL_setAutoPipelineMode(bool enabled) {
     SwappyGL::setAutoPipelineMode(enabled);
 }
 
+void SwappyGL_setSwapIntervalController(
+    SwappySwapIntervalController controller) {
+    SwappyGL::setSwapIntervalController(controller);
+}
+
+void SwappyGL_getFrameDurationPercentiles(
+    SwappyFrameDurationPercentiles *percentiles) {
+    SwappyGL::getFrameDurationPercentiles(percentiles);
+}
+
 void SwappyGL_enableStats(bool enabled) { SwappyGL::enableStats(enabled); }
 
 void SwappyGL_recordFrameStart(EGLDisplay display, EGLSurface surface) {
@@ -103,6 +119,27 @@ void SwappyGL_getStats(SwappyStats *stats) { SwappyGL::getStats(stats); }
 
 void SwappyGL_clearStats() { SwappyGL::clearStats(); }
 
+void SwappyGL_setExtendedStatsConfig(const SwappyExtendedStatsConfig *config) {
+    SwappyGL::setExtendedStatsConfig(config);
+}
+
+void SwappyGL_getExtendedStats(SwappyExtendedStats *stats) {
+    SwappyGL::getExtendedStats(stats);
+}
+
+void SwappyGL_enableFrameTimeline(bool enabled) {
+    SwappyGL::enableFrameTimeline(enabled);
+}
+
+int SwappyGL_drainFrameTimeline(SwappyFrameRecord *records, int maxRecords,
+                                uint64_t *droppedRecords) {
+    return SwappyGL::drainFrameTimeline(records, maxRecords, droppedRecords);
+}
+
+int SwappyGL_dumpFrameTimeline(int fd) {
+    return SwappyGL::dumpFrameTimeline(fd);
+}
+
 bool SwappyGL_isEnabled() { return SwappyGL::isEnabled(); }
 
 void SwappyGL_setFenceTimeoutNS(uint64_t t) {
@@ -113,6 +150,14 @@ uint64_t SwappyGL_getFenceTimeoutNS() {
     return SwappyGL::getFenceTimeout().count();
 }
 
+void SwappyGL_setMaxFencesInFlight(uint32_t count) {
+    SwappyGL::setMaxFencesInFlight(std::min<uint32_t>(count, INT32_MAX));
+}
+
+uint32_t SwappyGL_getMaxFencesInFlight() {
+    return SwappyGL::getMaxFencesInFlight();
+}
+
 void SwappyGL_setBufferStuffingFixWait(int32_t n_frames) {
     SwappyGL::setBufferStuffingFixWait(n_frames);
 }
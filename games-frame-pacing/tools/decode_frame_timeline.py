@@ -0,0 +1,109 @@
+# Lint as: python3
+"""Decode a Swappy frame timeline dump.
+
+Reads files written by SwappyGL_dumpFrameTimeline or SwappyVk_dumpFrameTimeline
+(see SwappyFrameTimelineHeader in swappy_common.h) and prints one CSV row per
+frame. Several dumps may be concatenated in one file.
+
+Presentation feedback arrives a few frames after the frame it is for, keyed by
+the time SwappyGL_recordFrameStart / SwappyVk_recordFrameStart was called. It
+is matched to the last frame that Swappy started before that time.
+
+Usage: decode_frame_timeline.py DUMP [DUMP...] > timeline.csv
+"""
+
+import bisect
+import csv
+import struct
+import sys
+from typing import BinaryIO, Dict, List, Tuple
+
+MAGIC = 0x4c545753
+VERSION = 1
+HEADER = struct.Struct('<IHHQQQ')
+RECORD = struct.Struct('<Iiii9q')
+
+RECORD_FRAME = 0
+RECORD_PRESENT = 1
+
+FIELDS = ('type', 'swapInterval', 'pipelineMode', 'lateFrames',
+          'choreographerTimeNanos', 'startFrameTimeNanos', 'preWaitTimeNanos',
+          'postWaitTimeNanos', 'swapTimeNanos', 'cpuTimeNanos', 'gpuTimeNanos',
+          'desiredPresentTimeNanos', 'actualPresentTimeNanos')
+
+
+def read_dumps(f: BinaryIO) -> Tuple[List[Dict[str, int]], int, int]:
+  """Reads all the dumps in a file.
+
+  Args:
+    f: The file to read.
+
+  Returns:
+    The records, the total number of dropped records and the last refresh
+    period, in nanoseconds.
+  """
+  records = []
+  dropped = 0
+  refresh_period = 0
+  while True:
+    data = f.read(HEADER.size)
+    if not data:
+      break
+    if len(data) < HEADER.size:
+      raise ValueError('truncated header')
+    magic, version, record_size, refresh_period, n_dropped, count = (
+        HEADER.unpack(data))
+    if magic != MAGIC:
+      raise ValueError('not a frame timeline dump')
+    if version != VERSION or record_size < RECORD.size:
+      raise ValueError('unsupported dump version %d' % version)
+    dropped += n_dropped
+    for _ in range(count):
+      data = f.read(record_size)
+      if len(data) < record_size:
+        raise ValueError('truncated record')
+      records.append(dict(zip(FIELDS, RECORD.unpack_from(data))))
+  return records, dropped, refresh_period
+
+
+def join_presents(records: List[Dict[str, int]]) -> List[Dict[str, int]]:
+  """Fills in the actual present time of frames from present records."""
+  frames = [r for r in records if r['type'] == RECORD_FRAME]
+  starts = [f['startFrameTimeNanos'] for f in frames]
+  for present in records:
+    if present['type'] != RECORD_PRESENT:
+      continue
+    i = bisect.bisect_right(starts, present['startFrameTimeNanos']) - 1
+    if i >= 0:
+      frames[i]['actualPresentTimeNanos'] = present['actualPresentTimeNanos']
+  return frames
+
+
+def main(argv: List[str]) -> int:
+  if len(argv) < 2:
+    sys.stderr.write(__doc__)
+    return 1
+  records = []
+  dropped = 0
+  refresh_period = 0
+  for path in argv[1:]:
+    with open(path, 'rb') as f:
+      file_records, file_dropped, refresh_period = read_dumps(f)
+    records += file_records
+    dropped += file_dropped
+  frames = join_presents(records)
+
+  writer = csv.writer(sys.stdout)
+  writer.writerow(FIELDS[1:] + ('presentLatencyNanos',))
+  for frame in frames:
+    latency = 0
+    if frame['actualPresentTimeNanos'] > 0:
+      latency = frame['actualPresentTimeNanos'] - frame['startFrameTimeNanos']
+    writer.writerow([frame[name] for name in FIELDS[1:]] + [latency])
+  sys.stderr.write('%d frames, %d records dropped, refresh period %d ns\n' %
+                   (len(frames), dropped, refresh_period))
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
@@ -156,6 +156,11 @@ bool SwappyVk::GetRefreshCycleDuration(JNIEnv* env, jobject jactivity,
                 physicalDevice, device);
             return false;
         }
+
+        auto timelineIt = areTimelineSemaphoresEnabled.find(device);
+        if (timelineIt != areTimelineSemaphoresEnabled.end()) {
+            pImplementation->setTimelineSemaphoresEnabled(timelineIt->second);
+        }
     }
 
     // Now, call that derived class to get the refresh duration to return
@@ -238,6 +243,7 @@ void SwappyVk::DestroyDevice(VkDevice device) {
             }
         }
     }
+    areTimelineSemaphoresEnabled.erase(device);
     {
         // Erase the device
         auto it = perQueueFamilyIndex.begin();
@@ -263,6 +269,19 @@ void SwappyVk::SetAutoPipelineMode(bool enabled) {
     }
 }
 
+void SwappyVk::SetSwapIntervalController(SwappySwapIntervalController type) {
+    for (auto i : perSwapchainImplementation) {
+        i.second->setSwapIntervalController(type);
+    }
+}
+
+void SwappyVk::GetFrameDurationPercentiles(
+    VkSwapchainKHR swapchain, SwappyFrameDurationPercentiles* percentiles) {
+    auto it = perSwapchainImplementation.find(swapchain);
+    if (it == perSwapchainImplementation.end()) return;
+    it->second->getFrameDurationPercentiles(percentiles);
+}
+
 void SwappyVk::SetMaxAutoSwapDuration(std::chrono::nanoseconds maxDuration) {
     for (auto i : perSwapchainImplementation) {
         i.second->setMaxAutoSwapDuration(maxDuration);
@@ -275,6 +294,15 @@ void SwappyVk::SetFenceTimeout(std::chrono::nanoseconds t) {
     }
 }
 
+void SwappyVk::SetTimelineSemaphoresEnabled(VkDevice device, bool enabled) {
+    areTimelineSemaphoresEnabled[device] = enabled;
+    for (auto i : perSwapchainImplementation) {
+        if (i.second->getDevice() == device) {
+            i.second->setTimelineSemaphoresEnabled(enabled);
+        }
+    }
+}
+
 std::chrono::nanoseconds SwappyVk::GetFenceTimeout() const {
     auto it = perSwapchainImplementation.begin();
     if (it != perSwapchainImplementation.end()) {
@@ -340,4 +368,39 @@ void SwappyVk::clearStats(VkSwapchainKHR swapchain) {
     if (it != perSwapchainImplementation.end()) it->second->clearStats();
 }
 
+void SwappyVk::setExtendedStatsConfig(VkSwapchainKHR swapchain,
+                                      const SwappyExtendedStatsConfig* config) {
+    auto it = perSwapchainImplementation.find(swapchain);
+    if (it != perSwapchainImplementation.end())
+        it->second->setExtendedStatsConfig(*config);
+}
+
+void SwappyVk::getExtendedStats(VkSwapchainKHR swapchain,
+                                SwappyExtendedStats* stats) {
+    auto it = perSwapchainImplementation.find(swapchain);
+    if (it != perSwapchainImplementation.end())
+        it->second->getExtendedStats(stats);
+}
+
+void SwappyVk::enableFrameTimeline(VkSwapchainKHR swapchain, bool enabled) {
+    auto it = perSwapchainImplementation.find(swapchain);
+    if (it != perSwapchainImplementation.end())
+        it->second->enableFrameTimeline(enabled);
+}
+
+int SwappyVk::drainFrameTimeline(VkSwapchainKHR swapchain,
+                                 SwappyFrameRecord* records, int maxRecords,
+                                 uint64_t* droppedRecords) {
+    auto it = perSwapchainImplementation.find(swapchain);
+    if (it == perSwapchainImplementation.end()) return 0;
+    return it->second->drainFrameTimeline(records, maxRecords,
+                                          droppedRecords);
+}
+
+int SwappyVk::dumpFrameTimeline(VkSwapchainKHR swapchain, int fd) {
+    auto it = perSwapchainImplementation.find(swapchain);
+    if (it == perSwapchainImplementation.end()) return -1;
+    return it->second->dumpFrameTimeline(fd);
+}
+
 }  // namespace swappy
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <map>
+
 #include "SwappyVkBase.h"
 #include "SwappyVkFallback.h"
 #include "SwappyVkGoogleDisplayTiming.h"
@@ -75,9 +77,13 @@ class SwappyVk {
 
     void SetAutoSwapInterval(bool enabled);
     void SetAutoPipelineMode(bool enabled);
+    void SetSwapIntervalController(SwappySwapIntervalController type);
+    void GetFrameDurationPercentiles(
+        VkSwapchainKHR swapchain, SwappyFrameDurationPercentiles* percentiles);
     void SetMaxAutoSwapDuration(std::chrono::nanoseconds maxDuration);
     void SetFenceTimeout(std::chrono::nanoseconds duration);
     std::chrono::nanoseconds GetFenceTimeout() const;
+    void SetTimelineSemaphoresEnabled(VkDevice device, bool enabled);
     std::chrono::nanoseconds GetSwapInterval(VkSwapchainKHR swapchain);
     int GetSupportedRefreshPeriodsNS(uint64_t* out_refreshrates,
                                      int allocated_entries,
@@ -97,9 +103,21 @@ class SwappyVk {
     void recordFrameStart(VkQueue queue, VkSwapchainKHR swapchain,
                           uint32_t image);
     void clearStats(VkSwapchainKHR swapchain);
+    void setExtendedStatsConfig(VkSwapchainKHR swapchain,
+                                const SwappyExtendedStatsConfig* config);
+    void getExtendedStats(VkSwapchainKHR swapchain,
+                          SwappyExtendedStats* stats);
+
+    // Frame timeline.
+    void enableFrameTimeline(VkSwapchainKHR swapchain, bool enabled);
+    int drainFrameTimeline(VkSwapchainKHR swapchain,
+                           SwappyFrameRecord* records, int maxRecords,
+                           uint64_t* droppedRecords);
+    int dumpFrameTimeline(VkSwapchainKHR swapchain, int fd);
 
    private:
     std::map<VkPhysicalDevice, bool> doesPhysicalDeviceHaveGoogleDisplayTiming;
+    std::map<VkDevice, bool> areTimelineSemaphoresEnabled;
     std::map<VkSwapchainKHR, std::shared_ptr<SwappyVkBase>>
         perSwapchainImplementation;
 
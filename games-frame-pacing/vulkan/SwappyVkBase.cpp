@@ -118,7 +118,18 @@ void SwappyVkBase::initGoogExtension() {
 #endif
 }
 
-SwappyVkBase::~SwappyVkBase() { destroyVkSyncObjects(); }
+SwappyVkBase::~SwappyVkBase() {
+    // The waiter may outlive this swapchain, so it must stop measuring its
+    // queues before they are destroyed.
+    if (mTimelineWaiter) {
+        const int count = mQueueSyncCount.load(std::memory_order_relaxed);
+        for (int i = 0; i < count; i++) {
+            if (mQueueSyncs[i]->usesTimelineSemaphore()) {
+                mTimelineWaiter->removeQueue(mQueueSyncs[i].get());
+            }
+        }
+    }
+}
 
 void SwappyVkBase::doSetWindow(ANativeWindow* window) {
     mCommonBase.setANativeWindow(window);
@@ -129,223 +140,80 @@ void SwappyVkBase::doSetSwapInterval(VkSwapchainKHR swapchain,
     Settings::getInstance()->setSwapDuration(swapNs);
 }
 
-VkResult SwappyVkBase::initializeVkSyncObjects(VkQueue queue,
-                                               uint32_t queueFamilyIndex) {
-    if (mCommandPool.find(queue) != mCommandPool.end()) {
+VkResult SwappyVkBase::initializeVkSyncObjects(
+    VkQueue queue, uint32_t queueFamilyIndex,
+    SwappyVkQueueSync** ppQueueSync) {
+    *ppQueueSync = findQueueSync(queue);
+    if (*ppQueueSync) {
         return VK_SUCCESS;
     }
 
-    VkSync sync;
-
-    const VkCommandPoolCreateInfo cmd_pool_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-        .pNext = NULL,
-        .flags = 0,
-        .queueFamilyIndex = queueFamilyIndex,
-    };
-
-    VkResult res = vkCreateCommandPool(mDevice, &cmd_pool_info, NULL,
-                                       &mCommandPool[queue]);
-    if (res) {
-        SWAPPY_LOGE("vkCreateCommandPool failed %d", res);
-        return res;
+    std::lock_guard<std::mutex> lock(mQueueSyncMutex);
+    // Another thread may have got here first.
+    *ppQueueSync = findQueueSync(queue);
+    if (*ppQueueSync) {
+        return VK_SUCCESS;
     }
-    const VkCommandBufferAllocateInfo present_cmd_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .pNext = NULL,
-        .commandPool = mCommandPool[queue],
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1,
-    };
-
-    for (int i = 0; i < MAX_PENDING_FENCES; i++) {
-        VkFenceCreateInfo fence_ci = {
-            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-            .pNext = NULL,
-            .flags = VK_FENCE_CREATE_SIGNALED_BIT};
-        res = vkCreateFence(mDevice, &fence_ci, NULL, &sync.fence);
-        if (res) {
-            SWAPPY_LOGE("failed to create fence: %d", res);
-            return res;
-        }
-
-        VkSemaphoreCreateInfo semaphore_ci = {
-            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-            .pNext = NULL,
-            .flags = 0};
-        res = vkCreateSemaphore(mDevice, &semaphore_ci, NULL, &sync.semaphore);
-        if (res) {
-            SWAPPY_LOGE("failed to create semaphore: %d", res);
-            return res;
-        }
-
-        res =
-            vkAllocateCommandBuffers(mDevice, &present_cmd_info, &sync.command);
-        if (res) {
-            SWAPPY_LOGE("vkAllocateCommandBuffers failed %d", res);
-            return res;
-        }
-
-        const VkCommandBufferBeginInfo cmd_buf_info = {
-            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-            .pNext = NULL,
-            .flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
-            .pInheritanceInfo = NULL,
-        };
-        res = vkBeginCommandBuffer(sync.command, &cmd_buf_info);
-        if (res) {
-            SWAPPY_LOGE("vkAllocateCommandBuffers failed %d", res);
-            return res;
-        }
-
-        VkEventCreateInfo event_info = {
-            .sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO,
-            .pNext = NULL,
-            .flags = 0,
-        };
-        res = vkCreateEvent(mDevice, &event_info, NULL, &sync.event);
-        if (res) {
-            SWAPPY_LOGE("vkCreateEvent failed %d", res);
-            return res;
-        }
-
-        vkCmdSetEvent(sync.command, sync.event,
-                      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
-
-        res = vkEndCommandBuffer(sync.command);
-        if (res) {
-            SWAPPY_LOGE("vkCreateEvent failed %d", res);
-            return res;
-        }
 
-        mFreeSyncPool[queue].push_back(sync);
+    const int count = mQueueSyncCount.load(std::memory_order_relaxed);
+    if (count == MAX_QUEUES) {
+        SWAPPY_LOGW_ONCE(
+            "Too many queues, at most %d are paced. Presenting the others "
+            "without pacing",
+            MAX_QUEUES);
+        return VK_SUCCESS;
     }
 
-    // Create a thread that will wait for the fences
-    auto emplaceResult =
-        mThreads.emplace(queue, std::make_unique<ThreadContext>(queue));
-    auto& threadContext = emplaceResult.first->second;
-
-    // Start the thread
-    std::lock_guard<std::mutex> lock(threadContext->lock);
-    threadContext->thread =
-        Thread([&]() { waitForFenceThreadMain(*threadContext); });
-    return VK_SUCCESS;
-}
-
-void SwappyVkBase::destroyVkSyncObjects() {
-    // Stop all waiters threads
-    for (auto it = mThreads.begin(); it != mThreads.end(); it++) {
-        {
-            std::lock_guard<std::mutex> lock(it->second->lock);
-            it->second->running = false;
-            it->second->condition.notify_one();
-        }
-        it->second->thread.join();
+    if (mTimelineSemaphoresEnabled && !mTimelineWaiter) {
+        mTimelineWaiter = SwappyVkTimelineWaiter::getForDevice(
+            mDevice, mpfnGetDeviceProcAddr, mCommonBase.getFenceTimeout());
+        // Fall back to fences from now on.
+        mTimelineSemaphoresEnabled = mTimelineWaiter != nullptr;
     }
 
-    // Wait for all unsignaled fences to get signlaed
-    for (auto it = mWaitingSyncs.begin(); it != mWaitingSyncs.end(); it++) {
-        auto queue = it->first;
-        auto syncList = it->second;
-        while (syncList.size() > 0) {
-            VkSync sync = syncList.front();
-            syncList.pop_front();
-            vkWaitForFences(mDevice, 1, &sync.fence, VK_TRUE, UINT64_MAX);
-            mSignaledSyncs[queue].push_back(sync);
+    VkResult res;
+    if (mTimelineSemaphoresEnabled) {
+        mQueueSyncs[count] = SwappyVkQueueSync::create(
+            mDevice, queue, queueFamilyIndex, mCommonBase.getFenceTimeout(),
+            mTimelineWaiter.get(), &res);
+        if (!mQueueSyncs[count]) {
+            SWAPPY_LOGW("Failed to use a timeline semaphore %d, using fences",
+                        res);
         }
     }
-
-    // Move all signaled fences to the free pool
-    for (auto it = mSignaledSyncs.begin(); it != mSignaledSyncs.end(); it++) {
-        auto queue = it->first;
-        reclaimSignaledFences(queue);
-    }
-
-    // Free all sync objects
-    for (auto it = mFreeSyncPool.begin(); it != mFreeSyncPool.end(); it++) {
-        auto syncList = it->second;
-        while (syncList.size() > 0) {
-            VkSync sync = syncList.front();
-            syncList.pop_front();
-            vkFreeCommandBuffers(mDevice, mCommandPool[it->first], 1,
-                                 &sync.command);
-            vkDestroyEvent(mDevice, sync.event, NULL);
-            vkDestroySemaphore(mDevice, sync.semaphore, NULL);
-            vkResetFences(mDevice, 1, &sync.fence);
-            vkDestroyFence(mDevice, sync.fence, NULL);
-        }
+    if (!mQueueSyncs[count]) {
+        mQueueSyncs[count] = SwappyVkQueueSync::create(
+            mDevice, queue, queueFamilyIndex, mCommonBase.getFenceTimeout(),
+            nullptr, &res);
     }
-
-    // Free destroy the command pools
-    for (auto it = mCommandPool.begin(); it != mCommandPool.end(); it++) {
-        auto commandPool = it->second;
-        vkDestroyCommandPool(mDevice, commandPool, NULL);
+    if (!mQueueSyncs[count]) {
+        return res;
     }
+    mQueueSyncCount.store(count + 1, std::memory_order_release);
+    *ppQueueSync = mQueueSyncs[count].get();
+    return VK_SUCCESS;
 }
 
-void SwappyVkBase::reclaimSignaledFences(VkQueue queue) {
-    std::lock_guard<std::mutex> lock(mThreads[queue]->lock);
-    while (!mSignaledSyncs[queue].empty()) {
-        VkSync sync = mSignaledSyncs[queue].front();
-        mSignaledSyncs[queue].pop_front();
-        mFreeSyncPool[queue].push_back(sync);
+SwappyVkQueueSync* SwappyVkBase::findQueueSync(VkQueue queue) const {
+    const int count = mQueueSyncCount.load(std::memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (mQueueSyncs[i]->getQueue() == queue) {
+            return mQueueSyncs[i].get();
+        }
     }
+    return nullptr;
 }
 
-bool SwappyVkBase::lastFrameIsCompleted(VkQueue queue) {
+bool SwappyVkBase::lastFrameIsCompleted(const SwappyVkQueueSync& queueSync) {
     auto pipelineMode = mCommonBase.getCurrentPipelineMode();
-    std::lock_guard<std::mutex> lock(mThreads[queue]->lock);
     if (pipelineMode == SwappyCommon::PipelineMode::On) {
         // We are in pipeline mode so we need to check the fence of frame N-1
-        return mWaitingSyncs[queue].size() < 2;
+        return queueSync.getPendingFenceCount() < 2;
     }
 
     // We are not in pipeline mode so we need to check the fence the current
     // frame. i.e. there are not unsignaled frames
-    return mWaitingSyncs[queue].empty();
-}
-
-VkResult SwappyVkBase::injectFence(VkQueue queue,
-                                   const VkPresentInfoKHR* pPresentInfo,
-                                   VkSemaphore* pSemaphore) {
-    reclaimSignaledFences(queue);
-
-    // If we cross the swap interval threshold, we don't pace at all.
-    // In this case we might not have a free fence, so just don't use the fence.
-    if (mFreeSyncPool[queue].empty() ||
-        vkGetFenceStatus(mDevice, mFreeSyncPool[queue].front().fence) !=
-            VK_SUCCESS) {
-        *pSemaphore = VK_NULL_HANDLE;
-        return VK_SUCCESS;
-    }
-
-    VkSync sync = mFreeSyncPool[queue].front();
-    mFreeSyncPool[queue].pop_front();
-
-    vkResetFences(mDevice, 1, &sync.fence);
-
-    VkPipelineStageFlags pipe_stage_flags;
-    VkSubmitInfo submit_info;
-    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit_info.pNext = NULL;
-    submit_info.pWaitDstStageMask = &pipe_stage_flags;
-    pipe_stage_flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    submit_info.waitSemaphoreCount = pPresentInfo->waitSemaphoreCount;
-    submit_info.pWaitSemaphores = pPresentInfo->pWaitSemaphores;
-    submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers = &sync.command;
-    submit_info.signalSemaphoreCount = 1;
-    submit_info.pSignalSemaphores = &sync.semaphore;
-    VkResult res = vkQueueSubmit(queue, 1, &submit_info, sync.fence);
-    *pSemaphore = sync.semaphore;
-
-    std::lock_guard<std::mutex> lock(mThreads[queue]->lock);
-    mWaitingSyncs[queue].push_back(sync);
-    mThreads[queue]->hasPendingWork = true;
-    mThreads[queue]->condition.notify_all();
-
-    return res;
+    return queueSync.getPendingFenceCount() == 0;
 }
 
 void SwappyVkBase::setAutoSwapInterval(bool enabled) {
@@ -360,60 +228,31 @@ void SwappyVkBase::setAutoPipelineMode(bool enabled) {
     mCommonBase.setAutoPipelineMode(enabled);
 }
 
-void SwappyVkBase::waitForFenceThreadMain(ThreadContext& thread) {
-    while (true) {
-        bool waitingSyncsEmpty;
-        {
-            std::lock_guard<std::mutex> lock(thread.lock);
-            // Wait for new fence object
-            thread.condition.wait(thread.lock, [&]() REQUIRES(thread.lock) {
-                return thread.hasPendingWork || !thread.running;
-            });
-
-            thread.hasPendingWork = false;
-
-            if (!thread.running) {
-                break;
-            }
-
-            waitingSyncsEmpty = mWaitingSyncs[thread.queue].empty();
-        }
-
-        while (!waitingSyncsEmpty) {
-            VkSync sync;
-            {  // Get the sync object with a lock
-                std::lock_guard<std::mutex> lock(thread.lock);
-                sync = mWaitingSyncs[thread.queue].front();
-            }
-
-            gamesdk::ScopedTrace tracer("Swappy: GPU frame time");
-            const auto startTime = std::chrono::steady_clock::now();
-            VkResult result =
-                vkWaitForFences(mDevice, 1, &sync.fence, VK_TRUE,
-                                mCommonBase.getFenceTimeout().count());
-            if (result) {
-                SWAPPY_LOGW_ONCE("Failed to wait for fence %d", result);
-            }
-            mLastFenceTime = std::chrono::steady_clock::now() - startTime;
-
-            // Move the sync object to the signaled list
-            {
-                std::lock_guard<std::mutex> lock(thread.lock);
-                mWaitingSyncs[thread.queue].pop_front();
-
-                mSignaledSyncs[thread.queue].push_back(sync);
-                waitingSyncsEmpty = mWaitingSyncs[thread.queue].empty();
-            }
-        }
-    }
+void SwappyVkBase::setSwapIntervalController(
+    SwappySwapIntervalController type) {
+    mCommonBase.setSwapIntervalController(type);
 }
 
-std::chrono::nanoseconds SwappyVkBase::getLastFenceTime(VkQueue queue) {
-    return mLastFenceTime;
+void SwappyVkBase::getFrameDurationPercentiles(
+    SwappyFrameDurationPercentiles* percentiles) {
+    mCommonBase.getFrameDurationPercentiles(percentiles);
 }
 
 void SwappyVkBase::setFenceTimeout(std::chrono::nanoseconds duration) {
+    std::lock_guard<std::mutex> lock(mQueueSyncMutex);
     mCommonBase.setFenceTimeout(duration);
+    const int count = mQueueSyncCount.load(std::memory_order_relaxed);
+    for (int i = 0; i < count; i++) {
+        mQueueSyncs[i]->setFenceTimeout(duration);
+    }
+    if (mTimelineWaiter) {
+        mTimelineWaiter->setFenceTimeout(duration);
+    }
+}
+
+void SwappyVkBase::setTimelineSemaphoresEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(mQueueSyncMutex);
+    mTimelineSemaphoresEnabled = enabled;
 }
 
 std::chrono::nanoseconds SwappyVkBase::getFenceTimeout() const {
@@ -432,6 +271,22 @@ void SwappyVkBase::removeTracer(const SwappyTracer* tracer) {
     if (tracer != nullptr) mCommonBase.removeTracerCallbacks(*tracer);
 }
 
+void SwappyVkBase::enableFrameTimeline(bool enabled) {
+    mCommonBase.getFrameTimeline().setEnabled(enabled);
+}
+
+int SwappyVkBase::drainFrameTimeline(SwappyFrameRecord* records,
+                                     int maxRecords,
+                                     uint64_t* droppedRecords) {
+    return mCommonBase.getFrameTimeline().drain(records, maxRecords,
+                                                droppedRecords);
+}
+
+int SwappyVkBase::dumpFrameTimeline(int fd) {
+    return mCommonBase.getFrameTimeline().dump(fd,
+                                               mCommonBase.getRefreshPeriod());
+}
+
 int SwappyVkBase::getSupportedRefreshPeriodsNS(uint64_t* out_refreshrates,
                                                int allocated_entries) {
     return mCommonBase.getSupportedRefreshPeriodsNS(out_refreshrates,
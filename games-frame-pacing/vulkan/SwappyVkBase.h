@@ -49,16 +49,17 @@
 #include <swappy/swappyVk.h>
 #include <unistd.h>
 
-#include <condition_variable>
+#include <array>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
-#include <list>
-#include <map>
+#include <memory>
 #include <mutex>
 
 #include "ChoreographerShim.h"
 #include "Settings.h"
 #include "SwappyCommon.h"
+#include "SwappyVkQueueSync.h"
 #include "Trace.h"
 
 namespace swappy {
@@ -91,6 +92,7 @@ extern PFN_vkDestroyCommandPool vkDestroyCommandPool;
 extern PFN_vkCreateFence vkCreateFence;
 extern PFN_vkDestroyFence vkDestroyFence;
 extern PFN_vkWaitForFences vkWaitForFences;
+extern PFN_vkGetFenceStatus vkGetFenceStatus;
 extern PFN_vkResetFences vkResetFences;
 extern PFN_vkCreateSemaphore vkCreateSemaphore;
 extern PFN_vkDestroySemaphore vkDestroySemaphore;
@@ -122,13 +124,13 @@ class SwappyVkBase {
     void doSetWindow(ANativeWindow* window);
     void doSetSwapInterval(VkSwapchainKHR swapchain, uint64_t swapNs);
 
-    VkResult injectFence(VkQueue queue, const VkPresentInfoKHR* pPresentInfo,
-                         VkSemaphore* pSemaphore);
-
     bool isEnabled() { return mEnabled; }
 
     void setAutoSwapInterval(bool enabled);
     void setAutoPipelineMode(bool enabled);
+    void setSwapIntervalController(SwappySwapIntervalController type);
+    void getFrameDurationPercentiles(
+        SwappyFrameDurationPercentiles* percentiles);
 
     void setMaxAutoSwapDuration(std::chrono::nanoseconds swapMaxNS);
 
@@ -136,6 +138,9 @@ class SwappyVkBase {
     std::chrono::nanoseconds getFenceTimeout() const;
     std::chrono::nanoseconds getSwapInterval();
 
+    // Only affects queues that weren't presented to yet.
+    void setTimelineSemaphoresEnabled(bool enabled);
+
     void addTracer(const SwappyTracer* tracer);
     void removeTracer(const SwappyTracer* tracer);
 
@@ -148,26 +153,16 @@ class SwappyVkBase {
     virtual void getStats(SwappyStats* swappyStats) = 0;
     virtual void recordFrameStart(VkQueue queue, uint32_t image) = 0;
     virtual void clearStats() = 0;
+    virtual void setExtendedStatsConfig(
+        const SwappyExtendedStatsConfig& config) = 0;
+    virtual void getExtendedStats(SwappyExtendedStats* stats) = 0;
 
-   protected:
-    struct VkSync {
-        VkFence fence;
-        VkSemaphore semaphore;
-        VkCommandBuffer command;
-        VkEvent event;
-    };
-
-    struct ThreadContext {
-        ThreadContext(VkQueue queue) : queue(queue) {}
-
-        Thread thread;
-        bool running GUARDED_BY(lock) = true;
-        bool hasPendingWork GUARDED_BY(lock);
-        std::mutex lock;
-        std::condition_variable_any condition;
-        VkQueue queue GUARDED_BY(lock);
-    };
+    void enableFrameTimeline(bool enabled);
+    int drainFrameTimeline(SwappyFrameRecord* records, int maxRecords,
+                           uint64_t* droppedRecords);
+    int dumpFrameTimeline(int fd);
 
+   protected:
     SwappyCommon mCommonBase;
     VkPhysicalDevice mPhysicalDevice;
     VkDevice mDevice;
@@ -186,29 +181,31 @@ class SwappyVkBase {
     PFN_vkGetPastPresentationTimingGOOGLE mpfnGetPastPresentationTimingGOOGLE =
         nullptr;
 #endif
-    // Holds VKSync objects ready to be used
-    std::map<VkQueue, std::list<VkSync>> mFreeSyncPool;
-
-    // Holds VKSync objects queued and but signaled yet
-    std::map<VkQueue, std::list<VkSync>> mWaitingSyncs;
-
-    // Holds VKSync objects that were signaled
-    std::map<VkQueue, std::list<VkSync>> mSignaledSyncs;
-
-    std::map<VkQueue, VkCommandPool> mCommandPool;
-    std::map<VkQueue, std::unique_ptr<ThreadContext>> mThreads;
-
-    static constexpr int MAX_PENDING_FENCES = 2;
-
-    std::atomic<std::chrono::nanoseconds> mLastFenceTime = {};
+    // Frames presented to more queues than this are not paced.
+    static constexpr int MAX_QUEUES = 8;
+
+    // The sync objects of each queue presented to, in the order they were
+    // first used. Slots below mQueueSyncCount never change, so they can be
+    // searched without a lock.
+    std::array<std::unique_ptr<SwappyVkQueueSync>, MAX_QUEUES> mQueueSyncs;
+    std::atomic<int> mQueueSyncCount = {0};
+    std::mutex mQueueSyncMutex;
+
+    bool mTimelineSemaphoresEnabled GUARDED_BY(mQueueSyncMutex) = false;
+    // Shared with the other swapchains of the device, and taken for the first
+    // queue that uses timeline semaphores. ~SwappyVkBase removes the queues
+    // from it, as it may outlive them.
+    std::shared_ptr<SwappyVkTimelineWaiter> mTimelineWaiter
+        GUARDED_BY(mQueueSyncMutex);
 
     void initGoogExtension();
-    VkResult initializeVkSyncObjects(VkQueue queue, uint32_t queueFamilyIndex);
-    void destroyVkSyncObjects();
-    void reclaimSignaledFences(VkQueue queue);
-    bool lastFrameIsCompleted(VkQueue queue);
-    std::chrono::nanoseconds getLastFenceTime(VkQueue queue);
-    void waitForFenceThreadMain(ThreadContext& thread);
+    // Looks up the sync objects of the queue, creating them on first use.
+    // Sets *ppQueueSync to null if there are already MAX_QUEUES queues, in
+    // which case the queue should be presented to without pacing.
+    VkResult initializeVkSyncObjects(VkQueue queue, uint32_t queueFamilyIndex,
+                                     SwappyVkQueueSync** ppQueueSync);
+    SwappyVkQueueSync* findQueueSync(VkQueue queue) const;
+    bool lastFrameIsCompleted(const SwappyVkQueueSync& queueSync);
 };
 
 }  // namespace swappy
@@ -55,22 +55,27 @@ VkResult SwappyVkFallback::doQueuePresent(
         return VK_ERROR_INITIALIZATION_FAILED;
     }
 
-    VkResult result = initializeVkSyncObjects(queue, queueFamilyIndex);
+    SwappyVkQueueSync* queueSync;
+    VkResult result =
+        initializeVkSyncObjects(queue, queueFamilyIndex, &queueSync);
     if (result) {
         return result;
     }
+    if (!queueSync) {
+        return mpfnQueuePresentKHR(queue, pPresentInfo);
+    }
 
     const SwappyCommon::SwapHandlers handlers = {
         .lastFrameIsComplete =
-            std::bind(&SwappyVkFallback::lastFrameIsCompleted, this, queue),
+            [this, queueSync]() { return lastFrameIsCompleted(*queueSync); },
         .getPrevFrameGpuTime =
-            std::bind(&SwappyVkFallback::getLastFenceTime, this, queue),
+            [queueSync]() { return queueSync->getLastFenceTime(); },
     };
 
     // Inject the fence first and wait for it in onPreSwap() as we don't want to
     // submit a frame before rendering is completed.
     VkSemaphore semaphore;
-    result = injectFence(queue, pPresentInfo, &semaphore);
+    result = queueSync->injectFence(pPresentInfo, &semaphore);
     if (result) {
         SWAPPY_LOGE("Failed to vkQueueSubmit %d", result);
         return result;
@@ -117,4 +122,13 @@ void SwappyVkFallback::clearStats() {
     SWAPPY_LOGE("Frame Statistics Unsupported - API ignored");
 }
 
+void SwappyVkFallback::setExtendedStatsConfig(
+    const SwappyExtendedStatsConfig& config) {
+    SWAPPY_LOGE("Frame Statistics Unsupported - API ignored");
+}
+
+void SwappyVkFallback::getExtendedStats(SwappyExtendedStats* stats) {
+    SWAPPY_LOGE("Frame Statistics Unsupported - API ignored");
+}
+
 }  // namespace swappy
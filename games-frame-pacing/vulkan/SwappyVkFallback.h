@@ -44,6 +44,9 @@ class SwappyVkFallback : public SwappyVkBase {
     void recordFrameStart(VkQueue queue, uint32_t image) override final;
     void getStats(SwappyStats* swappyStats) override final;
     void clearStats() override final;
+    void setExtendedStatsConfig(
+        const SwappyExtendedStatsConfig& config) override final;
+    void getExtendedStats(SwappyExtendedStats* stats) override final;
 };
 
 }  // namespace swappy
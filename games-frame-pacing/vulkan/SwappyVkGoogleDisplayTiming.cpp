@@ -66,20 +66,24 @@ VkResult SwappyVkGoogleDisplayTiming::doQueuePresent(
         return VK_ERROR_INITIALIZATION_FAILED;
     }
 
-    VkResult res = initializeVkSyncObjects(queue, queueFamilyIndex);
+    SwappyVkQueueSync* queueSync;
+    VkResult res = initializeVkSyncObjects(queue, queueFamilyIndex, &queueSync);
     if (res) {
         return res;
     }
+    if (!queueSync) {
+        return mpfnQueuePresentKHR(queue, pPresentInfo);
+    }
 
     const SwappyCommon::SwapHandlers handlers = {
-        .lastFrameIsComplete = std::bind(
-            &SwappyVkGoogleDisplayTiming::lastFrameIsCompleted, this, queue),
-        .getPrevFrameGpuTime = std::bind(
-            &SwappyVkGoogleDisplayTiming::getLastFenceTime, this, queue),
+        .lastFrameIsComplete =
+            [this, queueSync]() { return lastFrameIsCompleted(*queueSync); },
+        .getPrevFrameGpuTime =
+            [queueSync]() { return queueSync->getLastFenceTime(); },
     };
 
     VkSemaphore semaphore;
-    res = injectFence(queue, pPresentInfo, &semaphore);
+    res = queueSync->injectFence(pPresentInfo, &semaphore);
     if (res) {
         SWAPPY_LOGE("Failed to vkQueueSubmit %d", res);
         return res;
@@ -190,6 +194,9 @@ void SwappyVkGoogleDisplayTiming::recordFrameStart(VkQueue queue,
 
             mFrameStatisticsCommon.updateFrameStats(
                 current, mCommonBase.getRefreshPeriod().count());
+            mCommonBase.getFrameTimeline().recordPresent(
+                current.startFrameTime, current.desiredPresentTime,
+                current.actualPresentTime);
             i++;
         }
         // If the past timings returned do not match, then the pending frame is
@@ -213,6 +220,16 @@ void SwappyVkGoogleDisplayTiming::getStats(SwappyStats* swappyStats) {
 void SwappyVkGoogleDisplayTiming::clearStats() {
     mFrameStatisticsCommon.clearStats();
 }
+
+void SwappyVkGoogleDisplayTiming::setExtendedStatsConfig(
+    const SwappyExtendedStatsConfig& config) {
+    mFrameStatisticsCommon.setExtendedStatsConfig(config);
+}
+
+void SwappyVkGoogleDisplayTiming::getExtendedStats(
+    SwappyExtendedStats* stats) {
+    mFrameStatisticsCommon.getExtendedStats(stats);
+}
 }  // namespace swappy
 
 #endif  // #if (not defined ANDROID_NDK_VERSION) || ANDROID_NDK_VERSION>=15
@@ -82,6 +82,9 @@ class SwappyVkGoogleDisplayTiming : public SwappyVkBase {
     void recordFrameStart(VkQueue queue, uint32_t image) override final;
     void getStats(SwappyStats* swappyStats) override final;
     void clearStats() override final;
+    void setExtendedStatsConfig(
+        const SwappyExtendedStatsConfig& config) override final;
+    void getExtendedStats(SwappyExtendedStats* stats) override final;
 
    private:
     static constexpr int MAX_FRAME_LAG = 10;
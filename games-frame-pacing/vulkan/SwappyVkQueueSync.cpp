@@ -0,0 +1,473 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SwappyVkQueueSync.h"
+
+#include <algorithm>
+
+#include "SwappyVkBase.h"
+
+#define LOG_TAG "SwappyVkQueueSync"
+#include "SwappyLog.h"
+
+namespace swappy {
+
+SwappyVkQueueSync::SwappyVkQueueSync(VkDevice device, VkQueue queue,
+                                     std::chrono::nanoseconds fenceTimeout,
+                                     SwappyVkTimelineWaiter* timelineWaiter,
+                                     ConstructorTag)
+    : mDevice(device),
+      mQueue(queue),
+      mTimelineWaiter(timelineWaiter),
+      mFenceTimeout(fenceTimeout) {
+    if (mTimelineWaiter) {
+        // Copied, as the waiter may be destroyed first.
+        mTimelineFunctions = mTimelineWaiter->getFunctions();
+    }
+}
+
+SwappyVkQueueSync::~SwappyVkQueueSync() {
+    if (mThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mRunning = false;
+            mCondition.notify_all();
+        }
+        mThread.join();
+    }
+
+    if (mTimelineWaiter) {
+#ifdef VK_KHR_timeline_semaphore
+        if (mTimelineSemaphore != VK_NULL_HANDLE) {
+            // Wait for the GPU to complete all the frames
+            const uint64_t injectedCount = mInjectedCount;
+            const VkSemaphoreWaitInfoKHR waitInfo = {
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR,
+                .pNext = NULL,
+                .flags = 0,
+                .semaphoreCount = 1,
+                .pSemaphores = &mTimelineSemaphore,
+                .pValues = &injectedCount,
+            };
+            mTimelineFunctions.waitSemaphores(mDevice, &waitInfo, UINT64_MAX);
+            vkDestroySemaphore(mDevice, mTimelineSemaphore, NULL);
+        }
+#endif
+        for (int i = 0; i < mSyncCount; i++) {
+            vkDestroySemaphore(mDevice, mSyncs[i].semaphore, NULL);
+        }
+        return;
+    }
+
+    // Wait for all unsignaled fences to get signaled
+    const uint64_t injectedCount = mInjectedCount;
+    for (uint64_t i = mCompletedCount; i != injectedCount; i++) {
+        vkWaitForFences(mDevice, 1, &mSyncs[i % MAX_PENDING_FENCES].fence,
+                        VK_TRUE, UINT64_MAX);
+    }
+
+    for (int i = 0; i < mSyncCount; i++) {
+        VkSync& sync = mSyncs[i];
+        vkFreeCommandBuffers(mDevice, mCommandPool, 1, &sync.command);
+        vkDestroyEvent(mDevice, sync.event, NULL);
+        vkDestroySemaphore(mDevice, sync.semaphore, NULL);
+        vkDestroyFence(mDevice, sync.fence, NULL);
+    }
+
+    if (mCommandPool != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(mDevice, mCommandPool, NULL);
+    }
+}
+
+std::unique_ptr<SwappyVkQueueSync> SwappyVkQueueSync::create(
+    VkDevice device, VkQueue queue, uint32_t queueFamilyIndex,
+    std::chrono::nanoseconds fenceTimeout,
+    SwappyVkTimelineWaiter* timelineWaiter, VkResult* pResult) {
+    auto queueSync = std::make_unique<SwappyVkQueueSync>(
+        device, queue, fenceTimeout, timelineWaiter, ConstructorTag{});
+    if (timelineWaiter) {
+        *pResult = queueSync->createTimelineSyncObjects();
+        if (*pResult) {
+            return nullptr;
+        }
+        if (!timelineWaiter->addQueue(queueSync.get())) {
+            SWAPPY_LOGE("Too many queues for the timeline waiter");
+            *pResult = VK_ERROR_TOO_MANY_OBJECTS;
+            return nullptr;
+        }
+        return queueSync;
+    }
+
+    *pResult = queueSync->createSyncObjects(queueFamilyIndex);
+    if (*pResult) {
+        return nullptr;
+    }
+
+    // Create a thread that will wait for the fences
+    SwappyVkQueueSync* self = queueSync.get();
+    queueSync->mThread = Thread([self]() { self->threadMain(); });
+    return queueSync;
+}
+
+VkResult SwappyVkQueueSync::createSyncObjects(uint32_t queueFamilyIndex) {
+    const VkCommandPoolCreateInfo cmd_pool_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .queueFamilyIndex = queueFamilyIndex,
+    };
+
+    VkResult res =
+        vkCreateCommandPool(mDevice, &cmd_pool_info, NULL, &mCommandPool);
+    if (res) {
+        SWAPPY_LOGE("vkCreateCommandPool failed %d", res);
+        mCommandPool = VK_NULL_HANDLE;
+        return res;
+    }
+
+    for (VkSync& sync : mSyncs) {
+        res = createSync(&sync);
+        if (res) {
+            return res;
+        }
+        mSyncCount++;
+    }
+    return VK_SUCCESS;
+}
+
+// Objects created before a failure are destroyed here, as the destructor only
+// destroys complete VkSyncs.
+VkResult SwappyVkQueueSync::createSync(VkSync* sync) {
+    const VkCommandBufferAllocateInfo present_cmd_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = NULL,
+        .commandPool = mCommandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    VkFenceCreateInfo fence_ci = {.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+                                  .pNext = NULL,
+                                  .flags = VK_FENCE_CREATE_SIGNALED_BIT};
+    VkResult res = vkCreateFence(mDevice, &fence_ci, NULL, &sync->fence);
+    if (res) {
+        SWAPPY_LOGE("failed to create fence: %d", res);
+        return res;
+    }
+
+    VkSemaphoreCreateInfo semaphore_ci = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0};
+    res = vkCreateSemaphore(mDevice, &semaphore_ci, NULL, &sync->semaphore);
+    if (res) {
+        SWAPPY_LOGE("failed to create semaphore: %d", res);
+        vkDestroyFence(mDevice, sync->fence, NULL);
+        return res;
+    }
+
+    res = vkAllocateCommandBuffers(mDevice, &present_cmd_info, &sync->command);
+    if (res) {
+        SWAPPY_LOGE("vkAllocateCommandBuffers failed %d", res);
+        vkDestroySemaphore(mDevice, sync->semaphore, NULL);
+        vkDestroyFence(mDevice, sync->fence, NULL);
+        return res;
+    }
+
+    VkEventCreateInfo event_info = {
+        .sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+    };
+    res = vkCreateEvent(mDevice, &event_info, NULL, &sync->event);
+    if (res) {
+        SWAPPY_LOGE("vkCreateEvent failed %d", res);
+        vkFreeCommandBuffers(mDevice, mCommandPool, 1, &sync->command);
+        vkDestroySemaphore(mDevice, sync->semaphore, NULL);
+        vkDestroyFence(mDevice, sync->fence, NULL);
+        return res;
+    }
+
+    const VkCommandBufferBeginInfo cmd_buf_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
+        .pInheritanceInfo = NULL,
+    };
+    res = vkBeginCommandBuffer(sync->command, &cmd_buf_info);
+    if (res == VK_SUCCESS) {
+        vkCmdSetEvent(sync->command, sync->event,
+                      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+        res = vkEndCommandBuffer(sync->command);
+    }
+    if (res) {
+        SWAPPY_LOGE("failed to record command buffer %d", res);
+        vkDestroyEvent(mDevice, sync->event, NULL);
+        vkFreeCommandBuffers(mDevice, mCommandPool, 1, &sync->command);
+        vkDestroySemaphore(mDevice, sync->semaphore, NULL);
+        vkDestroyFence(mDevice, sync->fence, NULL);
+        return res;
+    }
+    return VK_SUCCESS;
+}
+
+VkResult SwappyVkQueueSync::createTimelineSyncObjects() {
+#ifdef VK_KHR_timeline_semaphore
+    const VkSemaphoreTypeCreateInfoKHR timeline_ci = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR,
+        .pNext = NULL,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR,
+        .initialValue = 0,
+    };
+    VkSemaphoreCreateInfo semaphore_ci = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &timeline_ci,
+        .flags = 0};
+    VkResult res =
+        vkCreateSemaphore(mDevice, &semaphore_ci, NULL, &mTimelineSemaphore);
+    if (res) {
+        SWAPPY_LOGE("failed to create timeline semaphore: %d", res);
+        mTimelineSemaphore = VK_NULL_HANDLE;
+        return res;
+    }
+
+    // The present waits for these, as it can't wait for a timeline semaphore.
+    semaphore_ci.pNext = NULL;
+    for (VkSync& sync : mSyncs) {
+        res = vkCreateSemaphore(mDevice, &semaphore_ci, NULL, &sync.semaphore);
+        if (res) {
+            SWAPPY_LOGE("failed to create semaphore: %d", res);
+            return res;
+        }
+        mSyncCount++;
+    }
+    return VK_SUCCESS;
+#else
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+#endif
+}
+
+VkResult SwappyVkQueueSync::injectFence(const VkPresentInfoKHR* pPresentInfo,
+                                        VkSemaphore* pSemaphore) {
+    if (mTimelineWaiter) {
+        return injectTimelineSignal(pPresentInfo, pSemaphore);
+    }
+
+    const uint64_t injectedCount =
+        mInjectedCount.load(std::memory_order_relaxed);
+    VkSync& sync = mSyncs[injectedCount % MAX_PENDING_FENCES];
+
+    // If we cross the swap interval threshold, we don't pace at all.
+    // In this case we might not have a free fence, so just don't use the fence.
+    // A fence that timed out in the waiter thread may not be signaled yet.
+    if (injectedCount - mCompletedCount.load(std::memory_order_acquire) >=
+            MAX_PENDING_FENCES ||
+        vkGetFenceStatus(mDevice, sync.fence) != VK_SUCCESS) {
+        *pSemaphore = VK_NULL_HANDLE;
+        return VK_SUCCESS;
+    }
+
+    vkResetFences(mDevice, 1, &sync.fence);
+
+    VkPipelineStageFlags pipe_stage_flags;
+    VkSubmitInfo submit_info;
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext = NULL;
+    submit_info.pWaitDstStageMask = &pipe_stage_flags;
+    pipe_stage_flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    submit_info.waitSemaphoreCount = pPresentInfo->waitSemaphoreCount;
+    submit_info.pWaitSemaphores = pPresentInfo->pWaitSemaphores;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &sync.command;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &sync.semaphore;
+    VkResult res = vkQueueSubmit(mQueue, 1, &submit_info, sync.fence);
+    *pSemaphore = sync.semaphore;
+
+    mInjectedCount.store(injectedCount + 1, std::memory_order_release);
+    // Taking the lock makes sure the waiter thread either sees the new count
+    // or is already waiting for the notification. Unlike
+    // std::condition_variable_any, notifying doesn't take another lock.
+    std::lock_guard<std::mutex> lock(mLock);
+    mCondition.notify_all();
+
+    return res;
+}
+
+VkResult SwappyVkQueueSync::injectTimelineSignal(
+    const VkPresentInfoKHR* pPresentInfo, VkSemaphore* pSemaphore) {
+#ifdef VK_KHR_timeline_semaphore
+    const uint64_t injectedCount =
+        mInjectedCount.load(std::memory_order_relaxed);
+    const int index = injectedCount % MAX_PENDING_FENCES;
+
+    // As with fences, don't pace if the GPU is too far behind. The semaphore
+    // and submit time of a frame are only reused once the GPU completed it and
+    // the waiter thread is done with it.
+    if (injectedCount - mCompletedCount.load(std::memory_order_acquire) >=
+            MAX_PENDING_FENCES ||
+        getTimelineValue() + MAX_PENDING_FENCES < injectedCount + 1) {
+        *pSemaphore = VK_NULL_HANDLE;
+        return VK_SUCCESS;
+    }
+
+    // The submission only waits for the app's semaphores and signals ours, so
+    // there is no command buffer or fence.
+    const uint64_t value = injectedCount + 1;
+    const VkSemaphore signalSemaphores[] = {mSyncs[index].semaphore,
+                                            mTimelineSemaphore};
+    // The value for the binary semaphore is ignored.
+    const uint64_t signalValues[] = {0, value};
+    const VkTimelineSemaphoreSubmitInfoKHR timeline_info = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR,
+        .pNext = NULL,
+        .waitSemaphoreValueCount = 0,
+        .pWaitSemaphoreValues = NULL,
+        .signalSemaphoreValueCount = 2,
+        .pSignalSemaphoreValues = signalValues,
+    };
+    std::array<VkPipelineStageFlags, 8> waitStages;
+    waitStages.fill(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    if (pPresentInfo->waitSemaphoreCount > waitStages.size()) {
+        *pSemaphore = VK_NULL_HANDLE;
+        return VK_SUCCESS;
+    }
+    VkSubmitInfo submit_info;
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext = &timeline_info;
+    submit_info.waitSemaphoreCount = pPresentInfo->waitSemaphoreCount;
+    submit_info.pWaitSemaphores = pPresentInfo->pWaitSemaphores;
+    submit_info.pWaitDstStageMask = waitStages.data();
+    submit_info.commandBufferCount = 0;
+    submit_info.pCommandBuffers = NULL;
+    submit_info.signalSemaphoreCount = 2;
+    submit_info.pSignalSemaphores = signalSemaphores;
+
+    mSubmitTimes[index].store(
+        std::chrono::steady_clock::now().time_since_epoch().count(),
+        std::memory_order_relaxed);
+    VkResult res = vkQueueSubmit(mQueue, 1, &submit_info, VK_NULL_HANDLE);
+    *pSemaphore = mSyncs[index].semaphore;
+
+    mInjectedCount.store(value, std::memory_order_release);
+    mTimelineWaiter->onFrameSubmitted();
+
+    return res;
+#else
+    *pSemaphore = VK_NULL_HANDLE;
+    return VK_SUCCESS;
+#endif
+}
+
+uint64_t SwappyVkQueueSync::getTimelineValue() const {
+    uint64_t value = 0;
+#ifdef VK_KHR_timeline_semaphore
+    if (mTimelineFunctions.getSemaphoreCounterValue(
+            mDevice, mTimelineSemaphore, &value) != VK_SUCCESS) {
+        return 0;
+    }
+#endif
+    return value;
+}
+
+int SwappyVkQueueSync::getPendingFenceCount() const {
+    const uint64_t injectedCount =
+        mInjectedCount.load(std::memory_order_relaxed);
+    if (mTimelineWaiter) {
+        // Polling the semaphore is cheap, and doesn't wait for the waiter
+        // thread to catch up.
+        return injectedCount - std::min(getTimelineValue(), injectedCount);
+    }
+    return injectedCount - mCompletedCount.load(std::memory_order_relaxed);
+}
+
+bool SwappyVkQueueSync::getNextTimelineWait(VkSemaphore* pSemaphore,
+                                            uint64_t* pValue) const {
+    const uint64_t completedCount =
+        mCompletedCount.load(std::memory_order_relaxed);
+    if (completedCount == mInjectedCount.load(std::memory_order_acquire)) {
+        return false;
+    }
+    *pSemaphore = mTimelineSemaphore;
+    *pValue = completedCount + 1;
+    return true;
+}
+
+void SwappyVkQueueSync::onTimelineProgress(
+    std::chrono::steady_clock::time_point now, bool giveUp) {
+    uint64_t completedCount = mCompletedCount.load(std::memory_order_relaxed);
+    const uint64_t injectedCount =
+        mInjectedCount.load(std::memory_order_acquire);
+    // Frames given up on may still not be complete.
+    uint64_t gpuCount = std::max(
+        completedCount, std::min(getTimelineValue(), injectedCount));
+    if (giveUp && gpuCount == completedCount &&
+        completedCount != injectedCount) {
+        SWAPPY_LOGW_ONCE("Gave up waiting for a frame to complete");
+        gpuCount++;
+    }
+
+    // As when waiting for fences in order, the GPU only starts on a frame once
+    // it completed the previous one.
+    for (; completedCount < gpuCount; completedCount++) {
+        const std::chrono::steady_clock::time_point submitTime(
+            std::chrono::nanoseconds(
+                mSubmitTimes[completedCount % MAX_PENDING_FENCES].load(
+                    std::memory_order_relaxed)));
+        mLastFenceTime = now - std::max(submitTime, mLastCompletionTime);
+        mLastCompletionTime = now;
+    }
+    mCompletedCount.store(completedCount, std::memory_order_release);
+}
+
+void SwappyVkQueueSync::threadMain() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        // Wait for new fence object
+        mCondition.wait(lock, [this]() {
+            return mCompletedCount != mInjectedCount || !mRunning;
+        });
+
+        if (!mRunning) {
+            break;
+        }
+
+        lock.unlock();
+        uint64_t completedCount = mCompletedCount;
+        while (completedCount !=
+               mInjectedCount.load(std::memory_order_acquire)) {
+            // The presenting thread doesn't reuse this sync until it is
+            // counted as completed.
+            const VkSync& sync = mSyncs[completedCount % MAX_PENDING_FENCES];
+
+            gamesdk::ScopedTrace tracer("Swappy: GPU frame time");
+            const auto startTime = std::chrono::steady_clock::now();
+            VkResult result = vkWaitForFences(
+                mDevice, 1, &sync.fence, VK_TRUE,
+                mFenceTimeout.load(std::memory_order_relaxed).count());
+            if (result) {
+                SWAPPY_LOGW_ONCE("Failed to wait for fence %d", result);
+            }
+            mLastFenceTime = std::chrono::steady_clock::now() - startTime;
+
+            completedCount++;
+            mCompletedCount.store(completedCount, std::memory_order_release);
+        }
+        lock.lock();
+    }
+}
+
+}  // namespace swappy
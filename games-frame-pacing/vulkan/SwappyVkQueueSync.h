@@ -0,0 +1,147 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <swappy/swappyVk.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "SwappyVkTimelineWaiter.h"
+#include "Thread.h"
+
+namespace swappy {
+
+// The sync objects Swappy injects into one queue before each present, and a
+// thread that waits for them to measure GPU time.
+//
+// With a SwappyVkTimelineWaiter, each present instead signals a timeline
+// semaphore from an empty submission, without a fence or command buffer. Its
+// progress is polled when pacing, and the waiter's thread measures GPU time.
+//
+// Everything is created up front and reused in order, so injecting a fence
+// doesn't allocate, and takes a lock only to wake the waiter thread.
+class SwappyVkQueueSync {
+   private:
+    // Allows construction with std::unique_ptr from a static method, but
+    // disallows construction outside of the class since no one else can
+    // construct a ConstructorTag
+    struct ConstructorTag {};
+
+   public:
+    static constexpr int MAX_PENDING_FENCES = 2;
+
+    SwappyVkQueueSync(VkDevice device, VkQueue queue,
+                      std::chrono::nanoseconds fenceTimeout,
+                      SwappyVkTimelineWaiter* timelineWaiter, ConstructorTag);
+    // Waits for any pending fences before destroying the sync objects.
+    ~SwappyVkQueueSync();
+
+    // Uses timeline semaphores if timelineWaiter isn't null. Returns nullptr
+    // and sets *pResult if creating the sync objects failed.
+    static std::unique_ptr<SwappyVkQueueSync> create(
+        VkDevice device, VkQueue queue, uint32_t queueFamilyIndex,
+        std::chrono::nanoseconds fenceTimeout,
+        SwappyVkTimelineWaiter* timelineWaiter, VkResult* pResult);
+
+    VkQueue getQueue() const { return mQueue; }
+    bool usesTimelineSemaphore() const { return mTimelineWaiter != nullptr; }
+
+    // Submits a command buffer that waits for the present's semaphores then
+    // signals *pSemaphore and a fence. If the GPU is too far behind for there
+    // to be free sync objects, *pSemaphore is set to VK_NULL_HANDLE and
+    // nothing is submitted.
+    VkResult injectFence(const VkPresentInfoKHR* pPresentInfo,
+                         VkSemaphore* pSemaphore);
+
+    // The number of injected fences not yet waited for, or with a timeline
+    // semaphore, not yet completed by the GPU. Doesn't block.
+    int getPendingFenceCount() const;
+
+    std::chrono::nanoseconds getLastFenceTime() const {
+        return mLastFenceTime;
+    }
+
+    void setFenceTimeout(std::chrono::nanoseconds timeout) {
+        mFenceTimeout = timeout;
+    }
+
+    // Called by the SwappyVkTimelineWaiter thread. Returns false if there are
+    // no frames to measure, otherwise the value the timeline semaphore reaches
+    // when the oldest one completes.
+    bool getNextTimelineWait(VkSemaphore* pSemaphore, uint64_t* pValue) const;
+    // Measures the frames the GPU completed. If giveUp is set, the oldest
+    // frame is counted as complete even if it isn't.
+    void onTimelineProgress(std::chrono::steady_clock::time_point now,
+                            bool giveUp);
+
+   private:
+    struct VkSync {
+        VkFence fence;
+        VkSemaphore semaphore;
+        VkCommandBuffer command;
+        VkEvent event;
+    };
+
+    VkResult createSyncObjects(uint32_t queueFamilyIndex);
+    VkResult createSync(VkSync* sync);
+    VkResult createTimelineSyncObjects();
+    VkResult injectTimelineSignal(const VkPresentInfoKHR* pPresentInfo,
+                                  VkSemaphore* pSemaphore);
+    uint64_t getTimelineValue() const;
+    void threadMain();
+
+    const VkDevice mDevice;
+    const VkQueue mQueue;
+    VkCommandPool mCommandPool = VK_NULL_HANDLE;
+    // Only the semaphores are used with a timeline semaphore.
+    std::array<VkSync, MAX_PENDING_FENCES> mSyncs = {};
+    // The number of mSyncs that were created, all of them unless creation
+    // failed.
+    int mSyncCount = 0;
+
+    SwappyVkTimelineWaiter* const mTimelineWaiter;
+    SwappyVkTimelineFunctions mTimelineFunctions;
+    // Reaches n when the GPU completes the nth injected frame.
+    VkSemaphore mTimelineSemaphore = VK_NULL_HANDLE;
+    // When each pending frame was submitted, in steady_clock nanoseconds.
+    std::array<std::atomic<int64_t>, MAX_PENDING_FENCES> mSubmitTimes = {};
+    // Only used by the waiter thread.
+    std::chrono::steady_clock::time_point mLastCompletionTime;
+
+    // Fences are injected in mSyncs order, so these counts are enough to know
+    // which are pending. Each is only changed by one thread: mInjectedCount by
+    // the presenting thread and mCompletedCount by the waiter thread.
+    std::atomic<uint64_t> mInjectedCount = {0};
+    std::atomic<uint64_t> mCompletedCount = {0};
+
+    std::atomic<std::chrono::nanoseconds> mFenceTimeout;
+    std::atomic<std::chrono::nanoseconds> mLastFenceTime = {};
+
+    Thread mThread;
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    // Guarded by mLock
+    bool mRunning = true;
+};
+
+}  // namespace swappy
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SwappyVkTimelineWaiter.h"
+
+#include <map>
+
+#include "SwappyVkQueueSync.h"
+#include "Trace.h"
+
+#define LOG_TAG "SwappyVkTimelineWaiter"
+#include "SwappyLog.h"
+
+namespace swappy {
+
+namespace {
+
+// The waiters of the devices, held by their swapchains.
+std::mutex sWaitersMutex;
+std::map<VkDevice, std::weak_ptr<SwappyVkTimelineWaiter>> sWaiters;
+
+}  // anonymous namespace
+
+SwappyVkTimelineWaiter::SwappyVkTimelineWaiter(
+    VkDevice device, const SwappyVkTimelineFunctions& functions,
+    std::chrono::nanoseconds fenceTimeout, ConstructorTag)
+    : mDevice(device), mFunctions(functions), mFenceTimeout(fenceTimeout) {
+    mThread = Thread([this]() { threadMain(); });
+}
+
+SwappyVkTimelineWaiter::~SwappyVkTimelineWaiter() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mRunning = false;
+        mCondition.notify_all();
+    }
+    mThread.join();
+}
+
+std::unique_ptr<SwappyVkTimelineWaiter> SwappyVkTimelineWaiter::create(
+    VkDevice device, PFN_vkGetDeviceProcAddr getDeviceProcAddr,
+    std::chrono::nanoseconds fenceTimeout) {
+#ifdef VK_KHR_timeline_semaphore
+    SwappyVkTimelineFunctions functions;
+    // Devices with Vulkan 1.2 may only have the core names.
+    functions.getSemaphoreCounterValue =
+        reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(
+            getDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR"));
+    if (!functions.getSemaphoreCounterValue) {
+        functions.getSemaphoreCounterValue =
+            reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(
+                getDeviceProcAddr(device, "vkGetSemaphoreCounterValue"));
+    }
+    functions.waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(
+        getDeviceProcAddr(device, "vkWaitSemaphoresKHR"));
+    if (!functions.waitSemaphores) {
+        functions.waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(
+            getDeviceProcAddr(device, "vkWaitSemaphores"));
+    }
+    if (!functions.getSemaphoreCounterValue || !functions.waitSemaphores) {
+        SWAPPY_LOGI("Timeline semaphores are not supported by the device");
+        return nullptr;
+    }
+    return std::make_unique<SwappyVkTimelineWaiter>(
+        device, functions, fenceTimeout, ConstructorTag{});
+#else
+    SWAPPY_LOGI("Timeline semaphores are not supported by this build");
+    return nullptr;
+#endif
+}
+
+std::shared_ptr<SwappyVkTimelineWaiter> SwappyVkTimelineWaiter::getForDevice(
+    VkDevice device, PFN_vkGetDeviceProcAddr getDeviceProcAddr,
+    std::chrono::nanoseconds fenceTimeout) {
+    std::lock_guard<std::mutex> lock(sWaitersMutex);
+    std::shared_ptr<SwappyVkTimelineWaiter> waiter = sWaiters[device].lock();
+    if (!waiter) {
+        waiter = create(device, getDeviceProcAddr, fenceTimeout);
+        sWaiters[device] = waiter;
+    }
+
+    // Forget the devices whose swapchains were all destroyed.
+    for (auto it = sWaiters.begin(); it != sWaiters.end();) {
+        if (it->second.expired()) {
+            it = sWaiters.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return waiter;
+}
+
+bool SwappyVkTimelineWaiter::addQueue(SwappyVkQueueSync* queueSync) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mQueueSyncCount == MAX_QUEUES) {
+        return false;
+    }
+    mQueueSyncs[mQueueSyncCount++] = queueSync;
+    return true;
+}
+
+void SwappyVkTimelineWaiter::removeQueue(SwappyVkQueueSync* queueSync) {
+    std::unique_lock<std::mutex> lock(mLock);
+    // Keep the thread from starting another wait until the queue is removed.
+    mRemoving++;
+    mCondition.wait(lock, [this]() { return !mWaiting; });
+    for (int i = 0; i < mQueueSyncCount; i++) {
+        if (mQueueSyncs[i] == queueSync) {
+            mQueueSyncs[i] = mQueueSyncs[--mQueueSyncCount];
+            mQueueSyncs[mQueueSyncCount] = nullptr;
+            break;
+        }
+    }
+    mRemoving--;
+    mCondition.notify_all();
+}
+
+void SwappyVkTimelineWaiter::onFrameSubmitted() {
+    // Taking the lock makes sure the thread either sees the new frame or is
+    // already waiting for the notification.
+    std::lock_guard<std::mutex> lock(mLock);
+    mCondition.notify_all();
+}
+
+bool SwappyVkTimelineWaiter::hasPendingFrames() const {
+    for (int i = 0; i < mQueueSyncCount; i++) {
+        VkSemaphore semaphore;
+        uint64_t value;
+        if (mQueueSyncs[i]->getNextTimelineWait(&semaphore, &value)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SwappyVkTimelineWaiter::threadMain() {
+#ifdef VK_KHR_timeline_semaphore
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mCondition.wait(lock, [this]() {
+            return (mRemoving == 0 && hasPendingFrames()) || !mRunning;
+        });
+
+        if (!mRunning) {
+            break;
+        }
+
+        // The queues can't be removed until mWaiting is cleared.
+        const std::array<SwappyVkQueueSync*, MAX_QUEUES> queueSyncs =
+            mQueueSyncs;
+        const int count = mQueueSyncCount;
+        mWaiting = true;
+        lock.unlock();
+        // Wait for the oldest pending frame of any queue. Queues that get
+        // their first pending frame meanwhile are only waited for after that.
+        std::array<VkSemaphore, MAX_QUEUES> semaphores;
+        std::array<uint64_t, MAX_QUEUES> values;
+        std::array<bool, MAX_QUEUES> waited;
+        uint32_t waitCount = 0;
+        for (int i = 0; i < count; i++) {
+            waited[i] = queueSyncs[i]->getNextTimelineWait(
+                &semaphores[waitCount], &values[waitCount]);
+            if (waited[i]) {
+                waitCount++;
+            }
+        }
+
+        VkResult result = VK_SUCCESS;
+        if (waitCount > 0) {
+            const VkSemaphoreWaitInfoKHR waitInfo = {
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR,
+                .pNext = NULL,
+                .flags = VK_SEMAPHORE_WAIT_ANY_BIT_KHR,
+                .semaphoreCount = waitCount,
+                .pSemaphores = semaphores.data(),
+                .pValues = values.data(),
+            };
+            gamesdk::ScopedTrace tracer("Swappy: GPU frame time");
+            result = mFunctions.waitSemaphores(
+                mDevice, &waitInfo,
+                mFenceTimeout.load(std::memory_order_relaxed).count());
+            if (result) {
+                SWAPPY_LOGW_ONCE("Failed to wait for semaphores %d", result);
+            }
+        }
+
+        // Like a fence that times out, the frame waited for is counted as
+        // complete if waiting failed, so the thread doesn't spin on it.
+        const auto now = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; i++) {
+            const bool giveUp = waited[i] && result != VK_SUCCESS;
+            queueSyncs[i]->onTimelineProgress(now, giveUp);
+        }
+        lock.lock();
+        mWaiting = false;
+        mCondition.notify_all();
+    }
+#endif
+}
+
+}  // namespace swappy
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <swappy/swappyVk.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include "Thread.h"
+
+namespace swappy {
+
+class SwappyVkQueueSync;
+
+// The VK_KHR_timeline_semaphore entry points of a device. They are only
+// available when building with Vulkan headers that have the extension.
+struct SwappyVkTimelineFunctions {
+#ifdef VK_KHR_timeline_semaphore
+    PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue = nullptr;
+    PFN_vkWaitSemaphoresKHR waitSemaphores = nullptr;
+#endif
+};
+
+// A single thread that measures the GPU time of frames for all the queues of a
+// device that track them with timeline semaphores, instead of one thread per
+// queue waiting on fences. All the swapchains of a device share one, see
+// getForDevice.
+class SwappyVkTimelineWaiter {
+   private:
+    // Allows construction with std::unique_ptr from a static method, but
+    // disallows construction outside of the class since no one else can
+    // construct a ConstructorTag
+    struct ConstructorTag {};
+
+   public:
+    static constexpr int MAX_QUEUES = 8;
+
+    SwappyVkTimelineWaiter(VkDevice device,
+                           const SwappyVkTimelineFunctions& functions,
+                           std::chrono::nanoseconds fenceTimeout,
+                           ConstructorTag);
+    ~SwappyVkTimelineWaiter();
+
+    // Returns nullptr if the device doesn't have the timeline semaphore
+    // functions. The app must also have enabled the timelineSemaphore feature
+    // when creating the device, which can't be checked here.
+    static std::unique_ptr<SwappyVkTimelineWaiter> create(
+        VkDevice device, PFN_vkGetDeviceProcAddr getDeviceProcAddr,
+        std::chrono::nanoseconds fenceTimeout);
+
+    // Returns the waiter of the device while anyone still holds it, or
+    // creates one as create does.
+    static std::shared_ptr<SwappyVkTimelineWaiter> getForDevice(
+        VkDevice device, PFN_vkGetDeviceProcAddr getDeviceProcAddr,
+        std::chrono::nanoseconds fenceTimeout);
+
+    const SwappyVkTimelineFunctions& getFunctions() const {
+        return mFunctions;
+    }
+
+    // Starts measuring the frames of queueSync, until it is removed. Returns
+    // false if the device already has MAX_QUEUES queues.
+    bool addQueue(SwappyVkQueueSync* queueSync);
+
+    // Stops measuring the frames of queueSync, so it can be destroyed. Waits
+    // for the thread if it is waiting on the GPU.
+    void removeQueue(SwappyVkQueueSync* queueSync);
+
+    // Wakes the thread after a frame was submitted.
+    void onFrameSubmitted();
+
+    void setFenceTimeout(std::chrono::nanoseconds timeout) {
+        mFenceTimeout = timeout;
+    }
+
+   private:
+    bool hasPendingFrames() const;
+    void threadMain();
+
+    const VkDevice mDevice;
+    const SwappyVkTimelineFunctions mFunctions;
+
+    std::atomic<std::chrono::nanoseconds> mFenceTimeout;
+
+    Thread mThread;
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    // Guarded by mLock
+    std::array<SwappyVkQueueSync*, MAX_QUEUES> mQueueSyncs = {};
+    int mQueueSyncCount = 0;
+    bool mRunning = true;
+    // Set while the thread uses a copy of mQueueSyncs without the lock.
+    bool mWaiting = false;
+    // The number of removeQueue calls waiting for the thread.
+    int mRemoving = 0;
+};
+
+}  // namespace swappy
@@ -16,6 +16,7 @@
 
 // API entry points
 
+#include "Settings.h"
 #include "SwappyVk.h"
 #include "swappy/swappyVk.h"
 
@@ -99,12 +100,37 @@ void SwappyVk_setAutoPipelineMode(bool enabled) {
     swappy.SetAutoPipelineMode(enabled);
 }
 
+void SwappyVk_setSwapIntervalController(
+    SwappySwapIntervalController controller) {
+    TRACE_CALL();
+    swappy::SwappyVk& swappy = swappy::SwappyVk::getInstance();
+    swappy.SetSwapIntervalController(controller);
+}
+
+void SwappyVk_getFrameDurationPercentiles(
+    VkSwapchainKHR swapchain, SwappyFrameDurationPercentiles* percentiles) {
+    TRACE_CALL();
+    swappy::SwappyVk& swappy = swappy::SwappyVk::getInstance();
+    swappy.GetFrameDurationPercentiles(swapchain, percentiles);
+}
+
+void SwappyVk_setUseSingleFilterThread(bool enabled) {
+    TRACE_CALL();
+    swappy::Settings::getInstance()->setUseSingleFilterThread(enabled);
+}
+
 void SwappyVk_setFenceTimeoutNS(uint64_t fence_timeout_ns) {
     TRACE_CALL();
     swappy::SwappyVk& swappy = swappy::SwappyVk::getInstance();
     swappy.SetFenceTimeout(std::chrono::nanoseconds(fence_timeout_ns));
 }
 
+void SwappyVk_enableTimelineSemaphores(VkDevice device, bool enabled) {
+    TRACE_CALL();
+    swappy::SwappyVk& swappy = swappy::SwappyVk::getInstance();
+    swappy.SetTimelineSemaphoresEnabled(device, enabled);
+}
+
 void SwappyVk_setMaxAutoSwapIntervalNS(uint64_t max_swap_ns) {
     TRACE_CALL();
     swappy::SwappyVk& swappy = swappy::SwappyVk::getInstance();
@@ -182,4 +208,39 @@ void SwappyVk_clearStats(VkSwapchainKHR swapchain) {
     swappy.clearStats(swapchain);
 }
 
+void SwappyVk_setExtendedStatsConfig(VkSwapchainKHR swapchain,
+                                     const SwappyExtendedStatsConfig* config) {
+    TRACE_CALL();
+    swappy::SwappyVk& swappy = swappy::SwappyVk::getInstance();
+    swappy.setExtendedStatsConfig(swapchain, config);
+}
+
+void SwappyVk_getExtendedStats(VkSwapchainKHR swapchain,
+                               SwappyExtendedStats* stats) {
+    TRACE_CALL();
+    swappy::SwappyVk& swappy = swappy::SwappyVk::getInstance();
+    swappy.getExtendedStats(swapchain, stats);
+}
+
+void SwappyVk_enableFrameTimeline(VkSwapchainKHR swapchain, bool enabled) {
+    TRACE_CALL();
+    swappy::SwappyVk& swappy = swappy::SwappyVk::getInstance();
+    swappy.enableFrameTimeline(swapchain, enabled);
+}
+
+int SwappyVk_drainFrameTimeline(VkSwapchainKHR swapchain,
+                                SwappyFrameRecord* records, int maxRecords,
+                                uint64_t* droppedRecords) {
+    TRACE_CALL();
+    swappy::SwappyVk& swappy = swappy::SwappyVk::getInstance();
+    return swappy.drainFrameTimeline(swapchain, records, maxRecords,
+                                     droppedRecords);
+}
+
+int SwappyVk_dumpFrameTimeline(VkSwapchainKHR swapchain, int fd) {
+    TRACE_CALL();
+    swappy::SwappyVk& swappy = swappy::SwappyVk::getInstance();
+    return swappy.dumpFrameTimeline(swapchain, fd);
+}
+
 }  // extern "C"
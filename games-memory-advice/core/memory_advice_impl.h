@@ -21,7 +21,7 @@
 
 #include "metrics_provider.h"
 #include "predictor.h"
-#include "state_watcher.h"
+#include "watcher_scheduler.h"
 
 namespace memory_advice {
 
@@ -45,14 +45,12 @@ class MemoryAdviceImpl {
     std::unique_ptr<IPredictor> default_realtime_predictor_,
         default_available_predictor_;
 
-    typedef std::vector<std::unique_ptr<StateWatcher>> WatcherContainer;
-    WatcherContainer active_watchers_;
-    std::mutex active_watchers_mutex_;
-    WatcherContainer cancelled_watchers_;
-    std::mutex cancelled_watchers_mutex_;
-
     MemoryAdvice_ErrorCode initialization_error_code_ = MEMORYADVICE_ERROR_OK;
 
+    /** @brief Runs the registered watchers. Declared last so that its thread
+     * is stopped before anything it samples is destroyed. */
+    WatcherScheduler watcher_scheduler_;
+
     MemoryAdvice_ErrorCode ProcessAdvisorParameters(const char* parameters);
     /** @brief Given a list of fields, extracts metrics by calling the matching
      * metrics functions and gathers them in a single Json object. */
@@ -77,9 +75,6 @@ class MemoryAdviceImpl {
     /** @brief Find a value in a JSON object, even when it is nested in
      * sub-dictionaries in the object. */
     Json GetValue(Json::object object, std::string key);
-    /** @brief Delete any watchers that have finished their thread of execution
-     */
-    void CheckCancelledWatchers();
 
    public:
     MemoryAdviceImpl(const char* params, IMetricsProvider* metrics_provider,
@@ -23,7 +23,6 @@
 #include <fstream>
 #include <iterator>
 #include <map>
-#include <regex>
 #include <sstream>
 #include <streambuf>
 #include <utility>
@@ -35,21 +34,27 @@ using namespace gamesdk::jni;
 
 constexpr double BYTES_IN_KB = 1024;
 constexpr double BYTES_IN_MB = 1024 * 1024;
-const std::regex MEMINFO_REGEX("([^:]+)[^\\d]*(\\d+).*\n");
-const std::regex STATUS_REGEX("([a-zA-Z]+)[^\\d]*(\\d+) kB.*\n");
 
 namespace memory_advice {
 
 using namespace json11;
 
+static std::string StatusPath() {
+    std::stringstream ss_path;
+    ss_path << "/proc/" << getpid() << "/status";
+    return ss_path.str();
+}
+
+DefaultMetricsProvider::DefaultMetricsProvider()
+    : meminfo_reader_("/proc/meminfo", ProcFileReader::Format::MEMINFO),
+      status_reader_(StatusPath(), ProcFileReader::Format::STATUS) {}
+
 Json::object DefaultMetricsProvider::GetMeminfoValues() {
-    return GetMemoryValuesFromFile("/proc/meminfo", MEMINFO_REGEX);
+    return GetMemoryValuesFromFile(meminfo_reader_);
 }
 
 Json::object DefaultMetricsProvider::GetStatusValues() {
-    std::stringstream ss_path;
-    ss_path << "/proc/" << getpid() << "/status";
-    return GetMemoryValuesFromFile(ss_path.str(), STATUS_REGEX);
+    return GetMemoryValuesFromFile(status_reader_);
 }
 
 Json::object DefaultMetricsProvider::GetProcValues() {
@@ -101,22 +106,15 @@ Json::object DefaultMetricsProvider::GetDebugValues() {
 }
 
 Json::object DefaultMetricsProvider::GetMemoryValuesFromFile(
-    const std::string &path, const std::regex &pattern) {
-    std::ifstream file_stream(path);
+    ProcFileReader &reader) {
     Json::object metrics_map;
-    if (!file_stream) {
-        ALOGE("Could not open %s", path.c_str());
-        return metrics_map;
-    }
-
-    std::string file((std::istreambuf_iterator<char>(file_stream)),
-                     std::istreambuf_iterator<char>());
-    std::smatch match;
-    while (std::regex_search(file, match, pattern)) {
-        metrics_map[match[1].str()] =
-            Json((double)(strtoll(match[2].str().c_str(), nullptr, 10) *
-                          BYTES_IN_KB));
-        file = match.suffix().str();
+    auto add_value = [](void *user_data, const char *key, size_t key_length,
+                        int64_t value) {
+        (*static_cast<Json::object *>(user_data))[std::string(
+            key, key_length)] = Json((double)(value * BYTES_IN_KB));
+    };
+    if (!reader.Scan(add_value, &metrics_map)) {
+        ALOGE("Could not read %s", reader.Path().c_str());
     }
     return metrics_map;
 }
@@ -18,11 +18,11 @@
 
 #include <map>
 #include <memory>
-#include <regex>
 #include <string>
 
 #include "jni/jni_wrap.h"
 #include "json11/json11.hpp"
+#include "proc_file_reader.h"
 
 #define LOG_TAG "MemoryAdvice"
 #include "Log.h"
@@ -77,6 +77,7 @@ class IMetricsProvider {
 // determine memory values
 class DefaultMetricsProvider : public IMetricsProvider {
    public:
+    DefaultMetricsProvider();
     Json::object GetMeminfoValues() override;
     Json::object GetStatusValues() override;
     Json::object GetProcValues() override;
@@ -86,11 +87,12 @@ class DefaultMetricsProvider : public IMetricsProvider {
 
    private:
     android::os::DebugClass android_debug_;
+    ProcFileReader meminfo_reader_;
+    ProcFileReader status_reader_;
     /**
      * @brief Reads the given file and dumps the memory values within as a map
      */
-    Json::object GetMemoryValuesFromFile(const std::string &path,
-                                         const std::regex &pattern);
+    Json::object GetMemoryValuesFromFile(ProcFileReader &reader);
     /** @brief Reads the OOM Score of the app from /proc/{pid}/oom_score */
     int32_t GetOomScore();
 };
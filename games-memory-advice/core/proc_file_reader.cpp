@@ -0,0 +1,108 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "proc_file_reader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <utility>
+
+namespace memory_advice {
+
+constexpr size_t ProcFileReader::kBufferSize;
+
+static inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+static inline bool IsLetter(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+ProcFileReader::ProcFileReader(std::string path, Format format)
+    : path_(std::move(path)), format_(format) {}
+
+ProcFileReader::~ProcFileReader() {
+    if (fd_ >= 0) close(fd_);
+}
+
+void ProcFileReader::ParseLine(Format format, const char* begin,
+                               const char* end, Callback callback,
+                               void* user_data) {
+    const char* key_end;
+    if (format == Format::MEMINFO) {
+        key_end = static_cast<const char*>(memchr(begin, ':', end - begin));
+        if (key_end == nullptr) return;
+    } else {
+        key_end = begin;
+        while (key_end != end && IsLetter(*key_end)) ++key_end;
+    }
+    if (key_end == begin) return;
+    const char* p = key_end;
+    while (p != end && !IsDigit(*p)) ++p;
+    if (p == end) return;
+    int64_t value = 0;
+    while (p != end && IsDigit(*p)) value = value * 10 + (*p++ - '0');
+    if (format == Format::STATUS &&
+        (end - p < 3 || memcmp(p, " kB", 3) != 0))
+        return;
+    callback(user_data, begin, key_end - begin, value);
+}
+
+bool ProcFileReader::Scan(Callback callback, void* user_data) {
+    if (fd_ < 0) {
+        fd_ = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) return false;
+    }
+    char buffer[kBufferSize];
+    size_t used = 0;
+    off_t offset = 0;
+    // Set while skipping the rest of a line that didn't fit in the buffer.
+    bool skipping = false;
+    while (true) {
+        ssize_t n = pread(fd_, buffer + used, kBufferSize - used, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            // Try opening the file again next time.
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        // As with the lines before it, a last line without a newline is
+        // ignored.
+        if (n == 0) return true;
+        offset += n;
+        const char* line = buffer;
+        const char* end = buffer + used + n;
+        while (const char* newline = static_cast<const char*>(
+                   memchr(line, '\n', end - line))) {
+            if (!skipping)
+                ParseLine(format_, line, newline, callback, user_data);
+            skipping = false;
+            line = newline + 1;
+        }
+        used = end - line;
+        if (used == kBufferSize) {
+            skipping = true;
+            used = 0;
+        } else if (used > 0) {
+            memmove(buffer, line, used);
+        }
+    }
+}
+
+}  // namespace memory_advice
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+namespace memory_advice {
+
+/**
+ * @brief Reads "Key: value" lines from a file in /proc, such as /proc/meminfo
+ * or /proc/{pid}/status.
+ *
+ * The file is kept open between reads and read from the start each time with
+ * pread into a fixed buffer on the stack, so a scan doesn't allocate.
+ * A reader must not be scanned from more than one thread at once.
+ */
+class ProcFileReader {
+   public:
+    enum class Format {
+        /** Lines of the form "Key: value", where the key may contain any
+         * character except ':'. */
+        MEMINFO,
+        /** Only lines of the form "Key: value kB" are read. The key is made
+         * of letters only. */
+        STATUS
+    };
+
+    /**
+     * @brief Called for each value found, with a key that is not
+     * null-terminated and the integer value as written in the file.
+     */
+    typedef void (*Callback)(void* user_data, const char* key,
+                             size_t key_length, int64_t value);
+
+    ProcFileReader(std::string path, Format format);
+    ~ProcFileReader();
+
+    ProcFileReader(const ProcFileReader&) = delete;
+    ProcFileReader& operator=(const ProcFileReader&) = delete;
+
+    /**
+     * @brief Read the whole file, calling the callback for each value.
+     * @return false if the file could not be opened or read.
+     */
+    bool Scan(Callback callback, void* user_data);
+
+    const std::string& Path() const { return path_; }
+
+    /**
+     * @brief Parse a single line, without its newline, calling the callback
+     * if it holds a value.
+     */
+    static void ParseLine(Format format, const char* begin, const char* end,
+                          Callback callback, void* user_data);
+
+   private:
+    static constexpr size_t kBufferSize = 2048;
+
+    std::string path_;
+    Format format_;
+    int fd_ = -1;
+};
+
+}  // namespace memory_advice
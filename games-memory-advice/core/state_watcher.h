@@ -17,40 +17,34 @@
 #pragma once
 
 #include <atomic>
-#include <memory>
-#include <thread>
+#include <chrono>
 
 #include "memory_advice/memory_advice.h"
 
 namespace memory_advice {
 
-class MemoryAdviceImpl;
-
+/** @brief A callback registered with MemoryAdvice_registerWatcher. It is
+ * invoked by the WatcherScheduler thread until it is cancelled. */
 class StateWatcher {
    public:
-    StateWatcher(MemoryAdviceImpl* impl, MemoryAdvice_WatcherCallback callback,
-                 void* user_data, uint64_t interval)
-        : callback_(callback),
+    StateWatcher(MemoryAdvice_WatcherCallback callback, void* user_data,
+                 uint64_t interval)
+        : do_cancel_(false),
+          callback_(callback),
           user_data_(user_data),
-          interval_(interval),
-          do_cancel_(false),
-          thread_running_(true),
-          impl_(impl),
-          thread_(std::make_unique<std::thread>(&StateWatcher::Looper, this)) {}
-    virtual ~StateWatcher();
+          interval_(interval) {}
     void Cancel() { do_cancel_ = true; }
-    bool ThreadRunning() const { return thread_running_; }
+    bool Cancelled() const { return do_cancel_; }
     const MemoryAdvice_WatcherCallback Callback() const { return callback_; }
+    std::chrono::milliseconds Interval() const { return interval_; }
+    /** @brief Invokes the callback, unless the watcher was cancelled. */
+    void Notify(MemoryAdvice_MemoryState state);
 
    private:
-    MemoryAdviceImpl* impl_;
     std::atomic<bool> do_cancel_;
-    std::atomic<bool> thread_running_;
-    std::unique_ptr<std::thread> thread_;
     MemoryAdvice_WatcherCallback callback_;
     void* user_data_;
-    uint64_t interval_;
-    void Looper();
+    std::chrono::milliseconds interval_;
 };
 
 }  // namespace memory_advice
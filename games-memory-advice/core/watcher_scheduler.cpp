@@ -0,0 +1,116 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "watcher_scheduler.h"
+
+#include <algorithm>
+
+namespace memory_advice {
+
+constexpr std::chrono::milliseconds WatcherScheduler::kDefaultTolerance;
+
+WatcherScheduler::WatcherScheduler(SampleFunction sample,
+                                   std::chrono::milliseconds tolerance)
+    : sample_(std::move(sample)), tolerance_(tolerance) {}
+
+WatcherScheduler::~WatcherScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        condition_.notify_all();
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void WatcherScheduler::Add(MemoryAdvice_WatcherCallback callback,
+                           void* user_data, uint64_t intervalMillis) {
+    auto watcher =
+        std::make_shared<StateWatcher>(callback, user_data, intervalMillis);
+    std::lock_guard<std::mutex> lock(mutex_);
+    heap_.push_back({Clock::now() + watcher->Interval(), std::move(watcher)});
+    std::push_heap(heap_.begin(), heap_.end(), Later);
+    if (!thread_.joinable()) {
+        thread_ = std::thread(&WatcherScheduler::Looper, this);
+    }
+    // The new watcher may be due before the one being waited for.
+    condition_.notify_all();
+}
+
+int WatcherScheduler::Remove(MemoryAdvice_WatcherCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Cancelling also stops a watcher the thread is about to call back.
+    auto removed = std::remove_if(
+        heap_.begin(), heap_.end(), [callback](const Entry& entry) {
+            if (entry.watcher->Callback() != callback) return false;
+            entry.watcher->Cancel();
+            return true;
+        });
+    int count = heap_.end() - removed;
+    if (count == 0) return 0;
+    heap_.erase(removed, heap_.end());
+    std::make_heap(heap_.begin(), heap_.end(), Later);
+    // Nothing to wake the thread for: if it was waiting for a removed
+    // watcher, it finds the heap changed when it wakes up.
+    return count;
+}
+
+void WatcherScheduler::Looper() {
+    std::vector<Entry> due;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        if (heap_.empty()) {
+            condition_.wait(lock);
+            continue;
+        }
+        // Copied, since the heap may change while waiting.
+        Clock::time_point deadline = heap_.front().deadline;
+        Clock::time_point now = Clock::now();
+        if (deadline > now) {
+            condition_.wait_until(lock, deadline);
+            continue;
+        }
+
+        // Reschedule every watcher due within the tolerance before sampling,
+        // so that they can be removed while the sample is taken.
+        Clock::time_point horizon = now + tolerance_;
+        while (!heap_.empty() && heap_.front().deadline <= horizon) {
+            std::pop_heap(heap_.begin(), heap_.end(), Later);
+            due.push_back(std::move(heap_.back()));
+            heap_.pop_back();
+        }
+        for (Entry& entry : due) {
+            // Keep the watcher's own cadence unless it fell behind.
+            heap_.push_back(
+                {std::max(entry.deadline, now) + entry.watcher->Interval(),
+                 entry.watcher});
+            std::push_heap(heap_.begin(), heap_.end(), Later);
+        }
+
+        lock.unlock();
+        MemoryAdvice_MemoryState state = sample_();
+        if (state != MEMORYADVICE_STATE_OK) {
+            for (Entry& entry : due) {
+                entry.watcher->Notify(state);
+            }
+        }
+        due.clear();
+        lock.lock();
+    }
+}
+
+}  // namespace memory_advice
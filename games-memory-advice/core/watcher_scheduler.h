@@ -0,0 +1,85 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "state_watcher.h"
+
+namespace memory_advice {
+
+/** @brief Runs all the registered watchers on a single thread.
+ *
+ * Watchers are kept in a heap ordered by their next deadline. When the
+ * earliest one is due, every watcher due within the coalescing tolerance is
+ * run with the same memory state sample, so that watchers with similar
+ * intervals don't each evaluate the metrics.
+ */
+class WatcherScheduler {
+   public:
+    typedef std::function<MemoryAdvice_MemoryState()> SampleFunction;
+    typedef std::chrono::steady_clock Clock;
+
+    /** @brief How early a watcher may run to share a sample with a watcher
+     * that is due before it. */
+    static constexpr std::chrono::milliseconds kDefaultTolerance{50};
+
+    WatcherScheduler(SampleFunction sample,
+                     std::chrono::milliseconds tolerance = kDefaultTolerance);
+    /** @brief Stops the thread. Blocks only while a sample or callbacks are
+     * in progress. */
+    ~WatcherScheduler();
+
+    /** @brief Runs the callback every intervalMillis milliseconds, starting
+     * the thread if needed. */
+    void Add(MemoryAdvice_WatcherCallback callback, void* user_data,
+             uint64_t intervalMillis);
+    /** @brief Cancels all the watchers with the given callback, without
+     * waiting for the thread. Returns the number of watchers removed. */
+    int Remove(MemoryAdvice_WatcherCallback callback);
+
+   private:
+    struct Entry {
+        Clock::time_point deadline;
+        std::shared_ptr<StateWatcher> watcher;
+    };
+    /** @brief Orders the heap so the earliest deadline is at the front. */
+    static bool Later(const Entry& a, const Entry& b) {
+        return a.deadline > b.deadline;
+    }
+
+    void Looper();
+
+    const SampleFunction sample_;
+    const std::chrono::milliseconds tolerance_;
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    // Guarded by mutex_
+    std::vector<Entry> heap_;
+    // Guarded by mutex_
+    bool running_ = true;
+    std::thread thread_;
+};
+
+}  // namespace memory_advice
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host benchmark comparing ProcFileReader with the regex parsing that
+// DefaultMetricsProvider used before, on the sample /proc files in this
+// directory. Both must produce the same values.
+//
+// Usage: proc_benchmark <dir containing meminfo.txt and status.txt> [reps]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <regex>
+#include <string>
+
+#include "core/proc_file_reader.h"
+
+using memory_advice::ProcFileReader;
+
+typedef std::map<std::string, double> Values;
+
+constexpr double BYTES_IN_KB = 1024;
+const std::regex MEMINFO_REGEX("([^:]+)[^\\d]*(\\d+).*\n");
+const std::regex STATUS_REGEX("([a-zA-Z]+)[^\\d]*(\\d+) kB.*\n");
+
+static Values ReadWithRegex(const std::string& path,
+                            const std::regex& pattern) {
+    std::ifstream file_stream(path);
+    Values values;
+    std::string file((std::istreambuf_iterator<char>(file_stream)),
+                     std::istreambuf_iterator<char>());
+    std::smatch match;
+    while (std::regex_search(file, match, pattern)) {
+        values[match[1].str()] =
+            (double)(strtoll(match[2].str().c_str(), nullptr, 10) *
+                     BYTES_IN_KB);
+        file = match.suffix().str();
+    }
+    return values;
+}
+
+static Values ReadWithScanner(ProcFileReader& reader) {
+    Values values;
+    auto add_value = [](void* user_data, const char* key, size_t key_length,
+                        int64_t value) {
+        (*static_cast<Values*>(user_data))[std::string(key, key_length)] =
+            (double)(value * BYTES_IN_KB);
+    };
+    if (!reader.Scan(add_value, &values)) {
+        fprintf(stderr, "Could not read %s\n", reader.Path().c_str());
+        exit(1);
+    }
+    return values;
+}
+
+template <typename F>
+static double MicrosecondsPerCall(int reps, F f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; ++i) f();
+    std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() / reps;
+}
+
+static bool Run(const std::string& path, ProcFileReader::Format format,
+                const std::regex& pattern, int reps) {
+    ProcFileReader reader(path, format);
+    Values expected = ReadWithRegex(path, pattern);
+    Values actual = ReadWithScanner(reader);
+    if (expected != actual) {
+        fprintf(stderr, "%s: scanner found %zu values, regex %zu\n",
+                path.c_str(), actual.size(), expected.size());
+        for (auto& v : expected) {
+            auto it = actual.find(v.first);
+            if (it == actual.end() || it->second != v.second)
+                fprintf(stderr, "  mismatch for %s\n", v.first.c_str());
+        }
+        return false;
+    }
+    double regex_us = MicrosecondsPerCall(
+        reps, [&]() { return ReadWithRegex(path, pattern); });
+    double scanner_us =
+        MicrosecondsPerCall(reps, [&]() { return ReadWithScanner(reader); });
+    printf("%s: %zu values, regex %.2f us, scanner %.2f us (%.1fx)\n",
+           path.c_str(), expected.size(), regex_us, scanner_us,
+           regex_us / scanner_us);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <sample dir> [reps]\n", argv[0]);
+        return 1;
+    }
+    std::string dir = argv[1];
+    int reps = argc > 2 ? atoi(argv[2]) : 1000;
+    bool ok = Run(dir + "/meminfo.txt", ProcFileReader::Format::MEMINFO,
+                  MEMINFO_REGEX, reps);
+    ok = Run(dir + "/status.txt", ProcFileReader::Format::STATUS,
+             STATUS_REGEX, reps) &&
+         ok;
+    return ok ? 0 : 1;
+}
@@ -16,7 +16,12 @@
 
 #include "annotation_map.h"
 
-#include <functional>
+#include <string.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "annotation_util.h"
 
 namespace {
 
@@ -24,7 +29,7 @@ namespace {
 // quick and distributed well enough.
 // There is a std::__murmur2_or_cityhash in <utility> but only on later
 // NDK's libc++, so we reproduce here.
-static uint32_t Murmur2Hash(const uint8_t* data, int len) {
+static uint32_t Murmur2Hash(const uint8_t* data, size_t len) {
     const uint32_t m = 0x5bd1e995;
     const int r = 24;
     uint32_t h = len;
@@ -59,29 +64,81 @@ static uint32_t Murmur2Hash(const uint8_t* data, int len) {
 
 namespace tuningfork {
 
-AnnotationMap::AnnotationMap() : hash_table_(kHashTableSize) {}
+constexpr uint32_t AnnotationMap::kEmpty;
+constexpr uint32_t AnnotationMap::kClaimed;
 
-TuningFork_ErrorCode AnnotationMap::GetOrInsert(
-    const ProtobufSerialization& ser, AnnotationId& id) {
-    id = Murmur2Hash(ser.data(), ser.size());
-    auto& ls = hash_table_[HashIndex(id)];
-    for (auto& l : ls) {
-        if (l.first == id) return TUNINGFORK_ERROR_OK;
-    }
-    ls.push_back({id, ser});
-    return TUNINGFORK_ERROR_OK;
+void AnnotationMap::Init(uint32_t max_annotations) {
+    capacity_ = std::max(max_annotations, 1u);
+    // Keep the load factor at or below 1/2 so probe sequences stay short.
+    uint32_t num_slots = 1;
+    while (num_slots < 2 * capacity_) num_slots <<= 1;
+    slot_mask_ = num_slots - 1;
+    slots_.reset(new std::atomic<uint32_t>[num_slots]);
+    for (uint32_t i = 0; i < num_slots; ++i)
+        slots_[i].store(kEmpty, std::memory_order_relaxed);
+    entries_.reset(new Entry[capacity_]);
+    next_id_.store(0, std::memory_order_relaxed);
+    AnnotationId empty_id;
+    GetOrInsert(nullptr, 0, empty_id);
 }
 
-TuningFork_ErrorCode AnnotationMap::Get(AnnotationId id,
-                                        ProtobufSerialization& ser) {
-    auto& ls = hash_table_[HashIndex(id)];
-    for (auto& l : ls) {
-        if (l.first == id) {
-            ser = l.second;
+TuningFork_ErrorCode AnnotationMap::GetOrInsert(const uint8_t* data,
+                                                size_t size, AnnotationId& id) {
+    id = annotation_util::kAnnotationError;
+    if (capacity_ == 0) return TUNINGFORK_ERROR_INVALID_ANNOTATION;
+    uint32_t hash = Murmur2Hash(data, size);
+    uint32_t i = hash & slot_mask_;
+    for (uint32_t n = 0; n <= slot_mask_; ++n, i = (i + 1) & slot_mask_) {
+        auto& slot = slots_[i];
+        uint32_t value = slot.load(std::memory_order_acquire);
+        while (value == kEmpty || value == kClaimed) {
+            if (value == kClaimed) {
+                // Another thread is filling in this slot: it may be our
+                // serialization, so wait to see.
+                std::this_thread::yield();
+                value = slot.load(std::memory_order_acquire);
+                continue;
+            }
+            if (!slot.compare_exchange_weak(value, kClaimed,
+                                            std::memory_order_acquire))
+                continue;
+            uint32_t new_id = next_id_.load(std::memory_order_relaxed);
+            do {
+                if (new_id >= capacity_) {
+                    slot.store(kEmpty, std::memory_order_release);
+                    return TUNINGFORK_ERROR_INVALID_ANNOTATION;
+                }
+            } while (!next_id_.compare_exchange_weak(
+                new_id, new_id + 1, std::memory_order_relaxed));
+            Entry& entry = entries_[new_id];
+            entry.ser.assign(data, data + size);
+            entry.hash = hash;
+            entry.published.store(true, std::memory_order_release);
+            slot.store(new_id + 1, std::memory_order_release);
+            id = new_id;
+            return TUNINGFORK_ERROR_OK;
+        }
+        const Entry& entry = entries_[value - 1];
+        if (entry.hash == hash && entry.ser.size() == size &&
+            (size == 0 || memcmp(entry.ser.data(), data, size) == 0)) {
+            id = value - 1;
             return TUNINGFORK_ERROR_OK;
         }
     }
     return TUNINGFORK_ERROR_INVALID_ANNOTATION;
 }
 
+TuningFork_ErrorCode AnnotationMap::Get(AnnotationId id,
+                                        ProtobufSerialization& ser) const {
+    if (id >= capacity_ ||
+        !entries_[id].published.load(std::memory_order_acquire))
+        return TUNINGFORK_ERROR_INVALID_ANNOTATION;
+    ser = entries_[id].ser;
+    return TUNINGFORK_ERROR_OK;
+}
+
+uint32_t AnnotationMap::Size() const {
+    return next_id_.load(std::memory_order_relaxed);
+}
+
 }  // namespace tuningfork
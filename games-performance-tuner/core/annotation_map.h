@@ -16,9 +16,8 @@
 
 #pragma once
 
-#include <list>
-#include <mutex>
-#include <vector>
+#include <atomic>
+#include <memory>
 
 #include "common.h"
 
@@ -26,25 +25,53 @@ namespace tuningfork {
 
 // Stores the mapping from annotation serializations to annotation ids
 // and back again.
+// Each distinct serialization is given the next id in sequence, starting with
+// 0 for the empty annotation, so ids can be used as array indices.
+// The table is allocated once, in Init, so that lookups and inserts don't need
+// to lock. It uses open addressing: an insert claims an empty slot with a
+// compare-and-swap, fills in the entry and then publishes its id in the slot.
+// A lookup that reaches a slot which is still being filled waits for it.
 class AnnotationMap {
-    // We store in a hash table of fixed size to avoid having to lock when
-    // inserting. If we used an STL unordered map there's the possibility of
-    // rehashing.
-    static const int kHashTableSize = 256;
-    typedef std::vector<
-        std::list<std::pair<AnnotationId, ProtobufSerialization>>>
-        InnerContainer;
-    typedef InnerContainer::iterator Iterator;
-    InnerContainer hash_table_;
-
    public:
-    AnnotationMap();
+    AnnotationMap() {}
+
+    AnnotationMap(const AnnotationMap&) = delete;
+    AnnotationMap& operator=(const AnnotationMap&) = delete;
+
+    // Make room for at least max_annotations serializations, including the
+    // empty one. This must be called before, and not concurrently with, any
+    // other method.
+    void Init(uint32_t max_annotations);
+
+    // Returns TUNINGFORK_ERROR_INVALID_ANNOTATION, with id set to
+    // annotation_util::kAnnotationError, if the table is full.
     TuningFork_ErrorCode GetOrInsert(const ProtobufSerialization& ser,
+                                     AnnotationId& id) {
+        return GetOrInsert(ser.data(), ser.size(), id);
+    }
+    TuningFork_ErrorCode GetOrInsert(const uint8_t* data, size_t size,
                                      AnnotationId& id);
-    TuningFork_ErrorCode Get(AnnotationId id, ProtobufSerialization& ser);
+    TuningFork_ErrorCode Get(AnnotationId id, ProtobufSerialization& ser) const;
+
+    // The number of ids given out so far.
+    uint32_t Size() const;
 
    private:
-    inline int HashIndex(AnnotationId id) { return id & 0xff; }
+    struct Entry {
+        ProtobufSerialization ser;
+        uint32_t hash;
+        // Set once ser and hash have been written.
+        std::atomic<bool> published{false};
+    };
+    // Slots hold kEmpty, kClaimed or an id + 1.
+    static constexpr uint32_t kEmpty = 0;
+    static constexpr uint32_t kClaimed = 0xffffffff;
+
+    uint32_t capacity_ = 0;
+    uint32_t slot_mask_ = 0;
+    std::unique_ptr<std::atomic<uint32_t>[]> slots_;
+    std::unique_ptr<Entry[]> entries_;
+    std::atomic<uint32_t> next_id_{0};
 };
 
 }  // namespace tuningfork
@@ -28,6 +28,10 @@ namespace tuningfork {
 // uploading histograms.
 const uint64_t HISTOGRAMS_PAUSED = 0;
 const uint64_t HISTOGRAMS_UPLOADING = 1;
+// Both keys hold journals (see telemetry_journal.h) of up to this many
+// sessions.
+const size_t MAX_PAUSED_SESSIONS = 8;
+const size_t MAX_UPLOADING_SESSIONS = 16;
 
 // Interface for download and upload of information from Tuning Fork.
 class IBackend {
@@ -68,8 +68,11 @@ struct BatteryMetricData : public MetricData {
         data_.push_back(metric);
     }
 
-    virtual void Clear() override { data_.erase(data_.begin(), data_.end()); }
-    virtual size_t Count() const override { return data_.size(); }
+    void Merge(const BatteryMetricData& other) {
+        data_.insert(data_.end(), other.data_.begin(), other.data_.end());
+    }
+    void Clear() { data_.erase(data_.begin(), data_.end()); }
+    size_t Count() const { return data_.size(); }
     static Metric::Type MetricType() { return Metric::Type::BATTERY; }
 };
 
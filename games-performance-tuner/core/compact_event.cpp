@@ -0,0 +1,429 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compact_event.h"
+
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace tuningfork {
+
+namespace compact_event {
+
+namespace {
+
+constexpr uint8_t kMagic[] = {'T', 'F', 'E', 1};
+// Events are only a few levels deep.
+constexpr int kMaxDepth = 32;
+// The most digits an int64_t can be parsed from without overflowing.
+constexpr int kMaxIntDigits = 18;
+
+enum Tag : uint8_t {
+    kEnd = 0,
+    kNull = 1,
+    kFalse = 2,
+    kTrue = 3,
+    kInt = 4,
+    kDouble = 5,
+    kString = 6,
+    kArray = 7,
+    kObject = 8,
+    kIntArray = 9,
+};
+
+void PutVarint(uint64_t n, std::vector<uint8_t>& out) {
+    while (n >= 0x80) {
+        out.push_back(static_cast<uint8_t>(n | 0x80));
+        n >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(n));
+}
+
+bool GetVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        value |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if ((b & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+uint64_t ZigZag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t UnZigZag(uint64_t n) {
+    return static_cast<int64_t>(n >> 1) ^ -static_cast<int64_t>(n & 1);
+}
+
+// Encoding works directly on the JSON text, so that no json11 tree is built.
+class Encoder {
+   public:
+    Encoder(const std::string& json, std::vector<uint8_t>& out)
+        : p_(json.data()), end_(json.data() + json.size()), out_(out) {}
+
+    bool Encode() {
+        if (!Value(0)) return false;
+        SkipSpace();
+        return p_ == end_;
+    }
+
+   private:
+    void SkipSpace() {
+        while (p_ < end_ &&
+               (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r'))
+            ++p_;
+    }
+
+    bool Literal(const char* s, Tag tag) {
+        size_t n = strlen(s);
+        if (static_cast<size_t>(end_ - p_) < n || memcmp(p_, s, n) != 0)
+            return false;
+        p_ += n;
+        out_.push_back(tag);
+        return true;
+    }
+
+    // Parse an integer without a fraction or exponent, as JsonWriter writes
+    // them. "-0" is left as a double so that it keeps its sign.
+    static bool ParseInt(const char*& p, const char* end, int64_t& value) {
+        const char* q = p;
+        bool negative = q < end && *q == '-';
+        if (negative) ++q;
+        const char* digits = q;
+        int64_t v = 0;
+        while (q < end && *q >= '0' && *q <= '9') {
+            if (q - digits == kMaxIntDigits) return false;
+            v = v * 10 + (*q++ - '0');
+        }
+        if (q == digits || (negative && v == 0)) return false;
+        if (q < end && (*q == '.' || *q == 'e' || *q == 'E')) return false;
+        value = negative ? -v : v;
+        p = q;
+        return true;
+    }
+
+    bool Number() {
+        int64_t i;
+        if (ParseInt(p_, end_, i)) {
+            out_.push_back(kInt);
+            PutVarint(ZigZag(i), out_);
+            return true;
+        }
+        // The text is not null terminated, so copy it before calling strtod.
+        char buf[64];
+        size_t n = 0;
+        while (p_ + n < end_ && n < sizeof(buf) - 1 &&
+               strchr("+-.0123456789eE", p_[n]) != nullptr)
+            ++n;
+        if (n == 0) return false;
+        memcpy(buf, p_, n);
+        buf[n] = '\0';
+        char* parsed_end;
+        double d = strtod(buf, &parsed_end);
+        if (parsed_end != buf + n) return false;
+        p_ += n;
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        out_.push_back(kDouble);
+        for (int i = 0; i < 8; ++i) {
+            out_.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+        }
+        return true;
+    }
+
+    // Copy a string without unescaping it.
+    bool String() {
+        if (p_ == end_ || *p_ != '"') return false;
+        const char* start = ++p_;
+        while (p_ < end_ && *p_ != '"') {
+            if (*p_ == '\\') ++p_;
+            ++p_;
+        }
+        if (p_ >= end_) return false;
+        out_.push_back(kString);
+        PutVarint(p_ - start, out_);
+        out_.insert(out_.end(), start, p_);
+        ++p_;
+        return true;
+    }
+
+    // Encode a non-empty array of integers, or return false without writing
+    // anything if the array holds anything else.
+    bool IntArray() {
+        const char* p = p_ + 1;
+        uint64_t count = 0;
+        for (;;) {
+            int64_t v;
+            while (p < end_ && *p == ' ') ++p;
+            if (!ParseInt(p, end_, v)) return false;
+            ++count;
+            while (p < end_ && *p == ' ') ++p;
+            if (p == end_) return false;
+            if (*p == ']') break;
+            if (*p++ != ',') return false;
+        }
+        out_.push_back(kIntArray);
+        PutVarint(count, out_);
+        ++p_;
+        int64_t previous = 0;
+        uint64_t zeros = 0;
+        for (uint64_t i = 0; i < count; ++i) {
+            int64_t v;
+            SkipSpace();
+            ParseInt(p_, end_, v);
+            SkipSpace();
+            ++p_;  // ',' or ']'
+            int64_t delta = v - previous;
+            previous = v;
+            if (delta == 0 && zeros > 0) {
+                ++zeros;
+                continue;
+            }
+            if (zeros > 0) {
+                PutVarint(zeros - 1, out_);
+                zeros = 0;
+            }
+            PutVarint(ZigZag(delta), out_);
+            if (delta == 0) zeros = 1;
+        }
+        if (zeros > 0) PutVarint(zeros - 1, out_);
+        return true;
+    }
+
+    bool Value(int depth) {
+        if (depth > kMaxDepth) return false;
+        SkipSpace();
+        if (p_ == end_) return false;
+        switch (*p_) {
+            case 'n':
+                return Literal("null", kNull);
+            case 'f':
+                return Literal("false", kFalse);
+            case 't':
+                return Literal("true", kTrue);
+            case '"':
+                return String();
+            case '[': {
+                if (IntArray()) return true;
+                out_.push_back(kArray);
+                ++p_;
+                SkipSpace();
+                if (p_ < end_ && *p_ == ']') {
+                    ++p_;
+                    out_.push_back(kEnd);
+                    return true;
+                }
+                for (;;) {
+                    if (!Value(depth + 1)) return false;
+                    SkipSpace();
+                    if (p_ == end_) return false;
+                    char c = *p_++;
+                    if (c == ']') break;
+                    if (c != ',') return false;
+                }
+                out_.push_back(kEnd);
+                return true;
+            }
+            case '{': {
+                out_.push_back(kObject);
+                ++p_;
+                SkipSpace();
+                if (p_ < end_ && *p_ == '}') {
+                    ++p_;
+                    out_.push_back(kEnd);
+                    return true;
+                }
+                for (;;) {
+                    SkipSpace();
+                    if (!String()) return false;
+                    SkipSpace();
+                    if (p_ == end_ || *p_++ != ':') return false;
+                    if (!Value(depth + 1)) return false;
+                    SkipSpace();
+                    if (p_ == end_) return false;
+                    char c = *p_++;
+                    if (c == '}') break;
+                    if (c != ',') return false;
+                }
+                out_.push_back(kEnd);
+                return true;
+            }
+            default:
+                return Number();
+        }
+    }
+
+    const char* p_;
+    const char* end_;
+    std::vector<uint8_t>& out_;
+};
+
+// Decoding writes the JSON with the same separators as json11.
+class Decoder {
+   public:
+    Decoder(const uint8_t* data, size_t size, std::string& out)
+        : p_(data), end_(data + size), out_(out) {}
+
+    bool Decode() { return Value(0) && p_ == end_; }
+
+   private:
+    void Int(int64_t v) {
+        char buf[32];
+        snprintf(buf, sizeof buf, "%" PRId64, v);
+        out_ += buf;
+    }
+
+    bool String() {
+        uint64_t size;
+        if (!GetVarint(p_, end_, size) ||
+            size > static_cast<uint64_t>(end_ - p_))
+            return false;
+        out_ += '"';
+        out_.append(reinterpret_cast<const char*>(p_), size);
+        out_ += '"';
+        p_ += size;
+        return true;
+    }
+
+    bool IntArray() {
+        uint64_t count;
+        if (!GetVarint(p_, end_, count)) return false;
+        out_ += '[';
+        int64_t v = 0;
+        uint64_t i = 0;
+        while (i < count) {
+            uint64_t zigzag;
+            if (!GetVarint(p_, end_, zigzag)) return false;
+            uint64_t repeats = 1;
+            if (zigzag == 0) {
+                uint64_t more;
+                if (!GetVarint(p_, end_, more) || more >= count - i)
+                    return false;
+                repeats += more;
+            }
+            // Add as unsigned so that corrupt deltas wrap instead of
+            // overflowing.
+            v = static_cast<int64_t>(static_cast<uint64_t>(v) +
+                                     static_cast<uint64_t>(UnZigZag(zigzag)));
+            for (uint64_t r = 0; r < repeats; ++r, ++i) {
+                if (i > 0) out_ += ", ";
+                Int(v);
+            }
+        }
+        out_ += ']';
+        return true;
+    }
+
+    bool Value(int depth) {
+        if (depth > kMaxDepth || p_ == end_) return false;
+        switch (*p_++) {
+            case kNull:
+                out_ += "null";
+                return true;
+            case kFalse:
+                out_ += "false";
+                return true;
+            case kTrue:
+                out_ += "true";
+                return true;
+            case kInt: {
+                uint64_t n;
+                if (!GetVarint(p_, end_, n)) return false;
+                Int(UnZigZag(n));
+                return true;
+            }
+            case kDouble: {
+                if (end_ - p_ < 8) return false;
+                uint64_t bits = 0;
+                for (int i = 0; i < 8; ++i) {
+                    bits |= static_cast<uint64_t>(*p_++) << (8 * i);
+                }
+                double d;
+                memcpy(&d, &bits, sizeof(d));
+                if (std::isfinite(d)) {
+                    char buf[32];
+                    snprintf(buf, sizeof buf, "%.17g", d);
+                    out_ += buf;
+                } else {
+                    out_ += "null";
+                }
+                return true;
+            }
+            case kString:
+                return String();
+            case kIntArray:
+                return IntArray();
+            case kArray: {
+                out_ += '[';
+                for (bool first = true;; first = false) {
+                    if (p_ == end_) return false;
+                    if (*p_ == kEnd) break;
+                    if (!first) out_ += ", ";
+                    if (!Value(depth + 1)) return false;
+                }
+                ++p_;
+                out_ += ']';
+                return true;
+            }
+            case kObject: {
+                out_ += '{';
+                for (bool first = true;; first = false) {
+                    if (p_ == end_) return false;
+                    if (*p_ == kEnd) break;
+                    if (!first) out_ += ", ";
+                    if (*p_++ != kString || !String()) return false;
+                    out_ += ": ";
+                    if (!Value(depth + 1)) return false;
+                }
+                ++p_;
+                out_ += '}';
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    const uint8_t* p_;
+    const uint8_t* end_;
+    std::string& out_;
+};
+
+}  // anonymous namespace
+
+bool Encode(const std::string& evt_json, std::vector<uint8_t>& out) {
+    out.insert(out.end(), kMagic, kMagic + sizeof(kMagic));
+    return Encoder(evt_json, out).Encode();
+}
+
+bool Decode(const uint8_t* data, size_t size, std::string& evt_json) {
+    evt_json.clear();
+    if (size < sizeof(kMagic) || memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        evt_json.assign(reinterpret_cast<const char*>(data), size);
+        return true;
+    }
+    return Decoder(data + sizeof(kMagic), size - sizeof(kMagic), evt_json)
+        .Decode();
+}
+
+}  // namespace compact_event
+
+}  // namespace tuningfork
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tuningfork {
+
+// A compact binary encoding of the JSON events that are queued in journals.
+// The layout is a 4 byte magic followed by a single tagged value:
+//  null, false, true
+//  int:       <zigzag varint>
+//  double:    <8 bytes, little-endian>
+//  string:    <varint size> <bytes, escaped as in the JSON>
+//  array:     <values> <end>
+//  object:    <string key> <value> ... <end>
+//  int array: <varint count> <zigzag varint deltas>
+// In an int array, each value is stored as its difference from the previous
+//  one, and a zero difference is followed by a varint count of the zeros that
+//  come after it. Histogram counts, which are mostly runs of zeros, take a few
+//  bytes instead of two per bucket.
+// Decoding gives the same bytes as json11::Json::dump and JsonWriter write.
+namespace compact_event {
+
+// Encode the JSON in evt_json onto the end of out. Returns false if evt_json
+//  is not valid JSON, in which case out may have been partly written.
+bool Encode(const std::string& evt_json, std::vector<uint8_t>& out);
+
+// Decode an event into evt_json, which is cleared first. Values without the
+//  magic, such as the JSON written by older versions, are copied as they are.
+//  Returns false if the encoding is corrupt.
+bool Decode(const uint8_t* data, size_t size, std::string& evt_json);
+
+}  // namespace compact_event
+
+}  // namespace tuningfork
@@ -51,19 +51,15 @@ TuningFork_ErrorCode FileCache::Get(uint64_t key,
                                     TuningFork_CProtobufSerialization* value) {
     std::lock_guard<std::mutex> lock(mutex_);
     ALOGV("FileCache::Get %" PRIu64, key);
-    if (CheckAndCreateDir(path_)) {
-        auto key_path = PathToKey(path_, key);
-        if (FileExists(key_path)) {
-            ALOGV("File %s exists", key_path.c_str());
-            if (LoadBytesFromFile(key_path, value)) {
-                ALOGV("Loaded key %" PRId64 " from %s (%" PRIu32 " bytes)", key,
-                      key_path.c_str(), value->size);
-                return TUNINGFORK_ERROR_OK;
-            }
-        } else {
-            ALOGV("File %s does not exist", key_path.c_str());
-        }
+    // No need to stat the directory or the file first: the open fails if
+    // either is missing.
+    auto key_path = PathToKey(path_, key);
+    if (LoadBytesFromFile(key_path, value)) {
+        ALOGV("Loaded key %" PRId64 " from %s (%" PRIu32 " bytes)", key,
+              key_path.c_str(), value->size);
+        return TUNINGFORK_ERROR_OK;
     }
+    ALOGV("File %s does not exist", key_path.c_str());
     return TUNINGFORK_ERROR_NO_SUCH_KEY;
 }
 
@@ -36,6 +36,32 @@ void FrameTimeMetricData::Record(Duration dt) {
     }
 }
 
+void FrameTimeMetricData::RecordBatch(const uint64_t* dts_ns, size_t n) {
+    // Convert to milliseconds a chunk at a time so the histogram can bucket
+    // several samples at once without anything being allocated.
+    constexpr size_t kChunkSize = 64;
+    double dts_ms[kChunkSize];
+    size_t m = 0;
+    int64_t total_ns = 0;
+    for (size_t i = 0; i < n; ++i) {
+        int64_t dt = static_cast<int64_t>(dts_ns[i]);
+        if (dt <= 0) continue;
+        total_ns += dt;
+        dts_ms[m++] = double(dt) / 1000000;
+        if (m == kChunkSize) {
+            histogram_.AddBatch(dts_ms, m);
+            m = 0;
+        }
+    }
+    if (m > 0) histogram_.AddBatch(dts_ms, m);
+    duration_ += std::chrono::nanoseconds(total_ns);
+}
+
+void FrameTimeMetricData::Merge(const FrameTimeMetricData& other) {
+    histogram_.MergeRebucketing(other.histogram_);
+    duration_ += other.duration_;
+}
+
 void FrameTimeMetricData::Clear() {
     last_time_ = TimePoint::min();
     histogram_.Clear();
@@ -43,8 +43,12 @@ struct FrameTimeMetricData : public MetricData {
     Duration duration_;
     void Tick(TimePoint t, bool record = true);
     void Record(Duration dt);
-    virtual void Clear() override;
-    virtual size_t Count() const override { return histogram_.Count(); }
+    // Equivalent to calling Record for each of the n nanosecond durations.
+    void RecordBatch(const uint64_t* dts_ns, size_t n);
+    // Add the frame times recorded in another metric with the same settings.
+    void Merge(const FrameTimeMetricData& other);
+    void Clear();
+    size_t Count() const { return histogram_.Count(); }
     static Metric::Type MetricType() { return Metric::Type::FRAME_TIME; }
 };
 
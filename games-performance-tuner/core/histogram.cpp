@@ -16,7 +16,59 @@
 
 #include "histogram.h"
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <cmath>
 #include <sstream>
 
-namespace tuningfork {}  // namespace tuningfork
+namespace tuningfork {
+
+/*static*/ void HistogramBase::AddToBuckets(const double* samples, size_t n,
+                                            double start,
+                                            double inv_bucket_size,
+                                            uint32_t* buckets,
+                                            uint32_t num_buckets) {
+    size_t i = 0;
+    // Compute the indices of two samples at a time: scale, clamp to
+    // [-1, num_buckets - 2] and truncate towards zero, then offset by one, as
+    // in BucketIndex. The increments themselves can't be vectorized.
+#if defined(__aarch64__)
+    const float64x2_t vstart = vdupq_n_f64(start);
+    const float64x2_t vscale = vdupq_n_f64(inv_bucket_size);
+    const float64x2_t vlo = vdupq_n_f64(-1);
+    const float64x2_t vhi = vdupq_n_f64(num_buckets - 2.0);
+    for (; i + 2 <= n; i += 2) {
+        float64x2_t x =
+            vmulq_f64(vsubq_f64(vld1q_f64(samples + i), vstart), vscale);
+        // The 'nm' variants return the number if one operand is a NaN
+        x = vminnmq_f64(vmaxnmq_f64(x, vlo), vhi);
+        int64x2_t b = vcvtq_s64_f64(x);
+        buckets[vgetq_lane_s64(b, 0) + 1]++;
+        buckets[vgetq_lane_s64(b, 1) + 1]++;
+    }
+#elif defined(__SSE2__)
+    const __m128d vstart = _mm_set1_pd(start);
+    const __m128d vscale = _mm_set1_pd(inv_bucket_size);
+    const __m128d vlo = _mm_set1_pd(-1);
+    const __m128d vhi = _mm_set1_pd(num_buckets - 2.0);
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(samples + i), vstart),
+                               vscale);
+        // max returns its second operand if either is a NaN
+        x = _mm_min_pd(_mm_max_pd(x, vlo), vhi);
+        __m128i b = _mm_cvttpd_epi32(x);
+        buckets[_mm_cvtsi128_si32(b) + 1]++;
+        buckets[_mm_cvtsi128_si32(_mm_shuffle_epi32(b, 1)) + 1]++;
+    }
+#endif
+    for (; i < n; ++i) {
+        buckets[BucketIndex((samples[i] - start) * inv_bucket_size,
+                            num_buckets)]++;
+    }
+}
+
+}  // namespace tuningfork
@@ -18,11 +18,13 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
 #include <cmath>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "quantile_sketch.h"
 #include "tuningfork_internal.h"
 
 #define LOG_TAG "TuningFork"
@@ -36,11 +38,29 @@ struct HistogramBase {
         AUTO_RANGE = 1,  // Store a buffer of events until they fill samples_,
                          // then bucket
         EVENTS_ONLY =
-            2  // Store a circular buffer of events and never bucket them
+            2,  // Store a circular buffer of events and never bucket them
+        QUANTILE_SKETCH = 3  // Store in the buckets, if a range is given, and
+                             // in a QuantileSketch
     };
     static constexpr int kAutoSizeNumStdDev = 3;
     static constexpr double kAutoSizeMinBucketSizeMs = 0.1;
     static constexpr int kDefaultNumBuckets = 200;
+
+    // The bucket for a sample, given (sample - start) / bucket_size. The first
+    // and last buckets are for samples outside the range, and NaNs go in the
+    // first.
+    static uint32_t BucketIndex(double x, uint32_t num_buckets) {
+        x = x > -1 ? x : -1;
+        double last = num_buckets - 2;
+        x = x < last ? x : last;
+        return static_cast<int32_t>(x) + 1;
+    }
+
+    // Count n samples into buckets, as BucketIndex does, using SSE2 or NEON
+    // where available.
+    static void AddToBuckets(const double* samples, size_t n, double start,
+                             double inv_bucket_size, uint32_t* buckets,
+                             uint32_t num_buckets);
 };
 
 template <typename Sample>
@@ -50,21 +70,35 @@ class Histogram : HistogramBase {
     Mode initial_mode_;
     Mode mode_;
     Sample start_, end_, bucket_size_;
+    // We multiply by this rather than divide by bucket_size_
+    double inv_bucket_size_;
     uint32_t num_buckets_;
     std::vector<uint32_t> buckets_;
     std::vector<Sample> samples_;
+    QuantileSketch sketch_;
     size_t count_;
     size_t next_event_index_;
 
+    void AddToBuckets(Sample sample);
+    void AddToBuckets(const Sample* samples, size_t n);
+    // Add n copies of sample, leaving out the sketch if add_to_sketch is
+    // false.
+    void AddRepeated(Sample sample, uint64_t n, bool add_to_sketch);
+    void SetBucketSize(Sample bucket_size);
+
    public:
     explicit Histogram(Sample start = 0, Sample end = 0,
                        int num_buckets_between = kDefaultNumBuckets,
-                       bool never_bucket = false);
+                       bool never_bucket = false, bool quantile_sketch = false);
     explicit Histogram(const Settings::Histogram&, bool never_bucket = false);
 
     // Add a sample delta time
     void Add(Sample sample);
 
+    // Add n samples. In HISTOGRAM mode, this is much faster than calling Add
+    // for each.
+    void AddBatch(const Sample* samples, size_t n);
+
     // Reset the histogram
     void Clear();
 
@@ -84,12 +118,25 @@ class Histogram : HistogramBase {
 
     TuningFork_ErrorCode AddCounts(const std::vector<uint32_t>& counts);
 
+    // Add the samples recorded in another histogram with the same buckets, in
+    // HISTOGRAM or QUANTILE_SKETCH mode.
+    TuningFork_ErrorCode Merge(const Histogram& h);
+
+    // Add the samples recorded in another histogram, whatever its mode and
+    // buckets, so that nothing is lost when two auto-ranged histograms chose
+    // different ranges. Samples that h has bucketed in a different range are
+    // re-bucketed at the middle of their bucket.
+    void MergeRebucketing(const Histogram& h);
+
     bool operator==(const Histogram& h) const;
 
     const std::vector<uint32_t>& buckets() const { return buckets_; }
 
     const std::vector<Sample>& samples() const { return samples_; }
 
+    // Only filled in QUANTILE_SKETCH mode
+    const QuantileSketch& sketch() const { return sketch_; }
+
     Mode GetMode() const { return mode_; }
     Sample BucketStart() const { return start_; }
     Sample BucketEnd() const { return end_; }
@@ -99,19 +146,26 @@ class Histogram : HistogramBase {
 
 template <typename Sample>
 Histogram<Sample>::Histogram(Sample start, Sample end, int num_buckets_between,
-                             bool never_bucket)
-    : initial_mode_(never_bucket
-                        ? Mode::EVENTS_ONLY
-                        : ((start == 0 && end == 0) ? Mode::AUTO_RANGE
-                                                    : Mode::HISTOGRAM)),
+                             bool never_bucket, bool quantile_sketch)
+    : initial_mode_(never_bucket      ? Mode::EVENTS_ONLY
+                    : quantile_sketch ? Mode::QUANTILE_SKETCH
+                    : (start == 0 && end == 0) ? Mode::AUTO_RANGE
+                                               : Mode::HISTOGRAM),
       mode_(initial_mode_),
       start_(start),
       end_(end),
       bucket_size_((end_ - start_) /
                    (num_buckets_between <= 0 ? 1 : num_buckets_between)),
+      inv_bucket_size_(bucket_size_ > 0 ? 1.0 / bucket_size_ : 0),
       num_buckets_(num_buckets_between <= 0 ? kDefaultNumBuckets
                                             : (num_buckets_between + 2)),
       buckets_(num_buckets_),
+      // Only QUANTILE_SKETCH mode adds to the sketch, so don't allocate its
+      // bins otherwise.
+      sketch_(QuantileSketch::kDefaultRelativeAccuracy,
+              initial_mode_ == Mode::QUANTILE_SKETCH
+                  ? QuantileSketch::kDefaultMaxBins
+                  : 1),
       count_(0),
       next_event_index_(0) {
     std::fill(buckets_.begin(), buckets_.end(), 0);
@@ -126,39 +180,82 @@ Histogram<Sample>::Histogram(Sample start, Sample end, int num_buckets_between,
         case Mode::EVENTS_ONLY:
             samples_.resize(num_buckets_);
             break;
+        case Mode::QUANTILE_SKETCH:
+            break;
     }
 }
 
 template <typename Sample>
 Histogram<Sample>::Histogram(const Settings::Histogram& hs, bool never_bucket)
-    : Histogram(hs.bucket_min, hs.bucket_max, hs.n_buckets, never_bucket) {}
+    : Histogram(hs.bucket_min, hs.bucket_max, hs.n_buckets, never_bucket,
+                hs.quantile_sketch) {}
+
+template <typename Sample>
+void Histogram<Sample>::SetBucketSize(Sample bucket_size) {
+    bucket_size_ = bucket_size;
+    inv_bucket_size_ = bucket_size_ > 0 ? 1.0 / bucket_size_ : 0;
+}
+
+template <typename Sample>
+void Histogram<Sample>::AddToBuckets(Sample sample) {
+    buckets_[BucketIndex((sample - start_) * inv_bucket_size_, num_buckets_)]++;
+}
+
+template <typename Sample>
+void Histogram<Sample>::AddToBuckets(const Sample* samples, size_t n) {
+    for (size_t i = 0; i < n; ++i) AddToBuckets(samples[i]);
+}
+
+template <>
+inline void Histogram<double>::AddToBuckets(const double* samples, size_t n) {
+    HistogramBase::AddToBuckets(samples, n, start_, inv_bucket_size_,
+                                buckets_.data(), num_buckets_);
+}
 
 template <typename Sample>
 void Histogram<Sample>::Add(Sample sample) {
     switch (mode_) {
-        case Mode::HISTOGRAM: {
-            int i = (sample - start_) / bucket_size_;
-            if (i < 0)
-                buckets_[0]++;
-            else if (i + 1 >= num_buckets_)
-                buckets_[num_buckets_ - 1]++;
-            else
-                buckets_[i + 1]++;
-        } break;
+        case Mode::HISTOGRAM:
+            AddToBuckets(sample);
+            break;
         case Mode::AUTO_RANGE: {
             samples_.push_back(sample);
             if (samples_.size() >= num_buckets_) {
+                // This sets the count, including this sample
                 CalcBucketsFromSamples();
+                return;
             }
         } break;
         case Mode::EVENTS_ONLY: {
             samples_[next_event_index_++] = sample;
             if (next_event_index_ >= samples_.size()) next_event_index_ = 0;
         } break;
+        case Mode::QUANTILE_SKETCH:
+            sketch_.Add(sample);
+            if (bucket_size_ > 0) AddToBuckets(sample);
+            break;
     }
     ++count_;
 }
 
+template <typename Sample>
+void Histogram<Sample>::AddBatch(const Sample* samples, size_t n) {
+    switch (mode_) {
+        case Mode::HISTOGRAM:
+            AddToBuckets(samples, n);
+            count_ += n;
+            break;
+        case Mode::QUANTILE_SKETCH:
+            for (size_t i = 0; i < n; ++i) sketch_.Add(samples[i]);
+            if (bucket_size_ > 0) AddToBuckets(samples, n);
+            count_ += n;
+            break;
+        default:
+            for (size_t i = 0; i < n; ++i) Add(samples[i]);
+            break;
+    }
+}
+
 template <typename Sample>
 void Histogram<Sample>::CalcBucketsFromSamples() {
     if (mode_ != Mode::AUTO_RANGE) return;
@@ -182,18 +279,16 @@ void Histogram<Sample>::CalcBucketsFromSamples() {
     double stddev_scaled = kAutoSizeNumStdDev * stddev;
     start_ = mean > stddev_scaled ? mean - stddev_scaled : Sample();
     end_ = mean + stddev_scaled;
-    bucket_size_ = (end_ - start_) / (num_buckets_ - 2);
+    SetBucketSize((end_ - start_) / (num_buckets_ - 2));
     if (bucket_size_ < kAutoSizeMinBucketSizeMs) {
-        bucket_size_ = kAutoSizeMinBucketSizeMs;
+        SetBucketSize(kAutoSizeMinBucketSizeMs);
         Sample w = bucket_size_ * (num_buckets_ - 2);
         start_ = mean - w / 2;
         end_ = mean + w / 2;
     }
     mode_ = Mode::HISTOGRAM;
-    count_ = 0;
-    for (Sample d : samples_) {
-        Add(d);
-    }
+    AddToBuckets(samples_.data(), samples_.size());
+    count_ = samples_.size();
 }
 
 template <typename Sample>
@@ -201,7 +296,7 @@ std::string Histogram<Sample>::ToDebugJSON() const {
     std::stringstream str;
     str.precision(2);
     str << std::fixed;
-    if (mode_ != Mode::HISTOGRAM) {
+    if (mode_ != Mode::HISTOGRAM && mode_ != Mode::QUANTILE_SKETCH) {
         bool first = true;
         str << "{\"events\":[";
         for (int i = 0; i < samples_.size(); ++i) {
@@ -241,6 +336,7 @@ void Histogram<Sample>::Clear() {
     } else {
         samples_.clear();
     }
+    sketch_.Clear();
     count_ = 0;
 }
 
@@ -260,4 +356,79 @@ TuningFork_ErrorCode Histogram<Sample>::AddCounts(
     return TUNINGFORK_ERROR_OK;
 }
 
+template <typename Sample>
+TuningFork_ErrorCode Histogram<Sample>::Merge(const Histogram& h) {
+    if (mode_ != h.mode_ ||
+        (mode_ != Mode::HISTOGRAM && mode_ != Mode::QUANTILE_SKETCH) ||
+        start_ != h.start_ || bucket_size_ != h.bucket_size_ ||
+        buckets_.size() != h.buckets_.size())
+        return TUNINGFORK_ERROR_BAD_PARAMETER;
+    if (mode_ == Mode::QUANTILE_SKETCH && !sketch_.Merge(h.sketch_))
+        return TUNINGFORK_ERROR_BAD_PARAMETER;
+    AddCounts(h.buckets_);
+    count_ += h.count_;
+    return TUNINGFORK_ERROR_OK;
+}
+
+template <typename Sample>
+void Histogram<Sample>::AddRepeated(Sample sample, uint64_t n,
+                                    bool add_to_sketch) {
+    switch (mode_) {
+        case Mode::HISTOGRAM:
+            buckets_[BucketIndex((sample - start_) * inv_bucket_size_,
+                                 num_buckets_)] += n;
+            count_ += n;
+            break;
+        case Mode::QUANTILE_SKETCH:
+            if (add_to_sketch) {
+                for (uint64_t i = 0; i < n; ++i) sketch_.Add(sample);
+            }
+            if (bucket_size_ > 0)
+                buckets_[BucketIndex((sample - start_) * inv_bucket_size_,
+                                     num_buckets_)] += n;
+            count_ += n;
+            break;
+        default:
+            for (uint64_t i = 0; i < n; ++i) Add(sample);
+            break;
+    }
+}
+
+template <typename Sample>
+void Histogram<Sample>::MergeRebucketing(const Histogram& h) {
+    if (Merge(h) == TUNINGFORK_ERROR_OK) return;
+    if (h.mode_ == Mode::AUTO_RANGE || h.mode_ == Mode::EVENTS_ONLY) {
+        // h kept its samples rather than bucketing them
+        AddBatch(h.samples_.data(), std::min(h.samples_.size(), h.count_));
+        return;
+    }
+    if (mode_ == Mode::AUTO_RANGE) {
+        // Take on the range h chose, then add the samples kept so far
+        std::vector<Sample> samples;
+        samples.swap(samples_);
+        Mode initial_mode = initial_mode_;
+        *this = h;
+        initial_mode_ = initial_mode;
+        AddBatch(samples.data(), samples.size());
+        return;
+    }
+    bool sketch_merged = mode_ == Mode::QUANTILE_SKETCH &&
+                         h.mode_ == Mode::QUANTILE_SKETCH &&
+                         sketch_.Merge(h.sketch_);
+    if (h.bucket_size_ > 0) {
+        // The first and last buckets are for samples outside the range, so
+        // put those half a bucket outside it.
+        for (uint32_t i = 0; i < h.num_buckets_; ++i) {
+            if (h.buckets_[i] == 0) continue;
+            AddRepeated(h.start_ + (i - 0.5) * h.bucket_size_, h.buckets_[i],
+                        !sketch_merged);
+        }
+    } else {
+        // h only has a sketch
+        h.sketch_.ForEachBin([&](double value, uint64_t n) {
+            AddRepeated(value, n, !sketch_merged);
+        });
+    }
+}
+
 }  // namespace tuningfork
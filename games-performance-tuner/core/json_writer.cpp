@@ -0,0 +1,137 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "json_writer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#define LOG_TAG "TuningFork"
+#include "Log.h"
+
+namespace tuningfork {
+
+void JsonWriter::BeforeValue() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (depth_ > 0) {
+        if (has_values_[depth_ - 1]) out_ += ", ";
+        has_values_[depth_ - 1] = true;
+    }
+}
+
+void JsonWriter::Open(char c) {
+    BeforeValue();
+    out_ += c;
+    if (depth_ == kMaxDepth) {
+        ALOGE("JsonWriter: maximum nesting depth exceeded");
+        return;
+    }
+    has_values_[depth_++] = false;
+}
+
+void JsonWriter::Close(char c) {
+    out_ += c;
+    if (depth_ > 0) --depth_;
+}
+
+void JsonWriter::BeginObject() { Open('{'); }
+
+void JsonWriter::EndObject() { Close('}'); }
+
+void JsonWriter::BeginArray() { Open('['); }
+
+void JsonWriter::EndArray() { Close(']'); }
+
+void JsonWriter::Key(const char* key) {
+    BeforeValue();
+    WriteEscaped(key, strlen(key));
+    out_ += ": ";
+    after_key_ = true;
+}
+
+void JsonWriter::String(const std::string& value) {
+    BeforeValue();
+    WriteEscaped(value.data(), value.length());
+}
+
+// Escaping matches json11.
+void JsonWriter::WriteEscaped(const char* value, size_t len) {
+    out_ += '"';
+    for (size_t i = 0; i < len; i++) {
+        const char ch = value[i];
+        if (ch == '\\') {
+            out_ += "\\\\";
+        } else if (ch == '"') {
+            out_ += "\\\"";
+        } else if (ch == '\b') {
+            out_ += "\\b";
+        } else if (ch == '\f') {
+            out_ += "\\f";
+        } else if (ch == '\n') {
+            out_ += "\\n";
+        } else if (ch == '\r') {
+            out_ += "\\r";
+        } else if (ch == '\t') {
+            out_ += "\\t";
+        } else if (static_cast<uint8_t>(ch) <= 0x1f) {
+            char buf[8];
+            snprintf(buf, sizeof buf, "\\u%04x", ch);
+            out_ += buf;
+        } else if (static_cast<uint8_t>(ch) == 0xe2 && i + 2 < len &&
+                   static_cast<uint8_t>(value[i + 1]) == 0x80 &&
+                   static_cast<uint8_t>(value[i + 2]) == 0xa8) {
+            out_ += "\\u2028";
+            i += 2;
+        } else if (static_cast<uint8_t>(ch) == 0xe2 && i + 2 < len &&
+                   static_cast<uint8_t>(value[i + 1]) == 0x80 &&
+                   static_cast<uint8_t>(value[i + 2]) == 0xa9) {
+            out_ += "\\u2029";
+            i += 2;
+        } else {
+            out_ += ch;
+        }
+    }
+    out_ += '"';
+}
+
+void JsonWriter::Int(int value) {
+    BeforeValue();
+    char buf[32];
+    snprintf(buf, sizeof buf, "%d", value);
+    out_ += buf;
+}
+
+void JsonWriter::Double(double value) {
+    BeforeValue();
+    if (std::isfinite(value)) {
+        char buf[32];
+        snprintf(buf, sizeof buf, "%.17g", value);
+        out_ += buf;
+    } else {
+        out_ += "null";
+    }
+}
+
+void JsonWriter::Bool(bool value) {
+    BeforeValue();
+    out_ += value ? "true" : "false";
+}
+
+}  // namespace tuningfork
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace tuningfork {
+
+// Append-only JSON writer that streams directly into a string.
+// The output is formatted in exactly the same way as json11::Json::dump, so
+// callers that write object keys in sorted order produce the same bytes as
+// building a json11 object tree and dumping it.
+class JsonWriter {
+   public:
+    // Output is appended to out, which is not cleared.
+    explicit JsonWriter(std::string& out) : out_(out) {}
+
+    JsonWriter(const JsonWriter&) = delete;
+    JsonWriter& operator=(const JsonWriter&) = delete;
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+
+    // Write the key for the next value in the current object.
+    void Key(const char* key);
+
+    void String(const std::string& value);
+    void Int(int value);
+    void Double(double value);
+    void Bool(bool value);
+
+    // Convenience functions for writing a single key/value pair.
+    template <typename T>
+    void Field(const char* key, const T& value) {
+        Key(key);
+        Value(value);
+    }
+    // Write an array of numbers.
+    template <typename T>
+    void IntArray(const std::vector<T>& values) {
+        BeginArray();
+        for (const auto& v : values) Int(static_cast<int>(v));
+        EndArray();
+    }
+
+   private:
+    // Objects and arrays can't be nested more deeply than this.
+    static constexpr int kMaxDepth = 16;
+
+    void Value(const std::string& value) { String(value); }
+    void Value(const char* value) {
+        BeforeValue();
+        WriteEscaped(value, strlen(value));
+    }
+    void Value(int value) { Int(value); }
+    void Value(double value) { Double(value); }
+    void Value(bool value) { Bool(value); }
+
+    // Write a separator if this isn't the first value in the container.
+    void BeforeValue();
+    void WriteEscaped(const char* s, size_t len);
+    void Open(char c);
+    void Close(char c);
+
+    std::string& out_;
+    // Whether anything has been written yet in each open container.
+    bool has_values_[kMaxDepth] = {};
+    int depth_ = 0;
+    bool after_key_ = false;
+};
+
+}  // namespace tuningfork
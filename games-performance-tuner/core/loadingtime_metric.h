@@ -41,11 +41,15 @@ struct LoadingTimeMetricData : public MetricData {
     Duration duration_;
     void Record(Duration dt);
     void Record(ProcessTimeInterval interval);
-    virtual void Clear() override {
+    void Merge(const LoadingTimeMetricData& other) {
+        for (auto& t : other.data_.Samples()) data_.Add(t);
+        duration_ += other.duration_;
+    }
+    void Clear() {
         data_.Clear();
         duration_ = Duration::zero();
     }
-    virtual size_t Count() const override { return data_.Count(); }
+    size_t Count() const { return data_.Count(); }
     static Metric::Type MetricType() { return Metric::Type::LOADING_TIME; }
 };
 
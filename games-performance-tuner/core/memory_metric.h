@@ -76,8 +76,14 @@ struct MemoryMetricData : public MetricData {
             cyclical_buffer_location %= kBufferSize;
         }
     }
-    virtual void Clear() override { data_.clear(); }
-    virtual size_t Count() const override { return data_.size(); }
+    void Merge(const MemoryMetricData& other) {
+        for (auto& m : other.data_) {
+            if (data_.size() >= kBufferSize) break;
+            data_.push_back(m);
+        }
+    }
+    void Clear() { data_.clear(); }
+    size_t Count() const { return data_.size(); }
     static Metric::Type MetricType() { return Metric::Type::MEMORY; }
 };
 
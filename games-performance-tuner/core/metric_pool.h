@@ -0,0 +1,123 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "metric.h"
+
+namespace tuningfork {
+
+constexpr uint32_t kNoMetricIndex = 0xffffffff;
+
+// Contiguous storage for all the metrics of one type in a session. Metrics
+// are created up front and handed out as their ids are first used, so nothing
+// is allocated while recording.
+// Each metric is created on one of a number of free lists, from which it is
+// later taken: frame time metrics use one per instrumentation key index, since
+// their histogram settings depend on it, while other types only use list 0.
+// Pointers to metrics are stable once all of them have been created, or after
+// Reserve has been called with the final number.
+template <typename T>
+class MetricPool {
+   public:
+    void Reserve(size_t n) {
+        data_.reserve(n);
+        list_.reserve(n);
+        next_.reserve(n);
+        taken_.reserve(n);
+    }
+
+    template <typename... Args>
+    T* Create(uint32_t list, Args&&... args) {
+        uint32_t i = static_cast<uint32_t>(data_.size());
+        data_.emplace_back(std::forward<Args>(args)...);
+        list_.push_back(list);
+        next_.push_back(kNoMetricIndex);
+        if (taken_.capacity() < data_.capacity())
+            taken_.reserve(data_.capacity());
+        if (list >= head_.size()) {
+            head_.resize(list + 1, kNoMetricIndex);
+            tail_.resize(list + 1, kNoMetricIndex);
+        }
+        // Keep the lists in order of creation
+        if (tail_[list] == kNoMetricIndex)
+            head_[list] = i;
+        else
+            next_[tail_[list]] = i;
+        tail_[list] = i;
+        return &data_.back();
+    }
+
+    // Take the next available metric from a list, giving it the id. Returns
+    // its index, or kNoMetricIndex if there are none left.
+    uint32_t Take(uint32_t list, MetricId id) {
+        if (list >= head_.size() || head_[list] == kNoMetricIndex)
+            return kNoMetricIndex;
+        uint32_t i = head_[list];
+        head_[list] = next_[i];
+        if (head_[list] == kNoMetricIndex) tail_[list] = kNoMetricIndex;
+        data_[i].metric_id_ = id;
+        taken_.push_back(i);
+        return i;
+    }
+
+    // Find a metric that has been taken, by searching. Returns kNoMetricIndex
+    // if there is none with this id.
+    uint32_t Find(MetricId id) const {
+        for (uint32_t i : taken_) {
+            if (data_[i].metric_id_ == id) return i;
+        }
+        return kNoMetricIndex;
+    }
+
+    // Clear the data in every metric and make them all available again.
+    void Clear() {
+        taken_.clear();
+        std::fill(head_.begin(), head_.end(), kNoMetricIndex);
+        std::fill(tail_.begin(), tail_.end(), kNoMetricIndex);
+        for (uint32_t i = static_cast<uint32_t>(data_.size()); i-- > 0;) {
+            data_[i].Clear();
+            uint32_t list = list_[i];
+            if (head_[list] == kNoMetricIndex) tail_[list] = i;
+            next_[i] = head_[list];
+            head_[list] = i;
+        }
+    }
+
+    T& operator[](uint32_t i) { return data_[i]; }
+    const T& operator[](uint32_t i) const { return data_[i]; }
+    size_t Size() const { return data_.size(); }
+
+    // The indices of the metrics that have been taken, in the order they were
+    // taken.
+    const std::vector<uint32_t>& Taken() const { return taken_; }
+
+   private:
+    std::vector<T> data_;
+    // The list each metric is on when available, and the next on that list.
+    std::vector<uint32_t> list_;
+    std::vector<uint32_t> next_;
+    std::vector<uint32_t> head_;
+    std::vector<uint32_t> tail_;
+    std::vector<uint32_t> taken_;
+};
+
+}  // namespace tuningfork
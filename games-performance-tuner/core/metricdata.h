@@ -27,13 +27,12 @@
 namespace tuningfork {
 
 // A histogram or time-series stored inside a Session.
+// Sessions store each type of metric separately (see MetricPool), so there
+// are no virtual functions: each type provides its own metric_id_, Clear()
+// and Count().
 struct MetricData {
     MetricData(Metric::Type t) : type(t) {}
     Metric::Type type;
-    virtual ~MetricData() {}
-    virtual void Clear() = 0;
-    virtual size_t Count() const = 0;
-    bool Empty() const { return Count() == 0; }
 };
 
 }  // namespace tuningfork
@@ -31,7 +31,8 @@ class ProcessTimeInterval {
    public:
     ProcessTimeInterval() : start_(0), end_(0) {}
     // Initialize as a duration.
-    ProcessTimeInterval(Duration duration) : start_(duration), end_(0) {}
+    ProcessTimeInterval(tuningfork::Duration duration)
+        : start_(duration), end_(0) {}
     // Initialize as an interval.
     ProcessTimeInterval(ProcessTime start, ProcessTime end)
         : start_(start), end_(end) {
@@ -41,7 +42,7 @@ class ProcessTimeInterval {
         }
     }
     bool IsDuration() const { return end_.count() == 0; }
-    Duration Duration() const {
+    tuningfork::Duration Duration() const {
         if (IsDuration())
             return start_;
         else
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "quantile_sketch.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace tuningfork {
+
+constexpr double QuantileSketch::kDefaultRelativeAccuracy;
+constexpr uint32_t QuantileSketch::kDefaultMaxBins;
+constexpr double QuantileSketch::kMinValue;
+
+QuantileSketch::QuantileSketch(double relative_accuracy, uint32_t max_bins)
+    : relative_accuracy_(
+          (relative_accuracy > 0 && relative_accuracy < 1)
+              ? relative_accuracy
+              : kDefaultRelativeAccuracy),
+      gamma_((1 + relative_accuracy_) / (1 - relative_accuracy_)),
+      inv_log_gamma_(1 / std::log(gamma_)),
+      max_bins_(max_bins > 0 ? max_bins : 1),
+      bins_(max_bins_, 0),
+      offset_(0),
+      num_bins_(0),
+      min_index_(0),
+      zero_count_(0),
+      count_(0),
+      min_(0),
+      max_(0),
+      sum_(0) {}
+
+int32_t QuantileSketch::BinIndex(double sample) const {
+    return static_cast<int32_t>(std::ceil(std::log(sample) * inv_log_gamma_));
+}
+
+// The value with the same relative distance to either end of the bin.
+double QuantileSketch::BinValue(int32_t index) const {
+    return 2 * std::pow(gamma_, index) / (gamma_ + 1);
+}
+
+void QuantileSketch::AddToBin(int32_t index, uint64_t count) {
+    if (num_bins_ == 0) {
+        num_bins_ = 1;
+        min_index_ = index;
+    } else if (index < min_index_) {
+        // Grow downwards as far as the bin limit allows; anything lower goes
+        // into the lowest bin.
+        int32_t lowest =
+            min_index_ - static_cast<int32_t>(max_bins_ - num_bins_);
+        if (index < lowest) index = lowest;
+        uint32_t shift = static_cast<uint32_t>(min_index_ - index);
+        offset_ = offset_ >= shift ? offset_ - shift
+                                   : offset_ + max_bins_ - shift;
+        num_bins_ += shift;
+        min_index_ = index;
+    } else if (index >= min_index_ + static_cast<int32_t>(num_bins_)) {
+        uint32_t new_size = static_cast<uint32_t>(index - min_index_) + 1;
+        if (new_size > max_bins_) {
+            // Collapse the lowest bins into what will be the lowest bin, and
+            // move the start of the array past them.
+            uint32_t shift = std::min(new_size - max_bins_, num_bins_ - 1);
+            uint64_t collapsed = 0;
+            for (uint32_t i = 0; i < shift; ++i) {
+                collapsed += bins_[Slot(i)];
+                bins_[Slot(i)] = 0;
+            }
+            offset_ = Slot(shift);
+            bins_[offset_] += collapsed;
+            min_index_ = index - static_cast<int32_t>(max_bins_) + 1;
+        }
+        num_bins_ = static_cast<uint32_t>(index - min_index_) + 1;
+    }
+    bins_[Slot(static_cast<uint32_t>(index - min_index_))] += count;
+}
+
+void QuantileSketch::Add(double sample) {
+    if (!std::isfinite(sample)) return;
+    if (count_ == 0) {
+        min_ = max_ = sample;
+    } else {
+        min_ = std::min(min_, sample);
+        max_ = std::max(max_, sample);
+    }
+    ++count_;
+    sum_ += sample;
+    if (sample < kMinValue)
+        ++zero_count_;
+    else
+        AddToBin(BinIndex(sample), 1);
+}
+
+bool QuantileSketch::Merge(const QuantileSketch& other) {
+    if (other.relative_accuracy_ != relative_accuracy_) return false;
+    if (other.count_ == 0) return true;
+    if (count_ == 0) {
+        min_ = other.min_;
+        max_ = other.max_;
+    } else {
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    zero_count_ += other.zero_count_;
+    if (other.num_bins_ > 0) {
+        // Size the bins for the whole range up front
+        int32_t other_max_index =
+            other.min_index_ + static_cast<int32_t>(other.num_bins_) - 1;
+        AddToBin(other_max_index, 0);
+        AddToBin(other.min_index_, 0);
+        for (uint32_t i = 0; i < other.num_bins_; ++i) {
+            uint64_t n = other.bins_[other.Slot(i)];
+            if (n > 0) AddToBin(other.min_index_ + static_cast<int32_t>(i), n);
+        }
+    }
+    return true;
+}
+
+double QuantileSketch::Quantile(double q) const {
+    if (count_ == 0) return 0;
+    if (q <= 0) return min_;
+    if (q >= 1) return max_;
+    double rank = q * (count_ - 1);
+    uint64_t n = zero_count_;
+    if (n > rank) return min_;
+    for (uint32_t i = 0; i < num_bins_; ++i) {
+        n += bins_[Slot(i)];
+        if (n > rank) {
+            double value = BinValue(min_index_ + static_cast<int32_t>(i));
+            return std::max(min_, std::min(max_, value));
+        }
+    }
+    return max_;
+}
+
+void QuantileSketch::Clear() {
+    std::fill(bins_.begin(), bins_.end(), 0);
+    offset_ = 0;
+    num_bins_ = 0;
+    min_index_ = 0;
+    zero_count_ = 0;
+    count_ = 0;
+    min_ = max_ = sum_ = 0;
+}
+
+}  // namespace tuningfork
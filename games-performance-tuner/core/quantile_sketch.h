@@ -0,0 +1,101 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tuningfork {
+
+// A mergeable sketch of the distribution of non-negative samples, from which
+// quantiles can be read to within a fixed relative accuracy (see DDSketch,
+// Masson et al. 2019).
+// Samples are counted in logarithmically sized bins, kept in a circular array
+// of max_bins counts that is allocated on construction, so adding a sample
+// never allocates and memory doesn't depend on the number of samples. If
+// more than max_bins bins are needed, the lowest ones are collapsed together
+// by moving the start of the array, which only affects the accuracy of the
+// lowest quantiles.
+class QuantileSketch {
+   public:
+    static constexpr double kDefaultRelativeAccuracy = 0.01;
+    static constexpr uint32_t kDefaultMaxBins = 2048;
+    // Samples smaller than this are counted as zero.
+    static constexpr double kMinValue = 1e-9;
+
+    explicit QuantileSketch(double relative_accuracy = kDefaultRelativeAccuracy,
+                            uint32_t max_bins = kDefaultMaxBins);
+
+    // Add a sample. NaNs and infinities are ignored.
+    void Add(double sample);
+
+    // Add the samples counted in another sketch with the same accuracy.
+    // Returns false, leaving this sketch unchanged, if the accuracies differ.
+    bool Merge(const QuantileSketch& other);
+
+    // The value below which a fraction q of the samples lie, to within the
+    // relative accuracy. The minimum and maximum are exact. Returns 0 if the
+    // sketch is empty.
+    double Quantile(double q) const;
+
+    void Clear();
+
+    size_t Count() const { return count_; }
+    double Min() const { return min_; }
+    double Max() const { return max_; }
+    double Sum() const { return sum_; }
+    double RelativeAccuracy() const { return relative_accuracy_; }
+    size_t NumBins() const { return num_bins_; }
+
+    // Call f(value, count) for each non-empty bin in increasing order of value.
+    template <typename F>
+    void ForEachBin(F f) const {
+        if (zero_count_ > 0) f(0.0, zero_count_);
+        for (uint32_t i = 0; i < num_bins_; ++i) {
+            uint64_t n = bins_[Slot(i)];
+            if (n > 0) f(BinValue(min_index_ + (int32_t)i), n);
+        }
+    }
+
+   private:
+    int32_t BinIndex(double sample) const;
+    double BinValue(int32_t index) const;
+    void AddToBin(int32_t index, uint64_t count);
+    // The position in bins_ of bin min_index_ + i.
+    uint32_t Slot(uint32_t i) const {
+        uint32_t slot = offset_ + i;
+        return slot < max_bins_ ? slot : slot - max_bins_;
+    }
+
+    double relative_accuracy_;
+    double gamma_;
+    double inv_log_gamma_;
+    uint32_t max_bins_;
+    // bins_[Slot(i)] counts samples in
+    // (gamma^(min_index_+i-1), gamma^(min_index_+i)] for i < num_bins_. The
+    // other max_bins_ - num_bins_ entries are zero.
+    std::vector<uint64_t> bins_;
+    uint32_t offset_;
+    uint32_t num_bins_;
+    int32_t min_index_;
+    uint64_t zero_count_;
+    size_t count_;
+    double min_, max_, sum_;
+};
+
+}  // namespace tuningfork
@@ -17,43 +17,180 @@
 
 #include "session.h"
 
+#include <algorithm>
+#include <unordered_map>
+
 namespace tuningfork {
 
 FrameTimeMetricData* Session::CreateFrameTimeHistogram(
     MetricId id, const Settings::Histogram& settings) {
-    frame_time_data_.push_back(
-        std::make_unique<FrameTimeMetricData>(id, settings));
-    auto p = frame_time_data_.back().get();
-    available_frame_time_data_.push_back(p);
-    return p;
+    return frame_time_data_.Create(id.detail.frame_time.ikey, id, settings);
+}
+
+void Session::ReserveMetrics(const TuningFork_MetricLimits& limits) {
+    frame_time_data_.Reserve(limits.frame_time);
+    loading_time_data_.Reserve(limits.loading_time);
+    memory_data_.Reserve(limits.memory);
+    battery_data_.Reserve(limits.battery);
+    thermal_data_.Reserve(limits.thermal);
+}
+
+void Session::InitFrameTimeSlots(uint32_t num_annotations, uint32_t num_ikeys) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_slot_ikeys_ = num_ikeys;
+    frame_time_slots_.assign(
+        num_ikeys > 0 ? static_cast<size_t>(num_annotations) * num_ikeys : 0,
+        kNoMetricIndex);
+    frame_time_index_.clear();
+    for (uint32_t i : frame_time_data_.Taken()) {
+        MetricId id = frame_time_data_[i].metric_id_;
+        if (auto slot = FrameTimeSlot(id))
+            *slot = i;
+        else
+            frame_time_index_.insert({id, i});
+    }
+}
+
+uint32_t* Session::FrameTimeSlot(MetricId id) {
+    AnnotationId annotation = id.detail.annotation;
+    uint16_t ikey = id.detail.frame_time.ikey;
+    // Other bits may be set in ids that don't come from MetricId::FrameTime
+    if (ikey >= num_slot_ikeys_ ||
+        !(id == MetricId::FrameTime(annotation, ikey)))
+        return nullptr;
+    size_t index = static_cast<size_t>(annotation) * num_slot_ikeys_ + ikey;
+    if (index >= frame_time_slots_.size()) return nullptr;
+    return &frame_time_slots_[index];
+}
+
+uint32_t Session::FindOrTake(MetricPool<FrameTimeMetricData>& pool,
+                             MetricId id) {
+    uint32_t* slot = FrameTimeSlot(id);
+    if (slot == nullptr) {
+        auto it = frame_time_index_.find(id);
+        if (it != frame_time_index_.end()) return it->second;
+    } else if (*slot != kNoMetricIndex) {
+        return *slot;
+    }
+    uint32_t i = pool.Take(id.detail.frame_time.ikey, id);
+    if (i == kNoMetricIndex) return i;
+    if (slot)
+        *slot = i;
+    else
+        frame_time_index_.insert({id, i});
+    return i;
+}
+
+bool Session::GetFrameTimeSketch(uint32_t ikey_index,
+                                 QuantileSketch& sketch) const {
+    bool found = false;
+    for (uint32_t i = 0; i < frame_time_data_.Size(); ++i) {
+        auto& d = frame_time_data_[i];
+        if (d.metric_id_.detail.frame_time.ikey != ikey_index) continue;
+        auto& h = d.histogram_;
+        if (h.GetMode() != HistogramBase::Mode::QUANTILE_SKETCH) continue;
+        found = sketch.Merge(h.sketch()) || found;
+    }
+    return found;
+}
+
+TuningFork_ErrorCode Session::GetFrameTimeQuantile(uint32_t ikey_index,
+                                                   double q,
+                                                   double& value) const {
+    QuantileSketch sketch;
+    if (!GetFrameTimeSketch(ikey_index, sketch))
+        return TUNINGFORK_ERROR_BAD_PARAMETER;
+    value = sketch.Quantile(q);
+    return TUNINGFORK_ERROR_OK;
 }
 
 LoadingTimeMetricData* Session::CreateLoadingTimeSeries(MetricId id) {
-    loading_time_data_.push_back(std::make_unique<LoadingTimeMetricData>(id));
-    auto p = loading_time_data_.back().get();
-    available_loading_time_data_.push_back(p);
-    return p;
+    return loading_time_data_.Create(0, id);
 }
 
 MemoryMetricData* Session::CreateMemoryTimeSeries(MetricId id) {
-    memory_data_.push_back(std::make_unique<MemoryMetricData>(id));
-    auto p = memory_data_.back().get();
-    available_memory_data_.push_back(p);
-    return p;
+    return memory_data_.Create(0, id);
 }
 
 BatteryMetricData* Session::CreateBatteryTimeSeries(MetricId id) {
-    battery_data_.push_back(std::make_unique<BatteryMetricData>(id));
-    auto p = battery_data_.back().get();
-    available_battery_data_.push_back(p);
-    return p;
+    return battery_data_.Create(0, id);
 }
 
 ThermalMetricData* Session::CreateThermalTimeSeries(MetricId id) {
-    thermal_data_.push_back(std::make_unique<ThermalMetricData>(id));
-    auto p = thermal_data_.back().get();
-    available_thermal_data_.push_back(p);
-    return p;
+    return thermal_data_.Create(0, id);
+}
+
+namespace {
+
+template <typename T>
+void AddToGroups(const MetricPool<T>& pool,
+                 std::vector<const T*> AnnotationMetrics::*metrics,
+                 std::vector<AnnotationMetrics>& groups,
+                 std::unordered_map<AnnotationId, size_t>& group_index) {
+    for (uint32_t i : pool.Taken()) {
+        const T& d = pool[i];
+        if (d.Count() == 0) continue;
+        AnnotationId annotation = d.metric_id_.detail.annotation;
+        auto it = group_index.find(annotation);
+        if (it == group_index.end()) {
+            it = group_index.insert({annotation, groups.size()}).first;
+            groups.push_back({annotation});
+        }
+        (groups[it->second].*metrics).push_back(&d);
+    }
+}
+
+}  // anonymous namespace
+
+std::vector<AnnotationMetrics> Session::GroupByAnnotation() const {
+    std::vector<AnnotationMetrics> groups;
+    std::unordered_map<AnnotationId, size_t> group_index;
+    AddToGroups(frame_time_data_, &AnnotationMetrics::frame_time, groups,
+                group_index);
+    AddToGroups(loading_time_data_, &AnnotationMetrics::loading_time, groups,
+                group_index);
+    AddToGroups(memory_data_, &AnnotationMetrics::memory, groups, group_index);
+    AddToGroups(battery_data_, &AnnotationMetrics::battery, groups,
+                group_index);
+    AddToGroups(thermal_data_, &AnnotationMetrics::thermal, groups,
+                group_index);
+    std::sort(groups.begin(), groups.end(),
+              [](const AnnotationMetrics& a, const AnnotationMetrics& b) {
+                  return a.annotation < b.annotation;
+              });
+    return groups;
+}
+
+template <typename T>
+bool Session::MergePool(const MetricPool<T>& other) {
+    bool all_merged = true;
+    for (uint32_t i : other.Taken()) {
+        const T& d = other[i];
+        if (d.Count() == 0) continue;
+        T* p = GetData<T>(d.metric_id_);
+        if (p)
+            p->Merge(d);
+        else
+            all_merged = false;
+    }
+    return all_merged;
+}
+
+bool Session::MergeFrom(const Session& other) {
+    bool all_merged = MergePool(other.frame_time_data_);
+    all_merged = MergePool(other.loading_time_data_) && all_merged;
+    all_merged = MergePool(other.memory_data_) && all_merged;
+    all_merged = MergePool(other.battery_data_) && all_merged;
+    all_merged = MergePool(other.thermal_data_) && all_merged;
+    if (other.time_.start != SystemTimePoint()) {
+        if (time_.start == SystemTimePoint() || other.time_.start < time_.start)
+            time_.start = other.time_.start;
+        if (other.time_.end > time_.end) time_.end = other.time_.end;
+    }
+    auto crashes = other.GetCrashReports();
+    std::lock_guard<std::mutex> lock(crash_mutex_);
+    crash_data_.insert(crash_data_.end(), crashes.begin(), crashes.end());
+    return all_merged;
 }
 
 void Session::RecordCrash(CrashReason reason) {
@@ -68,32 +205,17 @@ std::vector<CrashReason> Session::GetCrashReports() const {
 
 void Session::ClearData() {
     std::lock_guard<std::mutex> lock(mutex_);
-    metric_data_.clear();
-    available_frame_time_data_.clear();
-    available_loading_time_data_.clear();
-    available_memory_data_.clear();
-    available_battery_data_.clear();
-    available_thermal_data_.clear();
-    for (auto& p : frame_time_data_) {
-        p->Clear();
-        available_frame_time_data_.push_back(p.get());
-    }
-    for (auto& p : loading_time_data_) {
-        p->Clear();
-        available_loading_time_data_.push_back(p.get());
-    }
-    for (auto& p : memory_data_) {
-        p->Clear();
-        available_memory_data_.push_back(p.get());
-    }
-    for (auto& p : battery_data_) {
-        p->Clear();
-        available_battery_data_.push_back(p.get());
-    }
-    for (auto& p : thermal_data_) {
-        p->Clear();
-        available_thermal_data_.push_back(p.get());
+    generation_.fetch_add(1, std::memory_order_acq_rel);
+    for (uint32_t i : frame_time_data_.Taken()) {
+        if (auto slot = FrameTimeSlot(frame_time_data_[i].metric_id_))
+            *slot = kNoMetricIndex;
     }
+    frame_time_index_.clear();
+    frame_time_data_.Clear();
+    loading_time_data_.Clear();
+    memory_data_.Clear();
+    battery_data_.Clear();
+    thermal_data_.Clear();
     time_.start = SystemTimePoint();
     time_.end = SystemTimePoint();
 }
@@ -16,16 +16,17 @@
 
 #pragma once
 
-#include <list>
-#include <memory>
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "battery_metric.h"
 #include "frametime_metric.h"
 #include "histogram.h"
 #include "loadingtime_metric.h"
 #include "memory_metric.h"
+#include "metric_pool.h"
 #include "thermal_metric.h"
 
 namespace tuningfork {
@@ -34,6 +35,17 @@ struct TimeInterval {
     std::chrono::system_clock::time_point start, end;
 };
 
+// The non-empty metrics of a frozen session that share an annotation,
+// grouped by type.
+struct AnnotationMetrics {
+    AnnotationId annotation;
+    std::vector<const FrameTimeMetricData*> frame_time;
+    std::vector<const LoadingTimeMetricData*> loading_time;
+    std::vector<const MemoryMetricData*> memory;
+    std::vector<const BatteryMetricData*> battery;
+    std::vector<const ThermalMetricData*> thermal;
+};
+
 typedef enum CrashReason {
     CRASH_REASON_UNSPECIFIED = 0,
     LOW_MEMORY = 1,
@@ -52,38 +64,22 @@ class Session {
     template <typename T>
     T* GetData(MetricId id) {
         std::lock_guard<std::mutex> lock(mutex_);
-        auto it = metric_data_.find(id);
-        if (it == metric_data_.end()) {
-            MetricData* d;
-            switch (T::MetricType()) {
-                case Metric::Type::FRAME_TIME:
-                    d = TakeFrameTimeData(id);
-                    break;
-                case Metric::Type::LOADING_TIME:
-                    d = TakeLoadingTimeData(id);
-                    break;
-                case Metric::Type::MEMORY:
-                    d = TakeMemoryData(id);
-                    break;
-                case Metric::Type::BATTERY:
-                    d = TakeBatteryData(id);
-                    break;
-                case Metric::Type::THERMAL:
-                    d = TakeThermalData(id);
-                    break;
-                case Metric::Type::ERROR:
-                    return nullptr;
-            }
-            if (d == nullptr) return nullptr;
-            metric_data_.insert({id, d});
-            return reinterpret_cast<T*>(d);
-        }
-        if (it->second->type == T::MetricType())
-            return reinterpret_cast<T*>(it->second);
-        else
-            return nullptr;
+        auto& pool = Pool(static_cast<T*>(nullptr));
+        uint32_t i = FindOrTake(pool, id);
+        return i == kNoMetricIndex ? nullptr : &pool[i];
     }
 
+    // Reserve space for metrics up to these limits, so that pointers to them
+    // are not invalidated as they are created.
+    void ReserveMetrics(const TuningFork_MetricLimits& limits);
+
+    // Give each (annotation, instrumentation key index) pair its own slot, so
+    // that frame time metrics are found without searching. Annotation ids are
+    // numbered as in annotation_util::SetUpAnnotationRadixes.
+    // Without this, or for ids outside this range such as hashed annotation
+    // ids, metrics are found through a hash map.
+    void InitFrameTimeSlots(uint32_t num_annotations, uint32_t num_ikeys);
+
     // Create a FrameTimeHistogram and add it to the available histograms.
     FrameTimeMetricData* CreateFrameTimeHistogram(
         MetricId id, const Settings::Histogram& settings);
@@ -104,19 +100,48 @@ class Session {
     // Clear the data in each created histogram or time series.
     void ClearData();
 
+    // Add the data recorded in another session, set up in the same way, to
+    // this one. Metrics for which there is no space left here are dropped, in
+    // which case false is returned.
+    // Note that the other session must not be recorded into while merging.
+    bool MergeFrom(const Session& other);
+
+    // Incremented each time the data is cleared. Pointers returned by GetData
+    // remain valid for as long as the generation is unchanged, so callers may
+    // cache them (see TuningForkImpl::GetFrameTimeData).
+    uint32_t Generation() const {
+        return generation_.load(std::memory_order_acquire);
+    }
+
     template <typename T>
     std::vector<const T*> GetNonEmptyHistograms() const {
         // Note that this must only be called once the session has been frozen
         std::vector<const T*> ret;
-        for (const auto& t : metric_data_) {
-            if (!t.second->Empty()) {
-                if (t.second->type == T::MetricType())
-                    ret.push_back(reinterpret_cast<T*>(t.second));
-            }
+        auto& pool = Pool(static_cast<T*>(nullptr));
+        for (uint32_t i : pool.Taken()) {
+            if (pool[i].Count() > 0) ret.push_back(&pool[i]);
         }
         return ret;
     }
 
+    // Index the non-empty metrics by annotation in a single pass over the
+    // session, ordered by annotation id. Within a group, metrics of each type
+    // are in the order GetNonEmptyHistograms would return them.
+    // Note that this must only be called once the session has been frozen.
+    std::vector<AnnotationMetrics> GroupByAnnotation() const;
+
+    // Merge the sketches of the frame time histograms for an instrumentation
+    // key index, over all annotations, into sketch. Returns false if the
+    // histograms for that key are not in QUANTILE_SKETCH mode.
+    // Note that this must only be called once the session has been frozen.
+    bool GetFrameTimeSketch(uint32_t ikey_index, QuantileSketch& sketch) const;
+
+    // Get the q'th quantile (0 <= q <= 1) of the frame times, in ms,
+    // recorded for an instrumentation key index over all annotations.
+    // Note that this must only be called once the session has been frozen.
+    TuningFork_ErrorCode GetFrameTimeQuantile(uint32_t ikey_index, double q,
+                                              double& value) const;
+
     // Update times
     void Ping(SystemTimePoint t);
 
@@ -136,73 +161,61 @@ class Session {
     std::vector<CrashReason> GetCrashReports() const;
 
    private:
-    // Get an available metric that has been set up to work with this id.
-    FrameTimeMetricData* TakeFrameTimeData(MetricId id) {
-        for (auto it = available_frame_time_data_.begin();
-             it != available_frame_time_data_.end(); ++it) {
-            auto p = *it;
-            if (p->metric_id_.detail.frame_time.ikey ==
-                id.detail.frame_time.ikey) {
-                available_frame_time_data_.erase(it);
-                p->metric_id_ = id;
-                return p;
-            }
-        }
-        return nullptr;
+    MetricPool<FrameTimeMetricData>& Pool(FrameTimeMetricData*) {
+        return frame_time_data_;
     }
-
-    // Get an available metric that has been set up to work with this id.
-    LoadingTimeMetricData* TakeLoadingTimeData(MetricId id) {
-        if (available_loading_time_data_.empty()) return nullptr;
-        auto p = available_loading_time_data_.back();
-        available_loading_time_data_.pop_back();
-        p->metric_id_ = id;
-        return p;
+    MetricPool<LoadingTimeMetricData>& Pool(LoadingTimeMetricData*) {
+        return loading_time_data_;
     }
-
-    // Get an available metric that has been set up to work with this id.
-    MemoryMetricData* TakeMemoryData(MetricId id) {
-        if (available_memory_data_.empty()) return nullptr;
-        auto p = available_memory_data_.back();
-        available_memory_data_.pop_back();
-        p->metric_id_ = id;
-        return p;
+    MetricPool<MemoryMetricData>& Pool(MemoryMetricData*) {
+        return memory_data_;
     }
-
-    // Get an available metric that has been set up to work with this id.
-    BatteryMetricData* TakeBatteryData(MetricId id) {
-        if (available_battery_data_.empty()) return nullptr;
-        auto p = available_battery_data_.back();
-        available_battery_data_.pop_back();
-        p->metric_id_ = id;
-        return p;
+    MetricPool<BatteryMetricData>& Pool(BatteryMetricData*) {
+        return battery_data_;
+    }
+    MetricPool<ThermalMetricData>& Pool(ThermalMetricData*) {
+        return thermal_data_;
+    }
+    template <typename T>
+    const MetricPool<T>& Pool(T* tag) const {
+        return const_cast<Session*>(this)->Pool(tag);
     }
 
-    // Get an available metric that has been set up to work with this id.
-    ThermalMetricData* TakeThermalData(MetricId id) {
-        if (available_thermal_data_.empty()) return nullptr;
-        auto p = available_thermal_data_.back();
-        available_thermal_data_.pop_back();
-        p->metric_id_ = id;
-        return p;
+    // Get the metric with this id, or an available one that has been set up to
+    // work with it. Returns kNoMetricIndex if there are none left.
+    // There are only a few metrics of each type other than frame time, so
+    // searching for them is fine.
+    template <typename T>
+    uint32_t FindOrTake(MetricPool<T>& pool, MetricId id) {
+        uint32_t i = pool.Find(id);
+        return i != kNoMetricIndex ? i : pool.Take(0, id);
     }
+    uint32_t FindOrTake(MetricPool<FrameTimeMetricData>& pool, MetricId id);
+
+    template <typename T>
+    bool MergePool(const MetricPool<T>& other);
+
+    // The slot for a frame time metric id, or nullptr if it has none.
+    uint32_t* FrameTimeSlot(MetricId id);
 
     TimeInterval time_ = {};
-    std::vector<std::unique_ptr<FrameTimeMetricData>> frame_time_data_;
-    std::vector<std::unique_ptr<LoadingTimeMetricData>> loading_time_data_;
-    std::vector<std::unique_ptr<MemoryMetricData>> memory_data_;
-    std::vector<std::unique_ptr<BatteryMetricData>> battery_data_;
-    std::vector<std::unique_ptr<ThermalMetricData>> thermal_data_;
-    std::list<FrameTimeMetricData*> available_frame_time_data_;
-    std::vector<LoadingTimeMetricData*> available_loading_time_data_;
-    std::vector<MemoryMetricData*> available_memory_data_;
-    std::vector<BatteryMetricData*> available_battery_data_;
-    std::vector<ThermalMetricData*> available_thermal_data_;
-    std::unordered_map<MetricId, MetricData*> metric_data_;
+    MetricPool<FrameTimeMetricData> frame_time_data_;
+    MetricPool<LoadingTimeMetricData> loading_time_data_;
+    MetricPool<MemoryMetricData> memory_data_;
+    MetricPool<BatteryMetricData> battery_data_;
+    MetricPool<ThermalMetricData> thermal_data_;
+    // The index of the frame time metric for each annotation and
+    // instrumentation key index, or kNoMetricIndex if it hasn't been taken.
+    std::vector<uint32_t> frame_time_slots_;
+    uint32_t num_slot_ikeys_ = 0;
+    // The index of each frame time metric that has been taken and has no
+    // slot.
+    std::unordered_map<MetricId, uint32_t> frame_time_index_;
     std::vector<CrashReason> crash_data_;
     std::vector<InstrumentationKey> instrumentation_keys_;
     std::mutex mutex_;
     mutable std::mutex crash_mutex_;
+    std::atomic<uint32_t> generation_{0};
 };
 
 }  // namespace tuningfork
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "session_ring.h"
+
+#define LOG_TAG "TuningFork"
+#include "Log.h"
+
+namespace tuningfork {
+
+constexpr uint32_t SessionRing::kDefaultMaxQueuedSessions;
+
+SessionRing::SessionRing(uint32_t max_queued_sessions)
+    : size_((max_queued_sessions > 0 ? max_queued_sessions
+                                     : kDefaultMaxQueuedSessions) +
+            1),
+      slots_(new Slot[size_]) {
+    for (uint32_t i = 0; i < size_; ++i) {
+        slots_[i].session = std::make_unique<Session>();
+    }
+    current_ = &slots_[0];
+    current_->state.store(CURRENT, std::memory_order_relaxed);
+}
+
+bool SessionRing::Submit(bool upload, TimePoint t) {
+    Slot* next = nullptr;
+    for (uint32_t i = 0; i < size_; ++i) {
+        // Only the consumer changes a state to FREE, after which it no longer
+        // touches the session.
+        if (slots_[i].state.load(std::memory_order_acquire) == FREE) {
+            next = &slots_[i];
+            break;
+        }
+    }
+    if (next == nullptr) next = MergeOldest();
+    if (next == nullptr) return false;
+    current_->sequence = next_sequence_++;
+    current_->submit_time = t;
+    current_->upload = upload;
+    current_->state.store(QUEUED, std::memory_order_release);
+    next->session->ClearData();
+    next->state.store(CURRENT, std::memory_order_relaxed);
+    current_ = next;
+    return true;
+}
+
+// Merge the second oldest queued session into the oldest and return its slot
+// for reuse, or nullptr if there aren't two sessions that can be merged.
+SessionRing::Slot* SessionRing::MergeOldest() {
+    Slot* oldest = nullptr;
+    Slot* second = nullptr;
+    for (uint32_t i = 0; i < size_; ++i) {
+        Slot* s = &slots_[i];
+        if (s->state.load(std::memory_order_acquire) != QUEUED) continue;
+        if (oldest == nullptr || s->sequence < oldest->sequence) {
+            second = oldest;
+            oldest = s;
+        } else if (second == nullptr || s->sequence < second->sequence) {
+            second = s;
+        }
+    }
+    if (second == nullptr) return nullptr;
+    // The consumer may have started on either of them since we looked.
+    uint32_t expected = QUEUED;
+    if (!oldest->state.compare_exchange_strong(expected, MERGING,
+                                               std::memory_order_acq_rel))
+        return nullptr;
+    expected = QUEUED;
+    if (!second->state.compare_exchange_strong(expected, MERGING,
+                                               std::memory_order_acq_rel)) {
+        oldest->state.store(QUEUED, std::memory_order_release);
+        return nullptr;
+    }
+    if (!oldest->session->MergeFrom(*second->session))
+        ALOGW("Not all metrics could be merged into the queued session");
+    // If either was to be saved rather than uploaded, save both. They will be
+    // uploaded along with the first session after the next start.
+    oldest->upload = oldest->upload && second->upload;
+    oldest->state.store(QUEUED, std::memory_order_release);
+    ++num_merges_;
+    ALOGW("Upload queue full: merged two queued sessions (%u merges so far)",
+          num_merges_);
+    return second;
+}
+
+SessionRing::Stats SessionRing::GetStats(TimePoint t) const {
+    Stats stats{0, Duration::zero(), num_merges_};
+    for (uint32_t i = 0; i < size_; ++i) {
+        auto& s = slots_[i];
+        auto state = s.state.load(std::memory_order_acquire);
+        if (state == FREE || state == CURRENT) continue;
+        ++stats.num_queued;
+        if (t - s.submit_time > stats.oldest_age)
+            stats.oldest_age = t - s.submit_time;
+    }
+    return stats;
+}
+
+const Session* SessionRing::Acquire(bool& upload) {
+    // Sessions must be uploaded in order, so if the oldest is being merged we
+    // have to wait for it.
+    Slot* oldest = nullptr;
+    for (uint32_t i = 0; i < size_; ++i) {
+        Slot* s = &slots_[i];
+        auto state = s->state.load(std::memory_order_acquire);
+        if (state != QUEUED && state != MERGING) continue;
+        if (oldest == nullptr || s->sequence < oldest->sequence) oldest = s;
+    }
+    if (oldest == nullptr) return nullptr;
+    uint32_t expected = QUEUED;
+    if (!oldest->state.compare_exchange_strong(expected, UPLOADING,
+                                               std::memory_order_acq_rel))
+        return nullptr;
+    upload = oldest->upload;
+    return oldest->session.get();
+}
+
+void SessionRing::Release(const Session* session) {
+    for (uint32_t i = 0; i < size_; ++i) {
+        if (slots_[i].session.get() == session) {
+            slots_[i].state.store(FREE, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+}  // namespace tuningfork
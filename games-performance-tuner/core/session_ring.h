@@ -0,0 +1,99 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "session.h"
+
+namespace tuningfork {
+
+// A fixed set of sessions through which recorded data is handed from the
+// thread that records it (the producer) to the upload thread (the consumer).
+// One session is recorded into while up to max_queued_sessions others wait to
+// be uploaded, oldest first. Each session's state is handed over atomically,
+// so neither side waits for the other.
+// If every session is queued when another is submitted, the two oldest that
+// aren't being uploaded are merged to make room rather than losing data.
+class SessionRing {
+   public:
+    struct Stats {
+        // Sessions waiting to be uploaded or being uploaded.
+        uint32_t num_queued;
+        // Time since the oldest of these was submitted.
+        Duration oldest_age;
+        // The number of times queued sessions were merged to make room.
+        uint32_t num_merges;
+    };
+
+    static constexpr uint32_t kDefaultMaxQueuedSessions = 2;
+
+    explicit SessionRing(uint32_t max_queued_sessions);
+
+    SessionRing(const SessionRing&) = delete;
+    SessionRing& operator=(const SessionRing&) = delete;
+
+    // All sessions, for setting up metrics before recording starts.
+    uint32_t Size() const { return size_; }
+    Session& operator[](uint32_t i) { return *slots_[i].session; }
+
+    // The following are only to be called by the producer. There must only be
+    // one at a time: callers that submit from several threads must serialize
+    // their calls, as TuningForkImpl::Flush does.
+
+    // The session being recorded into.
+    Session* Current() const { return current_->session.get(); }
+
+    // Queue the current session to be uploaded (or saved if upload is false)
+    // and start recording into a cleared one. Returns false, leaving the
+    // current session as it is, if there's no room even after merging.
+    bool Submit(bool upload, TimePoint t);
+
+    // Clear the data recorded in the current session.
+    void DiscardCurrent() { current_->session->ClearData(); }
+
+    Stats GetStats(TimePoint t) const;
+
+    // The following are only to be called by the consumer.
+
+    // Get the oldest queued session, or nullptr if there is none ready. It
+    // must be released once it has been dealt with.
+    const Session* Acquire(bool& upload);
+    void Release(const Session* session);
+
+   private:
+    enum State : uint32_t { FREE, CURRENT, QUEUED, UPLOADING, MERGING };
+    struct Slot {
+        std::unique_ptr<Session> session;
+        std::atomic<uint32_t> state{FREE};
+        // Only written by the producer, before the session is queued
+        uint64_t sequence = 0;
+        TimePoint submit_time;
+        bool upload = false;
+    };
+
+    Slot* MergeOldest();
+
+    const uint32_t size_;
+    std::unique_ptr<Slot[]> slots_;
+    Slot* current_;
+    uint64_t next_sequence_ = 0;
+    uint32_t num_merges_ = 0;
+};
+
+}  // namespace tuningfork
@@ -32,6 +32,8 @@ struct Settings {
         float bucket_min;
         float bucket_max;
         int32_t n_buckets;
+        // Also record into a QuantileSketch (see Histogram::Mode).
+        bool quantile_sketch = false;
     };
     struct AggregationStrategy {
         enum class Submission { TICK_BASED, TIME_BASED };
@@ -39,6 +41,8 @@ struct Settings {
         uint32_t intervalms_or_count;
         uint32_t max_instrumentation_keys;
         std::vector<uint32_t> annotation_enum_size;
+        // 0 means SessionRing::kDefaultMaxQueuedSessions.
+        uint32_t max_queued_sessions = 0;
     };
     TuningFork_Settings c_settings;
     AggregationStrategy aggregation_strategy;
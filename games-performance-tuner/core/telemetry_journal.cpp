@@ -0,0 +1,218 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "telemetry_journal.h"
+
+#include <cinttypes>
+#include <cstring>
+#include <mutex>
+
+#define LOG_TAG "TuningFork"
+#include "Log.h"
+#include "compact_event.h"
+#include "proto/protobuf_util.h"
+
+namespace tuningfork {
+
+namespace journal {
+
+namespace {
+
+constexpr uint8_t kMagic[] = {'T', 'F', 'J', 1};
+constexpr size_t kCrcSize = 4;
+constexpr size_t kMaxVarintSize = 10;
+
+// Modifications are a get followed by a set, so serialize them in case
+// several threads update the same journal at once.
+std::mutex s_append_mutex;
+
+// CRC-32 (IEEE 802.3), a nibble at a time to keep the table small.
+uint32_t Crc32(const uint8_t* data, size_t size) {
+    static constexpr uint32_t kTable[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+        0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+        0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c};
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ kTable[crc & 0xf];
+        crc = (crc >> 4) ^ kTable[crc & 0xf];
+    }
+    return ~crc;
+}
+
+void WriteRecord(const uint8_t* payload, size_t size,
+                 std::vector<uint8_t>& out) {
+    uint64_t n = size;
+    while (n >= 0x80) {
+        out.push_back(static_cast<uint8_t>(n | 0x80));
+        n >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(n));
+    uint32_t crc = Crc32(payload, size);
+    for (size_t i = 0; i < kCrcSize; ++i) {
+        out.push_back(static_cast<uint8_t>(crc >> (8 * i)));
+    }
+    out.insert(out.end(), payload, payload + size);
+}
+
+bool ReadVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        value |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if ((b & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+bool Equal(const Record& a, const Record& b) {
+    return a.size == b.size && memcmp(a.data, b.data, a.size) == 0;
+}
+
+}  // anonymous namespace
+
+bool ReadRecords(const uint8_t* bytes, size_t size,
+                 std::vector<Record>& records) {
+    if (size < sizeof(kMagic) || memcmp(bytes, kMagic, sizeof(kMagic)) != 0) {
+        if (size > 0) records.push_back({bytes, size});
+        return true;
+    }
+    const uint8_t* p = bytes + sizeof(kMagic);
+    const uint8_t* end = bytes + size;
+    while (p < end) {
+        uint64_t record_size;
+        if (!ReadVarint(p, end, record_size) ||
+            static_cast<size_t>(end - p) < kCrcSize ||
+            record_size > static_cast<size_t>(end - p) - kCrcSize) {
+            ALOGW("Truncated journal record");
+            return false;
+        }
+        uint32_t crc = 0;
+        for (size_t i = 0; i < kCrcSize; ++i) {
+            crc |= static_cast<uint32_t>(p[i]) << (8 * i);
+        }
+        p += kCrcSize;
+        if (Crc32(p, record_size) != crc) {
+            ALOGW("Bad checksum in journal record");
+            return false;
+        }
+        records.push_back({p, static_cast<size_t>(record_size)});
+        p += record_size;
+    }
+    return true;
+}
+
+TuningFork_ErrorCode Append(const TuningFork_Cache* persister, uint64_t key,
+                            const uint8_t* payload, size_t size,
+                            size_t max_records) {
+    if (persister == nullptr || max_records == 0)
+        return TUNINGFORK_ERROR_BAD_PARAMETER;
+    std::lock_guard<std::mutex> lock(s_append_mutex);
+    std::vector<uint8_t> journal(kMagic, kMagic + sizeof(kMagic));
+    TuningFork_CProtobufSerialization existing;
+    if (persister->get(key, &existing, persister->user_data) ==
+        TUNINGFORK_ERROR_OK) {
+        std::vector<Record> records;
+        ReadRecords(existing.bytes, existing.size, records);
+        size_t first = 0;
+        if (records.size() >= max_records) {
+            first = records.size() - max_records + 1;
+            ALOGW("Journal %" PRIu64 " is full, dropping %zu record(s)", key,
+                  first);
+        }
+        // Room for an extra record header in case existing is a legacy value.
+        journal.reserve(existing.size + size +
+                        2 * (kMaxVarintSize + kCrcSize));
+        for (size_t i = first; i < records.size(); ++i) {
+            WriteRecord(records[i].data, records[i].size, journal);
+        }
+        TuningFork_CProtobufSerialization_free(&existing);
+    } else {
+        journal.reserve(sizeof(kMagic) + size + kMaxVarintSize + kCrcSize);
+    }
+    WriteRecord(payload, size, journal);
+    TuningFork_CProtobufSerialization value{
+        journal.data(), static_cast<uint32_t>(journal.size()), nullptr};
+    return persister->set(key, &value, persister->user_data);
+}
+
+TuningFork_ErrorCode AppendEvent(const TuningFork_Cache* persister,
+                                 uint64_t key, const std::string& evt_json,
+                                 size_t max_records) {
+    std::vector<uint8_t> encoded;
+    encoded.reserve(evt_json.size() / 2);
+    if (!compact_event::Encode(evt_json, encoded)) {
+        ALOGW("Could not encode event, storing it as JSON");
+        return Append(persister, key,
+                      reinterpret_cast<const uint8_t*>(evt_json.data()),
+                      evt_json.size(), max_records);
+    }
+    return Append(persister, key, encoded.data(), encoded.size(),
+                  max_records);
+}
+
+bool ReadEvent(const Record& record, std::string& evt_json) {
+    if (!compact_event::Decode(record.data, record.size, evt_json)) {
+        ALOGW("Corrupt event in journal");
+        return false;
+    }
+    return true;
+}
+
+TuningFork_ErrorCode Remove(const TuningFork_Cache* persister, uint64_t key,
+                            const std::vector<Record>& done) {
+    if (persister == nullptr) return TUNINGFORK_ERROR_BAD_PARAMETER;
+    std::lock_guard<std::mutex> lock(s_append_mutex);
+    TuningFork_CProtobufSerialization existing;
+    auto ret = persister->get(key, &existing, persister->user_data);
+    if (ret != TUNINGFORK_ERROR_OK) return ret;
+    std::vector<Record> records;
+    ReadRecords(existing.bytes, existing.size, records);
+    // Records may have been dropped from the front by Append since done was
+    // read, so skip over any of done that are no longer present.
+    std::vector<const Record*> present;
+    for (auto& d : done) {
+        for (auto& r : records) {
+            if (Equal(r, d)) {
+                present.push_back(&d);
+                break;
+            }
+        }
+    }
+    std::vector<uint8_t> journal(kMagic, kMagic + sizeof(kMagic));
+    journal.reserve(existing.size + kMaxVarintSize + kCrcSize);
+    size_t next = 0;
+    size_t num_kept = 0;
+    for (auto& r : records) {
+        if (next < present.size() && Equal(r, *present[next])) {
+            ++next;
+            continue;
+        }
+        WriteRecord(r.data, r.size, journal);
+        ++num_kept;
+    }
+    TuningFork_CProtobufSerialization_free(&existing);
+    if (num_kept == 0) return persister->remove(key, persister->user_data);
+    TuningFork_CProtobufSerialization value{
+        journal.data(), static_cast<uint32_t>(journal.size()), nullptr};
+    return persister->set(key, &value, persister->user_data);
+}
+
+}  // namespace journal
+
+}  // namespace tuningfork
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tuningfork/tuningfork.h"
+
+namespace tuningfork {
+
+// A journal is a single persisted value holding a queue of serialized events,
+//  so that several sessions can be pending under one key of a TuningFork_Cache
+//  instead of each one overwriting the last.
+// The layout is a 4 byte magic followed by records of:
+//  <varint payload size> <little-endian CRC-32 of payload> <payload>
+// Values without the magic (written by older versions) are read as a single
+//  record.
+namespace journal {
+
+struct Record {
+    const uint8_t* data;
+    size_t size;
+};
+
+// Split a journal value into its records, oldest first. The records point into
+//  bytes and are not copied. Returns false if a truncated or corrupt record was
+//  found, in which case the records before it are still returned.
+bool ReadRecords(const uint8_t* bytes, size_t size,
+                 std::vector<Record>& records);
+
+// Append a record to the journal stored under key, dropping the oldest records
+//  so that no more than max_records remain.
+TuningFork_ErrorCode Append(const TuningFork_Cache* persister, uint64_t key,
+                            const uint8_t* payload, size_t size,
+                            size_t max_records);
+
+// Append an event serialized as JSON, in the compact encoding of
+//  compact_event.h. An event that can't be encoded is stored as its JSON.
+TuningFork_ErrorCode AppendEvent(const TuningFork_Cache* persister,
+                                 uint64_t key, const std::string& evt_json,
+                                 size_t max_records);
+
+// Get the JSON of an event written by AppendEvent, or by older versions.
+//  Returns false if the record is corrupt.
+bool ReadEvent(const Record& record, std::string& evt_json);
+
+// Remove records from the journal stored under key, once they have been dealt
+//  with. done holds records read from the journal, oldest first, and the
+//  records equal to them are removed, in case the journal was modified after
+//  done was read from it. The key is removed when no records remain.
+TuningFork_ErrorCode Remove(const TuningFork_Cache* persister, uint64_t key,
+                            const std::vector<Record>& done);
+
+}  // namespace journal
+
+}  // namespace tuningfork
@@ -57,8 +57,11 @@ struct ThermalMetricData : public MetricData {
         data_.push_back(metric);
     }
 
-    virtual void Clear() override { data_.erase(data_.begin(), data_.end()); }
-    virtual size_t Count() const override { return data_.size(); }
+    void Merge(const ThermalMetricData& other) {
+        data_.insert(data_.end(), other.data_.begin(), other.data_.end());
+    }
+    void Clear() { data_.erase(data_.begin(), data_.end()); }
+    size_t Count() const { return data_.size(); }
     static Metric::Type MetricType() { return Metric::Type::THERMAL; }
 };
 
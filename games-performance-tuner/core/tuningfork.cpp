@@ -137,6 +137,16 @@ TuningFork_ErrorCode FrameDeltaTimeNanos(InstrumentationKey id, Duration dt) {
     }
 }
 
+TuningFork_ErrorCode FrameDeltaTimeNanosBatch(InstrumentationKey id,
+                                              const TuningFork_Duration *dts,
+                                              uint32_t count) {
+    if (!s_impl) {
+        return TUNINGFORK_ERROR_TUNINGFORK_NOT_INITIALIZED;
+    } else {
+        return s_impl->FrameDeltaTimeNanosBatch(id, dts, count);
+    }
+}
+
 TuningFork_ErrorCode StartTrace(InstrumentationKey key, TraceHandle &handle) {
     if (!s_impl) {
         return TUNINGFORK_ERROR_TUNINGFORK_NOT_INITIALIZED;
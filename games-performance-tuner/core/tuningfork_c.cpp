@@ -108,6 +108,14 @@ TuningFork_ErrorCode TuningFork_frameDeltaTimeNanos(TuningFork_InstrumentKey id,
     return tf::FrameDeltaTimeNanos(id, std::chrono::nanoseconds(dt));
 }
 
+// Record several frame ticks using external times
+TuningFork_ErrorCode TuningFork_frameDeltaTimeNanosBatch(
+    TuningFork_InstrumentKey id, const TuningFork_Duration *dts,
+    uint32_t count) {
+    if (dts == nullptr && count > 0) return TUNINGFORK_ERROR_BAD_PARAMETER;
+    return tf::FrameDeltaTimeNanosBatch(id, dts, count);
+}
+
 // Start a trace segment
 TuningFork_ErrorCode TuningFork_startTrace(TuningFork_InstrumentKey key,
                                            TuningFork_TraceHandle *handle) {
@@ -40,15 +40,43 @@ namespace tuningfork {
 
 static constexpr Duration kMinAllowedFlushInterval = std::chrono::seconds(60);
 
+namespace {
+
+// A frame time metric already resolved by the calling thread. It is only valid
+// while the session it came from has the same generation.
+struct FrameTimeSlot {
+    uint64_t owner;
+    const Session *session;
+    uint32_t generation;
+    AnnotationId annotation;
+    InstrumentationKey key;
+    FrameTimeMetricData *data;
+};
+
+// Threads normally tick only a few instrumentation keys each, so a small array
+// scanned linearly is cheaper than hashing into the session's map.
+constexpr int kFrameTimeSlotCacheSize = 8;
+struct FrameTimeSlotCache {
+    FrameTimeSlot slots[kFrameTimeSlotCacheSize] = {};
+    int next = 0;
+};
+
+thread_local FrameTimeSlotCache s_frame_time_slots;
+
+std::atomic<uint64_t> s_next_instance_id{1};
+
+}  // anonymous namespace
+
 TuningForkImpl::TuningForkImpl(const Settings &settings, IBackend *backend,
                                ITimeProvider *time_provider,
                                IMemInfoProvider *meminfo_provider,
                                IBatteryProvider *battery_provider,
                                bool first_run)
     : settings_(settings),
+      sessions_(settings.aggregation_strategy.max_queued_sessions),
       trace_(gamesdk::Trace::create()),
       backend_(backend),
-      upload_thread_(this),
+      upload_thread_(this, &sessions_),
       current_annotation_id_(MetricId::FrameTime(0, 0)),
       time_provider_(time_provider),
       meminfo_provider_(meminfo_provider),
@@ -56,7 +84,8 @@ TuningForkImpl::TuningForkImpl(const Settings &settings, IBackend *backend,
       ikeys_(settings.aggregation_strategy.max_instrumentation_keys),
       next_ikey_(0),
       before_first_tick_(true),
-      app_first_run_(first_run) {
+      app_first_run_(first_run),
+      instance_id_(s_next_instance_id++) {
     if (backend == nullptr) {
         default_backend_ = std::make_unique<HttpBackend>();
         TuningFork_ErrorCode err = default_backend_->Init(settings);
@@ -114,6 +143,7 @@ TuningForkImpl::TuningForkImpl(const Settings &settings, IBackend *backend,
 
     InitHistogramSettings();
     InitAnnotationRadixes();
+    annotation_map_.Init(annotation_radix_mult_.back());
     InitTrainingModeParams();
 
     size_t max_num_frametime_metrics = 0;
@@ -124,19 +154,27 @@ TuningForkImpl::TuningForkImpl(const Settings &settings, IBackend *backend,
             "Neither max_annotations nor max_instrumentation_keys can be zero");
     else
         max_num_frametime_metrics = max_ikeys * annotation_radix_mult_.back();
-    for (int i = 0; i < 2; ++i) {
-        sessions_[i] = std::make_unique<Session>();
-        CreateSessionFrameHistograms(*sessions_[i], max_num_frametime_metrics,
+    for (uint32_t i = 0; i < sessions_.Size(); ++i) {
+        CreateSessionFrameHistograms(sessions_[i], max_num_frametime_metrics,
                                      max_ikeys, settings_.histograms,
                                      settings.c_settings.max_num_metrics);
+        if (max_num_frametime_metrics > 0)
+            sessions_[i].InitFrameTimeSlots(annotation_radix_mult_.back(),
+                                            max_ikeys);
     }
-    current_session_ = sessions_[0].get();
+    current_session_ = sessions_.Current();
     live_traces_.resize(max_num_frametime_metrics);
     for (auto &t : live_traces_) t = TimePoint::min();
     auto crash_callback = [this]() -> bool {
         std::stringstream ss;
         ss << std::this_thread::get_id();
-        TuningFork_ErrorCode ret = this->Flush(true);
+        // Don't wait if the crash was in the middle of a flush.
+        std::unique_lock<std::mutex> lock(flush_mutex_, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            ALOGW("Crashed while flushing: not flushing again");
+            return true;
+        }
+        TuningFork_ErrorCode ret = this->FlushLocked(true);
         ALOGI("Crash flush result : %d", ret);
         return true;
     };
@@ -177,6 +215,7 @@ void TuningForkImpl::CreateSessionFrameHistograms(
     Session &session, size_t size, int max_num_instrumentation_keys,
     const std::vector<Settings::Histogram> &histogram_settings,
     const TuningFork_MetricLimits &limits) {
+    session.ReserveMetrics(limits);
     InstrumentationKey ikey = 0;
     int num_loading_created = 0;
     int num_frametime_created = 0;
@@ -208,7 +247,6 @@ void TuningForkImpl::CreateSessionFrameHistograms(
 // Return the set annotation id or -1 if it could not be set
 MetricId TuningForkImpl::SetCurrentAnnotation(
     const ProtobufSerialization &annotation) {
-    current_annotation_ = annotation;
     AnnotationId id;
     SerializedAnnotationToAnnotationId(annotation, id);
     if (id == annotation_util::kAnnotationError) {
@@ -387,17 +425,14 @@ TuningFork_ErrorCode TuningForkImpl::EndTrace(TraceHandle h) {
 
 TuningFork_ErrorCode TuningForkImpl::FrameTick(InstrumentationKey key) {
     if (Loading()) return TUNINGFORK_ERROR_OK;  // No recording when loading
-    MetricId id{0};
-    auto err =
-        MakeCompoundId(key, current_annotation_id_.detail.annotation, id);
+    FrameTimeMetricData *p;
+    auto err = GetFrameTimeData(key, p);
     if (err != TUNINGFORK_ERROR_OK) return err;
     trace_->beginSection("TFTick");
     current_session_->Ping(time_provider_->SystemNow());
     auto t = time_provider_->Now();
-    MetricData *p;
-    err = TickNanos(id, t, &p);
-    if (err != TUNINGFORK_ERROR_OK) return err;
-    if (p) CheckForSubmit(t, p);
+    TickNanos(p, t);
+    CheckForSubmit(t, p);
     trace_->endSection();
     return TUNINGFORK_ERROR_OK;
 }
@@ -405,19 +440,54 @@ TuningFork_ErrorCode TuningForkImpl::FrameTick(InstrumentationKey key) {
 TuningFork_ErrorCode TuningForkImpl::FrameDeltaTimeNanos(InstrumentationKey key,
                                                          Duration dt) {
     if (Loading()) return TUNINGFORK_ERROR_OK;  // No recording when loading
-    MetricId id{0};
-    auto err =
-        MakeCompoundId(key, current_annotation_id_.detail.annotation, id);
+    FrameTimeMetricData *p;
+    auto err = GetFrameTimeData(key, p);
     if (err != TUNINGFORK_ERROR_OK) return err;
-    MetricData *p;
-    err = TraceNanos(id, dt, &p);
+    if (!logging_paused_) p->Record(dt);
+    CheckForSubmit(time_provider_->Now(), p);
+    return TUNINGFORK_ERROR_OK;
+}
+
+TuningFork_ErrorCode TuningForkImpl::FrameDeltaTimeNanosBatch(
+    InstrumentationKey key, const TuningFork_Duration *dts, uint32_t count) {
+    if (Loading()) return TUNINGFORK_ERROR_OK;  // No recording when loading
+    FrameTimeMetricData *p;
+    auto err = GetFrameTimeData(key, p);
+    if (err != TUNINGFORK_ERROR_OK) return err;
+    if (!logging_paused_) p->RecordBatch(dts, count);
+    CheckForSubmit(time_provider_->Now(), p);
+    return TUNINGFORK_ERROR_OK;
+}
+
+TuningFork_ErrorCode TuningForkImpl::GetFrameTimeData(
+    InstrumentationKey key, FrameTimeMetricData *&data) {
+    Session *session = current_session_;
+    uint32_t generation = session->Generation();
+    AnnotationId annotation = current_annotation_id_.detail.annotation;
+    auto &cache = s_frame_time_slots;
+    for (auto &slot : cache.slots) {
+        if (slot.owner == instance_id_ && slot.session == session &&
+            slot.generation == generation && slot.annotation == annotation &&
+            slot.key == key) {
+            data = slot.data;
+            return TUNINGFORK_ERROR_OK;
+        }
+    }
+    // Slow path: resolve through the session, then remember the result.
+    MetricId id{0};
+    auto err = MakeCompoundId(key, annotation, id);
     if (err != TUNINGFORK_ERROR_OK) return err;
-    if (p) CheckForSubmit(time_provider_->Now(), p);
+    data = session->GetData<FrameTimeMetricData>(id);
+    if (data == nullptr)
+        return TUNINGFORK_ERROR_NO_MORE_SPACE_FOR_FRAME_TIME_DATA;
+    cache.slots[cache.next] = {instance_id_, session, generation,
+                               annotation,   key,     data};
+    cache.next = (cache.next + 1) % kFrameTimeSlotCacheSize;
     return TUNINGFORK_ERROR_OK;
 }
 
-TuningFork_ErrorCode TuningForkImpl::TickNanos(MetricId compound_id,
-                                               TimePoint t, MetricData **pp) {
+TuningFork_ErrorCode TuningForkImpl::TickNanos(FrameTimeMetricData *data,
+                                               TimePoint t) {
     if (before_first_tick_) {
         before_first_tick_ = false;
         // Record the time to the first tick.
@@ -439,20 +509,14 @@ TuningFork_ErrorCode TuningForkImpl::TickNanos(MetricId compound_id,
     // Don't record while we have any loading events live
     if (Loading()) return TUNINGFORK_ERROR_OK;
 
-    // Find the appropriate histogram and add this time
-    auto p = current_session_->GetData<FrameTimeMetricData>(compound_id);
-    if (p) {
-        // Continue ticking even while logging is paused but don't record values
-        p->Tick(t, !logging_paused_ /*record*/);
-        if (pp != nullptr) *pp = p;
-        return TUNINGFORK_ERROR_OK;
-    } else {
-        return TUNINGFORK_ERROR_NO_MORE_SPACE_FOR_FRAME_TIME_DATA;
-    }
+    // Continue ticking even while logging is paused but don't record values
+    data->Tick(t, !logging_paused_ /*record*/);
+    return TUNINGFORK_ERROR_OK;
 }
 
 TuningFork_ErrorCode TuningForkImpl::TraceNanos(MetricId compound_id,
-                                                Duration dt, MetricData **pp) {
+                                                Duration dt,
+                                                FrameTimeMetricData **pp) {
     // Don't record while we have any loading events live
     if (Loading()) return TUNINGFORK_ERROR_OK;
 
@@ -473,7 +537,8 @@ void TuningForkImpl::SetUploadCallback(TuningFork_UploadCallback cbk) {
     upload_thread_.SetUploadCallback(cbk);
 }
 
-bool TuningForkImpl::ShouldSubmit(TimePoint t, MetricData *histogram) {
+bool TuningForkImpl::ShouldSubmit(TimePoint t,
+                                  FrameTimeMetricData *histogram) {
     auto method = settings_.aggregation_strategy.method;
     auto count = settings_.aggregation_strategy.intervalms_or_count;
     switch (settings_.aggregation_strategy.method) {
@@ -485,8 +550,8 @@ bool TuningForkImpl::ShouldSubmit(TimePoint t, MetricData *histogram) {
     return false;
 }
 
-TuningFork_ErrorCode TuningForkImpl::CheckForSubmit(TimePoint t,
-                                                    MetricData *histogram) {
+TuningFork_ErrorCode TuningForkImpl::CheckForSubmit(
+    TimePoint t, FrameTimeMetricData *histogram) {
     TuningFork_ErrorCode ret_code = TUNINGFORK_ERROR_OK;
     if (ShouldSubmit(t, histogram)) {
         ret_code = Flush(t, true);
@@ -542,7 +607,9 @@ void TuningForkImpl::InitHistogramSettings() {
     // histogram
     auto check_histogram = [](Settings::Histogram &h) {
         if (h.bucket_max == 0 || h.n_buckets == 0) {
+            bool quantile_sketch = h.quantile_sketch;
             h = Settings::DefaultHistogram(h.instrument_key);
+            h.quantile_sketch = quantile_sketch;
         }
     };
     for (auto &h : settings_.histograms) {
@@ -551,8 +618,9 @@ void TuningForkImpl::InitHistogramSettings() {
     ALOGI("Settings::Histograms");
     for (uint32_t i = 0; i < settings_.histograms.size(); ++i) {
         auto &h = settings_.histograms[i];
-        ALOGI("ikey: %d min: %f max: %f nbkts: %d", h.instrument_key,
-              h.bucket_min, h.bucket_max, h.n_buckets);
+        ALOGI("ikey: %d min: %f max: %f nbkts: %d sketch: %d",
+              h.instrument_key, h.bucket_min, h.bucket_max, h.n_buckets,
+              h.quantile_sketch);
     }
 }
 
@@ -563,32 +631,43 @@ void TuningForkImpl::InitAnnotationRadixes() {
 }
 
 TuningFork_ErrorCode TuningForkImpl::Flush(bool upload) {
+    std::lock_guard<std::mutex> lock(flush_mutex_);
+    return FlushLocked(upload);
+}
+
+TuningFork_ErrorCode TuningForkImpl::Flush(TimePoint t, bool upload) {
+    std::lock_guard<std::mutex> lock(flush_mutex_);
+    return FlushLocked(t, upload);
+}
+
+TuningFork_ErrorCode TuningForkImpl::FlushLocked(bool upload) {
     auto t = std::chrono::steady_clock::now();
     if (t - last_submit_time_ < kMinAllowedFlushInterval)
         return TUNINGFORK_ERROR_UPLOAD_TOO_FREQUENT;
-    return Flush(t, upload);
+    return FlushLocked(t, upload);
 }
 
-void TuningForkImpl::SwapSessions() {
-    if (current_session_ == sessions_[0].get()) {
-        sessions_[1]->ClearData();
-        current_session_ = sessions_[1].get();
-    } else {
-        sessions_[0]->ClearData();
-        current_session_ = sessions_[0].get();
-    }
-    async_telemetry_->SetSession(current_session_);
-}
-TuningFork_ErrorCode TuningForkImpl::Flush(TimePoint t, bool upload) {
+TuningFork_ErrorCode TuningForkImpl::FlushLocked(TimePoint t, bool upload) {
     ALOGV("Flush %d", upload);
     TuningFork_ErrorCode ret_code;
     current_session_->SetInstrumentationKeys(ikeys_);
-    if (upload_thread_.Submit(current_session_, upload)) {
-        SwapSessions();
+    if (sessions_.Submit(upload, t)) {
+        current_session_ = sessions_.Current();
+        async_telemetry_->SetSession(current_session_);
+        upload_thread_.Notify();
         ret_code = TUNINGFORK_ERROR_OK;
     } else {
         ret_code = TUNINGFORK_ERROR_PREVIOUS_UPLOAD_PENDING;
     }
+    auto stats = sessions_.GetStats(t);
+    if (stats.num_queued > 1)
+        ALOGI("%" PRIu32 " sessions waiting to upload, the oldest for %" PRId64
+              "s",
+              stats.num_queued,
+              static_cast<int64_t>(
+                  std::chrono::duration_cast<std::chrono::seconds>(
+                      stats.oldest_age)
+                      .count()));
     if (upload) last_submit_time_ = t;
     return ret_code;
 }
@@ -602,10 +681,13 @@ void TuningForkImpl::InitTrainingModeParams() {
 
 TuningFork_ErrorCode TuningForkImpl::SetFidelityParameters(
     const ProtobufSerialization &params) {
-    auto flush_result = Flush(true);
-    if (flush_result != TUNINGFORK_ERROR_OK) {
-        ALOGW("Warning, previous data could not be flushed.");
-        SwapSessions();
+    {
+        std::lock_guard<std::mutex> lock(flush_mutex_);
+        auto flush_result = FlushLocked(true);
+        if (flush_result != TUNINGFORK_ERROR_OK) {
+            ALOGW("Warning, previous data could not be flushed.");
+            sessions_.DiscardCurrent();
+        }
     }
     RequestInfo::CachedValue().current_fidelity_parameters = params;
     // We clear the experiment id here.
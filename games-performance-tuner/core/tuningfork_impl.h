@@ -29,6 +29,7 @@
 #include "meminfo_provider.h"
 #include "memory_telemetry.h"
 #include "session.h"
+#include "session_ring.h"
 #include "thermal_metric.h"
 #include "thermal_reporting_task.h"
 #include "time_provider.h"
@@ -42,14 +43,13 @@ class TuningForkImpl : public IdProvider {
    private:
     CrashHandler crash_handler_;
     Settings settings_;
-    std::unique_ptr<Session> sessions_[2];
+    SessionRing sessions_;
     Session *current_session_ = nullptr;
     TimePoint last_submit_time_ = TimePoint::min();
     std::unique_ptr<gamesdk::Trace> trace_;
     std::vector<TimePoint> live_traces_;
     IBackend *backend_;
     UploadThread upload_thread_;
-    SerializedAnnotation current_annotation_;
     std::vector<uint32_t> annotation_radix_mult_;
     MetricId current_annotation_id_;
     ITimeProvider *time_provider_ = nullptr;
@@ -94,6 +94,13 @@ class TuningForkImpl : public IdProvider {
     std::map<AnnotationId, std::string> trace_marker_cache_;
     AnnotationId last_id_;
 
+    // Distinguishes this instance in the per-thread frame time metric cache.
+    const uint64_t instance_id_;
+
+    // SessionRing has a single producer, but Flush is called from the frame
+    // thread, the app's threads and the crash handler.
+    std::mutex flush_mutex_;
+
    public:
     TuningForkImpl(const Settings &settings, IBackend *backend,
                    ITimeProvider *time_provider,
@@ -129,6 +136,9 @@ class TuningForkImpl : public IdProvider {
     TuningFork_ErrorCode FrameDeltaTimeNanos(InstrumentationKey id,
                                              Duration dt);
 
+    TuningFork_ErrorCode FrameDeltaTimeNanosBatch(
+        InstrumentationKey id, const TuningFork_Duration *dts, uint32_t count);
+
     // Fills handle with that to be used by EndTrace
     TuningFork_ErrorCode StartTrace(InstrumentationKey key,
                                     TraceHandle &handle);
@@ -180,21 +190,29 @@ class TuningForkImpl : public IdProvider {
         TuningFork_Submission method, uint32_t interval_ms_or_count);
 
    private:
-    // Record the time between t and the previous tick in the histogram
-    // associated with compound_id. Return the MetricData associated with
-    // compound_id in *ppdata if ppdata is non-null and there is no error.
-    TuningFork_ErrorCode TickNanos(MetricId compound_id, TimePoint t,
-                                   MetricData **ppdata);
+    // Find the frame time metric for key and the current annotation in the
+    // current session. The result is cached per-thread so that, once
+    // resolved, FrameTick and FrameDeltaTimeNanos don't lock or hash.
+    TuningFork_ErrorCode GetFrameTimeData(InstrumentationKey key,
+                                          FrameTimeMetricData *&data);
+
+    // Record the time between t and the previous tick in data.
+    TuningFork_ErrorCode TickNanos(FrameTimeMetricData *data, TimePoint t);
 
     // Record dt in the histogram associated with compound_id.
-    // Return the MetricData associated with compound_id in *ppdata if
+    // Return the FrameTimeMetricData associated with compound_id in *ppdata if
     // ppdata is non-null and there is no error.
     TuningFork_ErrorCode TraceNanos(MetricId compound_id, Duration dt,
-                                    MetricData **ppdata);
+                                    FrameTimeMetricData **ppdata);
+
+    TuningFork_ErrorCode CheckForSubmit(TimePoint t,
+                                        FrameTimeMetricData *metric_data);
 
-    TuningFork_ErrorCode CheckForSubmit(TimePoint t, MetricData *metric_data);
+    bool ShouldSubmit(TimePoint t, FrameTimeMetricData *metric_data);
 
-    bool ShouldSubmit(TimePoint t, MetricData *metric_data);
+    // Flush, with flush_mutex_ held.
+    TuningFork_ErrorCode FlushLocked(bool upload);
+    TuningFork_ErrorCode FlushLocked(TimePoint t, bool upload);
 
     TuningFork_ErrorCode SerializedAnnotationToAnnotationId(
         const SerializedAnnotation &ser, AnnotationId &id) override;
@@ -222,8 +240,6 @@ class TuningForkImpl : public IdProvider {
 
     bool Loading() const { return live_loading_events_.size() > 0; }
 
-    void SwapSessions();
-
     bool Debugging() const;
 
     void InitAsyncTelemetry();
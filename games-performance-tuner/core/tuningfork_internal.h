@@ -81,6 +81,11 @@ TuningFork_ErrorCode FrameTick(InstrumentationKey id);
 // Record a frame tick using an external time, rather than system time
 TuningFork_ErrorCode FrameDeltaTimeNanos(InstrumentationKey id, Duration dt);
 
+// Record several frame ticks using external times, in nanoseconds
+TuningFork_ErrorCode FrameDeltaTimeNanosBatch(InstrumentationKey id,
+                                              const TuningFork_Duration* dts,
+                                              uint32_t count);
+
 // Start a trace segment
 TuningFork_ErrorCode StartTrace(InstrumentationKey key, TraceHandle& handle);
 
@@ -128,7 +128,8 @@ static bool decodeHistograms(pb_istream_t* stream, const pb_field_t* field,
     if (pb_decode(stream, com_google_tuningfork_Settings_Histogram_fields,
                   &hist)) {
         settings->histograms.push_back({hist.instrument_key, hist.bucket_min,
-                                        hist.bucket_max, hist.n_buckets});
+                                        hist.bucket_max, hist.n_buckets,
+                                        hist.quantile_sketch});
         return true;
     } else {
         return false;
@@ -167,6 +168,8 @@ static bool decodeHistograms(pb_istream_t* stream, const pb_field_t* field,
         pbsettings.aggregation_strategy.intervalms_or_count;
     settings->aggregation_strategy.max_instrumentation_keys =
         pbsettings.aggregation_strategy.max_instrumentation_keys;
+    settings->aggregation_strategy.max_queued_sessions =
+        pbsettings.aggregation_strategy.max_queued_sessions;
     settings->initial_request_timeout_ms =
         pbsettings.initial_request_timeout_ms;
     settings->ultimate_request_timeout_ms =
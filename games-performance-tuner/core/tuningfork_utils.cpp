@@ -18,6 +18,7 @@
 
 #include <android/api-level.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/sysinfo.h>
 #include <sys/system_properties.h>
@@ -25,7 +26,6 @@
 
 #include <cinttypes>
 #include <cstdio>
-#include <fstream>
 #include <sstream>
 
 #include "proto/protobuf_util.h"
@@ -39,6 +39,7 @@
 #include "Log.h"
 #include "apk_utils.h"
 #include "jni/jni_wrap.h"
+#include "json_writer.h"
 
 namespace tuningfork {
 
@@ -193,27 +194,47 @@ bool DeleteDir(const std::string& path) {
 bool LoadBytesFromFile(std::string file_name,
                        TuningFork_CProtobufSerialization* params) {
     ALOGV("LoadBytesFromFile:%s", file_name.c_str());
-    std::ifstream f(file_name, std::ios::binary);
-    if (f.good()) {
-        f.seekg(0, std::ios::end);
-        params->size = f.tellg();
+    int fd = open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return false;
+    struct stat sb;
+    bool ok = fstat(fd, &sb) == 0;
+    if (ok) {
+        params->size = sb.st_size;
         params->bytes = (uint8_t*)::malloc(params->size);
         params->dealloc = TuningFork_CProtobufSerialization_Dealloc;
-        f.seekg(0, std::ios::beg);
-        f.read((char*)params->bytes, params->size);
-        return true;
+        size_t total = 0;
+        while (total < params->size) {
+            ssize_t n = read(fd, params->bytes + total, params->size - total);
+            if (n == -1 && errno == EINTR) continue;
+            if (n <= 0) break;
+            total += n;
+        }
+        // The file may have been truncated since the fstat
+        params->size = total;
     }
-    return false;
+    close(fd);
+    return ok;
 }
 
 bool SaveBytesToFile(std::string file_name,
                      const TuningFork_CProtobufSerialization* params) {
     ALOGV("SaveBytesToFile:%s", file_name.c_str());
-    std::ofstream save_file(file_name, std::ios::binary);
-    if (save_file.good()) {
-        save_file.write((const char*)params->bytes, params->size);
-        return true;
+    std::string tmp_name = file_name + ".tmp";
+    int fd = open(tmp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0660);
+    if (fd == -1) return false;
+    size_t total = 0;
+    while (total < params->size) {
+        ssize_t n = write(fd, params->bytes + total, params->size - total);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) break;
+        total += n;
     }
+    bool ok = total == params->size && fsync(fd) == 0;
+    ok = (close(fd) == 0) && ok;
+    if (ok && rename(tmp_name.c_str(), file_name.c_str()) == 0) return true;
+    ALOGW("Error saving %s: %d", file_name.c_str(), errno);
+    unlink(tmp_name.c_str());
     return false;
 }
 
@@ -254,6 +275,37 @@ Json::object DeviceSpecJson(const RequestInfo& request_info) {
                         {"width_pixels", request_info.width_pixels}};
 }
 
+// Keys are written in sorted order to match the json11 object above.
+void WriteDeviceSpecJson(const RequestInfo& request_info, JsonWriter& writer) {
+    writer.BeginObject();
+    writer.Field("brand", request_info.brand);
+    writer.Field("build_version", request_info.build_version_sdk);
+    writer.Key("cpu_core_freqs_hz");
+    writer.BeginArray();
+    for (auto f : request_info.cpu_max_freq_hz)
+        writer.Double(static_cast<double>(f));
+    writer.EndArray();
+    writer.Field("device", request_info.device);
+    writer.Field("fingerprint", request_info.build_fingerprint);
+    writer.Key("gles_version");
+    writer.BeginObject();
+    writer.Field("major", static_cast<int>(request_info.gl_es_version >> 16));
+    writer.Field("minor",
+                 static_cast<int>(request_info.gl_es_version & 0xffff));
+    writer.EndObject();
+    writer.Field("height_pixels", request_info.height_pixels);
+    writer.Field("model", request_info.model);
+    writer.Field("product", request_info.product);
+    writer.Field("soc_manufacturer", request_info.soc_manufacturer);
+    writer.Field("soc_model", request_info.soc_model);
+    writer.Field("swap_total_bytes",
+                 static_cast<double>(request_info.swap_total_bytes));
+    writer.Field("total_memory_bytes",
+                 static_cast<double>(request_info.total_memory_bytes));
+    writer.Field("width_pixels", request_info.width_pixels);
+    writer.EndObject();
+}
+
 }  // namespace json_utils
 
 std::string UniqueId() {
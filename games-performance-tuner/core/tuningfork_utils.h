@@ -61,6 +61,8 @@ bool DeleteDir(const std::string& path);
 bool LoadBytesFromFile(std::string file_name,
                        TuningFork_CProtobufSerialization* params);
 
+// Writes to a temporary file and renames it over file_name, so a crash never
+//  leaves a partially written file behind.
 bool SaveBytesToFile(std::string file_name,
                      const TuningFork_CProtobufSerialization* params);
 
@@ -69,6 +71,8 @@ std::string GetAppCacheDir();
 
 }  // namespace file_utils
 
+class JsonWriter;
+
 namespace json_utils {
 
 // Resource name for the tuning parameters of an apk, identified by package
@@ -78,6 +82,9 @@ std::string GetResourceName(const RequestInfo& request_info);
 // See DeviceSpec in proto/performanceparameters.proto
 json11::Json::object DeviceSpecJson(const RequestInfo& request_info);
 
+// Stream the same DeviceSpec as above into writer.
+void WriteDeviceSpecJson(const RequestInfo& request_info, JsonWriter& writer);
+
 }  // namespace json_utils
 
 // Get a unique identifier using java.util.UUID
@@ -26,6 +26,7 @@
 
 #define LOG_TAG "TuningFork"
 #include "Log.h"
+#include "telemetry_journal.h"
 #include "tuningfork_impl.h"
 
 namespace tuningfork {
@@ -71,8 +72,9 @@ class DebugBackend : public IBackend {
 static std::unique_ptr<DebugBackend> s_debug_backend =
     std::make_unique<DebugBackend>();
 
-UploadThread::UploadThread(IdProvider* id_provider)
+UploadThread::UploadThread(IdProvider* id_provider, SessionRing* sessions)
     : Runnable(nullptr),
+      sessions_(sessions),
       backend_(s_debug_backend.get()),
       upload_callback_(nullptr),
       persister_(nullptr),
@@ -89,30 +91,23 @@ void UploadThread::SetBackend(IBackend* backend) {
 
 UploadThread::~UploadThread() { Stop(); }
 
-void UploadThread::Start() {
-    ready_ = nullptr;
-    Runnable::Start();
-}
+void UploadThread::Start() { Runnable::Start(); }
 
 Duration UploadThread::DoWork() {
-    if (ready_) {
-        std::string evt_ser_json;
-        JsonSerializer serializer(*ready_, id_provider_);
-        serializer.SerializeEvent(RequestInfo::CachedValue(), evt_ser_json);
+    bool upload;
+    while (const Session* session = sessions_->Acquire(upload)) {
+        JsonSerializer serializer(*session, id_provider_);
+        serializer.SerializeEvent(RequestInfo::CachedValue(), evt_ser_json_);
+        sessions_->Release(session);
         if (upload_callback_) {
-            upload_callback_(evt_ser_json.c_str(), evt_ser_json.size());
+            upload_callback_(evt_ser_json_.c_str(), evt_ser_json_.size());
         }
-        if (upload_)
-            backend_->UploadTelemetry(evt_ser_json);
-        else {
-            TuningFork_CProtobufSerialization cser;
-            ToCProtobufSerialization(evt_ser_json, cser);
-            if (persister_)
-                persister_->set(HISTOGRAMS_PAUSED, &cser,
-                                persister_->user_data);
-            TuningFork_CProtobufSerialization_free(&cser);
+        if (upload)
+            backend_->UploadTelemetry(evt_ser_json_);
+        else if (persister_) {
+            journal::AppendEvent(persister_, HISTOGRAMS_PAUSED, evt_ser_json_,
+                                 MAX_PAUSED_SESSIONS);
         }
-        ready_ = nullptr;
     }
     if (!lifecycle_event_.empty()) {
         std::string evt_ser_json;
@@ -129,21 +124,6 @@ Duration UploadThread::DoWork() {
     return std::chrono::seconds(1);
 }
 
-// Returns true if we submitted, false if we are waiting for a previous submit
-// to complete
-bool UploadThread::Submit(const Session* session, bool upload) {
-    if (ready_ == nullptr) {
-        {
-            std::lock_guard<std::mutex> lock(mutex_);
-            upload_ = upload;
-            ready_ = session;
-        }
-        cv_.notify_one();
-        return true;
-    } else
-        return false;
-}
-
 void UploadThread::InitialChecks(Session& session, IdProvider& id_provider,
                                  const TuningFork_Cache* persister) {
     persister_ = persister;
@@ -151,14 +131,33 @@ void UploadThread::InitialChecks(Session& session, IdProvider& id_provider,
         ALOGE("No persistence mechanism given");
         return;
     }
-    // Check for PAUSED session
+    // Check for PAUSED sessions
     TuningFork_CProtobufSerialization paused_hists_ser;
     if (persister->get(HISTOGRAMS_PAUSED, &paused_hists_ser,
                        persister_->user_data) == TUNINGFORK_ERROR_OK) {
-        std::string paused_hists_str = ToString(paused_hists_ser);
-        ALOGI("Got PAUSED histograms: %s", paused_hists_str.c_str());
-        JsonSerializer::DeserializeAndMerge(paused_hists_str, id_provider,
-                                            session);
+        std::vector<journal::Record> records;
+        journal::ReadRecords(paused_hists_ser.bytes, paused_hists_ser.size,
+                             records);
+        std::vector<journal::Record> done;
+        std::string paused_hists_str;
+        for (auto& record : records) {
+            // A corrupt record will never merge, so drop it.
+            if (!journal::ReadEvent(record, paused_hists_str)) {
+                done.push_back(record);
+                continue;
+            }
+            ALOGI("Got PAUSED histograms: %s", paused_hists_str.c_str());
+            if (JsonSerializer::DeserializeAndMerge(
+                    paused_hists_str, id_provider, session) ==
+                TUNINGFORK_ERROR_OK) {
+                done.push_back(record);
+            } else {
+                ALOGW("Could not merge PAUSED histograms, keeping them");
+            }
+        }
+        // The merged histograms are now part of session, which will be
+        // uploaded or paused again. Any others are left in the journal.
+        if (!done.empty()) journal::Remove(persister_, HISTOGRAMS_PAUSED, done);
         TuningFork_CProtobufSerialization_free(&paused_hists_ser);
     } else {
         ALOGI("No PAUSED histograms");
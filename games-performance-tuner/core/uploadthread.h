@@ -20,13 +20,13 @@
 #include "lifecycle_upload_event.h"
 #include "runnable.h"
 #include "session.h"
+#include "session_ring.h"
 
 namespace tuningfork {
 
 class UploadThread : public Runnable {
    private:
-    const Session* ready_ = nullptr;
-    bool upload_ = false;
+    SessionRing* sessions_;
     IBackend* backend_ = nullptr;
     TuningFork_UploadCallback upload_callback_ = nullptr;
     const TuningFork_Cache* persister_ = nullptr;
@@ -34,9 +34,12 @@ class UploadThread : public Runnable {
     // Optional isn't available until C++17 so use vector instead.
     std::vector<LifecycleUploadEvent> lifecycle_event_;
     const Session* lifecycle_event_session_ = nullptr;
+    // Reused for each upload so that its capacity is only allocated once.
+    std::string evt_ser_json_;
 
    public:
-    UploadThread(IdProvider* id_provider);
+    // Sessions queued in the ring are uploaded or, if paused, saved.
+    UploadThread(IdProvider* id_provider, SessionRing* sessions);
     ~UploadThread();
 
     UploadThread(const UploadThread&) = delete;
@@ -50,10 +53,8 @@ class UploadThread : public Runnable {
     void Start() override;
     Duration DoWork() override;
 
-    // Returns true if we submitted, false if we are waiting for a previous
-    // submit to complete If upload is false, the cache is serialized and saved,
-    // not uploaded.
-    bool Submit(const Session* session, bool upload);
+    // Wake the thread after a session has been submitted to the ring.
+    void Notify() { cv_.notify_one(); }
 
     void SetUploadCallback(TuningFork_UploadCallback upload_callback) {
         upload_callback_ = upload_callback;
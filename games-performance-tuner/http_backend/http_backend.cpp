@@ -3,6 +3,7 @@
 #define LOG_TAG "TuningFork.GE"
 #include "Log.h"
 #include "core/runnable.h"
+#include "core/telemetry_journal.h"
 #include "core/tuningfork_utils.h"
 #include "http_request.h"
 #include "proto/protobuf_util.h"
@@ -31,7 +32,8 @@ TuningFork_ErrorCode HttpBackend::Init(const Settings& settings) {
 
     if (ultimate_uploader_.get() == nullptr) {
         ultimate_uploader_ =
-            std::make_shared<UltimateUploader>(persister_, request);
+            std::make_shared<UltimateUploader>(
+                persister_, std::make_shared<HttpRequest>(request));
         ultimate_uploader_->Start();
     }
 
@@ -44,13 +46,11 @@ HttpBackend::~HttpBackend() {}
 TuningFork_ErrorCode HttpBackend::UploadTelemetry(const std::string& evt_ser) {
     ALOGV("HttpBackend::Process %s", evt_ser.c_str());
 
-    // Save event to file
-    TuningFork_CProtobufSerialization uploading_hists_ser;
-    ToCProtobufSerialization(evt_ser, uploading_hists_ser);
-    auto ret = persister_->set(HISTOGRAMS_UPLOADING, &uploading_hists_ser,
-                               persister_->user_data);
-
-    TuningFork_CProtobufSerialization_free(&uploading_hists_ser);
+    // Queue the event and wake the uploader
+    auto ret = journal::AppendEvent(persister_, HISTOGRAMS_UPLOADING, evt_ser,
+                                    MAX_UPLOADING_SESSIONS);
+    if (ret == TUNINGFORK_ERROR_OK && ultimate_uploader_)
+        ultimate_uploader_->Notify();
 
     return ret;
 }
@@ -195,135 +195,241 @@ static Json::array SerializeIntervalVector(
     return result;
 }
 
-Json::object JsonSerializer::TelemetryReportJson(const AnnotationId& annotation,
-                                                 bool& empty,
-                                                 Duration& duration) {
-    std::vector<Json::object> render_histograms;
-    std::vector<Json::object> loading_events;
-    std::vector<Json::object> battery_events;
-    std::vector<Json::object> thermal_events;
-    std::vector<Json::object> memory_events;
-    duration = Duration::zero();
-    for (const auto& th :
-         session_.GetNonEmptyHistograms<FrameTimeMetricData>()) {
-        auto ft = th->metric_id_.detail;
-        if (ft.annotation != annotation) continue;
-        std::vector<int32_t> counts;
-        for (auto& c : th->histogram_.buckets())
-            counts.push_back(static_cast<int32_t>(c));
-        Json::object o{{"counts", counts}};
-        o["instrument_id"] = session_.GetInstrumentationKey(ft.frame_time.ikey);
-        render_histograms.push_back(o);
-        duration = std::max(th->duration_, duration);
+static int LifecycleEventType(TuningFork_LifecycleState state) {
+    switch (state) {
+        case TUNINGFORK_STATE_ONSTART:
+            return 1;
+        case TUNINGFORK_STATE_ONSTOP:
+            return 2;
+        default:
+            return 0;
     }
-    for (const auto& th :
-         session_.GetNonEmptyHistograms<LoadingTimeMetricData>()) {
-        if (th->metric_id_.detail.annotation != annotation) continue;
-        std::vector<int> loading_events_times;
-        std::vector<ProcessTimeInterval> loading_events_intervals;
-        for (const auto& c : th->data_.Samples()) {
-            if (c.IsDuration()) {
-                loading_events_times.push_back(
-                    std::chrono::duration_cast<std::chrono::milliseconds>(
-                        c.Duration())
-                        .count());
-            } else {
-                loading_events_intervals.push_back(c);
-            }
-            duration = std::max(th->duration_, duration);
-        }
-        if (loading_events_times.size() > 0 ||
-            loading_events_intervals.size() > 0) {
-            LoadingTimeMetadataWithGroup md;
-            if (id_provider_->MetricIdToLoadingTimeMetadata(
-                    th->metric_id_, md) == TUNINGFORK_ERROR_OK) {
-                Json::object o({});
-                if (loading_events_times.size() > 0)
-                    o["times_ms"] = loading_events_times;
-                if (loading_events_intervals.size() > 0)
-                    o["intervals"] =
-                        SerializeIntervalVector(loading_events_intervals);
-                o["loading_metadata"] = LoadingTimeMetadataJson(md);
-                loading_events.push_back(o);
-            }
-        }
+}
+
+static void WriteGameSdkInfo(JsonWriter& writer,
+                             const RequestInfo& request_info) {
+    writer.BeginObject();
+    writer.Field("session_id", request_info.session_id);
+    if (request_info.swappy_version != 0) {
+        writer.Field("swappy_version",
+                     GetVersionString(request_info.swappy_version));
     }
-    for (const auto& th : session_.GetNonEmptyHistograms<BatteryMetricData>()) {
-        auto ft = th->metric_id_.detail;
-        if (ft.annotation != annotation) continue;
-        for (auto& report : th->data_) {
-            Json::object o({});
-            o["event_time"] =
-                DurationToSecondsString(report.time_since_process_start_);
-            o["percentage"] = report.percentage_;
-            o["current_charge_microampere_hours"] = report.current_charge_;
-            o["charging"] = report.is_charging_;
-            o["app_on_foreground"] = report.app_on_foreground_;
-            o["power_save_mode"] = report.power_save_mode_;
-            battery_events.push_back(o);
-        }
+    writer.Field("version", GetVersionString(request_info.tuningfork_version));
+    writer.EndObject();
+}
+
+static void WriteTelemetryContext(JsonWriter& writer,
+                                  const SerializedAnnotation& annotation,
+                                  const RequestInfo& request_info,
+                                  Duration duration) {
+    writer.BeginObject();
+    writer.Field("annotations", B64Encode(annotation));
+    writer.Field("duration", DurationToSecondsString(duration));
+    writer.Key("tuning_parameters");
+    writer.BeginObject();
+    writer.Field("experiment_id", request_info.experiment_id);
+    writer.Field("serialized_fidelity_parameters",
+                 B64Encode(request_info.current_fidelity_parameters));
+    writer.EndObject();
+    writer.EndObject();
+}
+
+static void WriteLoadingTimeMetadata(JsonWriter& writer,
+                                     const LoadingTimeMetadataWithGroup& mdg) {
+    const LoadingTimeMetadata& md = mdg.metadata;
+    writer.BeginObject();
+    if (md.compression_level != 0)
+        writer.Field("compression_level", md.compression_level);
+    if (!mdg.group_id.empty()) writer.Field("group_id", mdg.group_id);
+    if (md.network_connectivity != 0 || md.network_transfer_speed_bps != 0 ||
+        md.network_latency_ns != 0) {
+        writer.Key("network_info");
+        writer.BeginObject();
+        if (md.network_transfer_speed_bps != 0)
+            writer.Field("bandwidth_bps",
+                         JsonUint64(md.network_transfer_speed_bps));
+        if (md.network_connectivity != 0)
+            writer.Field("connectivity",
+                         static_cast<int>(md.network_connectivity));
+        if (md.network_latency_ns != 0)
+            writer.Field("latency",
+                         DurationJsonFromNanos(md.network_latency_ns));
+        writer.EndObject();
     }
-    for (const auto& th : session_.GetNonEmptyHistograms<ThermalMetricData>()) {
-        auto ft = th->metric_id_.detail;
-        if (ft.annotation != annotation) continue;
-        for (auto& report : th->data_) {
-            Json::object o({});
-            o["event_time"] =
-                DurationToSecondsString(report.time_since_process_start_);
-            o["thermal_state"] = report.thermal_state_;
-            thermal_events.push_back(o);
+    if (md.source != 0) writer.Field("source", static_cast<int>(md.source));
+    if (md.state != 0) writer.Field("state", static_cast<int>(md.state));
+    writer.EndObject();
+}
+
+static void WriteLoadingEvent(JsonWriter& writer,
+                              const LoadingTimeMetricData& data,
+                              const LoadingTimeMetadataWithGroup& md) {
+    bool has_times = false;
+    bool has_intervals = false;
+    for (const auto& c : data.data_.Samples()) {
+        if (c.IsDuration())
+            has_times = true;
+        else
+            has_intervals = true;
+    }
+    writer.BeginObject();
+    if (has_intervals) {
+        writer.Key("intervals");
+        writer.BeginArray();
+        for (const auto& c : data.data_.Samples()) {
+            if (c.IsDuration()) continue;
+            writer.BeginObject();
+            writer.Field("end", DurationToSecondsString(c.End()));
+            writer.Field("start", DurationToSecondsString(c.Start()));
+            writer.EndObject();
         }
+        writer.EndArray();
     }
-    for (const auto& th : session_.GetNonEmptyHistograms<MemoryMetricData>()) {
-        auto ft = th->metric_id_.detail;
-        if (ft.annotation != annotation) continue;
-        for (auto& report : th->data_) {
-            Json::object o({});
-            o["event_time"] =
-                DurationToSecondsString(report.time_since_process_start_);
-            o["avail_mem"] = static_cast<double>(report.avail_mem_);
-            o["oom_score"] = static_cast<double>(report.oom_score_);
-            o["proportional_set_size"] =
-                static_cast<double>(report.proportional_set_size_);
-            memory_events.push_back(o);
+    writer.Key("loading_metadata");
+    WriteLoadingTimeMetadata(writer, md);
+    if (has_times) {
+        writer.Key("times_ms");
+        writer.BeginArray();
+        for (const auto& c : data.data_.Samples()) {
+            if (!c.IsDuration()) continue;
+            writer.Int(static_cast<int>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    c.Duration())
+                    .count()));
         }
+        writer.EndArray();
     }
+    writer.EndObject();
+}
 
-    int total_size = render_histograms.size() + loading_events.size();
-    empty = (total_size == 0);
-    Json::object ret;
-    if (render_histograms.size() > 0) {
-        ret["rendering"] =
-            Json::object{{"render_time_histogram", render_histograms}};
+// Keys in each object are written in sorted order, so that the output is the
+// same as dumping the equivalent json11 objects.
+bool JsonSerializer::WriteTelemetry(JsonWriter& writer,
+                                    const AnnotationMetrics& metrics,
+                                    const RequestInfo& request_info) {
+    // The context comes before the report and includes its duration, and the
+    // telemetry is omitted entirely if there are no rendering or loading
+    // events, so look through the metrics before writing anything.
+    Duration duration = Duration::zero();
+    for (const auto& th : metrics.frame_time) {
+        duration = std::max(th->duration_, duration);
     }
-    // Loading events
-    if (loading_events.size() > 0) {
-        ret["loading"] = Json::object{{"loading_events", loading_events}};
+    loading_events_.clear();
+    for (const auto& th : metrics.loading_time) {
+        if (th->data_.Samples().empty()) continue;
+        duration = std::max(th->duration_, duration);
+        LoadingTimeMetadataWithGroup md;
+        if (id_provider_->MetricIdToLoadingTimeMetadata(th->metric_id_, md) ==
+            TUNINGFORK_ERROR_OK) {
+            loading_events_.push_back({th, md});
+        }
     }
-    // Battery events
-    if (battery_events.size() > 0) {
-        ret["battery"] = Json::object{{"battery_event", battery_events}};
+    if (metrics.frame_time.empty() && loading_events_.empty()) return false;
+
+    SerializedAnnotation annotation;
+    id_provider_->AnnotationIdToSerializedAnnotation(metrics.annotation,
+                                                     annotation);
+    writer.BeginObject();
+    writer.Key("context");
+    WriteTelemetryContext(writer, annotation, request_info, duration);
+    writer.Key("report");
+    writer.BeginObject();
+    if (!metrics.battery.empty()) {
+        writer.Key("battery");
+        writer.BeginObject();
+        writer.Key("battery_event");
+        writer.BeginArray();
+        for (const auto& th : metrics.battery) {
+            for (auto& report : th->data_) {
+                writer.BeginObject();
+                writer.Field("app_on_foreground", report.app_on_foreground_);
+                writer.Field("charging", report.is_charging_);
+                writer.Field("current_charge_microampere_hours",
+                             report.current_charge_);
+                writer.Field(
+                    "event_time",
+                    DurationToSecondsString(report.time_since_process_start_));
+                writer.Field("percentage", report.percentage_);
+                writer.Field("power_save_mode", report.power_save_mode_);
+                writer.EndObject();
+            }
+        }
+        writer.EndArray();
+        writer.EndObject();
     }
-    // Thermal events
-    if (thermal_events.size() > 0) {
-        ret["thermal"] = Json::object{{"thermal_event", thermal_events}};
+    if (!loading_events_.empty()) {
+        writer.Key("loading");
+        writer.BeginObject();
+        writer.Key("loading_events");
+        writer.BeginArray();
+        for (const auto& e : loading_events_) {
+            WriteLoadingEvent(writer, *e.first, e.second);
+        }
+        writer.EndArray();
+        writer.EndObject();
     }
-    // Memory events
-    if (memory_events.size() > 0) {
-        ret["memory"] = Json::object{{"memory_event", memory_events}};
+    if (!metrics.memory.empty()) {
+        writer.Key("memory");
+        writer.BeginObject();
+        writer.Key("memory_event");
+        writer.BeginArray();
+        for (const auto& th : metrics.memory) {
+            for (auto& report : th->data_) {
+                writer.BeginObject();
+                writer.Field("avail_mem",
+                             static_cast<double>(report.avail_mem_));
+                writer.Field(
+                    "event_time",
+                    DurationToSecondsString(report.time_since_process_start_));
+                writer.Field("oom_score",
+                             static_cast<double>(report.oom_score_));
+                writer.Field("proportional_set_size",
+                             static_cast<double>(report.proportional_set_size_));
+                writer.EndObject();
+            }
+        }
+        writer.EndArray();
+        writer.EndObject();
     }
-    return ret;
-}
-
-static int LifecycleEventType(TuningFork_LifecycleState state) {
-    switch (state) {
-        case TUNINGFORK_STATE_ONSTART:
-            return 1;
-        case TUNINGFORK_STATE_ONSTOP:
-            return 2;
-        default:
-            return 0;
+    if (!metrics.frame_time.empty()) {
+        writer.Key("rendering");
+        writer.BeginObject();
+        writer.Key("render_time_histogram");
+        writer.BeginArray();
+        for (const auto& th : metrics.frame_time) {
+            writer.BeginObject();
+            writer.Key("counts");
+            writer.IntArray(th->histogram_.buckets());
+            writer.Field("instrument_id",
+                         static_cast<int>(session_.GetInstrumentationKey(
+                             th->metric_id_.detail.frame_time.ikey)));
+            writer.EndObject();
+        }
+        writer.EndArray();
+        writer.EndObject();
     }
+    if (!metrics.thermal.empty()) {
+        writer.Key("thermal");
+        writer.BeginObject();
+        writer.Key("thermal_event");
+        writer.BeginArray();
+        for (const auto& th : metrics.thermal) {
+            for (auto& report : th->data_) {
+                writer.BeginObject();
+                writer.Field(
+                    "event_time",
+                    DurationToSecondsString(report.time_since_process_start_));
+                writer.Field("thermal_state",
+                             static_cast<int>(report.thermal_state_));
+                writer.EndObject();
+            }
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+    writer.EndObject();
+    writer.EndObject();
+    return true;
 }
 
 Json::object JsonSerializer::PartialLoadingTelemetryReportJson(
@@ -351,14 +457,6 @@ Json::object JsonSerializer::PartialLoadingTelemetryReportJson(
     return ret;
 }
 
-Json::object JsonSerializer::TelemetryJson(const AnnotationId& annotation,
-                                           const RequestInfo& request_info,
-                                           Duration& duration, bool& empty) {
-    auto report = TelemetryReportJson(annotation, empty, duration);
-    return Json::object{
-        {"context", TelemetryContextJson(annotation, request_info, duration)},
-        {"report", report}};
-}
 Json::object JsonSerializer::PartialLoadingTelemetryJson(
     const AnnotationId& annotation, const LifecycleUploadEvent& event,
     const RequestInfo& request_info) {
@@ -389,28 +487,49 @@ void JsonSerializer::SerializeTelemetryRequest(
     evt_json_ser = telemetry_request.dump();
 }
 
+void JsonSerializer::WriteSessionContext(JsonWriter& writer,
+                                         const RequestInfo& request_info) {
+    writer.BeginObject();
+    auto crash_reports = session_.GetCrashReports();
+    if (!crash_reports.empty()) {
+        writer.Key("crash_reports");
+        writer.BeginArray();
+        for (auto reason : crash_reports) {
+            writer.BeginObject();
+            writer.Field("crash_reason", static_cast<int>(reason));
+            writer.Field("session_id", request_info.previous_session_id);
+            writer.EndObject();
+        }
+        writer.EndArray();
+    }
+    writer.Key("device");
+    json_utils::WriteDeviceSpecJson(request_info, writer);
+    writer.Key("game_sdk_info");
+    WriteGameSdkInfo(writer, request_info);
+    writer.Key("time_period");
+    writer.BeginObject();
+    writer.Field("end_time", TimeToRFC3339(session_.time().end));
+    writer.Field("start_time", TimeToRFC3339(session_.time().start));
+    writer.EndObject();
+    writer.EndObject();
+}
+
 void JsonSerializer::SerializeEvent(const RequestInfo& request_info,
                                     std::string& evt_json_ser) {
-    std::vector<Json::object> telemetry;
+    evt_json_ser.clear();
+    JsonWriter writer(evt_json_ser);
+    writer.BeginObject();
+    writer.Field("name", json_utils::GetResourceName(request_info));
+    writer.Key("session_context");
+    WriteSessionContext(writer, request_info);
+    writer.Key("telemetry");
+    writer.BeginArray();
     // Loop over unique annotations
-    std::set<AnnotationId> annotations;
-    for (const auto& p :
-         session_.GetNonEmptyHistograms<FrameTimeMetricData>()) {
-        annotations.insert(p->metric_id_.detail.annotation);
-    }
-    for (const auto& p :
-         session_.GetNonEmptyHistograms<LoadingTimeMetricData>()) {
-        annotations.insert(p->metric_id_.detail.annotation);
+    for (const auto& metrics : session_.GroupByAnnotation()) {
+        WriteTelemetry(writer, metrics, request_info);
     }
-    Duration max_duration = Duration::zero();
-    for (auto& a : annotations) {
-        bool empty;
-        Duration duration = Duration::zero();
-        auto tel = TelemetryJson(a, request_info, duration, empty);
-        max_duration = std::max(max_duration, duration);
-        if (!empty) telemetry.push_back(tel);
-    }
-    SerializeTelemetryRequest(request_info, telemetry, evt_json_ser);
+    writer.EndArray();
+    writer.EndObject();
 }
 
 void JsonSerializer::SerializeLifecycleEvent(const LifecycleUploadEvent& event,
@@ -501,7 +620,10 @@ struct Hist {
         }
     }
 
-    // Merge
+    // Find all the histograms before merging any, so that nothing is merged
+    // if the event doesn't fit the session.
+    std::vector<FrameTimeMetricData*> targets;
+    targets.reserve(hists.size());
     for (auto& h : hists) {
         MetricId id{0};
         AnnotationId annotation_id;
@@ -512,9 +634,14 @@ struct Hist {
         auto r = id_provider.MakeCompoundId(h.instrument_id, annotation_id, id);
         if (r != TUNINGFORK_ERROR_OK) return r;
         auto p = session.GetData<FrameTimeMetricData>(id);
-        if (p == nullptr) return TUNINGFORK_ERROR_BAD_PARAMETER;
-        auto& orig_counts = p->histogram_.buckets();
-        p->histogram_.AddCounts(h.counts);
+        if (p == nullptr || p->histogram_.buckets().size() != h.counts.size())
+            return TUNINGFORK_ERROR_BAD_PARAMETER;
+        targets.push_back(p);
+    }
+
+    // Merge
+    for (size_t i = 0; i < hists.size(); ++i) {
+        targets[i]->histogram_.AddCounts(hists[i].counts);
     }
     return TUNINGFORK_ERROR_OK;
 }
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "core/id_provider.h"
+#include "core/json_writer.h"
 #include "core/lifecycle_upload_event.h"
 #include "core/session.h"
 
@@ -31,6 +32,9 @@ class JsonSerializer {
     JsonSerializer(const Session& session, IdProvider* id_provider)
         : session_(session), id_provider_(id_provider) {}
 
+    // Stream the session into evt_json_ser without building a json11 tree.
+    // evt_json_ser is cleared first but its capacity is kept, so callers can
+    // reuse the same string for each upload.
     void SerializeEvent(const RequestInfo& device_info,
                         std::string& evt_json_ser);
 
@@ -38,6 +42,8 @@ class JsonSerializer {
                                  const RequestInfo& request_info,
                                  std::string& evt_json_ser);
 
+    // Add the histograms in a serialized event to session. Nothing is merged
+    // unless all of them have a matching histogram in session.
     static TuningFork_ErrorCode DeserializeAndMerge(
         const std::string& evt_json_ser, IdProvider& id_provider,
         Session& session);
@@ -53,16 +59,17 @@ class JsonSerializer {
                                               const RequestInfo& request_info,
                                               const Duration& duration);
 
-    json11::Json::object TelemetryReportJson(const AnnotationId& annotation,
-                                             bool& empty, Duration& duration);
-
     json11::Json::object PartialLoadingTelemetryReportJson(
         const AnnotationId& annotation, const LifecycleUploadEvent& event,
         Duration& duration);
 
-    json11::Json::object TelemetryJson(const AnnotationId& annotation,
-                                       const RequestInfo& request_info,
-                                       Duration& duration, bool& empty);
+    // Write the telemetry for one annotation, unless it would have an empty
+    // report. Returns whether anything was written.
+    bool WriteTelemetry(JsonWriter& writer, const AnnotationMetrics& metrics,
+                        const RequestInfo& request_info);
+
+    void WriteSessionContext(JsonWriter& writer,
+                             const RequestInfo& request_info);
 
     json11::Json::object PartialLoadingTelemetryJson(
         const AnnotationId& annotation, const LifecycleUploadEvent& event,
@@ -80,6 +87,10 @@ class JsonSerializer {
 
     const Session& session_;
     IdProvider* id_provider_;
+    // Scratch space used while writing the loading events of an annotation.
+    std::vector<
+        std::pair<const LoadingTimeMetricData*, LoadingTimeMetadataWithGroup>>
+        loading_events_;
 };
 
 }  // namespace tuningfork
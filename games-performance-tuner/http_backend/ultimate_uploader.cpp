@@ -17,55 +17,142 @@
 
 #include "ultimate_uploader.h"
 
+#include <algorithm>
+
 #define LOG_TAG "TuningFork.GE"
 #include "Log.h"
+#include "core/telemetry_journal.h"
+#include "jni/jni_helper.h"
 
 namespace tuningfork {
 
-constexpr Duration kUploadCheckInterval = std::chrono::seconds(1);
+// Even when nothing has been queued, look at the persister now and again in
+// case something was left there by a previous run.
+constexpr Duration kIdleCheckInterval = std::chrono::minutes(10);
+constexpr Duration kMeteredRetryInterval = std::chrono::minutes(5);
+constexpr Duration kInitialBackoff = std::chrono::seconds(2);
+constexpr Duration kMaxBackoff = std::chrono::minutes(30);
 
 const char kUploadRpcName[] = ":uploadTelemetry";
 
 UltimateUploader::UltimateUploader(const TuningFork_Cache* persister,
-                                   const HttpRequest& request)
-    : Runnable(nullptr), persister_(persister), request_(request) {}
+                                   std::shared_ptr<HttpRequest> request,
+                                   ITimeProvider* time_provider)
+    : Runnable(time_provider),
+      persister_(persister),
+      request_(request),
+      rng_(std::chrono::steady_clock::now().time_since_epoch().count()) {}
+
 Duration UltimateUploader::DoWork() {
-    CheckUploadPending();
-    return kUploadCheckInterval;
+    // Don't let Notify cut a backoff short.
+    auto now = Now();
+    if (now < next_attempt_time_) return next_attempt_time_ - now;
+    return UploadPending();
 }
 
-void UltimateUploader::Run() { Runnable::Run(); }
+// Unlike Runnable::Run, the lock isn't held during DoWork, so that Notify
+// doesn't block while an upload is in progress.
+void UltimateUploader::Run() {
+    while (!do_quit_) {
+        auto wait_time = DoWork();
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, wait_time, [this] { return do_quit_ || wake_; });
+        wake_ = false;
+    }
+    if (gamesdk::jni::IsValid()) gamesdk::jni::DetachThread();
+}
 
-bool UltimateUploader::CheckUploadPending() {
+void UltimateUploader::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        do_quit_ = true;
+    }
+    Runnable::Stop();
+}
+
+void UltimateUploader::Notify() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wake_ = true;
+    }
+    cv_.notify_one();
+}
+
+Duration UltimateUploader::UploadPending() {
     TuningFork_CProtobufSerialization uploading_hists_ser;
     if (persister_->get(HISTOGRAMS_UPLOADING, &uploading_hists_ser,
-                        persister_->user_data) == TUNINGFORK_ERROR_OK) {
-        std::string request_json = ToString(uploading_hists_ser);
+                        persister_->user_data) != TUNINGFORK_ERROR_OK) {
+        ALOGV("No upload pending");
+        num_failures_ = 0;
+        return kIdleCheckInterval;
+    }
+    std::vector<journal::Record> records;
+    journal::ReadRecords(uploading_hists_ser.bytes, uploading_hists_ser.size,
+                         records);
+    Duration wait_time = kIdleCheckInterval;
+    size_t num_done = 0;
+    std::string request_json;
+    for (auto& record : records) {
+        if (!journal::ReadEvent(record, request_json)) {
+            // It can never be sent, so drop it.
+            ++num_done;
+            continue;
+        }
         int response_code = -1;
         std::string body;
         ALOGV("Got UPLOADING histograms: %s", request_json.c_str());
         TuningFork_ErrorCode ret =
-            request_.Send(kUploadRpcName, request_json, response_code, body);
-        if (ret == TUNINGFORK_ERROR_OK) {
-            ALOGI("UPLOAD request returned %d %s", response_code, body.c_str());
-            if (response_code == 200) {
-                persister_->remove(HISTOGRAMS_UPLOADING, persister_->user_data);
-                TuningFork_CProtobufSerialization_free(&uploading_hists_ser);
-                return true;
-            }
+            request_->Send(kUploadRpcName, request_json, response_code, body);
+        if (ret == TUNINGFORK_ERROR_METERED_CONNECTION_DISALLOWED) {
+            // Not the server's fault, so don't back off any further.
+            ALOGI("Waiting for an unmetered connection to upload");
+            wait_time = kMeteredRetryInterval;
+            break;
+        }
+        if (ret != TUNINGFORK_ERROR_OK) {
+            ALOGW("Error %d when sending UPLOAD request", ret);
+            wait_time = Backoff();
+            break;
+        }
+        ALOGI("UPLOAD request returned %d %s", response_code, body.c_str());
+        if (response_code == 200) {
+            num_failures_ = 0;
+        } else if (response_code >= 400 && response_code < 500 &&
+                   response_code != 408 && response_code != 429) {
+            // The same request will always be rejected, so drop it.
+            ALOGW("Dropping rejected UPLOAD request\n%s", request_json.c_str());
         } else {
-            ALOGW("Error %d when sending UPLOAD request\n%s", ret,
-                  request_json.c_str());
-            persister_->remove(HISTOGRAMS_UPLOADING, persister_->user_data);
-            persister_->set(HISTOGRAMS_PAUSED, &uploading_hists_ser,
-                            persister_->user_data);
+            wait_time = Backoff();
+            break;
         }
-        TuningFork_CProtobufSerialization_free(&uploading_hists_ser);
-    } else {
-        ALOGV("No upload pending");
-        return true;
+        ++num_done;
+    }
+    if (num_done > 0) {
+        records.resize(num_done);
+        journal::Remove(persister_, HISTOGRAMS_UPLOADING, records);
     }
-    return false;
+    TuningFork_CProtobufSerialization_free(&uploading_hists_ser);
+    return wait_time;
+}
+
+// Exponential backoff with jitter, so that devices that failed at the same
+// time don't all retry together.
+Duration UltimateUploader::Backoff() {
+    auto backoff = kMaxBackoff;
+    if (num_failures_ < 16) {
+        backoff = std::min(kMaxBackoff, kInitialBackoff * (1 << num_failures_));
+    }
+    ++num_failures_;
+    std::uniform_int_distribution<Duration::rep> jitter(0,
+                                                        backoff.count() / 2);
+    auto wait_time = backoff / 2 + Duration(jitter(rng_));
+    next_attempt_time_ = Now() + wait_time;
+    return wait_time;
+}
+
+TimePoint UltimateUploader::Now() const {
+    if (time_provider_ != nullptr) return time_provider_->Now();
+    return std::chrono::steady_clock::now();
 }
 
 }  // namespace tuningfork
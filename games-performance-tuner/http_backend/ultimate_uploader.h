@@ -17,6 +17,9 @@
 
 #pragma once
 
+#include <memory>
+#include <random>
+
 #include "core/runnable.h"
 #include "core/tuningfork_utils.h"
 #include "http_request.h"
@@ -24,20 +27,36 @@
 
 namespace tuningfork {
 
-// This class periodically listens on a separate thread for upload packets from
-// the persister and performs the HTTP request to do the upload.
+// This class listens on a separate thread for upload packets queued in the
+// persister and performs the HTTP requests to upload them. It sleeps until
+// Notify is called, retrying failed uploads with exponential backoff.
 class UltimateUploader : public Runnable {
     const TuningFork_Cache* persister_ = nullptr;
-    HttpRequest request_;
+    std::shared_ptr<HttpRequest> request_;
+    bool wake_ = false;
+    int num_failures_ = 0;
+    TimePoint next_attempt_time_;
+    std::minstd_rand rng_;
 
    public:
+    // If a time provider is given, it is used to time retries, e.g. in tests.
+    // The request is shared so that tests can substitute their own.
     UltimateUploader(const TuningFork_Cache* persister,
-                     const HttpRequest& request);
+                     std::shared_ptr<HttpRequest> request,
+                     ITimeProvider* time_provider = nullptr);
     virtual Duration DoWork() override;
     virtual void Run() override;
+    virtual void Stop() override;
+
+    // Wake the thread to upload newly queued packets.
+    void Notify();
 
    private:
-    bool CheckUploadPending();
+    // Upload everything in the queue, stopping at the first failure.
+    // Returns the time to wait until the next attempt.
+    Duration UploadPending();
+    Duration Backoff();
+    TimePoint Now() const;
 };
 
 }  // namespace tuningfork
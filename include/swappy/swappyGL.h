@@ -78,6 +78,16 @@ bool SwappyGL_swap(EGLDisplay display, EGLSurface surface);
 
 void SwappyGL_setUseAffinity(bool tf);
 
+/**
+ * @brief Use a single thread to wake Swappy ahead of vsync.
+ *
+ * By default two threads race to wake Swappy on each vsync. With this on, one
+ * thread predicts vsync from a least squares fit of recent Choreographer
+ * callbacks and sleeps until then with an absolute timer. Changes of refresh
+ * rate are then picked up without restarting the thread.
+ */
+void SwappyGL_setUseSingleFilterThread(bool tf);
+
 /**
  * @brief Override the swap interval
  *
@@ -106,6 +116,17 @@ void SwappyGL_setSwapIntervalNS(uint64_t swap_ns);
  */
 void SwappyGL_setFenceTimeoutNS(uint64_t fence_timeout_ns);
 
+/**
+ * @brief Set how many frames the GPU can fall behind before swapping blocks.
+ *
+ * Swappy creates a sync fence for each frame and waits for them on a
+ * background thread, to measure GPU time. ::SwappyGL_swap only waits once
+ * this many fences are still pending. The count is clamped to between 1 and 4
+ * and defaults to 2. With 1, each swap waits for the GPU to finish the
+ * previous frame.
+ */
+void SwappyGL_setMaxFencesInFlight(uint32_t count);
+
 // Parameter getters:
 
 /**
@@ -125,6 +146,11 @@ bool SwappyGL_getUseAffinity();
  */
 uint64_t SwappyGL_getFenceTimeoutNS();
 
+/**
+ * @brief Get how many frames the GPU can fall behind before swapping blocks.
+ */
+uint32_t SwappyGL_getMaxFencesInFlight();
+
 /**
  * @brief Set the number of bad frames to wait before applying a fix for buffer
  * stuffing. Set to zero in order to turn off this feature. Default value = 0.
@@ -76,6 +76,29 @@ void SwappyGL_setMaxAutoSwapIntervalNS(uint64_t max_swap_ns);
  */
 void SwappyGL_setAutoPipelineMode(bool enabled);
 
+/**
+ * @brief Sets the algorithm used to choose the swap interval when auto-swap
+ * interval is on.
+ *
+ * By default, ::SWAPPY_SWAP_INTERVAL_CONTROLLER_AVERAGE is used.
+ */
+void SwappyGL_setSwapIntervalController(
+    SwappySwapIntervalController controller);
+
+/**
+ * @brief Returns percentiles of the CPU and GPU time of recent frames.
+ *
+ * These are the frame times the swap interval controller is working from, and
+ * are collected whether or not stats are enabled.
+ *
+ * @param[out] percentiles - Pointer to a SwappyFrameDurationPercentiles that
+ *                           will be populated. Cannot be NULL.
+ *
+ * @see SwappyFrameDurationPercentiles
+ */
+void SwappyGL_getFrameDurationPercentiles(
+    SwappyFrameDurationPercentiles *percentiles);
+
 /**
  * @brief Toggle statistics collection on/off
  *
@@ -117,6 +140,75 @@ void SwappyGL_getStats(SwappyStats *swappyStats);
  */
 void SwappyGL_clearStats();
 
+/**
+ * @brief Sets the buckets of the extended statistics histograms, and clears
+ * them.
+ *
+ * @param config Pointer to the new configuration. Out of range values are
+ * clamped.
+ * @see SwappyExtendedStatsConfig
+ * @see SwappyGL_getExtendedStats
+ */
+void SwappyGL_setExtendedStatsConfig(const SwappyExtendedStatsConfig *config);
+
+/**
+ * @brief Returns the extended stats collected, if statistics collection was
+ * toggled on.
+ *
+ * Unlike ::SwappyGL_getStats, this doesn't block the thread recording the
+ * stats, so can be called as often as needed from any thread.
+ *
+ * @param stats Pointer to a SwappyExtendedStats that will be populated with
+ * collected stats.
+ * @see SwappyExtendedStats
+ * @see SwappyGL_enableStats
+ */
+void SwappyGL_getExtendedStats(SwappyExtendedStats *stats);
+
+/**
+ * @brief Toggle recording of the frame timeline on/off
+ *
+ * By default the timeline is off and recording costs nothing more than a
+ * check of the flag. When it is on, a ::SwappyFrameRecord is added to a
+ * fixed-size buffer for each frame swapped, without blocking or allocating,
+ * and the oldest records are dropped if the buffer fills up. If the app also
+ * calls ::SwappyGL_recordFrameStart, records of type
+ * ::SWAPPY_FRAME_RECORD_PRESENT are added when the presentation times of
+ * frames become known.
+ *
+ * The records can be read with ::SwappyGL_drainFrameTimeline or
+ * ::SwappyGL_dumpFrameTimeline, from any thread.
+ */
+void SwappyGL_enableFrameTimeline(bool enabled);
+
+/**
+ * @brief Moves the oldest records of the frame timeline into records.
+ *
+ * @param records Array of at least maxRecords records to fill.
+ * @param maxRecords The maximum number of records to return.
+ * @param droppedRecords If not NULL, set to the number of records that were
+ * dropped since the last call to this function or ::SwappyGL_dumpFrameTimeline
+ * because the buffer was full.
+ * @return The number of records returned.
+ * @see SwappyGL_enableFrameTimeline
+ */
+int SwappyGL_drainFrameTimeline(SwappyFrameRecord *records, int maxRecords,
+                                uint64_t *droppedRecords);
+
+/**
+ * @brief Moves all the records of the frame timeline to a file.
+ *
+ * The records are written in the format described by
+ * ::SwappyFrameTimelineHeader. Successive dumps can be appended to the same
+ * file. The `decode_frame_timeline.py` tool in the Swappy sources prints a
+ * dump as CSV.
+ *
+ * @param fd A file descriptor open for writing.
+ * @return The number of records written, or -1 if writing failed.
+ * @see SwappyGL_enableFrameTimeline
+ */
+int SwappyGL_dumpFrameTimeline(int fd);
+
 /** @brief Remove callbacks that were previously added using
  * SwappyGL_injectTracer. */
 void SwappyGL_uninjectTracer(const SwappyTracer *t);
@@ -231,6 +231,47 @@ void SwappyVk_setAutoSwapInterval(bool enabled);
  */
 void SwappyVk_setAutoPipelineMode(bool enabled);
 
+/**
+ * @brief Sets the algorithm used to choose the swap interval for all
+ * instances, when Auto-Swap-Interval is enabled.
+ *
+ * By default ::SWAPPY_SWAP_INTERVAL_CONTROLLER_AVERAGE is used. Changing it is
+ * completely optional for fine-tuning swappy behaviour.
+ *
+ * @param[in]  controller - The algorithm to use.
+ */
+void SwappyVk_setSwapIntervalController(
+    SwappySwapIntervalController controller);
+
+/**
+ * @brief Use a single thread to wake Swappy ahead of vsync, for all instances.
+ *
+ * By default two threads race to wake Swappy on each vsync. With this on, one
+ * thread predicts vsync from a least squares fit of recent Choreographer
+ * callbacks and sleeps until then with an absolute timer. Changes of refresh
+ * rate are then picked up without restarting the thread.
+ *
+ * @param[in]  enabled - True to use a single thread.
+ */
+void SwappyVk_setUseSingleFilterThread(bool enabled);
+
+/**
+ * @brief Returns percentiles of the CPU and GPU time of recent frames on a
+ * swapchain.
+ *
+ * These are the frame times the swap interval controller is working from, and
+ * are collected whether or not stats are enabled. Calls must be externally
+ * synchronized with other SwappyVk calls, as for ::SwappyVk_getStats.
+ *
+ * @param[in]  swapchain   - The swapchain to query.
+ * @param[out] percentiles - Pointer to a SwappyFrameDurationPercentiles that
+ *                           will be populated. Cannot be NULL.
+ *
+ * @see SwappyFrameDurationPercentiles
+ */
+void SwappyVk_getFrameDurationPercentiles(
+    VkSwapchainKHR swapchain, SwappyFrameDurationPercentiles* percentiles);
+
 /**
  * @brief Sets the maximal swap duration for all instances.
  *
@@ -255,6 +296,25 @@ void SwappyVk_setFenceTimeoutNS(uint64_t fence_timeout_ns);
  */
 uint64_t SwappyVk_getFenceTimeoutNS();
 
+/**
+ * @brief Track GPU completion with a timeline semaphore instead of fences.
+ *
+ * By default, SwappyVk submits a command buffer with a fence before each
+ * present, and uses a thread per queue to wait for the fences. With timeline
+ * semaphores, it instead adds an empty submission that signals a timeline
+ * semaphore, and a single thread per device waits for them, for all its
+ * swapchains.
+ *
+ * Only enable this if the device was created with VK_KHR_timeline_semaphore
+ * (or Vulkan 1.2) and the timelineSemaphore feature enabled. SwappyVk falls
+ * back to fences if the device doesn't have the timeline semaphore functions.
+ * It only affects queues that SwappyVk_queuePresent wasn't called for yet.
+ *
+ * @param[in]  device  - The device to use timeline semaphores with.
+ * @param      enabled - Whether to use timeline semaphores. Off by default.
+ */
+void SwappyVk_enableTimelineSemaphores(VkDevice device, bool enabled);
+
 /**
  * @brief Inject callback functions to be called each frame.
  *
@@ -413,6 +473,80 @@ void SwappyVk_getStats(VkSwapchainKHR swapchain, SwappyStats *swappyStats);
  */
 void SwappyVk_clearStats(VkSwapchainKHR swapchain);
 
+/**
+ * @brief Sets the buckets of the extended statistics histograms of a
+ * swapchain, and clears them. See ::SwappyVk_enableStats for more conditions.
+ *
+ * @param[in]  swapchain - The swapchain for which stats are being configured.
+ * @param[in]  config    - Pointer to the new configuration. Out of range
+ *                         values are clamped. Cannot be NULL.
+ * @see SwappyExtendedStatsConfig
+ */
+void SwappyVk_setExtendedStatsConfig(VkSwapchainKHR swapchain,
+                                     const SwappyExtendedStatsConfig* config);
+
+/**
+ * @brief Returns the extended stats collected, if statistics collection was
+ * toggled on.
+ *
+ * Reading the stats doesn't block the thread recording them, but as for
+ * ::SwappyVk_getStats, calls must be externally synchronized with other
+ * SwappyVk calls. See ::SwappyVk_enableStats for more conditions.
+ *
+ * @param[in]  swapchain - The swapchain for which stats are being queried.
+ * @param[out] stats     - Pointer to a SwappyExtendedStats that will be
+ *                         populated with the collected stats. Cannot be NULL.
+ * @see SwappyExtendedStats
+ */
+void SwappyVk_getExtendedStats(VkSwapchainKHR swapchain,
+                               SwappyExtendedStats* stats);
+
+/**
+ * @brief Toggle recording of the frame timeline on/off
+ *
+ * By default the timeline is off and recording costs nothing more than a
+ * check of the flag. When it is on, a ::SwappyFrameRecord is added to a
+ * fixed-size buffer for each frame presented, without blocking or allocating,
+ * and the oldest records are dropped if the buffer fills up. If the platform
+ * supports VK_GOOGLE_display_timing and the app also calls
+ * ::SwappyVk_recordFrameStart, records of type ::SWAPPY_FRAME_RECORD_PRESENT
+ * are added when the presentation times of frames become known.
+ *
+ * SwappyVk_initAndGetRefreshCycleDuration must have been called successfully
+ * before for this swapchain, otherwise there is no effect in this call.
+ *
+ * @param[in]  swapchain - The swapchain for which the timeline is recorded.
+ * @param      enabled   - Whether to enable/disable the timeline.
+ */
+void SwappyVk_enableFrameTimeline(VkSwapchainKHR swapchain, bool enabled);
+
+/**
+ * @brief Moves the oldest records of the frame timeline into records.
+ *
+ * @param[in]  swapchain      - The swapchain whose timeline is read.
+ * @param[out] records        - Array of at least maxRecords records to fill.
+ * @param      maxRecords     - The maximum number of records to return.
+ * @param[out] droppedRecords - If not NULL, set to the number of records that
+ *                              were dropped since the last drain or dump
+ *                              because the buffer was full.
+ * @return The number of records returned.
+ * @see SwappyVk_enableFrameTimeline
+ */
+int SwappyVk_drainFrameTimeline(VkSwapchainKHR swapchain,
+                                SwappyFrameRecord* records, int maxRecords,
+                                uint64_t* droppedRecords);
+
+/**
+ * @brief Moves all the records of the frame timeline to a file, in the format
+ * described by ::SwappyFrameTimelineHeader.
+ *
+ * @param[in]  swapchain - The swapchain whose timeline is written.
+ * @param      fd        - A file descriptor open for writing.
+ * @return The number of records written, or -1 if writing failed.
+ * @see SwappyVk_enableFrameTimeline
+ */
+int SwappyVk_dumpFrameTimeline(VkSwapchainKHR swapchain, int fd);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
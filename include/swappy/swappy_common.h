@@ -178,6 +178,199 @@ typedef struct SwappyStats {
     uint64_t latencyFrames[MAX_FRAME_BUCKETS];
 } SwappyStats;
 
+/**
+ * The most buckets in each histogram of the extended statistics.
+ * @see SwappyExtendedStatsConfig
+ */
+#define SWAPPY_EXTENDED_STATS_MAX_BUCKETS 128
+
+/**
+ * @brief The buckets of the histograms in ::SwappyExtendedStats.
+ * @see SwappyGL_setExtendedStatsConfig
+ * @see SwappyVk_setExtendedStatsConfig
+ *
+ * The default is 128 buckets of 500us, which covers up to 64ms.
+ */
+typedef struct SwappyExtendedStatsConfig {
+    /** @brief The width of each bucket, in microseconds. At least 1. */
+    uint32_t bucketWidthMicros;
+    /**
+     * @brief The number of buckets, from 1 to
+     * ::SWAPPY_EXTENDED_STATS_MAX_BUCKETS. The last bucket also counts all
+     * longer durations.
+     */
+    uint32_t bucketCount;
+} SwappyExtendedStatsConfig;
+
+/**
+ * @brief A histogram of durations, with its percentiles.
+ *
+ * Percentiles are the middle of the bucket they fall in, or the start of the
+ * last bucket if they fall in that one. They are 0 when there are no frames.
+ */
+typedef struct SwappyDurationHistogram {
+    /** @brief Frames counted in each bucket. Unused buckets are 0. */
+    uint64_t counts[SWAPPY_EXTENDED_STATS_MAX_BUCKETS];
+    /** @brief Median duration. */
+    int64_t p50Nanos;
+    /** @brief 95th percentile of the durations. */
+    int64_t p95Nanos;
+    /** @brief 99th percentile of the durations. */
+    int64_t p99Nanos;
+} SwappyDurationHistogram;
+
+/**
+ * @brief Swappy frame statistics with configurable histograms in microseconds,
+ * collected alongside ::SwappyStats if toggled on with ::SwappyGL_enableStats
+ * or ::SwappyVk_enableStats.
+ *
+ * The histograms are of the same times as those of ::SwappyStats, but are not
+ * rounded down to whole refresh periods.
+ */
+typedef struct SwappyExtendedStats {
+    /** @brief Total frames counted. */
+    uint64_t totalFrames;
+    /** @brief The buckets of the histograms. */
+    SwappyExtendedStatsConfig config;
+    /** @brief Time frames waited in the compositor queue after rendering. */
+    SwappyDurationHistogram idle;
+    /** @brief Time between the requested and actual present times. */
+    SwappyDurationHistogram late;
+    /** @brief Time between two consecutive frames being presented. */
+    SwappyDurationHistogram offsetFromPreviousFrame;
+    /** @brief Time from the start of the frame to when it was presented. */
+    SwappyDurationHistogram latency;
+} SwappyExtendedStats;
+
+/**
+ * @brief The algorithms that can choose the swap interval when auto-swap
+ * interval is on.
+ * @see SwappyGL_setSwapIntervalController
+ * @see SwappyVk_setSwapIntervalController
+ */
+typedef enum SwappySwapIntervalController {
+    /**
+     * @brief Compares the mean frame time over the last 2 seconds, and the
+     * share of frames that missed their deadline, to fixed thresholds. This is
+     * the default.
+     */
+    SWAPPY_SWAP_INTERVAL_CONTROLLER_AVERAGE = 0,
+    /**
+     * @brief Predicts frame times from the 90th percentile of recent frames,
+     * reacting within a few frames when they get slower but only swapping
+     * faster once there has been headroom for a while. This avoids most of
+     * the missed frames after load spikes and the oscillation on content
+     * that is close to a refresh period.
+     */
+    SWAPPY_SWAP_INTERVAL_CONTROLLER_PREDICTIVE = 1,
+} SwappySwapIntervalController;
+
+/**
+ * @brief Percentiles of the CPU and GPU time of recent frames, as seen by the
+ * swap interval controller.
+ * @see SwappyGL_getFrameDurationPercentiles
+ * @see SwappyVk_getFrameDurationPercentiles
+ *
+ * With ::SWAPPY_SWAP_INTERVAL_CONTROLLER_AVERAGE these cover up to the last 2
+ * seconds of frames since the swap interval last changed, in 250us steps. With
+ * ::SWAPPY_SWAP_INTERVAL_CONTROLLER_PREDICTIVE they cover the last 32 frames.
+ * All times are 0 when there are no frames.
+ */
+typedef struct SwappyFrameDurationPercentiles {
+    /** @brief The number of frames the percentiles were taken over. */
+    uint64_t frameCount;
+    /** @brief Median CPU time of the frames. */
+    int64_t cpuTimeP50Nanos;
+    /** @brief 95th percentile of the CPU time of the frames. */
+    int64_t cpuTimeP95Nanos;
+    /** @brief Median GPU time of the frames. */
+    int64_t gpuTimeP50Nanos;
+    /** @brief 95th percentile of the GPU time of the frames. */
+    int64_t gpuTimeP95Nanos;
+} SwappyFrameDurationPercentiles;
+
+/**
+ * @brief The kinds of record in a frame timeline.
+ * @see SwappyFrameRecord
+ */
+typedef enum SwappyFrameRecordType {
+    /** @brief Swappy's timings for a frame, recorded when it is swapped. */
+    SWAPPY_FRAME_RECORD_FRAME = 0,
+    /**
+     * @brief Presentation feedback for an earlier frame, recorded when the
+     * platform reports it. Only the startFrameTimeNanos,
+     * desiredPresentTimeNanos and actualPresentTimeNanos fields are set, and
+     * the start time is the one of the matching call to
+     * ::SwappyGL_recordFrameStart or ::SwappyVk_recordFrameStart.
+     */
+    SWAPPY_FRAME_RECORD_PRESENT = 1,
+} SwappyFrameRecordType;
+
+/**
+ * @brief One entry of the frame timeline, collected if toggled on with
+ * ::SwappyGL_enableFrameTimeline or ::SwappyVk_enableFrameTimeline.
+ *
+ * All times are CLOCK_MONOTONIC timestamps or durations in nanoseconds, and
+ * are 0 when unknown.
+ */
+typedef struct SwappyFrameRecord {
+    /** @brief One of ::SwappyFrameRecordType. */
+    uint32_t type;
+    /** @brief Swap interval, in refresh periods, the frame was paced to. */
+    int32_t swapInterval;
+    /** @brief 1 if the frame was rendered in pipeline mode, 0 otherwise. */
+    int32_t pipelineMode;
+    /** @brief Refresh periods waited for the previous frame's GPU work. */
+    int32_t lateFrames;
+    /** @brief Time of the choreographer tick the frame was started after. */
+    int64_t choreographerTimeNanos;
+    /** @brief Time the frame was started, after the previous swap. */
+    int64_t startFrameTimeNanos;
+    /** @brief Time Swappy started waiting for the swap interval. */
+    int64_t preWaitTimeNanos;
+    /** @brief Time Swappy stopped waiting for the swap interval. */
+    int64_t postWaitTimeNanos;
+    /** @brief Time the frame was handed to the compositor. */
+    int64_t swapTimeNanos;
+    /** @brief CPU time of the frame. */
+    int64_t cpuTimeNanos;
+    /** @brief GPU time of the previous frame, as measured with a fence. */
+    int64_t gpuTimeNanos;
+    /** @brief The presentation time Swappy requested for the frame. */
+    int64_t desiredPresentTimeNanos;
+    /** @brief The time the frame was presented on screen. */
+    int64_t actualPresentTimeNanos;
+} SwappyFrameRecord;
+
+/** @brief "SWTL", the first 4 bytes of a frame timeline dump. */
+#define SWAPPY_FRAME_TIMELINE_MAGIC 0x4c545753u
+
+/** @brief The version of the frame timeline dump format. */
+#define SWAPPY_FRAME_TIMELINE_VERSION 1
+
+/**
+ * @brief Header of a frame timeline dump, written by
+ * ::SwappyGL_dumpFrameTimeline or ::SwappyVk_dumpFrameTimeline.
+ *
+ * The header is followed by recordCount records of recordSize bytes, each
+ * laid out as ::SwappyFrameRecord, in the order they were recorded. All fields
+ * are little-endian.
+ */
+typedef struct SwappyFrameTimelineHeader {
+    /** @brief ::SWAPPY_FRAME_TIMELINE_MAGIC. */
+    uint32_t magic;
+    /** @brief ::SWAPPY_FRAME_TIMELINE_VERSION. */
+    uint16_t version;
+    /** @brief sizeof(::SwappyFrameRecord). */
+    uint16_t recordSize;
+    /** @brief The refresh period of the display when the dump was made. */
+    uint64_t refreshPeriodNanos;
+    /** @brief Records lost since the previous dump or drain. */
+    uint64_t droppedRecords;
+    /** @brief The number of records that follow. */
+    uint64_t recordCount;
+} SwappyFrameTimelineHeader;
+
 
 #ifdef __cplusplus
 }  // extern "C"
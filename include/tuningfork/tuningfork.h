@@ -522,6 +522,24 @@ TuningFork_ErrorCode TuningFork_frameTick(TuningFork_InstrumentKey key);
 TuningFork_ErrorCode TuningFork_frameDeltaTimeNanos(
     TuningFork_InstrumentKey key, TuningFork_Duration dt);
 
+/**
+ * @brief Record several frame times at once using external times, e.g. when
+ * frame times are collected on another thread and reported periodically.
+ * This is equivalent to calling TuningFork_frameDeltaTimeNanos for each
+ * duration, but cheaper.
+ * @param key an instrument key
+ * @see the reserved instrument keys above
+ * @param dts an array of the durations you wish to record (in nanoseconds)
+ * @param count the number of durations in dts
+ * @return TUNINGFORK_ERROR_INVALID_INSTRUMENT_KEY if the instrument key is
+ * invalid.
+ * @return TUNINGFORK_ERROR_BAD_PARAMETER if dts is NULL and count is not 0.
+ * @return TUNINGFORK_ERROR_OK on success.
+ */
+TuningFork_ErrorCode TuningFork_frameDeltaTimeNanosBatch(
+    TuningFork_InstrumentKey key, const TuningFork_Duration* dts,
+    uint32_t count);
+
 /**
  * @brief Start a trace segment.
  * @param key an instrument key
@@ -136,14 +136,13 @@ std::string GetExceptionMessage() {
     std::string msg;
     jthrowable exception = Env()->ExceptionOccurred();
     Env()->ExceptionClear();
-    jclass oclass = FindClass("java/lang/Object");
+    jclass oclass = JNI_CACHED_CLASS("java/lang/Object").Get();
     jmethodID toString =
-        Env()->GetMethodID(oclass, "toString", "()Ljava/lang/String;");
+        JNI_CACHED_METHOD("toString", "()Ljava/lang/String;").Get(oclass);
     jstring s = (jstring)Env()->CallObjectMethod(exception, toString);
     const char* utf = Env()->GetStringUTFChars(s, nullptr);
     msg = utf;
     Env()->ReleaseStringUTFChars(s, utf);
-    Env()->DeleteLocalRef(oclass);
     Env()->DeleteLocalRef(s);
     Env()->DeleteLocalRef(exception);
     return msg;
@@ -195,6 +194,34 @@ int64_t LocalObject::GetLongField(const char* field_name) const {
     else
         return BAD_FIELD;
 }
+LocalObject LocalObject::GetObjectField(FieldId& field) const {
+    jfieldID fid = field.Get(clz_);
+    if (fid != nullptr)
+        return LocalObject(Env()->GetObjectField(obj_, fid), nullptr);
+    else
+        return LocalObject(nullptr, nullptr);
+}
+int LocalObject::GetIntField(FieldId& field) const {
+    jfieldID fid = field.Get(clz_);
+    if (fid != nullptr)
+        return Env()->GetIntField(obj_, fid);
+    else
+        return BAD_FIELD;
+}
+bool LocalObject::GetBooleanField(FieldId& field) const {
+    jfieldID fid = field.Get(clz_);
+    if (fid != nullptr)
+        return Env()->GetBooleanField(obj_, fid);
+    else
+        return false;
+}
+int64_t LocalObject::GetLongField(FieldId& field) const {
+    jfieldID fid = field.Get(clz_);
+    if (fid != nullptr)
+        return Env()->GetLongField(obj_, fid);
+    else
+        return BAD_FIELD;
+}
 std::vector<unsigned char> GetByteArrayBytesAndDeleteRef(jbyteArray jbs) {
     jbyte* bs = Env()->GetByteArrayElements(jbs, 0);
     std::vector<unsigned char> ret(bs, bs + Env()->GetArrayLength(jbs));
@@ -212,6 +239,13 @@ jni::String GetStaticStringField(const char* class_name,
     jfieldID fid = env->GetStaticFieldID(clz, field_name, "Ljava/lang/String;");
     return (jstring)env->GetStaticObjectField(clz, fid);
 }
+jni::String GetStaticStringField(ClassRef& clz, StaticFieldId& field) {
+    jclass c = clz.Get();
+    if (c == nullptr) return jni::String((jstring) nullptr);
+    jfieldID fid = field.Get(c);
+    if (fid == nullptr) return jni::String((jstring) nullptr);
+    return (jstring)Env()->GetStaticObjectField(c, fid);
+}
 
 #ifndef NDEBUG
 void DumpLocalRefTable() {
@@ -21,6 +21,8 @@
 #include <string>
 #include <vector>
 
+#include "jni/jni_id_cache.h"
+
 #define CHECK_FOR_JNI_EXCEPTION_AND_RETURN(A)              \
     if (RawExceptionCheck()) {                             \
         std::string exception_msg = GetExceptionMessage(); \
@@ -179,6 +181,12 @@ class LocalObject {
         SetClass(c);
         return true;
     }
+    bool Cast(ClassRef& clz_to) {
+        jclass c = clz_to.Get();
+        if (c == nullptr) return false;
+        SetClass((jclass)Env()->NewLocalRef(c));
+        return true;
+    }
 
     // These methods take a variable number of arguments and have the return the
     // type indicated. The arguments are passed directly to JNI and it's not
@@ -201,6 +209,48 @@ class LocalObject {
     bool GetBooleanField(const char* field_name) const;
     int64_t GetLongField(const char* field_name) const;
 
+    // As above, but with the method or field id cached: use JNI_CACHED_METHOD
+    // and JNI_CACHED_FIELD from jni_id_cache.h to get one.
+    template <typename... Args>
+    jobject CallObjectMethod(MethodId& method, Args... args) const {
+        jmethodID mid = method.Get(clz_);
+        if (mid == nullptr) return nullptr;
+        return Env()->CallObjectMethod(obj_, mid, args...);
+    }
+    template <typename... Args>
+    jobject CallStaticObjectMethod(StaticMethodId& method,
+                                   Args... args) const {
+        jmethodID mid = method.Get(clz_);
+        if (mid == nullptr) return nullptr;
+        return Env()->CallStaticObjectMethod(clz_, mid, args...);
+    }
+    template <typename... Args>
+    jni::String CallStringMethod(MethodId& method, Args... args) const {
+        return jni::String((jstring)CallObjectMethod(method, args...));
+    }
+    template <typename... Args>
+    void CallVoidMethod(MethodId& method, Args... args) const {
+        jmethodID mid = method.Get(clz_);
+        if (mid == nullptr) return;
+        Env()->CallVoidMethod(obj_, mid, args...);
+    }
+    template <typename... Args>
+    int CallIntMethod(MethodId& method, Args... args) const {
+        jmethodID mid = method.Get(clz_);
+        if (mid == nullptr) return 0;
+        return Env()->CallIntMethod(obj_, mid, args...);
+    }
+    template <typename... Args>
+    bool CallBooleanMethod(MethodId& method, Args... args) const {
+        jmethodID mid = method.Get(clz_);
+        if (mid == nullptr) return false;
+        return Env()->CallBooleanMethod(obj_, mid, args...);
+    }
+    LocalObject GetObjectField(FieldId& field) const;
+    int GetIntField(FieldId& field) const;
+    bool GetBooleanField(FieldId& field) const;
+    int64_t GetLongField(FieldId& field) const;
+
    private:
     void Release() {
         if (clz_ != nullptr) {
@@ -216,6 +266,15 @@ class LocalObject {
 
 LocalObject NewObjectV(const char* cclz, const char* ctorSig, va_list argptr);
 LocalObject NewObject(const char* cclz, const char* ctorSig, ...);
+template <typename... Args>
+LocalObject NewObject(ClassRef& clz_ref, MethodId& ctor, Args... args) {
+    jclass clz = clz_ref.Get();
+    if (clz == nullptr) return LocalObject();
+    jmethodID mid = ctor.Get(clz);
+    if (mid == nullptr) return LocalObject();
+    jobject o = Env()->NewObject(clz, mid, args...);
+    return LocalObject(o, (jclass)Env()->NewLocalRef(clz));
+}
 
 inline bool RawExceptionCheck() { return Env()->ExceptionCheck(); }
 // This will clear the exception and get the exception message.
@@ -231,6 +290,8 @@ std::vector<unsigned char> GetByteArrayBytesAndDeleteRef(jbyteArray jbs);
 
 jni::String GetStaticStringField(const char* class_name,
                                  const char* field_name);
+// The field's signature must be "Ljava/lang/String;".
+jni::String GetStaticStringField(ClassRef& clz, StaticFieldId& field);
 
 // Debugging
 #ifndef NDEBUG
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jni/jni_id_cache.h"
+
+#include "jni/jni_helper.h"
+
+namespace gamesdk {
+
+namespace jni {
+
+static std::atomic<uint64_t> lookups_{0};
+static std::atomic<uint64_t> lookups_avoided_{0};
+
+IdCacheStats GetIdCacheStats() {
+    return {lookups_.load(std::memory_order_relaxed),
+            lookups_avoided_.load(std::memory_order_relaxed)};
+}
+
+jclass ClassRef::Get() {
+    jclass clz = clz_.load(std::memory_order_acquire);
+    if (clz != nullptr) {
+        lookups_avoided_.fetch_add(1, std::memory_order_relaxed);
+        return clz;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    clz = clz_.load(std::memory_order_relaxed);
+    if (clz != nullptr) return clz;
+    lookups_.fetch_add(1, std::memory_order_relaxed);
+    jclass local = FindClass(name_);
+    if (local == nullptr) return nullptr;
+    clz = reinterpret_cast<jclass>(Env()->NewGlobalRef(local));
+    Env()->DeleteLocalRef(local);
+    clz_.store(clz, std::memory_order_release);
+    return clz;
+}
+
+template <>
+jmethodID MethodId::Lookup(jclass clz) const {
+    return Env()->GetMethodID(clz, name_, sig_);
+}
+template <>
+jmethodID StaticMethodId::Lookup(jclass clz) const {
+    return Env()->GetStaticMethodID(clz, name_, sig_);
+}
+template <>
+jfieldID FieldId::Lookup(jclass clz) const {
+    return Env()->GetFieldID(clz, name_, sig_);
+}
+template <>
+jfieldID StaticFieldId::Lookup(jclass clz) const {
+    return Env()->GetStaticFieldID(clz, name_, sig_);
+}
+
+template <typename IdType, IdKind kind>
+IdType MemberId<IdType, kind>::Get(jclass clz) {
+    if (clz == nullptr) return nullptr;
+    jclass cached = clz_.load(std::memory_order_acquire);
+    if (cached == nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cached = clz_.load(std::memory_order_relaxed);
+        if (cached == nullptr) {
+            lookups_.fetch_add(1, std::memory_order_relaxed);
+            IdType id = Lookup(clz);
+            if (id == nullptr) return nullptr;
+            id_.store(id, std::memory_order_relaxed);
+            clz_.store(reinterpret_cast<jclass>(Env()->NewGlobalRef(clz)),
+                       std::memory_order_release);
+            return id;
+        }
+    }
+    // Ids are only valid for the class they were looked up in (and its
+    // subclasses), so check this is the same class.
+    if (cached == clz || Env()->IsSameObject(cached, clz)) {
+        lookups_avoided_.fetch_add(1, std::memory_order_relaxed);
+        return id_.load(std::memory_order_relaxed);
+    }
+    lookups_.fetch_add(1, std::memory_order_relaxed);
+    return Lookup(clz);
+}
+
+template class MemberId<jmethodID, IdKind::METHOD>;
+template class MemberId<jmethodID, IdKind::STATIC_METHOD>;
+template class MemberId<jfieldID, IdKind::FIELD>;
+template class MemberId<jfieldID, IdKind::STATIC_FIELD>;
+
+}  // namespace jni
+
+}  // namespace gamesdk
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <jni.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+
+// Each use of these macros creates its own static cache, so that the class
+// reference or id is looked up once per call site rather than on every call.
+// The arguments must be strings that outlive the cache, e.g. string literals.
+#define JNI_CACHED_CLASS(NAME) JNI_CACHED_(::gamesdk::jni::ClassRef, NAME)
+#define JNI_CACHED_METHOD(NAME, SIG) \
+    JNI_CACHED_(::gamesdk::jni::MethodId, NAME, SIG)
+#define JNI_CACHED_STATIC_METHOD(NAME, SIG) \
+    JNI_CACHED_(::gamesdk::jni::StaticMethodId, NAME, SIG)
+#define JNI_CACHED_FIELD(NAME, SIG) \
+    JNI_CACHED_(::gamesdk::jni::FieldId, NAME, SIG)
+#define JNI_CACHED_STATIC_FIELD(NAME, SIG) \
+    JNI_CACHED_(::gamesdk::jni::StaticFieldId, NAME, SIG)
+
+#define JNI_CACHED_(TYPE, ...)            \
+    ([]() -> TYPE& {                      \
+        static TYPE cached_(__VA_ARGS__); \
+        return cached_;                   \
+    }())
+
+namespace gamesdk {
+
+namespace jni {
+
+struct IdCacheStats {
+    // Calls made to FindClass, GetMethodID, GetFieldID, etc. by the caches.
+    uint64_t lookups;
+    // Calls that used a cached class reference or id instead.
+    uint64_t lookups_avoided;
+};
+IdCacheStats GetIdCacheStats();
+
+// A global reference to a class, found with jni::FindClass the first time it
+// is needed and kept for the life of the process.
+class ClassRef {
+   public:
+    explicit ClassRef(const char* name) : name_(name) {}
+    ClassRef(const ClassRef&) = delete;
+    ClassRef& operator=(const ClassRef&) = delete;
+
+    // Returns nullptr, with an exception pending, if the class can't be found.
+    jclass Get();
+    const char* Name() const { return name_; }
+
+   private:
+    const char* name_;
+    std::atomic<jclass> clz_{nullptr};
+    std::mutex mutex_;
+};
+
+enum class IdKind { METHOD, STATIC_METHOD, FIELD, STATIC_FIELD };
+
+// The id of a method or field, cached for the first class it is looked up
+// in. Lookups in any other class are passed straight through to JNI.
+template <typename IdType, IdKind kind>
+class MemberId {
+   public:
+    MemberId(const char* name, const char* sig) : name_(name), sig_(sig) {}
+    MemberId(const MemberId&) = delete;
+    MemberId& operator=(const MemberId&) = delete;
+
+    // Returns nullptr, with an exception pending, if there is no such member.
+    IdType Get(jclass clz);
+
+   private:
+    IdType Lookup(jclass clz) const;
+
+    const char* name_;
+    const char* sig_;
+    // A global reference to the class id_ belongs to, set after id_.
+    std::atomic<jclass> clz_{nullptr};
+    std::atomic<IdType> id_{nullptr};
+    std::mutex mutex_;
+};
+
+typedef MemberId<jmethodID, IdKind::METHOD> MethodId;
+typedef MemberId<jmethodID, IdKind::STATIC_METHOD> StaticMethodId;
+typedef MemberId<jfieldID, IdKind::FIELD> FieldId;
+typedef MemberId<jfieldID, IdKind::STATIC_FIELD> StaticFieldId;
+
+}  // namespace jni
+
+}  // namespace gamesdk
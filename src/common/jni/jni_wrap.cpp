@@ -27,6 +27,7 @@ android::content::Context AppContext() {
 namespace android {
 namespace os {
 constexpr const char Build::class_name[];
+constexpr const char Build::string_sig[];
 }
 }  // namespace android
 
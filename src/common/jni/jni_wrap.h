@@ -16,8 +16,6 @@
 
 #pragma once
 
-#include <sstream>
-
 #include "jni/jni_helper.h"
 
 namespace gamesdk {
@@ -35,6 +33,9 @@ class Object {
         obj_ = NewObjectV(className, ctorSig, argptr);
         va_end(argptr);
     }
+    template <typename... Args>
+    Object(ClassRef& clz, MethodId& ctor, Args... args)
+        : obj_(NewObject(clz, ctor, args...)) {}
     Object(LocalObject&& o) : obj_(std::move(o)) {}
     Object(jobject o) {
         // If there's an exception pending, don't store the reference as it may
@@ -45,95 +46,58 @@ class Object {
         }
     }
     bool valid() const { return !obj_.ClassIsNull(); }
-    void CallVVMethod(const char* name) { obj_.CallVoidMethod(name, "()V"); }
-    void CallIVMethod(const char* name, int a) {
-        obj_.CallVoidMethod(name, "(I)V", a);
-    }
-    int CallVIMethod(const char* name) {
-        return obj_.CallIntMethod(name, "()I");
-    }
-    int CallIIMethod(const char* name, const int a) {
-        return obj_.CallIntMethod(name, "(I)I", a);
-    }
-    void CallZVMethod(const char* name, bool a) {
-        obj_.CallVoidMethod(name, "(Z)V", a);
-    }
-    void CallSVMethod(const char* name, const char* a) {
-        obj_.CallVoidMethod(name, "(Ljava/lang/String;)V", String(a).J());
-    }
-    String CallVSMethod(const char* name) {
-        return obj_.CallStringMethod(name, "()Ljava/lang/String;");
-    }
-    void CallSSVMethod(const char* name, const char* a, const char* b) {
-        obj_.CallVoidMethod(name, "(Ljava/lang/String;Ljava/lang/String;)V",
-                            String(a).J(), String(b).J());
-    }
-    Object CallAOMethod(const char* name, const char* returnClass) {
-        std::stringstream str;
-        str << "()[L" << returnClass << ";";
-        jobject o = obj_.CallObjectMethod(name, str.str().c_str());
-        return Object(o);
-    }
-    Object CallVOMethod(const char* name, const char* returnClass) {
-        std::stringstream str;
-        str << "()L" << returnClass << ";";
-        jobject o = obj_.CallObjectMethod(name, str.str().c_str());
-        return Object(o);
-    }
-    Object CallIOMethod(const char* name, int a, const char* returnClass) {
-        std::stringstream str;
-        str << "(I)L" << returnClass << ";";
-        jobject o = obj_.CallObjectMethod(name, str.str().c_str(), a);
-        return Object(o);
-    }
-    void CallOVMethod(const char* name, const char* parameterClassA,
-                      const Object& a) {
-        std::stringstream str;
-        str << "(L" << parameterClassA << ";)V";
-        obj_.CallVoidMethod(name, str.str().c_str(), (jobject)a.obj_);
-    }
-    Object CallSIOMethod(const char* name, const char* a, int b,
-                         const char* returnClass) {
-        std::stringstream str;
-        str << "(Ljava/lang/String;I)L" << returnClass << ";";
-        jobject o =
-            obj_.CallObjectMethod(name, str.str().c_str(), String(a).J(), b);
-        return Object(o);
-    }
-    Object CallOOOMethod(const char* name, const char* parameterClassA,
-                         const Object& a, const char* parameterClassB,
-                         const Object& b, const char* returnClass) {
-        std::stringstream str;
-        str << "(L" << parameterClassA << ";L" << parameterClassB << ";)L"
-            << returnClass << ";";
-        jobject o = obj_.CallObjectMethod(name, str.str().c_str(),
-                                          (jobject)a.obj_, (jobject)b.obj_);
-        return Object(o);
-    }
-    int CallSIIMethod(const char* name, const char* a, const int b) {
-        std::stringstream str;
-        str << "(Ljava/lang/String;I)I";
-        return obj_.CallIntMethod(name, "(Ljava/lang/String;I)I", String(a).J(),
-                                  b);
-    }
-    Object CallSIIOMethod(const char* name, const char* a, int b, int c,
-                          const char* returnClass) {
-        std::stringstream str;
-        str << "(Ljava/lang/String;II)L" << returnClass << ";";
-        jobject o =
-            obj_.CallObjectMethod(name, str.str().c_str(), String(a).J(), b, c);
-        return Object(o);
-    }
-    Object CallSOMethod(const char* name, const char* a,
-                        const char* returnClass) {
-        std::stringstream str;
-        str << "(Ljava/lang/String;)L" << returnClass << ";";
-        jobject o =
-            obj_.CallObjectMethod(name, str.str().c_str(), String(a).J());
-        return Object(o);
-    }
-    bool CallVZMethod(const char* name) {
-        return obj_.CallBooleanMethod(name, "()Z");
+    // The method ids passed to these should come from JNI_CACHED_METHOD, with
+    // a signature matching the argument and return types in the name.
+    void CallVVMethod(MethodId& method) { obj_.CallVoidMethod(method); }
+    void CallIVMethod(MethodId& method, int a) {
+        obj_.CallVoidMethod(method, a);
+    }
+    int CallVIMethod(MethodId& method) { return obj_.CallIntMethod(method); }
+    int CallIIMethod(MethodId& method, const int a) {
+        return obj_.CallIntMethod(method, a);
+    }
+    void CallZVMethod(MethodId& method, bool a) {
+        obj_.CallVoidMethod(method, (jboolean)a);
+    }
+    void CallSVMethod(MethodId& method, const char* a) {
+        obj_.CallVoidMethod(method, String(a).J());
+    }
+    String CallVSMethod(MethodId& method) {
+        return obj_.CallStringMethod(method);
+    }
+    void CallSSVMethod(MethodId& method, const char* a, const char* b) {
+        obj_.CallVoidMethod(method, String(a).J(), String(b).J());
+    }
+    Object CallAOMethod(MethodId& method) {
+        return Object(obj_.CallObjectMethod(method));
+    }
+    Object CallVOMethod(MethodId& method) {
+        return Object(obj_.CallObjectMethod(method));
+    }
+    Object CallIOMethod(MethodId& method, int a) {
+        return Object(obj_.CallObjectMethod(method, a));
+    }
+    void CallOVMethod(MethodId& method, const Object& a) {
+        obj_.CallVoidMethod(method, (jobject)a.obj_);
+    }
+    Object CallSIOMethod(MethodId& method, const char* a, int b) {
+        return Object(obj_.CallObjectMethod(method, String(a).J(), b));
+    }
+    Object CallOOOMethod(MethodId& method, const Object& a, const Object& b) {
+        return Object(
+            obj_.CallObjectMethod(method, (jobject)a.obj_, (jobject)b.obj_));
+    }
+    int CallSIIMethod(MethodId& method, const char* a, const int b) {
+        return obj_.CallIntMethod(method, String(a).J(), b);
+    }
+    Object CallSIIOMethod(MethodId& method, const char* a, int b, int c) {
+        return Object(obj_.CallObjectMethod(method, String(a).J(), b, c));
+    }
+    Object CallSOMethod(MethodId& method, const char* a) {
+        return Object(obj_.CallObjectMethod(method, String(a).J()));
+    }
+    bool CallVZMethod(MethodId& method) {
+        return obj_.CallBooleanMethod(method);
     }
     bool IsNull() const { return obj_.IsNull(); }
 };
@@ -143,64 +107,78 @@ namespace io {
 class OutputStream : public Object {
    public:
     OutputStream(Object&& o) : Object(std::move(o)) {}
-    void close() { CallVVMethod("close"); }
+    void close() { CallVVMethod(JNI_CACHED_METHOD("close", "()V")); }
 };
 
 class OutputStreamWriter : public Object {
    public:
     OutputStreamWriter(OutputStream& o, const std::string& s)
-        : Object("java/io/OutputStreamWriter",
-                 "(Ljava/io/OutputStream;Ljava/lang/String;)V", (jobject)o.obj_,
-                 String(s.c_str()).J()) {}
+        : Object(JNI_CACHED_CLASS("java/io/OutputStreamWriter"),
+                 JNI_CACHED_METHOD(
+                     "<init>", "(Ljava/io/OutputStream;Ljava/lang/String;)V"),
+                 (jobject)o.obj_, String(s.c_str()).J()) {}
 };
 
 class Writer : public Object {
    public:
     Writer(Object&& o) : Object(std::move(o)) {}
-    void write(const std::string& s) { CallSVMethod("write", s.c_str()); }
-    void flush() { CallVVMethod("flush"); }
-    void close() { CallVVMethod("close"); }
+    void write(const std::string& s) {
+        CallSVMethod(JNI_CACHED_METHOD("write", "(Ljava/lang/String;)V"),
+                     s.c_str());
+    }
+    void flush() { CallVVMethod(JNI_CACHED_METHOD("flush", "()V")); }
+    void close() { CallVVMethod(JNI_CACHED_METHOD("close", "()V")); }
 };
 
 class BufferedWriter : public Writer {
    public:
     BufferedWriter(const Writer& w)
-        : Writer(Object("java/io/BufferedWriter", "(Ljava/io/Writer;)V",
+        : Writer(Object(JNI_CACHED_CLASS("java/io/BufferedWriter"),
+                        JNI_CACHED_METHOD("<init>", "(Ljava/io/Writer;)V"),
                         (jobject)w.obj_)) {}
 };
 
 class InputStream : public Object {
    public:
     InputStream(Object&& o) : Object(std::move(o)) {}
-    void close() { CallVVMethod("close"); }
+    void close() { CallVVMethod(JNI_CACHED_METHOD("close", "()V")); }
 };
 
 class Reader : public Object {
    public:
     Reader(Object&& o) : Object(std::move(o)) {}
-    jni::String readLine() { return CallVSMethod("readLine"); }
-    void close() { CallVVMethod("close"); }
+    jni::String readLine() {
+        return CallVSMethod(
+            JNI_CACHED_METHOD("readLine", "()Ljava/lang/String;"));
+    }
+    void close() { CallVVMethod(JNI_CACHED_METHOD("close", "()V")); }
 };
 
 class InputStreamReader : public Reader {
    public:
     InputStreamReader(const InputStream& is, const std::string& s)
-        : Reader(Object("java/io/InputStreamReader",
-                        "(Ljava/io/InputStream;Ljava/lang/String;)V",
+        : Reader(Object(JNI_CACHED_CLASS("java/io/InputStreamReader"),
+                        JNI_CACHED_METHOD(
+                            "<init>",
+                            "(Ljava/io/InputStream;Ljava/lang/String;)V"),
                         (jobject)is.obj_, String(s.c_str()).J())) {}
 };
 
 class BufferedReader : public Reader {
    public:
     BufferedReader(const Reader& r)
-        : Reader(Object("java/io/BufferedReader", "(Ljava/io/Reader;)V",
+        : Reader(Object(JNI_CACHED_CLASS("java/io/BufferedReader"),
+                        JNI_CACHED_METHOD("<init>", "(Ljava/io/Reader;)V"),
                         (jobject)r.obj_)) {}
 };
 
 class File : public Object {
    public:
     File(Object&& o) : Object(std::move(o)) {}
-    jni::String getPath() { return CallVSMethod("getPath"); }
+    jni::String getPath() {
+        return CallVSMethod(
+            JNI_CACHED_METHOD("getPath", "()Ljava/lang/String;"));
+    }
 };
 
 }  // namespace io
@@ -211,22 +189,31 @@ class UUID : public Object {
    public:
     UUID(LocalObject&& o) : Object(std::move(o)) {}
     static UUID randomUUID() {
-        LocalObject obj(nullptr, Env()->FindClass("java/util/UUID"));
-        auto o = obj.CallStaticObjectMethod("randomUUID", "()Ljava/util/UUID;");
+        LocalObject obj;
+        obj.Cast(JNI_CACHED_CLASS("java/util/UUID"));
+        auto o = obj.CallStaticObjectMethod(JNI_CACHED_STATIC_METHOD(
+            "randomUUID", "()Ljava/util/UUID;"));
         obj.SetObj(o);
         return obj;
     }
-    jni::String toString() { return CallVSMethod("toString"); }
+    jni::String toString() {
+        return CallVSMethod(
+            JNI_CACHED_METHOD("toString", "()Ljava/lang/String;"));
+    }
 };
 
 class List : public java::Object {
    public:
     List(Object&& o) : Object(std::move(o)) {}
     java::Object get(int index) {
-        return CallIOMethod("get", index, "java/lang/Object");
+        return CallIOMethod(
+            JNI_CACHED_METHOD("get", "(I)Ljava/lang/Object;"), index);
+    }
+    bool isEmpty() { return CallVZMethod(JNI_CACHED_METHOD("isEmpty", "()Z")); }
+    jni::String toString() {
+        return CallVSMethod(
+            JNI_CACHED_METHOD("toString", "()Ljava/lang/String;"));
     }
-    bool isEmpty() { return CallVZMethod("isEmpty"); }
-    jni::String toString() { return CallVSMethod("toString"); }
 };
 
 }  // namespace util
@@ -241,32 +228,50 @@ class URLConnection : public Object {
 class HttpURLConnection : public URLConnection {
    public:
     HttpURLConnection(URLConnection&& u) : URLConnection(std::move(u)) {
-        obj_.Cast("java/net/HttpURLConnection");
+        obj_.Cast(JNI_CACHED_CLASS("java/net/HttpURLConnection"));
     }
     void setRequestMethod(const std::string& method) {
-        CallSVMethod("setRequestMethod", method.c_str());
+        CallSVMethod(
+            JNI_CACHED_METHOD("setRequestMethod", "(Ljava/lang/String;)V"),
+            method.c_str());
+    }
+    void setConnectTimeout(int t) {
+        CallIVMethod(JNI_CACHED_METHOD("setConnectTimeout", "(I)V"), t);
     }
-    void setConnectTimeout(int t) { CallIVMethod("setConnectTimeout", t); }
     void setReadTimeout(int timeout) {
-        CallIVMethod("setReadTimeout", timeout);
+        CallIVMethod(JNI_CACHED_METHOD("setReadTimeout", "(I)V"), timeout);
+    }
+    void setDoOutput(bool d) {
+        CallZVMethod(JNI_CACHED_METHOD("setDoOutput", "(Z)V"), d);
+    }
+    void setDoInput(bool d) {
+        CallZVMethod(JNI_CACHED_METHOD("setDoInput", "(Z)V"), d);
+    }
+    void setUseCaches(bool d) {
+        CallZVMethod(JNI_CACHED_METHOD("setUseCaches", "(Z)V"), d);
     }
-    void setDoOutput(bool d) { CallZVMethod("setDoOutput", d); }
-    void setDoInput(bool d) { CallZVMethod("setDoInput", d); }
-    void setUseCaches(bool d) { CallZVMethod("setUseCaches", d); }
     void setRequestProperty(const std::string& name, const std::string& value) {
-        CallSSVMethod("setRequestProperty", name.c_str(), value.c_str());
+        CallSSVMethod(
+            JNI_CACHED_METHOD("setRequestProperty",
+                              "(Ljava/lang/String;Ljava/lang/String;)V"),
+            name.c_str(), value.c_str());
     }
     io::OutputStream getOutputStream() {
-        return CallVOMethod("getOutputStream", "java/io/OutputStream");
+        return CallVOMethod(
+            JNI_CACHED_METHOD("getOutputStream", "()Ljava/io/OutputStream;"));
+    }
+    void connect() { CallVVMethod(JNI_CACHED_METHOD("connect", "()V")); }
+    void disconnect() { CallVVMethod(JNI_CACHED_METHOD("disconnect", "()V")); }
+    int getResponseCode() {
+        return CallVIMethod(JNI_CACHED_METHOD("getResponseCode", "()I"));
     }
-    void connect() { CallVVMethod("connect"); }
-    void disconnect() { CallVVMethod("disconnect"); }
-    int getResponseCode() { return CallVIMethod("getResponseCode"); }
     jni::String getResponseMessage() {
-        return CallVSMethod("getResponseMessage");
+        return CallVSMethod(
+            JNI_CACHED_METHOD("getResponseMessage", "()Ljava/lang/String;"));
     }
     io::InputStream getInputStream() {
-        return CallVOMethod("getInputStream", "java/io/InputStream");
+        return CallVOMethod(
+            JNI_CACHED_METHOD("getInputStream", "()Ljava/io/InputStream;"));
     }
 };
 
@@ -274,11 +279,12 @@ class URL : public Object {
    public:
     URL(LocalObject o) : Object(o) {}
     URL(const std::string& s)
-        : Object("java/net/URL", "(Ljava/lang/String;)V",
+        : Object(JNI_CACHED_CLASS("java/net/URL"),
+                 JNI_CACHED_METHOD("<init>", "(Ljava/lang/String;)V"),
                  String(s.c_str()).J()) {}
     URLConnection openConnection() {
-        return URLConnection(Object(obj_.CallObjectMethod(
-            "openConnection", "()Ljava/net/URLConnection;")));
+        return URLConnection(Object(obj_.CallObjectMethod(JNI_CACHED_METHOD(
+            "openConnection", "()Ljava/net/URLConnection;"))));
     }
 };
 
@@ -289,9 +295,12 @@ namespace security {
 class MessageDigest : public java::Object {
    public:
     MessageDigest(const std::string& instance) : java::Object(nullptr) {
-        LocalObject temp(nullptr, FindClass("java/security/MessageDigest"));
+        LocalObject temp;
+        temp.Cast(JNI_CACHED_CLASS("java/security/MessageDigest"));
         auto o = temp.CallStaticObjectMethod(
-            "getInstance", "(Ljava/lang/String;)Ljava/security/MessageDigest;",
+            JNI_CACHED_STATIC_METHOD(
+                "getInstance",
+                "(Ljava/lang/String;)Ljava/security/MessageDigest;"),
             String(instance.c_str()).J());
         temp.SetObj(o);
         obj_ = std::move(temp);
@@ -303,7 +312,7 @@ class MessageDigest : public java::Object {
         env->SetByteArrayRegion(jbs, 0, bs.size(),
                                 reinterpret_cast<const jbyte*>(bs.data()));
         jbyteArray out = reinterpret_cast<jbyteArray>(
-            obj_.CallObjectMethod("digest", "([B)[B", jbs));
+            obj_.CallObjectMethod(JNI_CACHED_METHOD("digest", "([B)[B"), jbs));
         env->DeleteLocalRef(jbs);
         return GetByteArrayBytesAndDeleteRef(out);
     }
@@ -321,9 +330,14 @@ class DisplayMetrics : public java::Object {
    public:
     DisplayMetrics(java::Object&& o) : java::Object(std::move(o)) {}
     DisplayMetrics()
-        : java::Object("android/util/DisplayMetrics", "()V") {}
-    int heightPixels() const { return obj_.GetIntField("heightPixels"); }
-    int widthPixels() const { return obj_.GetIntField("widthPixels"); }
+        : java::Object(JNI_CACHED_CLASS("android/util/DisplayMetrics"),
+                       JNI_CACHED_METHOD("<init>", "()V")) {}
+    int heightPixels() const {
+        return obj_.GetIntField(JNI_CACHED_FIELD("heightPixels", "I"));
+    }
+    int widthPixels() const {
+        return obj_.GetIntField(JNI_CACHED_FIELD("widthPixels", "I"));
+    }
 };
 
 }  // namespace util
@@ -334,7 +348,8 @@ class Display : public java::Object {
    public:
     Display(java::Object&& o) : java::Object(std::move(o)) {}
     void getMetrics(util::DisplayMetrics& displayMetrics) {
-        CallOVMethod("getMetrics", "android/util/DisplayMetrics",
+        CallOVMethod(JNI_CACHED_METHOD("getMetrics",
+                                       "(Landroid/util/DisplayMetrics;)V"),
                      displayMetrics);
     }
 };
@@ -343,8 +358,8 @@ class WindowManager : public java::Object {
    public:
     WindowManager(java::Object&& o) : java::Object(std::move(o)) {}
     Display getDefaultDisplay() {
-        return CallVOMethod("getDefaultDisplay",
-                            "android/view/Display");
+        return CallVOMethod(JNI_CACHED_METHOD("getDefaultDisplay",
+                                              "()Landroid/view/Display;"));
     }
 };
 
@@ -358,10 +373,13 @@ class FeatureInfo : public java::Object {
    public:
     FeatureInfo(java::Object&& o) : java::Object(std::move(o)) {
         jni::String jname(
-            (jstring)obj_.GetObjectField("name", "Ljava/lang/String;")
+            (jstring)obj_
+                .GetObjectField(
+                    JNI_CACHED_FIELD("name", "Ljava/lang/String;"))
                 .ObjNewRef());
         if (jname.J() != nullptr) name = jname.C();
-        reqGlEsVersion = obj_.GetIntField("reqGlEsVersion");
+        reqGlEsVersion =
+            obj_.GetIntField(JNI_CACHED_FIELD("reqGlEsVersion", "I"));
     }
     static constexpr int GL_ES_VERSION_UNDEFINED = 0x0000000;
 
@@ -372,7 +390,9 @@ class FeatureInfo : public java::Object {
 class ApplicationInfo : public java::Object {
    public:
     ApplicationInfo(java::Object&& o) : java::Object(std::move(o)) {}
-    int flags() const { return obj_.GetIntField("flags"); }
+    int flags() const {
+        return obj_.GetIntField(JNI_CACHED_FIELD("flags", "I"));
+    }
     static const int FLAG_DEBUGGABLE = 2;
 };
 
@@ -382,8 +402,8 @@ class PackageInfo : public java::Object {
     typedef std::vector<unsigned char> Signature;
     std::vector<Signature> signatures() const {
         auto env = Env();
-        auto jsigs = obj_.GetObjectField("signatures",
-                                         "[Landroid/content/pm/Signature;");
+        auto jsigs = obj_.GetObjectField(JNI_CACHED_FIELD(
+            "signatures", "[Landroid/content/pm/Signature;"));
         jobjectArray sigs = jsigs.AsObjectArray();
         if (sigs == nullptr) return {};
         int n = env->GetArrayLength(sigs);
@@ -391,18 +411,21 @@ class PackageInfo : public java::Object {
             std::vector<std::vector<unsigned char>> ret;
             for (int i = 0; i < n; ++i) {
                 Object sig(env->GetObjectArrayElement(sigs, i));
-                jbyteArray bytes = reinterpret_cast<jbyteArray>(
-                    sig.obj_.CallObjectMethod("toByteArray", "()[B"));
+                jbyteArray bytes =
+                    reinterpret_cast<jbyteArray>(sig.obj_.CallObjectMethod(
+                        JNI_CACHED_METHOD("toByteArray", "()[B")));
                 ret.push_back(GetByteArrayBytesAndDeleteRef(bytes));
             }
             return ret;
         } else
             return {};
     }
-    int versionCode() const { return obj_.GetIntField("versionCode"); }
+    int versionCode() const {
+        return obj_.GetIntField(JNI_CACHED_FIELD("versionCode", "I"));
+    }
     ApplicationInfo applicationInfo() const {
-        auto appInfo = obj_.GetObjectField(
-            "applicationInfo", "[Landroid/content/pm/ApplicationInfo;");
+        auto appInfo = obj_.GetObjectField(JNI_CACHED_FIELD(
+            "applicationInfo", "[Landroid/content/pm/ApplicationInfo;"));
         return ApplicationInfo(std::move(appInfo));
     }
 };
@@ -412,13 +435,17 @@ class PackageManager : public java::Object {
     PackageManager(java::Object&& o) : java::Object(std::move(o)) {}
     static constexpr int GET_SIGNATURES = 0x0000040;
     PackageInfo getPackageInfo(const std::string& name, int flags) {
-        return CallSIOMethod("getPackageInfo", name.c_str(), flags,
-                             "android/content/pm/PackageInfo");
+        return CallSIOMethod(
+            JNI_CACHED_METHOD(
+                "getPackageInfo",
+                "(Ljava/lang/String;I)Landroid/content/pm/PackageInfo;"),
+            name.c_str(), flags);
     }
     std::vector<FeatureInfo> getSystemAvailableFeatures() {
         auto env = Env();
-        auto jfeatures = CallAOMethod("getSystemAvailableFeatures",
-                                      "android/content/pm/FeatureInfo");
+        auto jfeatures = CallAOMethod(
+            JNI_CACHED_METHOD("getSystemAvailableFeatures",
+                              "()[Landroid/content/pm/FeatureInfo;"));
         if (jfeatures.obj_.IsNull()) return {};
         jobjectArray features = jfeatures.obj_.AsObjectArray();
         int n = env->GetArrayLength(features);
@@ -450,7 +477,9 @@ class Intent : java::Object {
         "android.intent.action.BATTERY_CHANGED";
     Intent(java::Object&& o) : java::Object(std::move(o)) {}
     int getIntExtra(const char* name, int defaultValue) {
-        return CallSIIMethod("getIntExtra", name, defaultValue);
+        return CallSIIMethod(
+            JNI_CACHED_METHOD("getIntExtra", "(Ljava/lang/String;I)I"), name,
+            defaultValue);
     }
 };
 
@@ -458,7 +487,8 @@ class IntentFilter : public java::Object {
    public:
     IntentFilter(jobject o) : java::Object(o) {}
     IntentFilter(const char* action)
-        : Object("android/content/IntentFilter", "(Ljava/lang/String;)V",
+        : Object(JNI_CACHED_CLASS("android/content/IntentFilter"),
+                 JNI_CACHED_METHOD("<init>", "(Ljava/lang/String;)V"),
                  String(action).J()) {}
 };
 
@@ -475,29 +505,39 @@ class Context : public java::Object {
     static constexpr const char* ACTIVITY_SERVICE = "activity";
     Context(jobject o) : java::Object(o) {}
     pm::PackageManager getPackageManager() {
-        return CallVOMethod("getPackageManager",
-                            "android/content/pm/PackageManager");
+        return CallVOMethod(
+            JNI_CACHED_METHOD("getPackageManager",
+                              "()Landroid/content/pm/PackageManager;"));
     }
     android::view::WindowManager getWindowManager() {
-        return CallVOMethod("getWindowManager",
-                            "android/view/WindowManager");
+        return CallVOMethod(JNI_CACHED_METHOD(
+            "getWindowManager", "()Landroid/view/WindowManager;"));
+    }
+    jni::String getPackageName() {
+        return CallVSMethod(
+            JNI_CACHED_METHOD("getPackageName", "()Ljava/lang/String;"));
     }
-    jni::String getPackageName() { return CallVSMethod("getPackageName"); }
     res::AssetManager getAssets() {
-        return CallVOMethod("getAssets", "android/content/res/AssetManager");
+        return CallVOMethod(JNI_CACHED_METHOD(
+            "getAssets", "()Landroid/content/res/AssetManager;"));
     }
     java::io::File getCacheDir() {
-        return CallVOMethod("getCacheDir", "java/io/File");
+        return CallVOMethod(
+            JNI_CACHED_METHOD("getCacheDir", "()Ljava/io/File;"));
     }
     java::Object getSystemService(const char* name) {
-        return CallSOMethod("getSystemService", name, "java/lang/Object");
+        return CallSOMethod(
+            JNI_CACHED_METHOD("getSystemService",
+                              "(Ljava/lang/String;)Ljava/lang/Object;"),
+            name);
     }
     java::Object registerReceiver(BroadcastReceiver& broadcastReceiver,
                                   IntentFilter& intentFilter) {
-        return CallOOOMethod("registerReceiver",
-                             "android/content/BroadcastReceiver",
-                             broadcastReceiver, "android/content/IntentFilter",
-                             intentFilter, "android/content/Intent");
+        return CallOOOMethod(
+            JNI_CACHED_METHOD("registerReceiver",
+                              "(Landroid/content/BroadcastReceiver;Landroid/"
+                              "content/IntentFilter;)Landroid/content/Intent;"),
+            broadcastReceiver, intentFilter);
     }
 };
 
@@ -506,89 +546,72 @@ class Context : public java::Object {
 namespace os {
 
 class DebugClass {
-    jmethodID getNativeHeapAllocatedSize_method_id_;
-
-   public:
-    static uint64_t getNativeHeapAllocatedSize() {
+    static uint64_t CallStaticLongMethod(StaticMethodId& method) {
         JNIEnv* env = Env();
         if (env != nullptr) {
-            LocalObject obj;
-            obj.Cast("android/os/Debug");
-            jclass clz = obj;
-            jmethodID method = env->GetStaticMethodID(
-                clz, "getNativeHeapAllocatedSize", "()J");
-            if (method != NULL)
-                return (uint64_t)env->CallStaticLongMethod(clz, method);
+            jclass clz = JNI_CACHED_CLASS("android/os/Debug").Get();
+            jmethodID mid = method.Get(clz);
+            if (mid != nullptr)
+                return (uint64_t)env->CallStaticLongMethod(clz, mid);
         }
         return 0;
     }
 
+   public:
+    static uint64_t getNativeHeapAllocatedSize() {
+        return CallStaticLongMethod(
+            JNI_CACHED_STATIC_METHOD("getNativeHeapAllocatedSize", "()J"));
+    }
+
     static uint64_t getNativeHeapFreeSize() {
-        JNIEnv* env = Env();
-        if (env != nullptr) {
-            LocalObject obj;
-            obj.Cast("android/os/Debug");
-            jclass clz = obj;
-            jmethodID method =
-                env->GetStaticMethodID(clz, "getNativeHeapFreeSize", "()J");
-            if (method != NULL)
-                return (uint64_t)env->CallStaticLongMethod(clz, method);
-        }
-        return 0;
+        return CallStaticLongMethod(
+            JNI_CACHED_STATIC_METHOD("getNativeHeapFreeSize", "()J"));
     }
 
     static uint64_t getNativeHeapSize() {
-        JNIEnv* env = Env();
-        if (env != nullptr) {
-            LocalObject obj;
-            obj.Cast("android/os/Debug");
-            jclass clz = obj;
-            jmethodID method =
-                env->GetStaticMethodID(clz, "getNativeHeapSize", "()J");
-            if (method != NULL)
-                return (uint64_t)env->CallStaticLongMethod(clz, method);
-        }
-        return 0;
+        return CallStaticLongMethod(
+            JNI_CACHED_STATIC_METHOD("getNativeHeapSize", "()J"));
     }
 
     static uint64_t getPss() {
-        JNIEnv* env = Env();
-        if (env != nullptr) {
-            LocalObject obj;
-            obj.Cast("android/os/Debug");
-            jclass clz = obj;
-            jmethodID method = env->GetStaticMethodID(clz, "getPss", "()J");
-            if (method != NULL)
-                return (uint64_t)env->CallStaticLongMethod(clz, method);
-        }
-        return 0;
+        return CallStaticLongMethod(
+            JNI_CACHED_STATIC_METHOD("getPss", "()J"));
     }
 };  // class Debug
 
 class Build {
     static constexpr const char class_name[] = "android/os/Build";
+    static constexpr const char string_sig[] = "Ljava/lang/String;";
+    static ClassRef& Class() { return JNI_CACHED_CLASS(class_name); }
 
    public:
     static jni::String MODEL() {
-        return GetStaticStringField(class_name, "MODEL");
+        return GetStaticStringField(
+            Class(), JNI_CACHED_STATIC_FIELD("MODEL", string_sig));
     }
     static jni::String BRAND() {
-        return GetStaticStringField(class_name, "BRAND");
+        return GetStaticStringField(
+            Class(), JNI_CACHED_STATIC_FIELD("BRAND", string_sig));
     }
     static jni::String PRODUCT() {
-        return GetStaticStringField(class_name, "PRODUCT");
+        return GetStaticStringField(
+            Class(), JNI_CACHED_STATIC_FIELD("PRODUCT", string_sig));
     }
     static jni::String DEVICE() {
-        return GetStaticStringField(class_name, "DEVICE");
+        return GetStaticStringField(
+            Class(), JNI_CACHED_STATIC_FIELD("DEVICE", string_sig));
     }
     static jni::String FINGERPRINT() {
-        return GetStaticStringField(class_name, "FINGERPRINT");
+        return GetStaticStringField(
+            Class(), JNI_CACHED_STATIC_FIELD("FINGERPRINT", string_sig));
     }
     static jni::String SOC_MODEL() {
-        return GetStaticStringField(class_name, "SOC_MODEL");
+        return GetStaticStringField(
+            Class(), JNI_CACHED_STATIC_FIELD("SOC_MODEL", string_sig));
     }
     static jni::String SOC_MANUFACTURER() {
-        return GetStaticStringField(class_name, "SOC_MANUFACTURER");
+        return GetStaticStringField(
+            Class(), JNI_CACHED_STATIC_FIELD("SOC_MANUFACTURER", string_sig));
     }
 };  // Class Build
 
@@ -597,10 +620,9 @@ class Process {
     static int myPid() {
         JNIEnv* env = Env();
         if (env != nullptr) {
-            LocalObject obj;
-            obj.Cast("android/os/Process");
-            jclass clz = obj;
-            jmethodID method = env->GetStaticMethodID(clz, "myPid", "()I");
+            jclass clz = JNI_CACHED_CLASS("android/os/Process").Get();
+            jmethodID method =
+                JNI_CACHED_STATIC_METHOD("myPid", "()I").Get(clz);
             if (method != NULL)
                 return (uint64_t)env->CallStaticIntMethod(clz, method);
         }
@@ -615,16 +637,21 @@ class BatteryManager : java::Object {
     static constexpr const char* EXTRA_PLUGGED = "plugged";
     static constexpr const int BATTERY_PROPERTY_CHARGE_COUNTER = 1;
     BatteryManager(java::Object&& o) : java::Object(std::move(o)) {}
-    int getIntProperty(int id) { return CallIIMethod("getIntProperty", id); }
+    int getIntProperty(int id) {
+        return CallIIMethod(JNI_CACHED_METHOD("getIntProperty", "(I)I"), id);
+    }
 };
 
 class PowerManager : java::Object {
    public:
     PowerManager(java::Object&& o) : java::Object(std::move(o)) {}
     int getCurrentThermalStatus() {
-        return CallVIMethod("getCurrentThermalStatus");
+        return CallVIMethod(
+            JNI_CACHED_METHOD("getCurrentThermalStatus", "()I"));
+    }
+    bool isPowerSaveMode() {
+        return CallVZMethod(JNI_CACHED_METHOD("isPowerSaveMode", "()Z"));
     }
-    bool isPowerSaveMode() { return CallVZMethod("isPowerSaveMode"); }
 };
 
 }  // namespace os
@@ -636,7 +663,8 @@ class ConnectivityManager : java::Object {
     ConnectivityManager(java::Object&& o) : java::Object(std::move(o)) {}
     // NB This requires Manifest.permission.ACCESS_NETWORK_STATE.
     bool isActiveNetworkMetered() {
-        return CallVZMethod("isActiveNetworkMetered");
+        return CallVZMethod(
+            JNI_CACHED_METHOD("isActiveNetworkMetered", "()Z"));
     }
 };
 
@@ -648,30 +676,47 @@ class MemoryInfo : public java::Object {
    public:
     MemoryInfo(java::Object&& o) : java::Object(std::move(o)) {}
     MemoryInfo()
-        : java::Object("android/app/ActivityManager$MemoryInfo", "()V") {}
-    int64_t threshold() const { return obj_.GetLongField("threshold"); }
-    int64_t availMem() const { return obj_.GetLongField("availMem"); }
-    bool lowMemory() const { return obj_.GetBooleanField("lowMemory"); }
-    int64_t totalMem() const { return obj_.GetLongField("totalMem"); }
+        : java::Object(
+              JNI_CACHED_CLASS("android/app/ActivityManager$MemoryInfo"),
+              JNI_CACHED_METHOD("<init>", "()V")) {}
+    int64_t threshold() const {
+        return obj_.GetLongField(JNI_CACHED_FIELD("threshold", "J"));
+    }
+    int64_t availMem() const {
+        return obj_.GetLongField(JNI_CACHED_FIELD("availMem", "J"));
+    }
+    bool lowMemory() const {
+        return obj_.GetBooleanField(JNI_CACHED_FIELD("lowMemory", "Z"));
+    }
+    int64_t totalMem() const {
+        return obj_.GetLongField(JNI_CACHED_FIELD("totalMem", "J"));
+    }
 };
 
 class ActivityManager : public java::Object {
    public:
     ActivityManager(java::Object&& o) : java::Object(std::move(o)) {}
     void getMemoryInfo(MemoryInfo& memoryInfo) {
-        CallOVMethod("getMemoryInfo", "android/app/ActivityManager$MemoryInfo",
-                     memoryInfo);
+        CallOVMethod(
+            JNI_CACHED_METHOD("getMemoryInfo",
+                              "(Landroid/app/ActivityManager$MemoryInfo;)V"),
+            memoryInfo);
+    }
+    int32_t getMemoryClass() {
+        return CallVIMethod(JNI_CACHED_METHOD("getMemoryClass", "()I"));
     }
-    int32_t getMemoryClass() { return CallVIMethod("getMemoryClass"); }
     int32_t getLargeMemoryClass() {
-        return CallVIMethod("getLargeMemoryClass");
+        return CallVIMethod(JNI_CACHED_METHOD("getLargeMemoryClass", "()I"));
+    }
+    bool isLowRamDevice() {
+        return CallVZMethod(JNI_CACHED_METHOD("isLowRamDevice", "()Z"));
     }
-    bool isLowRamDevice() { return CallVZMethod("isLowRamDevice"); }
     java::util::List getHistoricalProcessExitReasons(std::string& packageName,
                                                      int pid, int maxNum) {
-        return CallSIIOMethod("getHistoricalProcessExitReasons",
-                              packageName.c_str(), pid, maxNum,
-                              "java/util/List");
+        return CallSIIOMethod(
+            JNI_CACHED_METHOD("getHistoricalProcessExitReasons",
+                              "(Ljava/lang/String;II)Ljava/util/List;"),
+            packageName.c_str(), pid, maxNum);
     }
 };
 
@@ -679,7 +724,9 @@ class ApplicationExitInfo : java::Object {
    public:
     static constexpr int REASON_LOW_MEMORY = 3;
     ApplicationExitInfo(java::Object&& o) : java::Object(std::move(o)) {}
-    int getReason() { return CallVIMethod("getReason"); }
+    int getReason() {
+        return CallVIMethod(JNI_CACHED_METHOD("getReason", "()I"));
+    }
 };
 
 }  // namespace app
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "allocation_counter.h"
+
+#include <stdlib.h>
+
+#include <new>
+
+// Heap allocations made by the current thread while sCountAllocations is set.
+static thread_local bool sCountAllocations = false;
+static thread_local int sAllocations = 0;
+
+void* operator new(size_t size) {
+    if (sCountAllocations) sAllocations++;
+    if (void* p = malloc(size)) return p;
+    abort();
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+void StartCountingAllocations() {
+    sAllocations = 0;
+    sCountAllocations = true;
+}
+
+int StopCountingAllocations() {
+    sCountAllocations = false;
+    return sAllocations;
+}
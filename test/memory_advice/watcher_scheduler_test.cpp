@@ -0,0 +1,141 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core/watcher_scheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+namespace watcher_scheduler_test {
+
+using namespace memory_advice;
+using namespace std::chrono;
+
+struct Calls {
+    std::atomic<int> count{0};
+    std::atomic<int> samples_seen{0};
+};
+
+// Counts the samples taken and reports memory as critical.
+struct Sampler {
+    std::atomic<int> count{0};
+    WatcherScheduler::SampleFunction Function() {
+        return [this]() {
+            ++count;
+            return MEMORYADVICE_STATE_CRITICAL;
+        };
+    }
+};
+
+static Sampler* s_sampler;
+
+static void Callback(MemoryAdvice_MemoryState state, void* user_data) {
+    Calls* calls = static_cast<Calls*>(user_data);
+    calls->samples_seen = s_sampler->count.load();
+    ++calls->count;
+}
+
+static void OtherCallback(MemoryAdvice_MemoryState state, void* user_data) {
+    Callback(state, user_data);
+}
+
+static bool WaitForCount(const std::atomic<int>& counter, int count,
+                         milliseconds timeout = seconds(5)) {
+    auto end = steady_clock::now() + timeout;
+    while (counter < count) {
+        if (steady_clock::now() > end) return false;
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    return true;
+}
+
+static bool WaitForCalls(const Calls& calls, int count) {
+    return WaitForCount(calls.count, count);
+}
+
+class WatcherSchedulerTest : public ::testing::Test {
+   protected:
+    void SetUp() override { s_sampler = &sampler_; }
+    Sampler sampler_;
+};
+
+TEST_F(WatcherSchedulerTest, CancelsWithoutWaitingForTheInterval) {
+    Calls calls;
+    auto start = steady_clock::now();
+    {
+        WatcherScheduler scheduler(sampler_.Function());
+        scheduler.Add(Callback, &calls, 60 * 1000);
+        std::this_thread::sleep_for(milliseconds(10));
+        EXPECT_EQ(scheduler.Remove(Callback), 1);
+        EXPECT_EQ(scheduler.Remove(Callback), 0);
+        scheduler.Add(Callback, &calls, 60 * 1000);
+    }
+    // Both removing and stopping the thread interrupt its wait.
+    EXPECT_LT(steady_clock::now() - start, milliseconds(500));
+    EXPECT_EQ(calls.count, 0);
+    EXPECT_EQ(sampler_.count, 0);
+}
+
+TEST_F(WatcherSchedulerTest, NoCallbacksAfterRemove) {
+    Calls calls;
+    WatcherScheduler scheduler(sampler_.Function());
+    scheduler.Add(Callback, &calls, 10);
+    ASSERT_TRUE(WaitForCalls(calls, 2));
+    EXPECT_EQ(scheduler.Remove(Callback), 1);
+    int count = calls.count;
+    std::this_thread::sleep_for(milliseconds(50));
+    // A callback that already had its sample may still be in progress.
+    EXPECT_LE(calls.count - count, 1);
+}
+
+TEST_F(WatcherSchedulerTest, SharesSamplesBetweenWatchersDueTogether) {
+    Calls first, second;
+    WatcherScheduler scheduler(sampler_.Function(), milliseconds(100));
+    scheduler.Add(Callback, &first, 200);
+    scheduler.Add(OtherCallback, &second, 250);
+    ASSERT_TRUE(WaitForCalls(first, 1));
+    ASSERT_TRUE(WaitForCalls(second, 1));
+    // The second watcher ran early with the first one's sample.
+    EXPECT_EQ(sampler_.count, 1);
+    EXPECT_EQ(first.samples_seen, 1);
+    EXPECT_EQ(second.samples_seen, 1);
+}
+
+TEST_F(WatcherSchedulerTest, SamplesSeparatelyOutsideTheTolerance) {
+    Calls first, second;
+    WatcherScheduler scheduler(sampler_.Function(), milliseconds(10));
+    scheduler.Add(Callback, &first, 100);
+    scheduler.Add(OtherCallback, &second, 250);
+    ASSERT_TRUE(WaitForCalls(second, 1));
+    // Samples at 100ms and 200ms for the first watcher, then its own.
+    EXPECT_EQ(second.samples_seen, 3);
+}
+
+TEST_F(WatcherSchedulerTest, NoCallbacksWhenMemoryIsOk) {
+    std::atomic<int> samples{0};
+    Calls calls;
+    WatcherScheduler scheduler([&samples]() {
+        ++samples;
+        return MEMORYADVICE_STATE_OK;
+    });
+    scheduler.Add(Callback, &calls, 10);
+    ASSERT_TRUE(WaitForCount(samples, 3));
+    EXPECT_EQ(calls.count, 0);
+}
+
+}  // namespace watcher_scheduler_test
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/ChoreographerFilter.h"
+
+#include <algorithm>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "common/Settings.h"
+#include "gtest/gtest.h"
+
+using namespace swappy;
+using namespace std::chrono_literals;
+using std::chrono::nanoseconds;
+using TimePoint = std::chrono::steady_clock::time_point;
+
+namespace choreographer_filter_test {
+
+constexpr nanoseconds kPeriod = 16666667ns;
+// Callbacks are late by up to twice this.
+constexpr nanoseconds kMeanDelay = 1ms;
+
+struct Result {
+    int vsyncs;
+    int wakes;
+    // How far wakes were from the mean callback time, after warming up.
+    nanoseconds medianError;
+    nanoseconds p90Error;
+};
+
+// Runs a filter for about two seconds, feeding it callbacks late by up to
+// 2 * kMeanDelay, with one in ten missing, and records when it does its work.
+static Result RunFilter(bool singleThread) {
+    Settings::getInstance()->setUseAffinity(false);
+    Settings::getInstance()->setUseSingleFilterThread(singleThread);
+
+    std::mutex mutex;
+    std::vector<TimePoint> wakes;
+    const int vsyncs = 120;
+    const TimePoint start = std::chrono::steady_clock::now() + 10ms;
+    {
+        ChoreographerFilter filter(kPeriod, 0ns, [&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            wakes.push_back(std::chrono::steady_clock::now());
+            return 0ns;
+        });
+
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<int64_t> delay(0,
+                                                     2 * kMeanDelay.count());
+        std::uniform_int_distribution<int> chance(0, 9);
+        for (int vsync = 0; vsync < vsyncs; ++vsync) {
+            std::this_thread::sleep_until(start + vsync * kPeriod +
+                                          nanoseconds(delay(rng)));
+            if (chance(rng) != 0) filter.onChoreographer();
+        }
+        std::this_thread::sleep_until(start + vsyncs * kPeriod);
+    }
+    Settings::reset();
+
+    std::vector<nanoseconds> errors;
+    for (const TimePoint wake : wakes) {
+        if (wake < start + 30 * kPeriod) continue;
+        const nanoseconds phase = (wake - start - kMeanDelay) % kPeriod;
+        const nanoseconds distance = std::chrono::abs(phase);
+        errors.push_back(std::min(distance, kPeriod - distance));
+    }
+    Result result = {vsyncs, static_cast<int>(wakes.size()), 0ns, 0ns};
+    if (!errors.empty()) {
+        std::sort(errors.begin(), errors.end());
+        result.medianError = errors[errors.size() / 2];
+        result.p90Error = errors[errors.size() * 9 / 10];
+    }
+    return result;
+}
+
+TEST(ChoreographerFilterTest, SingleThreadWakesNearVsync) {
+    const Result result = RunFilter(true);
+    // Once per vsync, though the first few callbacks only start the model.
+    EXPECT_GE(result.wakes, result.vsyncs - 10);
+    EXPECT_LE(result.wakes, result.vsyncs + 2);
+    // These are wall clock times, so they are loose: on a busy device or
+    // under a sanitizer the feeder and filter threads can both be scheduled
+    // late.
+    EXPECT_LT(result.medianError, kPeriod / 8);
+    EXPECT_LT(result.p90Error, kPeriod / 4);
+}
+
+TEST(ChoreographerFilterTest, TwoThreadsStillWork) {
+    const Result result = RunFilter(false);
+    EXPECT_GE(result.wakes, result.vsyncs / 2);
+    EXPECT_LE(result.wakes, result.vsyncs + 2);
+}
+
+}  // namespace choreographer_filter_test
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/ExtendedFrameStatistics.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+using namespace swappy;
+using namespace std::chrono_literals;
+using std::chrono::nanoseconds;
+
+namespace extended_frame_statistics_test {
+
+static uint64_t Total(const SwappyDurationHistogram& histogram) {
+    uint64_t total = 0;
+    for (uint64_t count : histogram.counts) total += count;
+    return total;
+}
+
+TEST(ExtendedFrameStatisticsTest, Empty) {
+    ExtendedFrameStatistics statistics;
+    SwappyExtendedStats stats;
+    statistics.get(&stats);
+    EXPECT_EQ(stats.totalFrames, 0);
+    EXPECT_EQ(stats.config.bucketWidthMicros,
+              ExtendedFrameStatistics::DEFAULT_BUCKET_WIDTH_MICROS);
+    EXPECT_EQ(stats.config.bucketCount,
+              ExtendedFrameStatistics::DEFAULT_BUCKET_COUNT);
+    EXPECT_EQ(Total(stats.latency), 0);
+    EXPECT_EQ(stats.latency.p50Nanos, 0);
+    EXPECT_EQ(stats.latency.p99Nanos, 0);
+}
+
+TEST(ExtendedFrameStatisticsTest, SubRefreshPeriodBuckets) {
+    ExtendedFrameStatistics statistics;
+    statistics.setConfig({100, 50});
+    // The first frame has no previous one.
+    statistics.add(250us, 1ms, -1ns, 20ms);
+    statistics.add(2ms, -3ms, 4ms, 25ms);
+
+    SwappyExtendedStats stats;
+    statistics.get(&stats);
+    EXPECT_EQ(stats.totalFrames, 2);
+    EXPECT_EQ(stats.idle.counts[2], 1);
+    EXPECT_EQ(stats.idle.counts[20], 1);
+    // Early presents count as on time.
+    EXPECT_EQ(stats.late.counts[0], 1);
+    EXPECT_EQ(stats.late.counts[10], 1);
+    EXPECT_EQ(Total(stats.offsetFromPreviousFrame), 1);
+    EXPECT_EQ(stats.offsetFromPreviousFrame.counts[40], 1);
+    // Anything past the last bucket goes in it.
+    EXPECT_EQ(stats.latency.counts[49], 2);
+    EXPECT_EQ(stats.latency.p50Nanos, 4900000);
+    // Buckets past the configured count are left empty.
+    EXPECT_EQ(stats.latency.counts[50], 0);
+}
+
+TEST(ExtendedFrameStatisticsTest, Percentiles) {
+    ExtendedFrameStatistics statistics;
+    statistics.setConfig({1000, 100});
+    for (int i = 0; i < 1000; ++i) {
+        // 1ms to 10ms, evenly, with one frame in 100 at 50ms.
+        const nanoseconds latency =
+            i % 100 == 99 ? 50ms : 1ms + nanoseconds(i % 100) * 90000;
+        statistics.add(0ns, 0ns, 16ms, latency);
+    }
+
+    SwappyExtendedStats stats;
+    statistics.get(&stats);
+    EXPECT_EQ(stats.latency.p50Nanos, 5500000);
+    EXPECT_EQ(stats.latency.p95Nanos, 9500000);
+    EXPECT_EQ(stats.latency.p99Nanos, 9500000);
+    EXPECT_EQ(stats.offsetFromPreviousFrame.p50Nanos, 16500000);
+
+    statistics.add(0ns, 0ns, 16ms, 50ms);
+    statistics.get(&stats);
+    EXPECT_EQ(stats.latency.p99Nanos, 50500000);
+}
+
+TEST(ExtendedFrameStatisticsTest, ConfigClearsAndClamps) {
+    ExtendedFrameStatistics statistics;
+    statistics.add(1ms, 1ms, 1ms, 1ms);
+    statistics.setConfig({0, 1000});
+
+    SwappyExtendedStats stats;
+    statistics.get(&stats);
+    EXPECT_EQ(stats.totalFrames, 0);
+    EXPECT_EQ(stats.config.bucketWidthMicros, 1);
+    EXPECT_EQ(stats.config.bucketCount, SWAPPY_EXTENDED_STATS_MAX_BUCKETS);
+
+    statistics.add(1ms, 1ms, 1ms, 1ms);
+    statistics.clear();
+    statistics.get(&stats);
+    EXPECT_EQ(stats.totalFrames, 0);
+    EXPECT_EQ(Total(stats.idle), 0);
+}
+
+TEST(ExtendedFrameStatisticsTest, ReadsAreConsistentWhileWriting) {
+    // Every frame adds to all four histograms, so a read that saw only part
+    // of a frame would have counts that don't add up to the total.
+    auto statistics = std::make_unique<ExtendedFrameStatistics>();
+    std::atomic<bool> done = {false};
+    std::thread writer([&]() {
+        for (int i = 0; i < 200000; ++i) {
+            const nanoseconds time = nanoseconds(i % 30) * 1000000;
+            statistics->add(time, time, time, time);
+            if (i % 50000 == 49999) {
+                statistics->setConfig({250u + i % 7, 64});
+            }
+        }
+        done = true;
+    });
+
+    SwappyExtendedStats stats;
+    int reads = 0;
+    int inconsistentReads = 0;
+    while (!done) {
+        statistics->get(&stats);
+        if (Total(stats.idle) != stats.totalFrames ||
+            Total(stats.late) != stats.totalFrames ||
+            Total(stats.offsetFromPreviousFrame) != stats.totalFrames ||
+            Total(stats.latency) != stats.totalFrames) {
+            inconsistentReads++;
+        }
+        reads++;
+    }
+    writer.join();
+    EXPECT_GT(reads, 0);
+    EXPECT_EQ(inconsistentReads, 0);
+}
+
+}  // namespace extended_frame_statistics_test
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "opengl/EGL.h"
+
+using namespace swappy;
+using namespace std::chrono_literals;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+namespace fence_waiter_test {
+
+// A fake GPU that signals fences, numbered from 1 in order of creation, when
+// the test tells it to.
+struct FakeGpu {
+    std::mutex mutex;
+    std::condition_variable condition;
+    intptr_t created = 0;
+    intptr_t signalled = 0;
+    intptr_t destroyed = 0;
+};
+static FakeGpu sGpu;
+
+static intptr_t FenceNumber(EGLSyncKHR sync) {
+    return reinterpret_cast<intptr_t>(sync);
+}
+
+static void Signal(intptr_t fence) {
+    std::lock_guard<std::mutex> lock(sGpu.mutex);
+    sGpu.signalled = fence;
+    sGpu.condition.notify_all();
+}
+
+static EGLBoolean SwapBuffers(EGLDisplay, EGLSurface) { return EGL_TRUE; }
+
+static EGLBoolean PresentationTime(EGLDisplay, EGLSurface, EGLnsecsANDROID) {
+    return EGL_TRUE;
+}
+
+static EGLSyncKHR CreateSync(EGLDisplay, EGLenum, const EGLint*) {
+    std::lock_guard<std::mutex> lock(sGpu.mutex);
+    return reinterpret_cast<EGLSyncKHR>(++sGpu.created);
+}
+
+static EGLBoolean DestroySync(EGLDisplay, EGLSyncKHR sync) {
+    std::lock_guard<std::mutex> lock(sGpu.mutex);
+    // Fences are waited for in order.
+    EXPECT_EQ(FenceNumber(sync), sGpu.destroyed + 1);
+    sGpu.destroyed++;
+    return EGL_TRUE;
+}
+
+static EGLBoolean GetSyncAttrib(EGLDisplay, EGLSyncKHR sync, EGLint attribute,
+                                EGLint* value) {
+    std::lock_guard<std::mutex> lock(sGpu.mutex);
+    EXPECT_EQ(attribute, EGL_SYNC_STATUS_KHR);
+    EXPECT_GT(FenceNumber(sync), sGpu.destroyed);
+    *value = FenceNumber(sync) <= sGpu.signalled ? EGL_SIGNALED_KHR
+                                                 : EGL_UNSIGNALED_KHR;
+    return EGL_TRUE;
+}
+
+static EGLBoolean ClientWaitSync(EGLDisplay, EGLSyncKHR sync, EGLint,
+                                 EGLTimeKHR timeout) {
+    std::unique_lock<std::mutex> lock(sGpu.mutex);
+    EXPECT_GT(FenceNumber(sync), sGpu.destroyed);
+    const bool signalled =
+        sGpu.condition.wait_for(lock, nanoseconds(timeout), [sync]() {
+            return FenceNumber(sync) <= sGpu.signalled;
+        });
+    return signalled ? EGL_CONDITION_SATISFIED_KHR : EGL_TIMEOUT_EXPIRED_KHR;
+}
+
+static EGLint GetError() { return EGL_SUCCESS; }
+
+static EGLBoolean SurfaceAttrib(EGLDisplay, EGLSurface, EGLint, EGLint) {
+    return EGL_TRUE;
+}
+
+using Proc = void (*)();
+
+static Proc GetProcAddress(const char* name) {
+    static const struct {
+        const char* name;
+        Proc proc;
+    } kProcs[] = {
+        {"eglSwapBuffers", reinterpret_cast<Proc>(SwapBuffers)},
+        {"eglPresentationTimeANDROID",
+         reinterpret_cast<Proc>(PresentationTime)},
+        {"eglCreateSyncKHR", reinterpret_cast<Proc>(CreateSync)},
+        {"eglDestroySyncKHR", reinterpret_cast<Proc>(DestroySync)},
+        {"eglGetSyncAttribKHR", reinterpret_cast<Proc>(GetSyncAttrib)},
+        {"eglClientWaitSyncKHR", reinterpret_cast<Proc>(ClientWaitSync)},
+        {"eglGetError", reinterpret_cast<Proc>(GetError)},
+        {"eglSurfaceAttrib", reinterpret_cast<Proc>(SurfaceAttrib)},
+    };
+    for (const auto& proc : kProcs) {
+        if (strcmp(name, proc.name) == 0) return proc.proc;
+    }
+    return nullptr;
+}
+
+static std::unique_ptr<EGL> CreateEgl(nanoseconds fenceTimeout) {
+    {
+        std::lock_guard<std::mutex> lock(sGpu.mutex);
+        sGpu.created = 0;
+        sGpu.signalled = 0;
+        sGpu.destroyed = 0;
+    }
+    // Not under sGpu.mutex: EGL takes its own locks, which are held when the
+    // fake EGL functions take sGpu.mutex.
+    return EGL::create(fenceTimeout, GetProcAddress);
+}
+
+// Waits for the fence waiter to catch up with the fake GPU.
+static void WaitForFencesDestroyed(intptr_t count) {
+    const auto deadline = steady_clock::now() + 5s;
+    while (steady_clock::now() < deadline) {
+        {
+            std::lock_guard<std::mutex> lock(sGpu.mutex);
+            if (sGpu.destroyed >= count) return;
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+}
+
+TEST(FenceWaiterTest, NeverBlocksBelowDepth) {
+    for (int depth = 1; depth <= 4; ++depth) {
+        auto egl = CreateEgl(10s);
+        ASSERT_NE(egl, nullptr);
+        egl->setMaxFencesInFlight(depth);
+        EXPECT_EQ(egl->getMaxFencesInFlight(), depth);
+
+        // The GPU is stalled, so blocking would take the whole fence timeout.
+        for (int i = 0; i < depth; ++i) {
+            const auto start = steady_clock::now();
+            egl->resetSyncFence(EGL_NO_DISPLAY);
+            EXPECT_LT(steady_clock::now() - start, 1s) << "depth " << depth;
+        }
+        EXPECT_FALSE(egl->lastFrameIsComplete(EGL_NO_DISPLAY));
+
+        // One more fence has to wait for the GPU to finish the oldest.
+        std::atomic<bool> created = {false};
+        std::thread app([&]() {
+            egl->resetSyncFence(EGL_NO_DISPLAY);
+            created = true;
+        });
+        std::this_thread::sleep_for(50ms);
+        EXPECT_FALSE(created) << "depth " << depth;
+        Signal(1);
+        app.join();
+        EXPECT_TRUE(created);
+
+        Signal(depth + 1);
+        WaitForFencesDestroyed(depth + 1);
+        EXPECT_TRUE(egl->lastFrameIsComplete(EGL_NO_DISPLAY));
+    }
+}
+
+TEST(FenceWaiterTest, DepthIsClamped) {
+    auto egl = CreateEgl(50ms);
+    ASSERT_NE(egl, nullptr);
+    EXPECT_EQ(egl->getMaxFencesInFlight(), 2);
+    egl->setMaxFencesInFlight(0);
+    EXPECT_EQ(egl->getMaxFencesInFlight(), 1);
+    egl->setMaxFencesInFlight(100);
+    EXPECT_EQ(egl->getMaxFencesInFlight(), 4);
+}
+
+TEST(FenceWaiterTest, RaisingDepthUnblocks) {
+    auto egl = CreateEgl(10s);
+    ASSERT_NE(egl, nullptr);
+    egl->setMaxFencesInFlight(1);
+    egl->resetSyncFence(EGL_NO_DISPLAY);
+
+    std::atomic<bool> created = {false};
+    std::thread app([&]() {
+        egl->resetSyncFence(EGL_NO_DISPLAY);
+        created = true;
+    });
+    std::this_thread::sleep_for(50ms);
+    EXPECT_FALSE(created);
+    egl->setMaxFencesInFlight(2);
+    app.join();
+    EXPECT_TRUE(created);
+
+    Signal(2);
+    WaitForFencesDestroyed(2);
+}
+
+TEST(FenceWaiterTest, DestroysFencesThatTimeOut) {
+    auto egl = CreateEgl(1ms);
+    ASSERT_NE(egl, nullptr);
+    // The GPU never signals, so each fence is given up on after the timeout.
+    for (int i = 0; i < 20; ++i) egl->resetSyncFence(EGL_NO_DISPLAY);
+    WaitForFencesDestroyed(20);
+    EXPECT_TRUE(egl->lastFrameIsComplete(EGL_NO_DISPLAY));
+    std::lock_guard<std::mutex> lock(sGpu.mutex);
+    EXPECT_EQ(sGpu.destroyed, 20);
+}
+
+TEST(FenceWaiterTest, DestroysPendingFencesOnDestruction) {
+    auto egl = CreateEgl(50ms);
+    ASSERT_NE(egl, nullptr);
+    // The GPU never signals, so these are still pending when EGL goes away.
+    egl->resetSyncFence(EGL_NO_DISPLAY);
+    egl->resetSyncFence(EGL_NO_DISPLAY);
+    egl.reset();
+    std::lock_guard<std::mutex> lock(sGpu.mutex);
+    EXPECT_EQ(sGpu.destroyed, 2);
+}
+
+TEST(FenceWaiterTest, GpuTimeExcludesWaitForPreviousFrame) {
+    auto egl = CreateEgl(10s);
+    ASSERT_NE(egl, nullptr);
+    egl->resetSyncFence(EGL_NO_DISPLAY);
+    egl->resetSyncFence(EGL_NO_DISPLAY);
+
+    std::this_thread::sleep_for(100ms);
+    Signal(1);
+    WaitForFencesDestroyed(1);
+    EXPECT_GE(egl->getFencePendingTime(), 100ms);
+
+    // The second frame was submitted at the same time, but the GPU only
+    // started on it once it had finished the first.
+    std::this_thread::sleep_for(20ms);
+    Signal(2);
+    WaitForFencesDestroyed(2);
+    EXPECT_GE(egl->getFencePendingTime(), 20ms);
+    EXPECT_LT(egl->getFencePendingTime(), 100ms);
+}
+
+}  // namespace fence_waiter_test
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host benchmark of the per-frame cost of FrameDurations::add, compared with
+// the std::deque based version it replaced, and of reading the percentiles that
+// only FrameDurations keeps. Both versions must agree on the mean frame time
+// and missed frame percentage. Heap allocations on the frame path are counted
+// too.
+//
+// Usage: frame_durations_benchmark [frames]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <new>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "common/FrameDurations.h"
+
+using namespace std::chrono_literals;
+using std::chrono::nanoseconds;
+using swappy::FrameDuration;
+using swappy::FrameDurations;
+using TimePoint = std::chrono::steady_clock::time_point;
+
+static size_t sAllocations = 0;
+
+void* operator new(size_t size) {
+    sAllocations++;
+    if (void* p = malloc(size)) return p;
+    abort();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+namespace {
+
+// FrameDurations as it was before it moved to a ring buffer.
+class DequeFrameDurations {
+   public:
+    void add(TimePoint now, FrameDuration frameDuration) {
+        mFrames.push_back({now, frameDuration});
+        mFrameDurationsSum += frameDuration;
+        if (frameDuration.frameMiss()) {
+            mMissedFrameCount++;
+        }
+
+        while (mFrames.size() >= 2 &&
+               now - (mFrames.begin() + 1)->first > 2s) {
+            mFrameDurationsSum -= mFrames.front().second;
+            if (mFrames.front().second.frameMiss()) {
+                mMissedFrameCount--;
+            }
+            mFrames.pop_front();
+        }
+    }
+
+    FrameDuration getAverageFrameTime() const {
+        return mFrameDurationsSum / mFrames.size();
+    }
+
+    int getMissedFramePercent() const {
+        return round(mMissedFrameCount * 100.0f / mFrames.size());
+    }
+
+   private:
+    std::deque<std::pair<TimePoint, FrameDuration>> mFrames;
+    FrameDuration mFrameDurationsSum = {};
+    int mMissedFrameCount = 0;
+};
+
+struct Result {
+    double nsPerFrame;
+    size_t allocations;
+    FrameDuration average;
+    int missedPercent;
+};
+
+template <typename T>
+Result Run(T& durations, const std::vector<FrameDuration>& frames,
+           nanoseconds period) {
+    TimePoint time;
+    // Fill the window first, so that frames are dropped as they are added.
+    for (int i = 0; i < 1000; ++i, time += period) {
+        durations.add(time, frames[i % frames.size()]);
+    }
+    const size_t allocations = sAllocations;
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto& frame : frames) {
+        durations.add(time, frame);
+        time += period;
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return {static_cast<double>((end - start).count()) / frames.size(),
+            sAllocations - allocations, durations.getAverageFrameTime(),
+            durations.getMissedFramePercent()};
+}
+
+// Returns the time per getPercentiles call in ns. Swappy only reads them when
+// logging frame statistics, not every frame.
+double TimePercentiles(const FrameDurations& durations, int reads,
+                       SwappyFrameDurationPercentiles& percentiles) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reads; ++i) durations.getPercentiles(&percentiles);
+    const auto end = std::chrono::steady_clock::now();
+    return static_cast<double>((end - start).count()) / reads;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int count = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    std::mt19937 rng(1);
+    std::lognormal_distribution<double> cpu(15.5, 0.3);
+    std::lognormal_distribution<double> gpu(15.8, 0.4);
+    std::vector<FrameDuration> frames;
+    frames.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        frames.push_back({nanoseconds(static_cast<int64_t>(cpu(rng))),
+                          nanoseconds(static_cast<int64_t>(gpu(rng))),
+                          i % 17 == 0});
+    }
+
+    int status = 0;
+    for (int hz : {60, 120, 240}) {
+        const nanoseconds period = nanoseconds(1s) / hz;
+        DequeFrameDurations deque;
+        const Result before = Run(deque, frames, period);
+        FrameDurations ring;
+        const Result after = Run(ring, frames, period);
+
+        SwappyFrameDurationPercentiles percentiles;
+        const double readNs = TimePercentiles(ring, 100000, percentiles);
+        printf("%3d Hz: add: deque %6.1f ns/frame, %zu allocations; ring "
+               "%6.1f ns/frame, %zu allocations\n",
+               hz, before.nsPerFrame, before.allocations, after.nsPerFrame,
+               after.allocations);
+        printf("        getPercentiles: ring %6.1f ns/read\n", readNs);
+        printf("        cpu p50 %.2f ms p95 %.2f ms, gpu p50 %.2f ms p95 "
+               "%.2f ms over %d frames\n",
+               percentiles.cpuTimeP50Nanos / 1e6,
+               percentiles.cpuTimeP95Nanos / 1e6,
+               percentiles.gpuTimeP50Nanos / 1e6,
+               percentiles.gpuTimeP95Nanos / 1e6,
+               static_cast<int>(percentiles.frameCount));
+
+        if (before.average.getCpuTime() != after.average.getCpuTime() ||
+            before.average.getGpuTime() != after.average.getGpuTime() ||
+            before.missedPercent != after.missedPercent) {
+            fprintf(stderr, "Mismatch at %d Hz\n", hz);
+            status = 1;
+        }
+        if (after.allocations != 0) {
+            fprintf(stderr, "FrameDurations allocated at %d Hz\n", hz);
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/FrameDurations.h"
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace swappy;
+using namespace std::chrono_literals;
+using std::chrono::nanoseconds;
+
+namespace frame_durations_test {
+
+// The exact percentile, rounded to the middle of its histogram bucket.
+static nanoseconds Expected(std::vector<nanoseconds> values, int percent) {
+    std::sort(values.begin(), values.end());
+    const int rank = std::max<int>(1, (values.size() * percent + 99) / 100);
+    const auto width = DurationHistogram::BUCKET_WIDTH;
+    return std::min(values[rank - 1], FrameDuration::MAX_DURATION) / width *
+               width +
+           width / 2;
+}
+
+TEST(FrameDurationsTest, HistogramEmpty) {
+    DurationHistogram histogram;
+    EXPECT_EQ(histogram.getCount(), 0);
+    EXPECT_EQ(histogram.getP50(), 0ns);
+    EXPECT_EQ(histogram.getP95(), 0ns);
+    histogram.add(5ms);
+    histogram.remove(5ms);
+    EXPECT_EQ(histogram.getP95(), 0ns);
+}
+
+TEST(FrameDurationsTest, HistogramMatchesSortedWindow) {
+    std::mt19937 rng(1);
+    std::lognormal_distribution<double> distribution(16, 0.5);
+    DurationHistogram histogram;
+    std::deque<nanoseconds> window;
+    for (int i = 0; i < 5000; ++i) {
+        const nanoseconds value(static_cast<int64_t>(distribution(rng)));
+        histogram.add(value);
+        window.push_back(value);
+        if (window.size() > 120) {
+            histogram.remove(window.front());
+            window.pop_front();
+        }
+        std::vector<nanoseconds> values(window.begin(), window.end());
+        ASSERT_EQ(histogram.getP50(), Expected(values, 50)) << i;
+        ASSERT_EQ(histogram.getP95(), Expected(values, 95)) << i;
+    }
+}
+
+TEST(FrameDurationsTest, HistogramClampsLongDurations) {
+    DurationHistogram histogram;
+    histogram.add(1s);
+    EXPECT_EQ(histogram.getP50(), Expected({1s}, 50));
+    histogram.remove(1s);
+    EXPECT_EQ(histogram.getCount(), 0);
+}
+
+TEST(FrameDurationsTest, WindowSlides) {
+    FrameDurations durations;
+    std::chrono::steady_clock::time_point time;
+    // 1 second of 2ms CPU frames, then 2 seconds of 6ms ones.
+    for (int i = 0; i < 60; ++i, time += 16ms) {
+        durations.add(time, {2ms, 1ms, false});
+    }
+    EXPECT_FALSE(durations.hasEnoughSamples());
+    for (int i = 0; i < 130; ++i, time += 16ms) {
+        durations.add(time, {6ms, 1ms, i % 10 == 0});
+    }
+    // The window keeps the frames of the last 2 seconds, plus the one before:
+    // 127 frames of which 12 were missed.
+    ASSERT_TRUE(durations.hasEnoughSamples());
+    EXPECT_EQ(durations.getAverageFrameTime().getCpuTime(), 6ms);
+    EXPECT_EQ(durations.getMissedFramePercent(), 9);
+
+    SwappyFrameDurationPercentiles percentiles;
+    durations.getPercentiles(&percentiles);
+    EXPECT_EQ(percentiles.frameCount, 127u);
+    EXPECT_EQ(nanoseconds(percentiles.cpuTimeP50Nanos), Expected({6ms}, 50));
+    EXPECT_EQ(nanoseconds(percentiles.gpuTimeP95Nanos), Expected({1ms}, 95));
+
+    durations.clear();
+    durations.getPercentiles(&percentiles);
+    EXPECT_EQ(percentiles.frameCount, 0u);
+    EXPECT_EQ(percentiles.cpuTimeP95Nanos, 0);
+}
+
+TEST(FrameDurationsTest, FullRingHasEnoughSamples) {
+    FrameDurations durations;
+    std::chrono::steady_clock::time_point time;
+    for (int i = 0; i < FrameDurations::CAPACITY + 10; ++i, time += 1ms) {
+        durations.add(time, {i < 10 ? 50ms : 1ms, 1ms, false});
+    }
+    ASSERT_TRUE(durations.hasEnoughSamples());
+    // The first, slow, frames were dropped.
+    EXPECT_EQ(durations.getAverageFrameTime().getCpuTime(), 1ms);
+}
+
+}  // namespace frame_durations_test
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "opengl/FrameStatisticsGL.h"
+
+#include <string.h>
+
+#include "allocation_counter.h"
+#include "common/Settings.h"
+#include "common/SwappyCommon.h"
+#include "gtest/gtest.h"
+
+using namespace swappy;
+using namespace std::chrono_literals;
+
+namespace frame_statistics_gl_test {
+
+constexpr int64_t kPeriod = 16666667;
+// Timestamps for a frame are available this many swaps later.
+constexpr int kTimestampLag = 3;
+
+// A fake EGL with the frame timestamps extension, where frame n is presented
+// at n refresh periods.
+struct FakeEgl {
+    EGLuint64KHR nextFrameId = 1;
+    int timestampQueries = 0;
+    bool wrongNames = false;
+};
+static FakeEgl sFake;
+
+static EGLBoolean SwapBuffers(EGLDisplay, EGLSurface) {
+    sFake.nextFrameId++;
+    return EGL_TRUE;
+}
+
+static EGLBoolean PresentationTime(EGLDisplay, EGLSurface, EGLnsecsANDROID) {
+    return EGL_TRUE;
+}
+
+static EGLSyncKHR CreateSync(EGLDisplay, EGLenum, const EGLint*) {
+    return EGL_NO_SYNC_KHR;
+}
+
+static EGLBoolean DestroySync(EGLDisplay, EGLSyncKHR) { return EGL_TRUE; }
+
+static EGLBoolean GetSyncAttrib(EGLDisplay, EGLSyncKHR, EGLint, EGLint*) {
+    return EGL_FALSE;
+}
+
+static EGLBoolean ClientWaitSync(EGLDisplay, EGLSyncKHR, EGLint, EGLTimeKHR) {
+    return EGL_TRUE;
+}
+
+static EGLint GetError() { return EGL_SUCCESS; }
+
+static EGLBoolean SurfaceAttrib(EGLDisplay, EGLSurface, EGLint, EGLint) {
+    return EGL_TRUE;
+}
+
+static EGLBoolean GetNextFrameId(EGLDisplay, EGLSurface, EGLuint64KHR* id) {
+    *id = sFake.nextFrameId;
+    return EGL_TRUE;
+}
+
+static EGLBoolean GetFrameTimestamps(EGLDisplay, EGLSurface,
+                                     EGLuint64KHR frameId, EGLint count,
+                                     const EGLint* names,
+                                     EGLnsecsANDROID* values) {
+    sFake.timestampQueries++;
+    const EGLint expectedNames[] = {
+        EGL_REQUESTED_PRESENT_TIME_ANDROID,
+        EGL_RENDERING_COMPLETE_TIME_ANDROID,
+        EGL_COMPOSITION_LATCH_TIME_ANDROID,
+        EGL_DISPLAY_PRESENT_TIME_ANDROID,
+    };
+    if (count != 4 || memcmp(names, expectedNames, sizeof(expectedNames))) {
+        sFake.wrongNames = true;
+        return EGL_FALSE;
+    }
+    const bool pending = frameId + kTimestampLag > sFake.nextFrameId;
+    const int64_t present = frameId * kPeriod;
+    values[0] = present;
+    values[1] = present - 8000000;
+    values[2] = present - 6000000;
+    values[3] = pending ? EGL_TIMESTAMP_PENDING_ANDROID : present;
+    return EGL_TRUE;
+}
+
+using Proc = void (*)();
+
+static Proc GetProcAddress(const char* name) {
+    static const struct {
+        const char* name;
+        Proc proc;
+    } kProcs[] = {
+        {"eglSwapBuffers", reinterpret_cast<Proc>(SwapBuffers)},
+        {"eglPresentationTimeANDROID",
+         reinterpret_cast<Proc>(PresentationTime)},
+        {"eglCreateSyncKHR", reinterpret_cast<Proc>(CreateSync)},
+        {"eglDestroySyncKHR", reinterpret_cast<Proc>(DestroySync)},
+        {"eglGetSyncAttribKHR", reinterpret_cast<Proc>(GetSyncAttrib)},
+        {"eglClientWaitSyncKHR", reinterpret_cast<Proc>(ClientWaitSync)},
+        {"eglGetError", reinterpret_cast<Proc>(GetError)},
+        {"eglSurfaceAttrib", reinterpret_cast<Proc>(SurfaceAttrib)},
+        {"eglGetNextFrameIdANDROID", reinterpret_cast<Proc>(GetNextFrameId)},
+        {"eglGetFrameTimestampsANDROID",
+         reinterpret_cast<Proc>(GetFrameTimestamps)},
+    };
+    for (const auto& proc : kProcs) {
+        if (strcmp(name, proc.name) == 0) return proc.proc;
+    }
+    return nullptr;
+}
+
+class SwappyCommonTest : public SwappyCommon {
+   public:
+    SwappyCommonTest()
+        : SwappyCommon(SwappyCommonSettings{
+              {0, 0}, std::chrono::nanoseconds(kPeriod), 0ns, 0ns}) {}
+};
+
+class FrameStatisticsGLTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        sFake = {};
+        Settings::reset();
+        mEgl = EGL::create(50ms, GetProcAddress);
+        ASSERT_NE(mEgl, nullptr);
+        ASSERT_TRUE(mEgl->statsSupported());
+        mCommon = std::make_unique<SwappyCommonTest>();
+        mStats = std::make_unique<FrameStatisticsGL>(*mEgl, *mCommon);
+    }
+
+    void TearDown() override {
+        mStats.reset();
+        mCommon.reset();
+        mEgl.reset();
+    }
+
+    // As SwappyGL_recordFrameStart then SwappyGL_swap would.
+    void Frame() {
+        mStats->capture(EGL_NO_DISPLAY, EGL_NO_SURFACE);
+        mEgl->swapBuffers(EGL_NO_DISPLAY, EGL_NO_SURFACE);
+    }
+
+    std::unique_ptr<EGL> mEgl;
+    std::unique_ptr<SwappyCommonTest> mCommon;
+    std::unique_ptr<FrameStatisticsGL> mStats;
+};
+
+TEST_F(FrameStatisticsGLTest, CountsEachFrameOnce) {
+    mStats->enableStats(true);
+    for (int i = 0; i < 100; ++i) Frame();
+    EXPECT_FALSE(sFake.wrongNames);
+
+    // The last few frames are still waiting for their timestamps.
+    const SwappyStats stats = mStats->getStats();
+    EXPECT_EQ(stats.totalFrames, 100 - kTimestampLag);
+    EXPECT_EQ(stats.offsetFromPreviousFrame[1], stats.totalFrames - 1);
+    SwappyExtendedStats extended;
+    mStats->getExtendedStats(&extended);
+    EXPECT_EQ(extended.totalFrames, stats.totalFrames);
+    EXPECT_EQ(extended.idle.p50Nanos, 2250000);
+}
+
+TEST_F(FrameStatisticsGLTest, DropsFramesThatLagTooFar) {
+    mStats->enableStats(true);
+    for (int i = 0; i < 10; ++i) Frame();
+    // Many frames swapped without stats being captured.
+    sFake.nextFrameId += 100;
+    for (int i = 0; i < 10; ++i) Frame();
+    EXPECT_EQ(mStats->getStats().totalFrames, 20 - 2 * kTimestampLag);
+}
+
+TEST_F(FrameStatisticsGLTest, NoAllocationsInSteadyState) {
+    mStats->enableStats(true);
+    for (int i = 0; i < 50; ++i) Frame();
+
+    const int queries = sFake.timestampQueries;
+    StartCountingAllocations();
+    for (int i = 0; i < 1000; ++i) Frame();
+    const int allocations = StopCountingAllocations();
+
+    EXPECT_GE(sFake.timestampQueries - queries, 1000);
+    EXPECT_EQ(allocations, 0);
+}
+
+}  // namespace frame_statistics_gl_test
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/FrameTimeline.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace swappy;
+
+namespace frame_timeline_test {
+
+// Every field is a function of i so that torn records can be detected.
+static SwappyFrameRecord MakeRecord(int64_t i) {
+    SwappyFrameRecord record = {};
+    record.type = SWAPPY_FRAME_RECORD_FRAME;
+    record.swapInterval = i % 4;
+    record.pipelineMode = i % 2;
+    record.lateFrames = i % 3;
+    record.choreographerTimeNanos = i;
+    record.startFrameTimeNanos = i + 1;
+    record.preWaitTimeNanos = i + 2;
+    record.postWaitTimeNanos = i + 3;
+    record.swapTimeNanos = i + 4;
+    record.cpuTimeNanos = i + 5;
+    record.gpuTimeNanos = i + 6;
+    record.desiredPresentTimeNanos = i + 7;
+    record.actualPresentTimeNanos = i + 8;
+    return record;
+}
+
+static bool IsRecord(const SwappyFrameRecord& record, int64_t i) {
+    SwappyFrameRecord expected = MakeRecord(i);
+    return memcmp(&record, &expected, sizeof(record)) == 0;
+}
+
+TEST(FrameTimelineTest, DisabledRecordsNothing) {
+    FrameTimeline timeline;
+    timeline.record(MakeRecord(0));
+    timeline.setEnabled(true);
+    timeline.setEnabled(false);
+    timeline.record(MakeRecord(1));
+    SwappyFrameRecord records[4];
+    uint64_t dropped = 1;
+    EXPECT_EQ(timeline.drain(records, 4, &dropped), 0);
+    EXPECT_EQ(dropped, 0);
+}
+
+TEST(FrameTimelineTest, DrainsInOrder) {
+    FrameTimeline timeline;
+    timeline.setEnabled(true);
+    for (int i = 0; i < 10; ++i) timeline.record(MakeRecord(i));
+    timeline.recordPresent(1, 2, 3);
+
+    SwappyFrameRecord records[8];
+    EXPECT_EQ(timeline.drain(records, 8, nullptr), 8);
+    for (int i = 0; i < 8; ++i) EXPECT_TRUE(IsRecord(records[i], i));
+    EXPECT_EQ(timeline.drain(records, 8, nullptr), 3);
+    EXPECT_TRUE(IsRecord(records[0], 8));
+    EXPECT_TRUE(IsRecord(records[1], 9));
+    EXPECT_EQ(records[2].type, SWAPPY_FRAME_RECORD_PRESENT);
+    EXPECT_EQ(records[2].startFrameTimeNanos, 1);
+    EXPECT_EQ(records[2].desiredPresentTimeNanos, 2);
+    EXPECT_EQ(records[2].actualPresentTimeNanos, 3);
+    EXPECT_EQ(timeline.drain(records, 8, nullptr), 0);
+}
+
+TEST(FrameTimelineTest, OverwritesOldestWhenFull) {
+    constexpr int kExtra = 100;
+    FrameTimeline timeline;
+    timeline.setEnabled(true);
+    for (int i = 0; i < FrameTimeline::CAPACITY + kExtra; ++i) {
+        timeline.record(MakeRecord(i));
+    }
+    std::vector<SwappyFrameRecord> records(FrameTimeline::CAPACITY);
+    uint64_t dropped = 0;
+    EXPECT_EQ(timeline.drain(records.data(), records.size(), &dropped),
+              FrameTimeline::CAPACITY);
+    EXPECT_EQ(dropped, kExtra);
+    for (int i = 0; i < FrameTimeline::CAPACITY; ++i) {
+        EXPECT_TRUE(IsRecord(records[i], i + kExtra));
+    }
+}
+
+TEST(FrameTimelineTest, ConcurrentDrain) {
+    constexpr int kNumRecords = 200000;
+    FrameTimeline timeline;
+    timeline.setEnabled(true);
+    std::thread writer([&timeline]() {
+        for (int i = 0; i < kNumRecords; ++i) timeline.record(MakeRecord(i));
+    });
+
+    std::vector<SwappyFrameRecord> records(64);
+    uint64_t received = 0;
+    uint64_t lost = 0;
+    int64_t last = -1;
+    while (received + lost < kNumRecords) {
+        uint64_t dropped = 0;
+        int count = timeline.drain(records.data(), records.size(), &dropped);
+        lost += dropped;
+        for (int i = 0; i < count; ++i) {
+            int64_t index = records[i].choreographerTimeNanos;
+            ASSERT_TRUE(IsRecord(records[i], index));
+            ASSERT_GT(index, last);
+            last = index;
+        }
+        received += count;
+    }
+    writer.join();
+    EXPECT_EQ(received + lost, kNumRecords);
+    EXPECT_EQ(last, kNumRecords - 1);
+}
+
+TEST(FrameTimelineTest, DumpFormat) {
+    FrameTimeline timeline;
+    timeline.setEnabled(true);
+    for (int i = 0; i < 3; ++i) timeline.record(MakeRecord(i));
+
+    FILE* file = tmpfile();
+    ASSERT_NE(file, nullptr);
+    EXPECT_EQ(timeline.dump(fileno(file), std::chrono::nanoseconds(16666666)),
+              3);
+    rewind(file);
+    SwappyFrameTimelineHeader header;
+    ASSERT_EQ(fread(&header, sizeof(header), 1, file), 1);
+    EXPECT_EQ(header.magic, SWAPPY_FRAME_TIMELINE_MAGIC);
+    EXPECT_EQ(header.version, SWAPPY_FRAME_TIMELINE_VERSION);
+    EXPECT_EQ(header.recordSize, sizeof(SwappyFrameRecord));
+    EXPECT_EQ(header.refreshPeriodNanos, 16666666);
+    EXPECT_EQ(header.droppedRecords, 0);
+    EXPECT_EQ(header.recordCount, 3);
+    SwappyFrameRecord records[3];
+    ASSERT_EQ(fread(records, sizeof(SwappyFrameRecord), 3, file), 3);
+    for (int i = 0; i < 3; ++i) EXPECT_TRUE(IsRecord(records[i], i));
+    fclose(file);
+}
+
+}  // namespace frame_timeline_test
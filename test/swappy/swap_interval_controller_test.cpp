@@ -0,0 +1,158 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays synthetic traces of frame durations through the swap interval
+// controllers and checks how they score on missed frames, config switches and
+// how quickly they react to load changes.
+
+#include "common/SwapIntervalController.h"
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "swap_interval_replay.h"
+
+using namespace swappy;
+using namespace std::chrono_literals;
+using std::chrono::nanoseconds;
+using namespace swap_interval_replay;
+
+namespace swap_interval_controller_test {
+
+// The number of frames from start until the swap interval is
+// swapInterval, or the number of frames left if it never is.
+int FramesUntilSwapInterval(const Score& score, size_t start,
+                            int32_t swapInterval) {
+    size_t frame = start;
+    while (frame < score.swapIntervals.size() &&
+           score.swapIntervals[frame] != swapInterval) {
+        ++frame;
+    }
+    return static_cast<int>(frame - start);
+}
+
+// A trace of frames with normally distributed GPU times and a light CPU load.
+void AddFrames(std::vector<FrameDuration>* trace, int count, nanoseconds gpu,
+               nanoseconds stddev, std::mt19937* rng) {
+    std::normal_distribution<double> noise(0, stddev.count());
+    for (int i = 0; i < count; ++i) {
+        nanoseconds gpuTime(
+            std::max<int64_t>(0, gpu.count() + noise(*rng)));
+        trace->push_back({4ms, gpuTime, false});
+    }
+}
+
+TEST(SwapIntervalControllerTest, CalculateSwapInterval) {
+    EXPECT_EQ(calculateSwapInterval(0ns, kRefreshPeriod60Hz), 1);
+    EXPECT_EQ(calculateSwapInterval(16ms, kRefreshPeriod60Hz), 1);
+    EXPECT_EQ(calculateSwapInterval(kRefreshPeriod60Hz + 400ns,
+                                    kRefreshPeriod60Hz),
+              1);
+    EXPECT_EQ(calculateSwapInterval(17ms, kRefreshPeriod60Hz), 2);
+    EXPECT_EQ(calculateSwapInterval(40ms, kRefreshPeriod60Hz), 3);
+}
+
+TEST(SwapIntervalControllerTest, LightLoadStaysAt60) {
+    std::mt19937 rng(1);
+    std::vector<FrameDuration> trace;
+    AddFrames(&trace, 600, 6ms, 1ms, &rng);
+    for (auto type : {SWAPPY_SWAP_INTERVAL_CONTROLLER_AVERAGE,
+                      SWAPPY_SWAP_INTERVAL_CONTROLLER_PREDICTIVE}) {
+        Score score = Replay(type, trace);
+        EXPECT_EQ(score.missedFrames, 0) << score;
+        EXPECT_EQ(score.totalSwapIntervals, score.frames) << score;
+    }
+}
+
+TEST(SwapIntervalControllerTest, HeavyLoadSettlesAt30) {
+    std::mt19937 rng(2);
+    std::vector<FrameDuration> trace;
+    AddFrames(&trace, 600, 24ms, 1ms, &rng);
+    for (auto type : {SWAPPY_SWAP_INTERVAL_CONTROLLER_AVERAGE,
+                      SWAPPY_SWAP_INTERVAL_CONTROLLER_PREDICTIVE}) {
+        Score score = Replay(type, trace);
+        EXPECT_LE(score.switches, 2) << score;
+        // Less the frames before the first change.
+        EXPECT_GT(score.totalSwapIntervals, score.frames * 18 / 10) << score;
+    }
+}
+
+TEST(SwapIntervalControllerTest, PredictiveReactsFasterToLoadSpikes) {
+    // Alternate between light frames and bursts of heavy ones.
+    constexpr int kBursts = 5;
+    constexpr int kLightFrames = 300;
+    constexpr int kHeavyFrames = 90;
+    std::mt19937 rng(3);
+    std::vector<FrameDuration> trace;
+    for (int i = 0; i < kBursts; ++i) {
+        AddFrames(&trace, kLightFrames, 8ms, 1ms, &rng);
+        AddFrames(&trace, kHeavyFrames, 24ms, 1ms, &rng);
+    }
+    Score average = Replay(SWAPPY_SWAP_INTERVAL_CONTROLLER_AVERAGE, trace);
+    Score predictive =
+        Replay(SWAPPY_SWAP_INTERVAL_CONTROLLER_PREDICTIVE, trace);
+    EXPECT_LT(predictive.missedFrames, average.missedFrames / 2)
+        << "average: " << average << ", predictive: " << predictive;
+    // The swap interval goes up and back down once per burst. Pipeline mode
+    // changes count as switches too.
+    EXPECT_LE(predictive.switches, 3 * kBursts) << predictive;
+    EXPECT_LE(predictive.switches, average.switches)
+        << "average: " << average << ", predictive: " << predictive;
+    for (int i = 0; i < kBursts; ++i) {
+        const size_t burstStart = i * (kLightFrames + kHeavyFrames) +
+                                  kLightFrames;
+        const int predictiveLatency =
+            FramesUntilSwapInterval(predictive, burstStart, 2);
+        EXPECT_LE(predictiveLatency, 3) << "burst " << i;
+        EXPECT_LT(predictiveLatency,
+                  FramesUntilSwapInterval(average, burstStart, 2))
+            << "burst " << i;
+        // The light frames that follow bring it back to 60Hz.
+        if (i + 1 < kBursts) {
+            EXPECT_LT(FramesUntilSwapInterval(predictive,
+                                              burstStart + kHeavyFrames, 1),
+                      kLightFrames)
+                << "burst " << i;
+        }
+    }
+}
+
+TEST(SwapIntervalControllerTest, PredictiveDoesNotOscillateOnBorderline) {
+    // Load that goes above and below a refresh period every second.
+    std::mt19937 rng(4);
+    std::vector<FrameDuration> trace;
+    for (int i = 0; i < 30; ++i) {
+        AddFrames(&trace, 60, 13500us, 500us, &rng);
+        AddFrames(&trace, 60, 16500us, 500us, &rng);
+    }
+    Score average = Replay(SWAPPY_SWAP_INTERVAL_CONTROLLER_AVERAGE, trace);
+    Score predictive =
+        Replay(SWAPPY_SWAP_INTERVAL_CONTROLLER_PREDICTIVE, trace);
+    EXPECT_LE(predictive.switches, 2) << predictive;
+    EXPECT_LT(predictive.switches, average.switches)
+        << "average: " << average << ", predictive: " << predictive;
+    EXPECT_LT(predictive.missedFrames, average.missedFrames)
+        << "average: " << average << ", predictive: " << predictive;
+    // It settles at 30Hz early in the first heavy second and stays there.
+    const int latency = FramesUntilSwapInterval(predictive, 60, 2);
+    EXPECT_LE(latency, 10);
+    const size_t settled = 60 + latency;
+    EXPECT_EQ(FramesUntilSwapInterval(predictive, settled, 1),
+              static_cast<int>(predictive.swapIntervals.size() - settled));
+}
+
+}  // namespace swap_interval_controller_test
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays traces of frame durations through the swap interval controllers and
+// scores them on missed frames and config switches. Shared by
+// swap_interval_controller_test and the swap_interval_replay tool.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "common/SwapIntervalController.h"
+
+namespace swap_interval_replay {
+
+using namespace std::chrono_literals;
+using std::chrono::nanoseconds;
+using swappy::calculateSwapInterval;
+using swappy::FrameDuration;
+using swappy::PipelineMode;
+using swappy::SwapIntervalController;
+
+constexpr nanoseconds kRefreshPeriod60Hz = 16666667ns;
+
+struct Score {
+    int frames = 0;
+    int missedFrames = 0;
+    int switches = 0;
+    int64_t totalSwapIntervals = 0;
+    // The swap interval each frame was shown at.
+    std::vector<int32_t> swapIntervals;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const Score& score) {
+    return os << score.frames << " frames, " << score.missedFrames
+              << " missed, " << score.switches << " switches, mean interval "
+              << static_cast<float>(score.totalSwapIntervals) / score.frames;
+}
+
+// Simulates frames with the given CPU and GPU times, shown at the swap
+// interval the controller chose or later if they didn't fit in it.
+inline Score Replay(SwappySwapIntervalController type,
+                    const std::vector<FrameDuration>& trace,
+                    nanoseconds refreshPeriod = kRefreshPeriod60Hz) {
+    auto controller = SwapIntervalController::create(type);
+    const SwapIntervalController::Limits limits = {refreshPeriod, 0ns, 50ms,
+                                                   true};
+    SwapIntervalController::Config config = {1, PipelineMode::On};
+    std::chrono::steady_clock::time_point time;
+    Score score;
+    for (const auto& frame : trace) {
+        const nanoseconds frameTime =
+            config.pipelineMode == PipelineMode::On
+                ? std::max(frame.getCpuTime(), frame.getGpuTime())
+                : frame.getCpuTime() + frame.getGpuTime();
+        const nanoseconds swapTime = refreshPeriod * config.swapInterval;
+        const bool missed = frameTime > swapTime;
+        time += missed ? refreshPeriod * calculateSwapInterval(frameTime,
+                                                               refreshPeriod)
+                       : swapTime;
+        controller->addFrame(
+            time, {frame.getCpuTime(), frame.getGpuTime(), missed});
+
+        nanoseconds preferredFrameTime;
+        if (controller->update(limits, &config, &preferredFrameTime)) {
+            score.switches++;
+        }
+        score.frames++;
+        score.missedFrames += missed;
+        score.totalSwapIntervals += config.swapInterval;
+        score.swapIntervals.push_back(config.swapInterval);
+    }
+    return score;
+}
+
+}  // namespace swap_interval_replay
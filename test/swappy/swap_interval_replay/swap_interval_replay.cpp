@@ -0,0 +1,85 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host tool that replays the frames of recorded frame timeline dumps (see
+// SwappyGL_dumpFrameTimeline) through each swap interval controller and prints
+// how they score.
+//
+// Usage: swap_interval_replay <dump>...
+
+#include <stdio.h>
+
+#include <sstream>
+#include <vector>
+
+#include "../swap_interval_replay.h"
+
+using namespace swap_interval_replay;
+using std::chrono::nanoseconds;
+using swappy::FrameDuration;
+
+namespace {
+
+// Reads the CPU and GPU times of the frames in a frame timeline dump.
+std::vector<FrameDuration> LoadTrace(const char* path) {
+    std::vector<FrameDuration> trace;
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) return trace;
+    SwappyFrameTimelineHeader header;
+    while (fread(&header, sizeof(header), 1, file) == 1 &&
+           header.magic == SWAPPY_FRAME_TIMELINE_MAGIC &&
+           header.recordSize == sizeof(SwappyFrameRecord)) {
+        for (uint64_t i = 0; i < header.recordCount; ++i) {
+            SwappyFrameRecord record;
+            if (fread(&record, sizeof(record), 1, file) != 1) break;
+            if (record.type != SWAPPY_FRAME_RECORD_FRAME) continue;
+            trace.push_back({nanoseconds(record.cpuTimeNanos),
+                             nanoseconds(record.gpuTimeNanos), false});
+        }
+    }
+    fclose(file);
+    return trace;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <dump>...\n", argv[0]);
+        return 1;
+    }
+    int result = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::vector<FrameDuration> trace = LoadTrace(argv[i]);
+        if (trace.empty()) {
+            fprintf(stderr, "No frames in %s\n", argv[i]);
+            result = 1;
+            continue;
+        }
+        printf("%s:\n", argv[i]);
+        for (auto type : {SWAPPY_SWAP_INTERVAL_CONTROLLER_AVERAGE,
+                          SWAPPY_SWAP_INTERVAL_CONTROLLER_PREDICTIVE}) {
+            std::ostringstream score;
+            score << Replay(type, trace);
+            printf("  %s: %s\n",
+                   type == SWAPPY_SWAP_INTERVAL_CONTROLLER_AVERAGE
+                       ? "average"
+                       : "predictive",
+                   score.str().c_str());
+        }
+    }
+    return result;
+}
@@ -0,0 +1,736 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vulkan/SwappyVkQueueSync.h"
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <string.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "allocation_counter.h"
+#include "gtest/gtest.h"
+#include "vulkan/SwappyVkBase.h"
+#include "vulkan/SwappyVkTimelineWaiter.h"
+
+using namespace swappy;
+using namespace std::chrono_literals;
+
+// Mutexes locked by the current thread while sCountLocks is set. This only
+// sees the locks if calls to pthread_mutex_lock bind to the definition below,
+// which isn't the case when the tests are in a shared library.
+static thread_local bool sCountLocks = false;
+static thread_local int sLocks = 0;
+using MutexLock = int (*)(pthread_mutex_t*);
+static std::atomic<MutexLock> sRealMutexLock = {nullptr};
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex) {
+    if (sCountLocks) sLocks++;
+    MutexLock realMutexLock = sRealMutexLock.load(std::memory_order_relaxed);
+    if (realMutexLock == nullptr) {
+        realMutexLock = reinterpret_cast<MutexLock>(
+            dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+        sRealMutexLock.store(realMutexLock, std::memory_order_relaxed);
+    }
+    return realMutexLock(mutex);
+}
+
+namespace vk_queue_sync_test {
+
+constexpr int kMaxObjects = 64;
+static const VkQueue kQueue = reinterpret_cast<VkQueue>(1);
+static const VkQueue kOtherQueue = reinterpret_cast<VkQueue>(2);
+
+// A fake device whose objects are numbered from 1. It doesn't lock or
+// allocate, so as not to be counted along with Swappy.
+struct FakeDevice {
+    std::atomic<int> nextObject;
+    std::atomic<int> liveObjects;
+    std::atomic<int> commandPools;
+    std::atomic<int> submits;
+    std::atomic<int> submittedCommandBuffers;
+    std::atomic<int> submittedFences;
+    // Creating the object with this number fails.
+    std::atomic<int> failingObject;
+    // Submitted fences and semaphores are signalled right away while the GPU
+    // is running.
+    std::atomic<bool> gpuRunning;
+    std::atomic<bool> signalled[kMaxObjects];
+    // Timeline semaphores, with the value they reach once the GPU catches up.
+    std::atomic<bool> hasTimelineFunctions;
+    std::atomic<bool> isTimeline[kMaxObjects];
+    std::atomic<uint64_t> counter[kMaxObjects];
+    std::atomic<uint64_t> submittedValue[kMaxObjects];
+};
+static FakeDevice sDevice;
+
+static void ResetDevice() {
+    sDevice.nextObject = 1;
+    sDevice.liveObjects = 0;
+    sDevice.commandPools = 0;
+    sDevice.submits = 0;
+    sDevice.submittedCommandBuffers = 0;
+    sDevice.submittedFences = 0;
+    sDevice.failingObject = 0;
+    sDevice.gpuRunning = true;
+    sDevice.hasTimelineFunctions = true;
+    for (int i = 0; i < kMaxObjects; i++) {
+        sDevice.signalled[i] = false;
+        sDevice.isTimeline[i] = false;
+        sDevice.counter[i] = 0;
+        sDevice.submittedValue[i] = 0;
+    }
+}
+
+template <typename T>
+static VkResult CreateObject(T* object) {
+    const int number = sDevice.nextObject++;
+    if (number == sDevice.failingObject || number >= kMaxObjects) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    sDevice.liveObjects++;
+    // Non-dispatchable handles are integers on 32-bit platforms.
+    *object = (T)static_cast<intptr_t>(number);
+    return VK_SUCCESS;
+}
+
+template <typename T>
+static int Number(T object) {
+    return static_cast<int>((intptr_t)object);
+}
+
+static void SignalAll() {
+    for (int i = 0; i < kMaxObjects; i++) {
+        sDevice.signalled[i] = true;
+        sDevice.counter[i] = sDevice.submittedValue[i].load();
+    }
+}
+
+static VkResult CreateCommandPool(VkDevice, const VkCommandPoolCreateInfo*,
+                                  const VkAllocationCallbacks*,
+                                  VkCommandPool* pool) {
+    sDevice.commandPools++;
+    return CreateObject(pool);
+}
+
+static void DestroyCommandPool(VkDevice, VkCommandPool,
+                               const VkAllocationCallbacks*) {
+    sDevice.commandPools--;
+    sDevice.liveObjects--;
+}
+
+static VkResult CreateFence(VkDevice, const VkFenceCreateInfo* info,
+                            const VkAllocationCallbacks*, VkFence* fence) {
+    VkResult result = CreateObject(fence);
+    if (result == VK_SUCCESS) {
+        sDevice.signalled[Number(*fence)] =
+            (info->flags & VK_FENCE_CREATE_SIGNALED_BIT) != 0;
+    }
+    return result;
+}
+
+static void DestroyObject() { sDevice.liveObjects--; }
+
+static void DestroyFence(VkDevice, VkFence, const VkAllocationCallbacks*) {
+    DestroyObject();
+}
+
+static VkResult WaitForFences(VkDevice, uint32_t count, const VkFence* fences,
+                              VkBool32, uint64_t timeout) {
+    EXPECT_EQ(count, 1);
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::nanoseconds(std::min<uint64_t>(
+                              timeout, std::chrono::nanoseconds(10s).count()));
+    while (!sDevice.signalled[Number(fences[0])]) {
+        if (std::chrono::steady_clock::now() > deadline) return VK_TIMEOUT;
+        std::this_thread::sleep_for(100us);
+    }
+    return VK_SUCCESS;
+}
+
+static VkResult GetFenceStatus(VkDevice, VkFence fence) {
+    return sDevice.signalled[Number(fence)] ? VK_SUCCESS : VK_NOT_READY;
+}
+
+static VkResult ResetFences(VkDevice, uint32_t count, const VkFence* fences) {
+    for (uint32_t i = 0; i < count; i++) {
+        sDevice.signalled[Number(fences[i])] = false;
+    }
+    return VK_SUCCESS;
+}
+
+static VkResult CreateSemaphore(VkDevice, const VkSemaphoreCreateInfo* info,
+                                const VkAllocationCallbacks*,
+                                VkSemaphore* semaphore) {
+    VkResult result = CreateObject(semaphore);
+#ifdef VK_KHR_timeline_semaphore
+    if (result == VK_SUCCESS && info->pNext) {
+        const auto* type =
+            static_cast<const VkSemaphoreTypeCreateInfoKHR*>(info->pNext);
+        EXPECT_EQ(type->sType,
+                  VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR);
+        sDevice.isTimeline[Number(*semaphore)] =
+            type->semaphoreType == VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+        sDevice.counter[Number(*semaphore)] = type->initialValue;
+    }
+#endif
+    return result;
+}
+
+static void DestroySemaphore(VkDevice, VkSemaphore,
+                             const VkAllocationCallbacks*) {
+    DestroyObject();
+}
+
+static VkResult CreateEvent(VkDevice, const VkEventCreateInfo*,
+                            const VkAllocationCallbacks*, VkEvent* event) {
+    return CreateObject(event);
+}
+
+static void DestroyEvent(VkDevice, VkEvent, const VkAllocationCallbacks*) {
+    DestroyObject();
+}
+
+static void CmdSetEvent(VkCommandBuffer, VkEvent, VkPipelineStageFlags) {}
+
+static VkResult AllocateCommandBuffers(VkDevice,
+                                       const VkCommandBufferAllocateInfo*,
+                                       VkCommandBuffer* commandBuffer) {
+    return CreateObject(commandBuffer);
+}
+
+static void FreeCommandBuffers(VkDevice, VkCommandPool, uint32_t,
+                               const VkCommandBuffer*) {
+    DestroyObject();
+}
+
+static VkResult BeginCommandBuffer(VkCommandBuffer,
+                                   const VkCommandBufferBeginInfo*) {
+    return VK_SUCCESS;
+}
+
+static VkResult EndCommandBuffer(VkCommandBuffer) { return VK_SUCCESS; }
+
+static VkResult QueueSubmit(VkQueue, uint32_t count,
+                            const VkSubmitInfo* submits, VkFence fence) {
+    EXPECT_EQ(count, 1);
+    sDevice.submits++;
+    sDevice.submittedCommandBuffers += submits[0].commandBufferCount;
+    if (fence != VK_NULL_HANDLE) {
+        sDevice.submittedFences++;
+        if (sDevice.gpuRunning) sDevice.signalled[Number(fence)] = true;
+    }
+#ifdef VK_KHR_timeline_semaphore
+    const auto* timeline =
+        static_cast<const VkTimelineSemaphoreSubmitInfoKHR*>(submits[0].pNext);
+    for (uint32_t i = 0; i < submits[0].signalSemaphoreCount; i++) {
+        const int semaphore = Number(submits[0].pSignalSemaphores[i]);
+        if (!sDevice.isTimeline[semaphore]) continue;
+        EXPECT_NE(timeline, nullptr);
+        EXPECT_EQ(timeline->signalSemaphoreValueCount,
+                  submits[0].signalSemaphoreCount);
+        const uint64_t value = timeline->pSignalSemaphoreValues[i];
+        EXPECT_GT(value, sDevice.submittedValue[semaphore]);
+        sDevice.submittedValue[semaphore] = value;
+        if (sDevice.gpuRunning) sDevice.counter[semaphore] = value;
+    }
+#endif
+    return VK_SUCCESS;
+}
+
+// Timeline semaphores need recent enough Vulkan headers.
+#ifdef VK_KHR_timeline_semaphore
+static VkResult GetSemaphoreCounterValue(VkDevice, VkSemaphore semaphore,
+                                         uint64_t* value) {
+    EXPECT_TRUE(sDevice.isTimeline[Number(semaphore)]);
+    *value = sDevice.counter[Number(semaphore)];
+    return VK_SUCCESS;
+}
+
+static VkResult WaitSemaphores(VkDevice, const VkSemaphoreWaitInfoKHR* info,
+                               uint64_t timeout) {
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::nanoseconds(std::min<uint64_t>(
+                              timeout, std::chrono::nanoseconds(10s).count()));
+    while (true) {
+        uint32_t reached = 0;
+        for (uint32_t i = 0; i < info->semaphoreCount; i++) {
+            const int semaphore = Number(info->pSemaphores[i]);
+            if (sDevice.counter[semaphore] >= info->pValues[i]) reached++;
+        }
+        if (reached == info->semaphoreCount ||
+            (reached > 0 && (info->flags & VK_SEMAPHORE_WAIT_ANY_BIT_KHR))) {
+            return VK_SUCCESS;
+        }
+        if (std::chrono::steady_clock::now() > deadline) return VK_TIMEOUT;
+        std::this_thread::sleep_for(100us);
+    }
+}
+
+static PFN_vkVoidFunction GetDeviceProcAddr(VkDevice, const char* name) {
+    if (!sDevice.hasTimelineFunctions) return nullptr;
+    if (strcmp(name, "vkGetSemaphoreCounterValueKHR") == 0) {
+        return reinterpret_cast<PFN_vkVoidFunction>(GetSemaphoreCounterValue);
+    }
+    if (strcmp(name, "vkWaitSemaphoresKHR") == 0) {
+        return reinterpret_cast<PFN_vkVoidFunction>(WaitSemaphores);
+    }
+    return nullptr;
+}
+#endif
+
+static bool Init() { return true; }
+
+static void* GetProcAddr(const char* name) {
+    static const struct {
+        const char* name;
+        void* proc;
+    } kProcs[] = {
+        {"vkCreateCommandPool", reinterpret_cast<void*>(CreateCommandPool)},
+        {"vkDestroyCommandPool", reinterpret_cast<void*>(DestroyCommandPool)},
+        {"vkCreateFence", reinterpret_cast<void*>(CreateFence)},
+        {"vkDestroyFence", reinterpret_cast<void*>(DestroyFence)},
+        {"vkWaitForFences", reinterpret_cast<void*>(WaitForFences)},
+        {"vkGetFenceStatus", reinterpret_cast<void*>(GetFenceStatus)},
+        {"vkResetFences", reinterpret_cast<void*>(ResetFences)},
+        {"vkCreateSemaphore", reinterpret_cast<void*>(CreateSemaphore)},
+        {"vkDestroySemaphore", reinterpret_cast<void*>(DestroySemaphore)},
+        {"vkCreateEvent", reinterpret_cast<void*>(CreateEvent)},
+        {"vkDestroyEvent", reinterpret_cast<void*>(DestroyEvent)},
+        {"vkCmdSetEvent", reinterpret_cast<void*>(CmdSetEvent)},
+        {"vkAllocateCommandBuffers",
+         reinterpret_cast<void*>(AllocateCommandBuffers)},
+        {"vkFreeCommandBuffers", reinterpret_cast<void*>(FreeCommandBuffers)},
+        {"vkBeginCommandBuffer", reinterpret_cast<void*>(BeginCommandBuffer)},
+        {"vkEndCommandBuffer", reinterpret_cast<void*>(EndCommandBuffer)},
+        {"vkQueueSubmit", reinterpret_cast<void*>(QueueSubmit)},
+    };
+    for (const auto& proc : kProcs) {
+        if (strcmp(name, proc.name) == 0) return proc.proc;
+    }
+    return nullptr;
+}
+
+static void Close() {}
+
+static const SwappyVkFunctionProvider kFunctionProvider = {Init, GetProcAddr,
+                                                           Close};
+
+class VkQueueSyncTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        ResetDevice();
+        LoadVulkanFunctions(&kFunctionProvider);
+    }
+
+    std::unique_ptr<SwappyVkQueueSync> Create() {
+        VkResult result = VK_SUCCESS;
+        auto queueSync = SwappyVkQueueSync::create(VK_NULL_HANDLE, kQueue, 0,
+                                                   50ms, nullptr, &result);
+        EXPECT_EQ(result, VK_SUCCESS);
+        return queueSync;
+    }
+
+    // As the Swappy backends do for each present.
+    VkSemaphore Present(SwappyVkQueueSync& queueSync) {
+        VkSemaphore semaphore;
+        EXPECT_EQ(queueSync.injectFence(&mPresentInfo, &semaphore),
+                  VK_SUCCESS);
+        queueSync.getPendingFenceCount();
+        queueSync.getLastFenceTime();
+        return semaphore;
+    }
+
+    // Also waits for the timeline waiter to measure the frames.
+    static void WaitForFences(const SwappyVkQueueSync& queueSync) {
+        const auto deadline = std::chrono::steady_clock::now() + 5s;
+        VkSemaphore semaphore;
+        uint64_t value;
+        while ((queueSync.getPendingFenceCount() > 0 ||
+                (queueSync.usesTimelineSemaphore() &&
+                 queueSync.getNextTimelineWait(&semaphore, &value))) &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+    }
+
+    VkSemaphore mWaitSemaphore = (VkSemaphore)1000;
+    VkPresentInfoKHR mPresentInfo = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+                                     nullptr,
+                                     1,
+                                     &mWaitSemaphore,
+                                     0,
+                                     nullptr,
+                                     nullptr,
+                                     nullptr};
+};
+
+TEST_F(VkQueueSyncTest, CreatesEverythingUpFront) {
+    auto queueSync = Create();
+    ASSERT_NE(queueSync, nullptr);
+    EXPECT_EQ(queueSync->getQueue(), kQueue);
+    EXPECT_EQ(sDevice.commandPools, 1);
+    // A fence, semaphore, event and command buffer per pending fence.
+    EXPECT_EQ(sDevice.liveObjects,
+              1 + 4 * SwappyVkQueueSync::MAX_PENDING_FENCES);
+    const int objects = sDevice.nextObject;
+
+    for (int i = 0; i < 10; i++) {
+        EXPECT_NE(Present(*queueSync), VK_NULL_HANDLE);
+        WaitForFences(*queueSync);
+    }
+    EXPECT_EQ(sDevice.submits, 10);
+    EXPECT_EQ(sDevice.nextObject, objects);
+
+    queueSync.reset();
+    EXPECT_EQ(sDevice.liveObjects, 0);
+}
+
+TEST_F(VkQueueSyncTest, FailedCreationDestroysEverything) {
+    // Every object up to the event of the second sync.
+    for (int failing = 1; failing <= 9; failing++) {
+        ResetDevice();
+        sDevice.failingObject = failing;
+        VkResult result = VK_SUCCESS;
+        auto queueSync = SwappyVkQueueSync::create(VK_NULL_HANDLE, kQueue, 0,
+                                                   50ms, nullptr, &result);
+        EXPECT_EQ(queueSync, nullptr) << "failing object " << failing;
+        EXPECT_EQ(result, VK_ERROR_OUT_OF_HOST_MEMORY);
+        EXPECT_EQ(sDevice.liveObjects, 0) << "failing object " << failing;
+    }
+}
+
+TEST_F(VkQueueSyncTest, SkipsFenceWhenGpuIsBehind) {
+    auto queueSync = Create();
+    ASSERT_NE(queueSync, nullptr);
+    sDevice.gpuRunning = false;
+    for (int i = 0; i < SwappyVkQueueSync::MAX_PENDING_FENCES; i++) {
+        EXPECT_NE(Present(*queueSync), VK_NULL_HANDLE);
+    }
+    EXPECT_EQ(queueSync->getPendingFenceCount(),
+              SwappyVkQueueSync::MAX_PENDING_FENCES);
+
+    EXPECT_EQ(Present(*queueSync), VK_NULL_HANDLE);
+    EXPECT_EQ(sDevice.submits, SwappyVkQueueSync::MAX_PENDING_FENCES);
+
+    SignalAll();
+    WaitForFences(*queueSync);
+    EXPECT_EQ(queueSync->getPendingFenceCount(), 0);
+    EXPECT_NE(Present(*queueSync), VK_NULL_HANDLE);
+}
+
+TEST_F(VkQueueSyncTest, SkipsFenceThatTimedOut) {
+    VkResult result = VK_SUCCESS;
+    auto queueSync = SwappyVkQueueSync::create(VK_NULL_HANDLE, kQueue, 0, 1ms,
+                                               nullptr, &result);
+    ASSERT_NE(queueSync, nullptr);
+    sDevice.gpuRunning = false;
+    EXPECT_NE(Present(*queueSync), VK_NULL_HANDLE);
+    EXPECT_NE(Present(*queueSync), VK_NULL_HANDLE);
+    WaitForFences(*queueSync);
+    EXPECT_EQ(queueSync->getPendingFenceCount(), 0);
+
+    // The waiter gave up on the fences, but they can't be reused until the GPU
+    // has signalled them.
+    EXPECT_EQ(Present(*queueSync), VK_NULL_HANDLE);
+    SignalAll();
+    EXPECT_NE(Present(*queueSync), VK_NULL_HANDLE);
+}
+
+TEST_F(VkQueueSyncTest, NoAllocationsPerPresent) {
+    auto queueSync = Create();
+    ASSERT_NE(queueSync, nullptr);
+    for (int i = 0; i < 10; i++) Present(*queueSync);
+    WaitForFences(*queueSync);
+
+    constexpr int kPresents = 1000;
+    int fencesInjected = 0;
+    StartCountingAllocations();
+    for (int i = 0; i < kPresents; i++) {
+        if (Present(*queueSync) != VK_NULL_HANDLE) fencesInjected++;
+        WaitForFences(*queueSync);
+    }
+    const int allocations = StopCountingAllocations();
+
+    EXPECT_EQ(fencesInjected, kPresents);
+    EXPECT_EQ(allocations, 0);
+}
+
+TEST_F(VkQueueSyncTest, OneLockPerPresent) {
+    std::mutex mutex;
+    sLocks = 0;
+    sCountLocks = true;
+    mutex.lock();
+    sCountLocks = false;
+    mutex.unlock();
+    if (sLocks != 1) {
+        GTEST_SKIP() << "Can't count locks in this build";
+    }
+
+    auto queueSync = Create();
+    ASSERT_NE(queueSync, nullptr);
+    constexpr int kPresents = 1000;
+    int locks = 0;
+    for (int i = 0; i < kPresents; i++) {
+        sLocks = 0;
+        sCountLocks = true;
+        Present(*queueSync);
+        sCountLocks = false;
+        locks += sLocks;
+        WaitForFences(*queueSync);
+    }
+    // Only to wake the waiter thread.
+    EXPECT_LE(locks, kPresents);
+}
+
+#ifdef VK_KHR_timeline_semaphore
+static int CountThreads() {
+    DIR* dir = opendir("/proc/self/task");
+    if (dir == nullptr) return -1;
+    int count = 0;
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+class VkTimelineQueueSyncTest : public VkQueueSyncTest {
+   protected:
+    void TearDown() override {
+        // The queues wait for the GPU to complete all frames when destroyed.
+        SignalAll();
+        Destroy();
+    }
+
+    SwappyVkTimelineWaiter* CreateWaiter(std::chrono::nanoseconds timeout) {
+        mWaiter = SwappyVkTimelineWaiter::create(VK_NULL_HANDLE,
+                                                 GetDeviceProcAddr, timeout);
+        return mWaiter.get();
+    }
+
+    SwappyVkQueueSync* CreateQueueSync(VkQueue queue) {
+        VkResult result = VK_SUCCESS;
+        auto queueSync = SwappyVkQueueSync::create(
+            VK_NULL_HANDLE, queue, 0, 50ms, mWaiter.get(), &result);
+        EXPECT_EQ(result, VK_SUCCESS);
+        if (!queueSync) return nullptr;
+        EXPECT_TRUE(queueSync->usesTimelineSemaphore());
+        mQueueSyncs.push_back(std::move(queueSync));
+        return mQueueSyncs.back().get();
+    }
+
+    // As in SwappyVkBase, the waiter is destroyed before the queues.
+    void Destroy() {
+        mWaiter.reset();
+        mQueueSyncs.clear();
+    }
+
+    std::vector<std::unique_ptr<SwappyVkQueueSync>> mQueueSyncs;
+    std::unique_ptr<SwappyVkTimelineWaiter> mWaiter;
+};
+
+TEST_F(VkTimelineQueueSyncTest, NeedsTimelineFunctions) {
+    sDevice.hasTimelineFunctions = false;
+    EXPECT_EQ(CreateWaiter(50ms), nullptr);
+}
+
+TEST_F(VkTimelineQueueSyncTest, SubmitsNoCommandBuffersOrFences) {
+    ASSERT_NE(CreateWaiter(50ms), nullptr);
+    SwappyVkQueueSync* queueSync = CreateQueueSync(kQueue);
+    ASSERT_NE(queueSync, nullptr);
+    // The timeline semaphore, and a binary one per pending frame for the
+    // present to wait for.
+    EXPECT_EQ(sDevice.commandPools, 0);
+    EXPECT_EQ(sDevice.liveObjects, 1 + SwappyVkQueueSync::MAX_PENDING_FENCES);
+
+    for (int i = 0; i < 10; i++) {
+        EXPECT_NE(Present(*queueSync), VK_NULL_HANDLE);
+        WaitForFences(*queueSync);
+    }
+    EXPECT_EQ(sDevice.submits, 10);
+    EXPECT_EQ(sDevice.submittedCommandBuffers, 0);
+    EXPECT_EQ(sDevice.submittedFences, 0);
+
+    Destroy();
+    EXPECT_EQ(sDevice.liveObjects, 0);
+}
+
+TEST_F(VkTimelineQueueSyncTest, OneThreadForAllQueues) {
+    const int threads = CountThreads();
+    ASSERT_NE(CreateWaiter(1s), nullptr);
+    SwappyVkQueueSync* queueSync = CreateQueueSync(kQueue);
+    SwappyVkQueueSync* otherQueueSync = CreateQueueSync(kOtherQueue);
+    ASSERT_NE(queueSync, nullptr);
+    ASSERT_NE(otherQueueSync, nullptr);
+    if (threads > 0) {
+        EXPECT_EQ(CountThreads(), threads + 1);
+    }
+
+    // The GPU time of each queue is measured.
+    sDevice.gpuRunning = false;
+    EXPECT_NE(Present(*queueSync), VK_NULL_HANDLE);
+    EXPECT_NE(Present(*otherQueueSync), VK_NULL_HANDLE);
+    std::this_thread::sleep_for(20ms);
+    SignalAll();
+    WaitForFences(*queueSync);
+    WaitForFences(*otherQueueSync);
+    EXPECT_GE(queueSync->getLastFenceTime(), 20ms);
+    EXPECT_GE(otherQueueSync->getLastFenceTime(), 20ms);
+}
+
+TEST_F(VkTimelineQueueSyncTest, SharesOneWaiterPerDevice) {
+    const VkDevice device = reinterpret_cast<VkDevice>(1);
+    const VkDevice otherDevice = reinterpret_cast<VkDevice>(2);
+    auto waiter =
+        SwappyVkTimelineWaiter::getForDevice(device, GetDeviceProcAddr, 1s);
+    ASSERT_NE(waiter, nullptr);
+    EXPECT_EQ(
+        SwappyVkTimelineWaiter::getForDevice(device, GetDeviceProcAddr, 1s),
+        waiter);
+    auto otherWaiter = SwappyVkTimelineWaiter::getForDevice(
+        otherDevice, GetDeviceProcAddr, 1s);
+    ASSERT_NE(otherWaiter, nullptr);
+    EXPECT_NE(otherWaiter, waiter);
+
+    // A new one is created once no one holds it.
+    waiter.reset();
+    waiter =
+        SwappyVkTimelineWaiter::getForDevice(device, GetDeviceProcAddr, 1s);
+    ASSERT_NE(waiter, nullptr);
+    EXPECT_EQ(waiter.use_count(), 1);
+}
+
+TEST_F(VkTimelineQueueSyncTest, RemovesQueueWhileWaiting) {
+    ASSERT_NE(CreateWaiter(1s), nullptr);
+    SwappyVkQueueSync* queueSync = CreateQueueSync(kQueue);
+    SwappyVkQueueSync* otherQueueSync = CreateQueueSync(kOtherQueue);
+    ASSERT_NE(queueSync, nullptr);
+    ASSERT_NE(otherQueueSync, nullptr);
+
+    // The thread is waiting on both queues when one is removed.
+    sDevice.gpuRunning = false;
+    EXPECT_NE(Present(*queueSync), VK_NULL_HANDLE);
+    EXPECT_NE(Present(*otherQueueSync), VK_NULL_HANDLE);
+    std::this_thread::sleep_for(10ms);
+    std::thread signaller([]() {
+        std::this_thread::sleep_for(10ms);
+        SignalAll();
+    });
+    mWaiter->removeQueue(queueSync);
+    signaller.join();
+    WaitForFences(*otherQueueSync);
+
+    // The removed queue is no longer measured until it is added again.
+    sDevice.gpuRunning = true;
+    EXPECT_NE(Present(*queueSync), VK_NULL_HANDLE);
+    EXPECT_NE(Present(*otherQueueSync), VK_NULL_HANDLE);
+    WaitForFences(*otherQueueSync);
+    VkSemaphore semaphore;
+    uint64_t value;
+    EXPECT_TRUE(queueSync->getNextTimelineWait(&semaphore, &value));
+    EXPECT_TRUE(mWaiter->addQueue(queueSync));
+    mWaiter->onFrameSubmitted();
+    WaitForFences(*queueSync);
+    EXPECT_FALSE(queueSync->getNextTimelineWait(&semaphore, &value));
+}
+
+TEST_F(VkTimelineQueueSyncTest, SkipsSignalWhenGpuIsBehind) {
+    ASSERT_NE(CreateWaiter(1s), nullptr);
+    SwappyVkQueueSync* queueSync = CreateQueueSync(kQueue);
+    ASSERT_NE(queueSync, nullptr);
+    sDevice.gpuRunning = false;
+    for (int i = 0; i < SwappyVkQueueSync::MAX_PENDING_FENCES; i++) {
+        EXPECT_NE(Present(*queueSync), VK_NULL_HANDLE);
+    }
+    EXPECT_EQ(queueSync->getPendingFenceCount(),
+              SwappyVkQueueSync::MAX_PENDING_FENCES);
+    EXPECT_EQ(Present(*queueSync), VK_NULL_HANDLE);
+    EXPECT_EQ(sDevice.submits, SwappyVkQueueSync::MAX_PENDING_FENCES);
+
+    // The semaphore is polled, so this doesn't wait for the waiter thread.
+    SignalAll();
+    EXPECT_EQ(queueSync->getPendingFenceCount(), 0);
+    WaitForFences(*queueSync);
+    EXPECT_NE(Present(*queueSync), VK_NULL_HANDLE);
+}
+
+TEST_F(VkTimelineQueueSyncTest, GivesUpOnFramesThatTimeOut) {
+    ASSERT_NE(CreateWaiter(1ms), nullptr);
+    SwappyVkQueueSync* queueSync = CreateQueueSync(kQueue);
+    ASSERT_NE(queueSync, nullptr);
+    sDevice.gpuRunning = false;
+    EXPECT_NE(Present(*queueSync), VK_NULL_HANDLE);
+    EXPECT_NE(Present(*queueSync), VK_NULL_HANDLE);
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    VkSemaphore semaphore;
+    uint64_t value;
+    while (queueSync->getNextTimelineWait(&semaphore, &value) &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    EXPECT_FALSE(queueSync->getNextTimelineWait(&semaphore, &value));
+
+    // The semaphores can't be reused until the GPU is done with them.
+    EXPECT_EQ(queueSync->getPendingFenceCount(), 2);
+    EXPECT_EQ(Present(*queueSync), VK_NULL_HANDLE);
+    SignalAll();
+    EXPECT_NE(Present(*queueSync), VK_NULL_HANDLE);
+}
+
+TEST_F(VkTimelineQueueSyncTest, NoAllocationsOrExtraLocksPerPresent) {
+    std::mutex mutex;
+    sLocks = 0;
+    sCountLocks = true;
+    mutex.lock();
+    sCountLocks = false;
+    mutex.unlock();
+    const bool countLocks = sLocks == 1;
+
+    ASSERT_NE(CreateWaiter(50ms), nullptr);
+    SwappyVkQueueSync* queueSync = CreateQueueSync(kQueue);
+    ASSERT_NE(queueSync, nullptr);
+    for (int i = 0; i < 10; i++) Present(*queueSync);
+    WaitForFences(*queueSync);
+
+    constexpr int kPresents = 1000;
+    int signalsInjected = 0;
+    int locks = 0;
+    StartCountingAllocations();
+    for (int i = 0; i < kPresents; i++) {
+        sLocks = 0;
+        sCountLocks = true;
+        if (Present(*queueSync) != VK_NULL_HANDLE) signalsInjected++;
+        sCountLocks = false;
+        locks += sLocks;
+        WaitForFences(*queueSync);
+    }
+    const int allocations = StopCountingAllocations();
+
+    EXPECT_EQ(signalsInjected, kPresents);
+    EXPECT_EQ(allocations, 0);
+    if (countLocks) {
+        EXPECT_LE(locks, kPresents);
+    }
+}
+#endif
+
+}  // namespace vk_queue_sync_test
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/VsyncPredictor.h"
+
+#include <stdlib.h>
+
+#include <random>
+
+#include "gtest/gtest.h"
+
+using namespace swappy;
+using namespace std::chrono_literals;
+using std::chrono::nanoseconds;
+using TimePoint = VsyncPredictor::TimePoint;
+
+namespace vsync_predictor_test {
+
+constexpr nanoseconds kNominal60Hz = 16666667ns;
+
+// Synthetic choreographer callbacks: late by up to maxDelay, with the odd
+// much later or missing one.
+class Callbacks {
+   public:
+    Callbacks(nanoseconds period, nanoseconds maxDelay, int seed)
+        : mPeriod(period), mDelay(0, maxDelay.count()), mRng(seed) {}
+
+    // The time of the callback for the next vsync, or of a later one if some
+    // are missed.
+    TimePoint next() {
+        mVsync++;
+        if (mChance(mRng) < 0.1) mVsync++;
+        nanoseconds delay(static_cast<int64_t>(mDelay(mRng)));
+        if (mChance(mRng) < 0.03) delay += mPeriod / 3;
+        return vsyncTime(mVsync) + delay;
+    }
+
+    int64_t lastVsync() const { return mVsync; }
+
+    TimePoint vsyncTime(int64_t vsync) const {
+        return mStart + vsync * mPeriod;
+    }
+
+   private:
+    const nanoseconds mPeriod;
+    const TimePoint mStart = TimePoint() + 1000s;
+    std::uniform_real_distribution<double> mDelay;
+    std::uniform_real_distribution<double> mChance{0, 1};
+    std::mt19937 mRng;
+    int64_t mVsync = 0;
+};
+
+TEST(VsyncPredictorTest, NoCallbacks) {
+    VsyncPredictor predictor(kNominal60Hz);
+    const TimePoint time = TimePoint() + 5s;
+    EXPECT_EQ(predictor.getNextVsync(time), time);
+    EXPECT_EQ(predictor.getPeriod(), kNominal60Hz);
+}
+
+TEST(VsyncPredictorTest, OnTimeCallbacks) {
+    // Apart from the odd late one.
+    VsyncPredictor predictor(kNominal60Hz);
+    Callbacks callbacks(kNominal60Hz, 0ns, 1);
+    TimePoint last;
+    for (int i = 0; i < 100; ++i) {
+        last = callbacks.next();
+        predictor.addTimestamp(last);
+    }
+    EXPECT_NEAR(predictor.getPeriod().count(), kNominal60Hz.count(), 10);
+    const TimePoint next = predictor.getNextVsync(last + 1ms);
+    EXPECT_NEAR((next - last).count(), kNominal60Hz.count(), 1000);
+}
+
+TEST(VsyncPredictorTest, TracksActualPeriodThroughJitter) {
+    // The display runs a little faster than reported, and callbacks are late
+    // by up to 2ms.
+    const nanoseconds actual = 16600000ns;
+    VsyncPredictor predictor(kNominal60Hz);
+    Callbacks callbacks(actual, 2ms, 2);
+    TimePoint last;
+    for (int i = 0; i < 300; ++i) {
+        last = callbacks.next();
+        predictor.addTimestamp(last);
+    }
+    EXPECT_NEAR(predictor.getPeriod().count(), actual.count(), 20000);
+
+    // The next few predictions line up with the vsyncs, plus the mean
+    // callback delay.
+    const int64_t lastVsync = callbacks.lastVsync();
+    for (int64_t vsync = lastVsync + 1; vsync <= lastVsync + 8; ++vsync) {
+        const TimePoint expected = callbacks.vsyncTime(vsync) + 1ms;
+        const TimePoint predicted =
+            predictor.getNextVsync(expected - actual / 2);
+        EXPECT_LT(abs((predicted - expected).count()), 1000000) << vsync;
+    }
+}
+
+TEST(VsyncPredictorTest, RestartsAfterGap) {
+    VsyncPredictor predictor(kNominal60Hz);
+    Callbacks callbacks(kNominal60Hz, 0ns, 3);
+    TimePoint last;
+    for (int i = 0; i < 50; ++i) {
+        last = callbacks.next();
+        predictor.addTimestamp(last);
+    }
+    // A callback half a period out of phase after a long pause.
+    const TimePoint resumed = last + 10s + kNominal60Hz / 2;
+    predictor.addTimestamp(resumed);
+    EXPECT_EQ(predictor.getSampleCount(), 1);
+    EXPECT_EQ(predictor.getNextVsync(resumed), resumed);
+}
+
+TEST(VsyncPredictorTest, NewNominalPeriod) {
+    VsyncPredictor predictor(kNominal60Hz);
+    Callbacks callbacks60(kNominal60Hz, 1ms, 4);
+    for (int i = 0; i < 50; ++i) {
+        predictor.addTimestamp(callbacks60.next());
+    }
+
+    const nanoseconds nominal120Hz = 8333333ns;
+    predictor.setNominalPeriod(nominal120Hz);
+    EXPECT_EQ(predictor.getSampleCount(), 0);
+    EXPECT_EQ(predictor.getPeriod(), nominal120Hz);
+    Callbacks callbacks120(nominal120Hz, 500us, 5);
+    for (int i = 0; i < 100; ++i) {
+        predictor.addTimestamp(callbacks120.next());
+    }
+    EXPECT_NEAR(predictor.getPeriod().count(), nominal120Hz.count(), 20000);
+}
+
+TEST(VsyncPredictorTest, WrongNominalPeriodRestarts) {
+    // Callbacks at 90Hz while 60Hz is reported can't be fitted, but the
+    // predictor keeps following the latest callbacks.
+    VsyncPredictor predictor(kNominal60Hz);
+    Callbacks callbacks(11111111ns, 0ns, 6);
+    TimePoint last;
+    for (int i = 0; i < 100; ++i) {
+        last = callbacks.next();
+        predictor.addTimestamp(last);
+        EXPECT_LE(predictor.getNextVsync(last), last + kNominal60Hz);
+    }
+    EXPECT_LT(predictor.getSampleCount(), VsyncPredictor::WINDOW);
+}
+
+}  // namespace vsync_predictor_test
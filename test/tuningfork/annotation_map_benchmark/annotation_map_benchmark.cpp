@@ -0,0 +1,187 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host benchmark of AnnotationMap::GetOrInsert, which TuningForkImpl calls on
+// each SetCurrentAnnotation, from several threads at once. It is compared
+// with the map of 256 hash buckets that AnnotationMap used before.
+//
+// Usage: annotation_map_benchmark [annotations] [calls per thread]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <thread>
+#include <vector>
+
+#include "core/annotation_map.h"
+
+using namespace tuningfork;
+using namespace std::chrono;
+
+namespace {
+
+static uint32_t Murmur2Hash(const uint8_t* data, int len) {
+    const uint32_t m = 0x5bd1e995;
+    const int r = 24;
+    uint32_t h = len;
+
+    for (; len >= 4; data += 4, len -= 4) {
+        uint32_t k = *(uint32_t*)data;
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h *= m;
+        h ^= k;
+    }
+
+    switch (len) {
+        case 3:
+            h ^= data[2] << 16;
+        case 2:
+            h ^= data[1] << 8;
+        case 1:
+            h ^= data[0];
+            h *= m;
+    };
+
+    h ^= h >> 13;
+    h *= m;
+    h ^= h >> 15;
+
+    return h;
+}
+
+// AnnotationMap as it was before: ids are hashes, kept in a fixed number of
+// buckets. Looking up a serialization that is already there only reads, so it
+// can be done from several threads.
+class HashBucketAnnotationMap {
+    static const int kHashTableSize = 256;
+    typedef std::vector<
+        std::list<std::pair<AnnotationId, ProtobufSerialization>>>
+        InnerContainer;
+    InnerContainer hash_table_;
+
+   public:
+    HashBucketAnnotationMap() : hash_table_(kHashTableSize) {}
+
+    TuningFork_ErrorCode GetOrInsert(const ProtobufSerialization& ser,
+                                     AnnotationId& id) {
+        id = Murmur2Hash(ser.data(), ser.size());
+        auto& ls = hash_table_[HashIndex(id)];
+        for (auto& l : ls) {
+            if (l.first == id) return TUNINGFORK_ERROR_OK;
+        }
+        ls.push_back({id, ser});
+        return TUNINGFORK_ERROR_OK;
+    }
+
+   private:
+    inline int HashIndex(AnnotationId id) { return id & 0xff; }
+};
+
+// Serializations of an annotation with two enum fields, as the protobuf
+// encoding of {level = 1 + i / 16, quality = 1 + i % 16}.
+std::vector<ProtobufSerialization> Annotations(int n) {
+    std::vector<ProtobufSerialization> annotations;
+    for (int i = 0; i < n; ++i) {
+        annotations.push_back({0x08, static_cast<uint8_t>(1 + i / 16), 0x10,
+                               static_cast<uint8_t>(1 + i % 16)});
+    }
+    return annotations;
+}
+
+// Calls get_or_insert for each annotation in turn, calls_per_thread times on
+// each of num_threads threads, and returns the total calls per second.
+template <typename F>
+double CallsPerSecond(int num_threads, int calls_per_thread,
+                      const std::vector<ProtobufSerialization>& annotations,
+                      F get_or_insert) {
+    std::atomic<bool> go{false};
+    std::atomic<int> errors{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t] {
+            while (!go.load(std::memory_order_acquire)) {
+            }
+            size_t a = t * annotations.size() / num_threads;
+            for (int i = 0; i < calls_per_thread; ++i) {
+                AnnotationId id;
+                if (get_or_insert(annotations[a], id) != TUNINGFORK_ERROR_OK)
+                    errors++;
+                if (++a == annotations.size()) a = 0;
+            }
+        });
+    }
+    const auto start = steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& thread : threads) thread.join();
+    const auto end = steady_clock::now();
+    if (errors > 0) {
+        fprintf(stderr, "%d calls failed\n", errors.load());
+        exit(1);
+    }
+    return num_threads * calls_per_thread /
+           duration_cast<duration<double>>(end - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int num_annotations = argc > 1 ? atoi(argv[1]) : 256;
+    const int calls_per_thread = argc > 2 ? atoi(argv[2]) : 1000000;
+    const auto annotations = Annotations(num_annotations);
+
+    AnnotationMap map;
+    map.Init(num_annotations + 1);
+    HashBucketAnnotationMap old_map;
+    auto get_or_insert = [&](const ProtobufSerialization& ser,
+                             AnnotationId& id) {
+        return map.GetOrInsert(ser, id);
+    };
+    auto old_get_or_insert = [&](const ProtobufSerialization& ser,
+                                 AnnotationId& id) {
+        return old_map.GetOrInsert(ser, id);
+    };
+
+    // The old map can only insert from one thread at a time, so fill both
+    // maps on one thread first.
+    printf("Inserting %d annotations: table %.1fM calls/s, "
+           "hash buckets %.1fM calls/s\n",
+           num_annotations,
+           CallsPerSecond(1, num_annotations, annotations, get_or_insert) / 1e6,
+           CallsPerSecond(1, num_annotations, annotations, old_get_or_insert) /
+               1e6);
+    for (int num_threads = 1; num_threads <= 8; num_threads *= 2) {
+        printf("%d thread%s: table %6.1fM calls/s, "
+               "hash buckets %6.1fM calls/s\n",
+               num_threads, num_threads == 1 ? " " : "s",
+               CallsPerSecond(num_threads, calls_per_thread, annotations,
+                              get_or_insert) /
+                   1e6,
+               CallsPerSecond(num_threads, calls_per_thread, annotations,
+                              old_get_or_insert) /
+                   1e6);
+    }
+    if (map.Size() != static_cast<uint32_t>(num_annotations) + 1) {
+        fprintf(stderr, "Expected %d ids, got %u\n", num_annotations + 1,
+                map.Size());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core/annotation_map.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "core/annotation_util.h"
+
+namespace annotation_map_test {
+
+using namespace tuningfork;
+
+// A distinct serialization for each i < 65536, of varying length.
+static ProtobufSerialization MakeSerialization(uint32_t i) {
+    ProtobufSerialization ser = {static_cast<uint8_t>(i),
+                                 static_cast<uint8_t>(i >> 8)};
+    for (uint32_t j = 0; j < i % 7; ++j) ser.push_back(0xaa);
+    return ser;
+}
+
+TEST(AnnotationMapTest, IdsAreDense) {
+    AnnotationMap map;
+    map.Init(10);
+    AnnotationId id;
+    EXPECT_EQ(map.GetOrInsert(ProtobufSerialization{}, id),
+              TUNINGFORK_ERROR_OK);
+    EXPECT_EQ(id, 0);
+    for (uint32_t i = 0; i < 9; ++i) {
+        EXPECT_EQ(map.GetOrInsert(MakeSerialization(i), id),
+                  TUNINGFORK_ERROR_OK);
+        EXPECT_EQ(id, i + 1);
+    }
+    for (uint32_t i = 0; i < 9; ++i) {
+        EXPECT_EQ(map.GetOrInsert(MakeSerialization(i), id),
+                  TUNINGFORK_ERROR_OK);
+        EXPECT_EQ(id, i + 1);
+        ProtobufSerialization ser;
+        EXPECT_EQ(map.Get(id, ser), TUNINGFORK_ERROR_OK);
+        EXPECT_EQ(ser, MakeSerialization(i));
+    }
+    EXPECT_EQ(map.Size(), 10);
+}
+
+TEST(AnnotationMapTest, HashCollisionsGetDifferentIds) {
+    // These have the same Murmur2 hash.
+    ProtobufSerialization a = {0x5c, 0x26, 0x00, 0x00, 0x9c, 0x01, 0x00, 0x18};
+    ProtobufSerialization b = {0x6c, 0xa9, 0x01, 0x00, 0xac, 0x2f, 0x6e, 0xd8};
+    AnnotationMap map;
+    map.Init(4);
+    AnnotationId id_a, id_b;
+    EXPECT_EQ(map.GetOrInsert(a, id_a), TUNINGFORK_ERROR_OK);
+    EXPECT_EQ(map.GetOrInsert(b, id_b), TUNINGFORK_ERROR_OK);
+    EXPECT_NE(id_a, id_b);
+    ProtobufSerialization ser;
+    EXPECT_EQ(map.Get(id_a, ser), TUNINGFORK_ERROR_OK);
+    EXPECT_EQ(ser, a);
+    EXPECT_EQ(map.Get(id_b, ser), TUNINGFORK_ERROR_OK);
+    EXPECT_EQ(ser, b);
+}
+
+TEST(AnnotationMapTest, FullTable) {
+    AnnotationMap map;
+    map.Init(2);
+    AnnotationId id;
+    EXPECT_EQ(map.GetOrInsert(MakeSerialization(0), id), TUNINGFORK_ERROR_OK);
+    EXPECT_EQ(id, 1);
+    EXPECT_EQ(map.GetOrInsert(MakeSerialization(1), id),
+              TUNINGFORK_ERROR_INVALID_ANNOTATION);
+    EXPECT_EQ(id, annotation_util::kAnnotationError);
+    // Existing entries can still be found.
+    EXPECT_EQ(map.GetOrInsert(MakeSerialization(0), id), TUNINGFORK_ERROR_OK);
+    EXPECT_EQ(id, 1);
+    ProtobufSerialization ser;
+    EXPECT_EQ(map.Get(2, ser), TUNINGFORK_ERROR_INVALID_ANNOTATION);
+}
+
+TEST(AnnotationMapTest, ConcurrentInserts) {
+    constexpr uint32_t kNumAnnotations = 2000;
+    constexpr int kNumThreads = 8;
+    AnnotationMap map;
+    map.Init(kNumAnnotations + 1);
+    std::vector<std::vector<AnnotationId>> ids(
+        kNumThreads, std::vector<AnnotationId>(kNumAnnotations));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; ++t) {
+        threads.emplace_back([&map, &ids, t]() {
+            // Each thread inserts the same annotations in a different order.
+            std::vector<uint32_t> order(kNumAnnotations);
+            for (uint32_t i = 0; i < kNumAnnotations; ++i) order[i] = i;
+            std::shuffle(order.begin(), order.end(), std::mt19937(t));
+            for (auto i : order) {
+                EXPECT_EQ(map.GetOrInsert(MakeSerialization(i), ids[t][i]),
+                          TUNINGFORK_ERROR_OK);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    EXPECT_EQ(map.Size(), kNumAnnotations + 1);
+    std::vector<bool> used(kNumAnnotations + 1);
+    for (uint32_t i = 0; i < kNumAnnotations; ++i) {
+        auto id = ids[0][i];
+        for (int t = 1; t < kNumThreads; ++t) EXPECT_EQ(ids[t][i], id);
+        ASSERT_GE(id, 1);
+        ASSERT_LE(id, kNumAnnotations);
+        EXPECT_FALSE(used[id]) << "Id " << id << " given out twice";
+        used[id] = true;
+        ProtobufSerialization ser;
+        EXPECT_EQ(map.Get(id, ser), TUNINGFORK_ERROR_OK);
+        EXPECT_EQ(ser, MakeSerialization(i));
+    }
+}
+
+}  // namespace annotation_map_test
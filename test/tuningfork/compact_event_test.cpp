@@ -0,0 +1,104 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core/compact_event.h"
+
+#include <gtest/gtest.h>
+
+#include <json11/json11.hpp>
+#include <string>
+#include <vector>
+
+namespace compact_event_test {
+
+using namespace tuningfork;
+using namespace json11;
+
+static std::string RoundTrip(const std::string& json,
+                             size_t* encoded_size = nullptr) {
+    std::vector<uint8_t> encoded;
+    EXPECT_TRUE(compact_event::Encode(json, encoded)) << json;
+    if (encoded_size != nullptr) *encoded_size = encoded.size();
+    std::string decoded;
+    EXPECT_TRUE(
+        compact_event::Decode(encoded.data(), encoded.size(), decoded));
+    return decoded;
+}
+
+TEST(CompactEventTest, RoundTripsJson11Output) {
+    Json event = Json::object{
+        {"name", "applications/packname/apks/0"},
+        {"escaped", "quote \" backslash \\ newline \n tab \t \x01"},
+        {"empty_array", Json::array{}},
+        {"empty_object", Json::object{}},
+        {"flags", Json::array{true, false, nullptr}},
+        {"ints", Json::array{0, -1, 2147483647, -2147483647, 5, 5, 5}},
+        {"doubles", Json::array{0.5, -0.0, 1e-9, 3000000000.0, 1e300}},
+        {"mixed", Json::array{1, 2.5, "three", Json::array{4}}},
+        {"nested",
+         Json::object{{"a", Json::object{{"b", Json::array{Json::object{
+                                                   {"c", 1}}}}}}}},
+    };
+    std::string json = event.dump();
+    EXPECT_EQ(RoundTrip(json), json);
+}
+
+TEST(CompactEventTest, HistogramCountsAreCompact) {
+    Json::array counts(200, 0);
+    counts[10] = 3;
+    counts[11] = 250;
+    counts[12] = 250;
+    counts[13] = 7;
+    Json histogram =
+        Json::object{{"counts", counts}, {"instrument_id", 1234}};
+    std::string json = histogram.dump();
+    size_t encoded_size = 0;
+    EXPECT_EQ(RoundTrip(json, &encoded_size), json);
+    EXPECT_LT(encoded_size, 50) << "JSON is " << json.size() << " bytes";
+}
+
+TEST(CompactEventTest, PlainJsonIsCopied) {
+    std::string json = "{\"session\": 1}";
+    std::string decoded;
+    EXPECT_TRUE(compact_event::Decode(
+        reinterpret_cast<const uint8_t*>(json.data()), json.size(), decoded));
+    EXPECT_EQ(decoded, json);
+}
+
+TEST(CompactEventTest, InvalidJsonIsNotEncoded) {
+    for (const char* json : {"", "{\"a\": }", "[1, 2", "\"abc", "{\"a\" 1}",
+                             "nul", "[1, 2] 3", "--1"}) {
+        std::vector<uint8_t> encoded;
+        EXPECT_FALSE(compact_event::Encode(json, encoded)) << json;
+    }
+}
+
+TEST(CompactEventTest, TruncatedEncodingIsRejected) {
+    std::string json = Json(Json::object{{"counts", Json::array{0, 0, 0, 1}},
+                                         {"name", "x"},
+                                         {"t", Json::array{1.5}}})
+                           .dump();
+    std::vector<uint8_t> encoded;
+    ASSERT_TRUE(compact_event::Encode(json, encoded));
+    // Shorter than the magic is read as plain JSON, so start after it.
+    for (size_t size = 4; size < encoded.size(); ++size) {
+        std::string decoded;
+        EXPECT_FALSE(compact_event::Decode(encoded.data(), size, decoded))
+            << size;
+    }
+}
+
+}  // namespace compact_event_test
@@ -22,7 +22,9 @@ using namespace gamesdk_test;
 
 namespace tuningfork_test {
 
-TuningForkLogEvent TestEndToEndWithAnnotation() {
+// Switch between all the annotations num_switches times before recording
+// frames with LEVEL_1.
+TuningForkLogEvent TestEndToEndWithAnnotation(int num_switches = 0) {
     const int NTICKS =
         101;  // note the first tick doesn't add anything to the histogram
     // {3} is the number of values in the Level enum in
@@ -31,6 +33,19 @@ TuningForkLogEvent TestEndToEndWithAnnotation() {
         TestSettings(tf::Settings::AggregationStrategy::Submission::TICK_BASED,
                      NTICKS - 1, 2, {3});
     TuningForkTest test(settings, milliseconds(10));
+    std::vector<tf::ProtobufSerialization> annotations;
+    for (auto level :
+         {com::google::tuningfork::LEVEL_1, com::google::tuningfork::LEVEL_2,
+          com::google::tuningfork::LEVEL_3}) {
+        Annotation ann;
+        ann.set_level(level);
+        annotations.push_back(tf::Serialize(ann));
+    }
+    for (int i = 0; i < num_switches; ++i) {
+        EXPECT_EQ(
+            tf::SetCurrentAnnotation(annotations[i % annotations.size()]),
+            TUNINGFORK_ERROR_OK);
+    }
     Annotation ann;
     ann.set_level(com::google::tuningfork::LEVEL_1);
     tf::SetCurrentAnnotation(tf::Serialize(ann));
@@ -88,4 +103,11 @@ TEST(EndToEndTest, WithAnnotation) {
     CheckStrings("Annotation", result, ExpectedForAnnotationTest());
 }
 
+// Each annotation keeps its id however often it is set, so switching back to
+// LEVEL_1 records into the same single histogram as above.
+TEST(EndToEndTest, SwitchingAnnotationsKeepsIds) {
+    auto result = TestEndToEndWithAnnotation(3000);
+    CheckStrings("SwitchingAnnotations", result, ExpectedForAnnotationTest());
+}
+
 }  // namespace tuningfork_test
@@ -20,6 +20,7 @@
 
 #include <string>
 
+#include "core/telemetry_journal.h"
 #include "core/tuningfork_utils.h"
 #include "jni/jni_helper.h"
 #include "proto/protobuf_util.h"
@@ -57,6 +58,24 @@ class FileCacheTest {
             return {};
     }
     void Remove(uint64_t key) { cache_.Remove(key); }
+    const TuningFork_Cache* CCache() const { return cache_.GetCCache(); }
+    // Load the journal stored at key and return its records.
+    std::vector<std::string> Records(uint64_t key, bool* valid = nullptr) {
+        auto value = Load(key);
+        std::vector<journal::Record> records;
+        bool ok = journal::ReadRecords(value.data(), value.size(), records);
+        if (valid != nullptr) *valid = ok;
+        std::vector<std::string> strs;
+        for (auto& r : records) {
+            strs.push_back(std::string((const char*)r.data, r.size));
+        }
+        return strs;
+    }
+    void Append(uint64_t key, const std::string& s, size_t max_records) {
+        EXPECT_EQ(journal::Append(CCache(), key, (const uint8_t*)s.data(),
+                                  s.size(), max_records),
+                  TUNINGFORK_ERROR_OK);
+    }
     static std::string GetPath() {
         // Use JNI if we can, for app cache usage rather than /data/local/tmp
         init_jni_for_tests();
@@ -87,6 +106,8 @@ TEST(FileCacheTest, FileSaveLoadOp) {
         ft.Save(k, saved);
         EXPECT_TRUE(file_utils::FileExists(FileCacheTest::LocalFileName(k)));
         EXPECT_EQ(ft.Load(k), saved) << "Save+Load 1";
+        EXPECT_FALSE(
+            file_utils::FileExists(FileCacheTest::LocalFileName(k) + ".tmp"));
     }
 }
 
@@ -107,4 +128,102 @@ TEST(FileCacheTest, FileRemoveOp) {
     }
 }
 
+TEST(FileCacheTest, JournalAppend) {
+    FileCacheTest ft;
+    if (!ft.IsValid()) GTEST_SKIP();
+    const uint64_t key = 7;
+    EXPECT_EQ(ft.Records(key), std::vector<std::string>{});
+    ft.Append(key, "{\"session\": 1}", 3);
+    ft.Append(key, "", 3);
+    ft.Append(key, std::string(300, 'x'), 3);
+    bool valid = false;
+    EXPECT_EQ(ft.Records(key, &valid),
+              (std::vector<std::string>{"{\"session\": 1}", "",
+                                        std::string(300, 'x')}));
+    EXPECT_TRUE(valid);
+    // The oldest record is dropped when the journal is full
+    ft.Append(key, "4", 3);
+    EXPECT_EQ(ft.Records(key), (std::vector<std::string>{
+                                   "", std::string(300, 'x'), "4"}));
+}
+
+TEST(FileCacheTest, JournalLegacyValue) {
+    FileCacheTest ft;
+    if (!ft.IsValid()) GTEST_SKIP();
+    const uint64_t key = 8;
+    std::string legacy = "{\"name\": \"paused\"}";
+    ft.Save(key, ProtobufSerialization(legacy.begin(), legacy.end()));
+    EXPECT_EQ(ft.Records(key), std::vector<std::string>{legacy});
+    ft.Append(key, "next", 8);
+    EXPECT_EQ(ft.Records(key), (std::vector<std::string>{legacy, "next"}));
+}
+
+TEST(FileCacheTest, JournalTruncated) {
+    FileCacheTest ft;
+    if (!ft.IsValid()) GTEST_SKIP();
+    const uint64_t key = 9;
+    ft.Append(key, "first", 8);
+    ft.Append(key, "second", 8);
+    auto value = ft.Load(key);
+    std::vector<journal::Record> records;
+    // Lose the last byte, as if a custom persister was interrupted
+    EXPECT_FALSE(journal::ReadRecords(value.data(), value.size() - 1, records));
+    ASSERT_EQ(records.size(), 1);
+    EXPECT_EQ(std::string((const char*)records[0].data, records[0].size),
+              "first");
+    // Corrupt the payload of the second record
+    value.back() ^= 1;
+    records.clear();
+    EXPECT_FALSE(journal::ReadRecords(value.data(), value.size(), records));
+    EXPECT_EQ(records.size(), 1);
+}
+
+TEST(FileCacheTest, JournalRemove) {
+    FileCacheTest ft;
+    if (!ft.IsValid()) GTEST_SKIP();
+    const uint64_t key = 10;
+    ft.Append(key, "first", 3);
+    ft.Append(key, "second", 3);
+    ft.Append(key, "third", 3);
+    auto value = ft.Load(key);
+    std::vector<journal::Record> records;
+    journal::ReadRecords(value.data(), value.size(), records);
+    // Records that are not done stay, wherever they are in the journal
+    std::vector<journal::Record> done = {records[0], records[2]};
+    // The first record is dropped by an append before done is removed
+    ft.Append(key, "fourth", 3);
+    EXPECT_EQ(journal::Remove(ft.CCache(), key, done), TUNINGFORK_ERROR_OK);
+    EXPECT_EQ(ft.Records(key),
+              (std::vector<std::string>{"second", "fourth"}));
+    value = ft.Load(key);
+    records.clear();
+    journal::ReadRecords(value.data(), value.size(), records);
+    EXPECT_EQ(journal::Remove(ft.CCache(), key, records), TUNINGFORK_ERROR_OK);
+    EXPECT_EQ(ft.Load(key), ProtobufSerialization{});
+}
+
+TEST(FileCacheTest, JournalEvent) {
+    FileCacheTest ft;
+    if (!ft.IsValid()) GTEST_SKIP();
+    const uint64_t key = 11;
+    std::string legacy = "{\"name\": \"paused\"}";
+    ft.Append(key, legacy, 3);
+    std::string event =
+        "{\"counts\": [0, 0, 0, 0, 0, 0, 0, 0, 3, 1, 0, 0, 0, 0, 0, 0], "
+        "\"instrument_id\": 1234}";
+    EXPECT_EQ(journal::AppendEvent(ft.CCache(), key, event, 3),
+              TUNINGFORK_ERROR_OK);
+    auto value = ft.Load(key);
+    std::vector<journal::Record> records;
+    journal::ReadRecords(value.data(), value.size(), records);
+    ASSERT_EQ(records.size(), 2);
+    // The event is stored in the compact encoding
+    EXPECT_LT(records[1].size, event.size());
+    std::string json;
+    EXPECT_TRUE(journal::ReadEvent(records[0], json));
+    EXPECT_EQ(json, legacy);
+    EXPECT_TRUE(journal::ReadEvent(records[1], json));
+    EXPECT_EQ(json, event);
+}
+
 }  // namespace test
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host benchmark of Histogram::AddBatch, which buckets with SSE2 or NEON where
+// available, against calling Histogram::Add for each sample.
+//
+// Usage: histogram_benchmark [samples] [batch size]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "core/histogram.h"
+
+using namespace std::chrono;
+typedef tuningfork::Histogram<double> Histogram;
+
+namespace {
+
+// Frame times in ms, mostly around 16.7 with some out of range.
+std::vector<double> FrameTimes(size_t n) {
+    std::vector<double> dts(n);
+    for (size_t i = 0; i < n; ++i) {
+        dts[i] = i % 97 == 0 ? 80.0 + i % 7 : 14.0 + (i * 7919 % 1000) / 200.0;
+    }
+    return dts;
+}
+
+// Returns the time per sample in ns.
+template <typename F>
+double Time(size_t num_samples, F add) {
+    const auto start = steady_clock::now();
+    add();
+    const auto end = steady_clock::now();
+    return duration_cast<duration<double, std::nano>>(end - start).count() /
+           num_samples;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t num_samples = argc > 1 ? atoi(argv[1]) : 1000000;
+    const size_t batch_size = argc > 2 ? atoi(argv[2]) : 64;
+    const auto dts = FrameTimes(num_samples);
+
+    struct {
+        const char* name;
+        Histogram add;
+        Histogram batch;
+    } modes[] = {
+        {"histogram", Histogram(6.54, 60, 200), Histogram(6.54, 60, 200)},
+        {"quantile sketch", Histogram(6.54, 60, 200, false, true),
+         Histogram(6.54, 60, 200, false, true)},
+    };
+    int mismatches = 0;
+    for (auto& m : modes) {
+        const double add_ns = Time(num_samples, [&] {
+            for (double dt : dts) m.add.Add(dt);
+        });
+        const double batch_ns = Time(num_samples, [&] {
+            for (size_t i = 0; i < num_samples; i += batch_size) {
+                m.batch.AddBatch(dts.data() + i,
+                                 std::min(batch_size, num_samples - i));
+            }
+        });
+        printf("%-15s: Add %5.2f ns/sample, AddBatch of %zu %5.2f ns/sample\n",
+               m.name, add_ns, batch_size, batch_ns);
+        if (m.batch.Count() != m.add.Count() ||
+            m.batch.buckets() != m.add.buckets()) {
+            fprintf(stderr, "%s: AddBatch and Add differ\n", m.name);
+            ++mismatches;
+        }
+    }
+    return mismatches;
+}
@@ -16,11 +16,17 @@
 
 #include "core/histogram.h"
 
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "allocation_counter.h"
 #include "gtest/gtest.h"
 
 namespace histogram_test {
 
 typedef tuningfork::Histogram<double> Histogram;
+using tuningfork::QuantileSketch;
 
 const char kEmptyHistogramJson[] = "{\"events\":[]}";
 const char kOneEventJson[] = "{\"events\":[1.00]}";
@@ -89,4 +95,219 @@ TEST(HistogramTest, AddElevenTo0To10EventsOnly) {
         << "Add 11 0-10 histogram bad";
 }
 
+// Frame times in ms: a few shader compilation hitches at startup followed by a
+// steady 60Hz-ish distribution.
+static std::vector<double> FrameTimes(int n) {
+    std::vector<double> dts;
+    for (int i = 0; i < 5; ++i) dts.push_back(400.0 + 50 * i);
+    for (int i = 0; i < n; ++i)
+        dts.push_back(14.0 + (i % 1000 * 7919 % 1000) / 200.0);
+    return dts;
+}
+
+static double ExactQuantile(std::vector<double> dts, double q) {
+    std::sort(dts.begin(), dts.end());
+    return dts[static_cast<size_t>(q * (dts.size() - 1))];
+}
+
+TEST(HistogramTest, QuantileSketchAccuracy) {
+    Histogram h(6.54, 60, 200, false, true);
+    auto dts = FrameTimes(10000);
+    for (auto dt : dts) h.Add(dt);
+    auto& sketch = h.sketch();
+    EXPECT_EQ(sketch.Count(), dts.size());
+    for (double q : {0.01, 0.1, 0.5, 0.9, 0.99, 0.999}) {
+        double exact = ExactQuantile(dts, q);
+        EXPECT_NEAR(sketch.Quantile(q), exact,
+                    exact * QuantileSketch::kDefaultRelativeAccuracy)
+            << "q=" << q;
+    }
+    EXPECT_EQ(sketch.Quantile(0), *std::min_element(dts.begin(), dts.end()));
+    EXPECT_EQ(sketch.Quantile(1), 600.0);
+}
+
+TEST(HistogramTest, QuantileSketchKeepsBuckets) {
+    Histogram h(0, 10, 10);
+    Histogram s(0, 10, 10, false, true);
+    for (int i = 0; i < 20; ++i) {
+        h.Add(i * 0.6);
+        s.Add(i * 0.6);
+    }
+    EXPECT_EQ(s.ToDebugJSON(), h.ToDebugJSON());
+    EXPECT_EQ(s.buckets(), h.buckets());
+    s.Clear();
+    EXPECT_EQ(s.ToDebugJSON(), kEmpty0To10Json);
+    EXPECT_EQ(s.sketch().Count(), 0);
+}
+
+TEST(HistogramTest, QuantileSketchMerge) {
+    auto dts = FrameTimes(2000);
+    Histogram all(6.54, 60, 200, false, true);
+    Histogram a(6.54, 60, 200, false, true);
+    Histogram b(6.54, 60, 200, false, true);
+    for (size_t i = 0; i < dts.size(); ++i) {
+        all.Add(dts[i]);
+        (i % 3 == 0 ? a : b).Add(dts[i]);
+    }
+    EXPECT_EQ(a.Merge(b), TUNINGFORK_ERROR_OK);
+    EXPECT_EQ(a.Count(), all.Count());
+    EXPECT_EQ(a.buckets(), all.buckets());
+    for (double q : {0.0, 0.5, 0.9, 0.99, 1.0}) {
+        EXPECT_EQ(a.sketch().Quantile(q), all.sketch().Quantile(q))
+            << "q=" << q;
+    }
+    Histogram other_range(0, 60, 200, false, true);
+    EXPECT_EQ(a.Merge(other_range), TUNINGFORK_ERROR_BAD_PARAMETER);
+}
+
+static size_t BucketTotal(const Histogram& h) {
+    size_t total = 0;
+    for (auto c : h.buckets()) total += c;
+    return total;
+}
+
+TEST(HistogramTest, MergeIndependentlyAutoRanged) {
+    // Both have more samples than buckets, so they choose different ranges
+    Histogram a;
+    Histogram b;
+    for (int i = 0; i < 500; ++i) {
+        a.Add(14.0 + (i * 7919 % 1000) / 200.0);
+        b.Add(30.0 + (i * 7919 % 1000) / 50.0);
+    }
+    EXPECT_EQ(a.Merge(b), TUNINGFORK_ERROR_BAD_PARAMETER);
+    a.MergeRebucketing(b);
+    EXPECT_EQ(a.Count(), 1000);
+    EXPECT_EQ(BucketTotal(a), 1000);
+    // b's samples are all above a's range, so land in the last bucket
+    EXPECT_EQ(a.buckets().back(), 500);
+}
+
+TEST(HistogramTest, MergeWhileAutoRanging) {
+    Histogram ranged;
+    for (int i = 0; i < 500; ++i) ranged.Add(14.0 + (i % 100) / 10.0);
+    // Still collecting samples to choose a range from
+    Histogram a;
+    for (int i = 0; i < 50; ++i) a.Add(16.0);
+    Histogram b = a;
+    a.MergeRebucketing(ranged);
+    EXPECT_EQ(a.Count(), 550);
+    EXPECT_EQ(BucketTotal(a), 550);
+    ranged.MergeRebucketing(b);
+    EXPECT_EQ(ranged.Count(), 550);
+    EXPECT_EQ(BucketTotal(ranged), 550);
+    EXPECT_EQ(a.buckets(), ranged.buckets());
+    // Neither has chosen a range yet
+    Histogram c;
+    for (int i = 0; i < 50; ++i) c.Add(33.0);
+    b.MergeRebucketing(c);
+    EXPECT_EQ(b.Count(), 100);
+    EXPECT_EQ(b.samples().size(), 100);
+}
+
+TEST(HistogramTest, QuantileSketchBoundedMemory) {
+    QuantileSketch sketch(0.01, 64);
+    // 1us to 10s
+    for (double dt = 0.001; dt < 10000; dt *= 1.01) sketch.Add(dt);
+    EXPECT_LE(sketch.NumBins(), 64);
+    // Only the lowest quantiles are affected by collapsing
+    EXPECT_NEAR(sketch.Quantile(0.99), 0.001 * std::pow(1e7, 0.99),
+                0.01 * 0.001 * std::pow(1e7, 0.99) * 2);
+}
+
+TEST(HistogramTest, QuantileSketchWrapsAround) {
+    QuantileSketch sketch(0.01, 8);
+    // Grow downwards, so that the lowest bins wrap around the array
+    for (int i = 0; i < 8; ++i) sketch.Add(20.0 / std::pow(1.03, i));
+    EXPECT_EQ(sketch.NumBins(), 8);
+    // Collapse everything below 24 into the lowest bin
+    StartCountingAllocations();
+    for (int i = 0; i < 100; ++i) sketch.Add(24.0 + i % 3 * 0.3);
+    EXPECT_EQ(StopCountingAllocations(), 0);
+    EXPECT_EQ(sketch.NumBins(), 8);
+    size_t total = 0;
+    double last = 0;
+    sketch.ForEachBin([&](double value, uint64_t n) {
+        EXPECT_GT(value, last);
+        last = value;
+        total += n;
+    });
+    EXPECT_EQ(total, 108);
+    EXPECT_NEAR(sketch.Quantile(0.5), 24.3, 24.3 * 0.01);
+    sketch.Clear();
+    EXPECT_EQ(sketch.NumBins(), 0);
+    sketch.Add(16.0);
+    EXPECT_NEAR(sketch.Quantile(0.5), 16.0, 16.0 * 0.01);
+}
+
+TEST(HistogramTest, QuantileSketchIgnoresNonFinite) {
+    QuantileSketch sketch;
+    sketch.Add(16.0);
+    for (double x : {std::numeric_limits<double>::quiet_NaN(),
+                     std::numeric_limits<double>::infinity(),
+                     -std::numeric_limits<double>::infinity()}) {
+        sketch.Add(x);
+    }
+    EXPECT_EQ(sketch.Count(), 1);
+    EXPECT_EQ(sketch.Min(), 16.0);
+    EXPECT_EQ(sketch.Max(), 16.0);
+    EXPECT_EQ(sketch.Sum(), 16.0);
+    EXPECT_EQ(sketch.NumBins(), 1);
+}
+
+TEST(HistogramTest, AddBatchMatchesAdd) {
+    // Include samples out of range, on bucket boundaries and NaNs
+    auto dts = FrameTimes(1001);
+    for (double dt : {-1.0, 0.0, 6.54, 6.8099, 6.81, 59.99, 60.0, 1e12}) {
+        dts.push_back(dt);
+    }
+    dts.push_back(std::numeric_limits<double>::quiet_NaN());
+    for (int num_buckets : {1, 10, 200}) {
+        Histogram h(6.54, 60, num_buckets);
+        Histogram b(6.54, 60, num_buckets);
+        for (auto dt : dts) h.Add(dt);
+        // An odd-sized batch followed by the rest
+        b.AddBatch(dts.data(), 7);
+        b.AddBatch(dts.data() + 7, dts.size() - 7);
+        EXPECT_EQ(b.Count(), h.Count());
+        EXPECT_EQ(b.buckets(), h.buckets()) << num_buckets << " buckets";
+    }
+}
+
+TEST(HistogramTest, AddBatchAutoRange) {
+    auto dts = FrameTimes(500);
+    Histogram h;
+    Histogram b;
+    for (auto dt : dts) h.Add(dt);
+    b.AddBatch(dts.data(), dts.size());
+    EXPECT_EQ(b.Count(), h.Count());
+    EXPECT_EQ(h.Count(), dts.size());
+    EXPECT_EQ(b.ToDebugJSON(), h.ToDebugJSON());
+}
+
+TEST(HistogramTest, AddBatchMatchesAddInEveryMode) {
+    constexpr int kNumSamples = 100000;
+    auto dts = FrameTimes(kNumSamples);
+    struct {
+        const char* name;
+        Histogram h;
+        Histogram b;
+    } modes[] = {
+        {"histogram", Histogram(6.54, 60, 200), Histogram(6.54, 60, 200)},
+        {"quantile sketch", Histogram(6.54, 60, 200, false, true),
+         Histogram(6.54, 60, 200, false, true)},
+        {"auto range", Histogram(), Histogram()},
+    };
+    for (auto& m : modes) {
+        for (auto dt : dts) m.h.Add(dt);
+        // Batches of every size from 1 up, then the rest
+        size_t i = 0;
+        for (size_t n = 1; i + n <= dts.size(); i += n++) {
+            m.b.AddBatch(dts.data() + i, n);
+        }
+        m.b.AddBatch(dts.data() + i, dts.size() - i);
+        EXPECT_EQ(m.b.Count(), m.h.Count()) << m.name;
+        EXPECT_EQ(m.b.buckets(), m.h.buckets()) << m.name;
+    }
+}
+
 }  // namespace histogram_test
@@ -0,0 +1,28 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The declarations of the NDK's android/asset_manager.h that
+// tuningfork_utils.cpp needs, for host builds only. Host benchmarks don't
+// read assets, so these are never defined.
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct AAsset AAsset;
+
+int64_t AAsset_getLength64(AAsset* asset);
+const void* AAsset_getBuffer(AAsset* asset);
@@ -30,3 +30,16 @@ TEST(JNI, Init) {
         EXPECT_EQ(jni::IsValid(), true) << ": should be valid after init";
     }
 }
+
+TEST(JNI, CachedIds) {
+    if (!jni::IsValid()) return;
+    jni::LocalObject obj(jni::Env()->NewStringUTF("abc"));
+    obj.Cast();
+    auto before = jni::GetIdCacheStats();
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(obj.CallIntMethod(JNI_CACHED_METHOD("length", "()I")), 3);
+    }
+    auto after = jni::GetIdCacheStats();
+    EXPECT_EQ(after.lookups - before.lookups, 1);
+    EXPECT_EQ(after.lookups_avoided - before.lookups_avoided, 2);
+}
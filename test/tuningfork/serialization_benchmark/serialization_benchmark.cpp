@@ -0,0 +1,232 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host benchmark of JsonSerializer::SerializeEvent for a session with a frame
+// time histogram per instrument key for each of many annotations, against the
+// json11 tree the serializer built before it streamed with JsonWriter.
+//
+// Usage: serialization_benchmark [annotations] [instrument keys] [reps]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <set>
+#include <string>
+
+#include "allocation_counter.h"
+#include "core/tuningfork_utils.h"
+#include "http_backend/json_serializer.h"
+
+namespace tuningfork {
+// Defined in json_serializer.cpp.
+json11::Json::object GameSdkInfoJson(const RequestInfo& request_info);
+std::string TimeToRFC3339(std::chrono::system_clock::time_point tp);
+std::string DurationToSecondsString(Duration d);
+std::string B64Encode(const std::vector<uint8_t>& bytes);
+}  // namespace tuningfork
+
+using namespace tuningfork;
+using namespace std::chrono;
+using json11::Json;
+
+namespace {
+
+// Gives each annotation its own two byte serialization.
+class BenchmarkIdProvider : public IdProvider {
+   public:
+    TuningFork_ErrorCode SerializedAnnotationToAnnotationId(
+        const ProtobufSerialization& ser, AnnotationId& id) override {
+        if (ser.size() != 2) return TUNINGFORK_ERROR_BAD_PARAMETER;
+        id = ser[0] | (ser[1] << 8);
+        return TUNINGFORK_ERROR_OK;
+    }
+    TuningFork_ErrorCode MakeCompoundId(InstrumentationKey k,
+                                        AnnotationId annotation_id,
+                                        MetricId& id) override {
+        id = MetricId::FrameTime(annotation_id, k);
+        return TUNINGFORK_ERROR_OK;
+    }
+    TuningFork_ErrorCode AnnotationIdToSerializedAnnotation(
+        AnnotationId id, SerializedAnnotation& ann) override {
+        ann = {static_cast<uint8_t>(id & 0xff),
+               static_cast<uint8_t>(id >> 8)};
+        return TUNINGFORK_ERROR_OK;
+    }
+    TuningFork_ErrorCode MetricIdToLoadingTimeMetadata(
+        MetricId id, LoadingTimeMetadataWithGroup& md) override {
+        return TUNINGFORK_ERROR_BAD_PARAMETER;
+    }
+};
+
+RequestInfo BenchmarkRequestInfo() {
+    RequestInfo info{};
+    info.experiment_id = "expt";
+    info.session_id = "sess";
+    info.build_fingerprint = "fing";
+    info.build_version_sdk = "33";
+    info.cpu_max_freq_hz = {1800000000, 1800000000, 2400000000, 2400000000};
+    info.apk_package_name = "com.example.game";
+    info.tuningfork_version = ANDROID_GAMESDK_PACKED_VERSION(1, 0, 0);
+    info.model = "MODEL";
+    info.brand = "BRAND";
+    info.product = "PRODUCT";
+    info.device = "DEVICE";
+    return info;
+}
+
+// Creates a frame time histogram for each annotation and instrument key, then
+// records a few frame times, spread over some buckets, in each.
+void FillSession(Session& session, int num_annotations,
+                 int num_instrument_keys) {
+    std::vector<InstrumentationKey> ikeys;
+    for (int i = 0; i < num_annotations * num_instrument_keys; ++i) {
+        const int k = i % num_instrument_keys;
+        Settings::Histogram settings = {k, 6.54f, 60.0f, 200};
+        session.CreateFrameTimeHistogram(MetricId::FrameTime(0, k), settings);
+        if (i < num_instrument_keys) ikeys.push_back(k);
+    }
+    session.SetInstrumentationKeys(ikeys);
+    for (int a = 0; a < num_annotations; ++a) {
+        for (int k = 0; k < num_instrument_keys; ++k) {
+            auto data =
+                session.GetData<FrameTimeMetricData>(MetricId::FrameTime(a, k));
+            if (data == nullptr) {
+                fprintf(stderr, "No histogram left for annotation %d\n", a);
+                exit(1);
+            }
+            for (int i = 0; i < 100; ++i) {
+                data->Record(microseconds(14000 + 500 * ((a + i) % 9)));
+            }
+        }
+    }
+}
+
+// SerializeEvent for a session of frame time histograms, building a json11
+// tree as JsonSerializer did before it streamed with JsonWriter.
+void DomSerializeEvent(const Session& session, IdProvider& id_provider,
+                       const RequestInfo& request_info,
+                       std::string& evt_json_ser) {
+    std::vector<Json::object> telemetry;
+    std::set<AnnotationId> annotations;
+    for (const auto& p : session.GetNonEmptyHistograms<FrameTimeMetricData>()) {
+        annotations.insert(p->metric_id_.detail.annotation);
+    }
+    for (auto& annotation : annotations) {
+        std::vector<Json::object> render_histograms;
+        Duration duration = Duration::zero();
+        for (const auto& th :
+             session.GetNonEmptyHistograms<FrameTimeMetricData>()) {
+            auto ft = th->metric_id_.detail;
+            if (ft.annotation != annotation) continue;
+            std::vector<int32_t> counts;
+            for (auto& c : th->histogram_.buckets())
+                counts.push_back(static_cast<int32_t>(c));
+            Json::object o{{"counts", counts}};
+            o["instrument_id"] =
+                session.GetInstrumentationKey(ft.frame_time.ikey);
+            render_histograms.push_back(o);
+            duration = std::max(th->duration_, duration);
+        }
+        if (render_histograms.empty()) continue;
+        SerializedAnnotation serialized_annotation;
+        id_provider.AnnotationIdToSerializedAnnotation(annotation,
+                                                       serialized_annotation);
+        Json::object context{
+            {"annotations", B64Encode(serialized_annotation)},
+            {"tuning_parameters",
+             Json::object{
+                 {"experiment_id", request_info.experiment_id},
+                 {"serialized_fidelity_parameters",
+                  B64Encode(request_info.current_fidelity_parameters)}}},
+            {"duration", DurationToSecondsString(duration)}};
+        Json::object report{
+            {"rendering",
+             Json::object{{"render_time_histogram", render_histograms}}}};
+        telemetry.push_back(
+            Json::object{{"context", context}, {"report", report}});
+    }
+    std::map<std::string, Json> context_items = {
+        {"device", json_utils::DeviceSpecJson(request_info)},
+        {"game_sdk_info", GameSdkInfoJson(request_info)},
+        {"time_period",
+         Json::object{{"start_time", TimeToRFC3339(session.time().start)},
+                      {"end_time", TimeToRFC3339(session.time().end)}}}};
+    Json telemetry_request = Json::object{
+        {"name", json_utils::GetResourceName(request_info)},
+        {"session_context", Json::object{context_items}},
+        {"telemetry", telemetry}};
+    evt_json_ser = telemetry_request.dump();
+}
+
+// Runs serialize reps times after a first pass that grows any buffers, and
+// returns the mean time per pass in ms. Also sets the allocations made by the
+// last pass.
+template <typename F>
+double Time(int reps, F serialize, int& allocations) {
+    serialize();
+    const auto start = steady_clock::now();
+    for (int i = 0; i < reps; ++i) {
+        if (i == reps - 1) StartCountingAllocations();
+        serialize();
+    }
+    allocations = StopCountingAllocations();
+    const auto end = steady_clock::now();
+    return duration_cast<duration<double, std::milli>>(end - start).count() /
+           reps;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int num_annotations = argc > 1 ? atoi(argv[1]) : 1000;
+    const int num_instrument_keys = argc > 2 ? atoi(argv[2]) : 4;
+    const int reps = argc > 3 ? atoi(argv[3]) : 20;
+
+    Session session{};
+    FillSession(session, num_annotations, num_instrument_keys);
+    BenchmarkIdProvider id_provider;
+    const RequestInfo request_info = BenchmarkRequestInfo();
+    JsonSerializer serializer(session, &id_provider);
+
+    std::string writer_ser;
+    std::string dom_ser;
+    int writer_allocations;
+    int dom_allocations;
+    const double writer_ms = Time(
+        reps,
+        [&] { serializer.SerializeEvent(request_info, writer_ser); },
+        writer_allocations);
+    const double dom_ms = Time(
+        reps,
+        [&] {
+            DomSerializeEvent(session, id_provider, request_info, dom_ser);
+        },
+        dom_allocations);
+
+    const int histograms = num_annotations * num_instrument_keys;
+    printf("%d annotations x %d instrument keys, %zu bytes:\n",
+           num_annotations, num_instrument_keys, writer_ser.size());
+    printf("  JsonWriter %8.2f ms/event, %6.0f ns/histogram, %8d allocations\n",
+           writer_ms, writer_ms * 1e6 / histograms, writer_allocations);
+    printf("  json11     %8.2f ms/event, %6.0f ns/histogram, %8d allocations\n",
+           dom_ms, dom_ms * 1e6 / histograms, dom_allocations);
+    if (writer_ser != dom_ser) {
+        fprintf(stderr, "JsonWriter and json11 output differ\n");
+        return 1;
+    }
+    return 0;
+}
@@ -16,9 +16,13 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <chrono>
+#include <numeric>
 
+#include "allocation_counter.h"
 #include "common/gamesdk_common.h"
+#include "core/annotation_map.h"
 #include "core/tuningfork_utils.h"
 #include "http_backend/json_serializer.h"
 #include "test_utils.h"
@@ -295,6 +299,324 @@ TEST(SerializationTest, GEDeserialization) {
     CheckSessions(session1, session);
 }
 
+std::string full_session_report = R"TF({
+  "name": "applications/packname/apks/0",
+  "session_context": {
+    "crash_reports": [{"crash_reason": 1, "session_id": "prev_sess"}],
+    "device": )TF" + test_device_info_ser + R"TF(,
+    "game_sdk_info": {
+      "session_id": "sess",
+      "swappy_version": "2.7.0",
+      "version": "0.10.0"
+    },
+    "time_period": {
+      "end_time": "1970-01-01T00:00:00.000000Z",
+      "start_time": "1970-01-01T00:00:00.000000Z"
+    }
+  },
+  "telemetry": [{
+    "context": {
+      "annotations": "AQID",
+      "duration": "1.55s",
+      "tuning_parameters": {
+        "experiment_id": "expt",
+        "serialized_fidelity_parameters": ""
+      }
+    },
+    "report": {
+      "battery": {
+        "battery_event": [{
+          "app_on_foreground": true,
+          "charging": false,
+          "current_charge_microampere_hours": 1200,
+          "event_time": "1s",
+          "percentage": 50,
+          "power_save_mode": false
+        }]
+      },
+      "loading": {
+        "loading_events": [{
+          "intervals": [{"end": "0.25s", "start": "0.2s"}],
+          "loading_metadata": {
+            "group_id": "ABC",
+            "network_info": {
+              "bandwidth_bps": "1000000000",
+              "connectivity": 1,
+              "latency": "0.05s"
+            },
+            "source": 5,
+            "state": 1
+          },
+          "times_ms": [1500]
+        }]
+      },
+      "memory": {
+        "memory_event": [{
+          "avail_mem": 3000000000,
+          "event_time": "2s",
+          "oom_score": 100,
+          "proportional_set_size": 123456
+        }]
+      },
+      "rendering": {
+        "render_time_histogram": [{
+          "counts": [**],
+          "instrument_id": 1234
+        }]
+      },
+      "thermal": {
+        "thermal_event": [{
+          "event_time": "3s",
+          "thermal_state": 2
+        }]
+      }
+    }
+  }]
+})TF";
+
+// The serializer streams its output rather than building a json11 tree, so
+// check that it is formatted exactly as json11 would dump it.
+TEST(SerializationTest, StreamedEventMatchesJson11) {
+    Session session{};
+    session.CreateLoadingTimeSeries(MetricId::LoadingTime(0, 0));
+    session.CreateFrameTimeHistogram(MetricId::FrameTime(0, 0),
+                                     Settings::DefaultHistogram(1));
+    session.CreateBatteryTimeSeries(MetricId::Battery(0));
+    session.CreateMemoryTimeSeries(MetricId::Memory(0));
+    session.CreateThermalTimeSeries(MetricId::Thermal(0));
+    session.SetInstrumentationKeys({1234});
+
+    auto loading =
+        session.GetData<LoadingTimeMetricData>(MetricId::LoadingTime(0, 0));
+    ASSERT_NE(loading, nullptr);
+    loading->Record(milliseconds(1500));
+    loading->Record(ProcessTimeInterval{milliseconds(200), milliseconds(250)});
+    auto frame_time =
+        session.GetData<FrameTimeMetricData>(MetricId::FrameTime(0, 0));
+    ASSERT_NE(frame_time, nullptr);
+    frame_time->Record(milliseconds(10));
+    auto battery = session.GetData<BatteryMetricData>(MetricId::Battery(0));
+    ASSERT_NE(battery, nullptr);
+    battery->data_.push_back({50, 1200, seconds(1), true, false, false});
+    auto memory = session.GetData<MemoryMetricData>(MetricId::Memory(0));
+    ASSERT_NE(memory, nullptr);
+    memory->data_.push_back({3000000000, 100, 123456, seconds(2)});
+    auto thermal = session.GetData<ThermalMetricData>(MetricId::Thermal(0));
+    ASSERT_NE(thermal, nullptr);
+    thermal->data_.push_back(
+        {IBatteryProvider::THERMAL_STATE_LIGHT, seconds(3)});
+    session.RecordCrash(LOW_MEMORY);
+
+    IdMap metric_map;
+    JsonSerializer serializer(session, &metric_map);
+    std::string evt_ser;
+    serializer.SerializeEvent(test_device_info, evt_ser);
+    EXPECT_TRUE(CompareIgnoringWhitespace(evt_ser, full_session_report))
+        << evt_ser << "\n!=\n"
+        << full_session_report;
+
+    std::string err;
+    Json parsed = Json::parse(evt_ser, err);
+    ASSERT_TRUE(err.empty()) << err;
+    EXPECT_EQ(parsed.dump(), evt_ser);
+}
+
+// Gives each annotation its own serialization, so that a round trip keeps
+// the annotations apart.
+class AnnotationIdMap : public IdMap {
+    TuningFork_ErrorCode SerializedAnnotationToAnnotationId(
+        const ProtobufSerialization& ser, AnnotationId& id) override {
+        if (ser.size() != 2) return TUNINGFORK_ERROR_BAD_PARAMETER;
+        id = ser[0] | (ser[1] << 8);
+        return TUNINGFORK_ERROR_OK;
+    }
+    TuningFork_ErrorCode AnnotationIdToSerializedAnnotation(
+        AnnotationId id, SerializedAnnotation& ann) override {
+        ann = {static_cast<uint8_t>(id & 0xff),
+               static_cast<uint8_t>(id >> 8)};
+        return TUNINGFORK_ERROR_OK;
+    }
+};
+
+void CreateLargeSession(Session& session, int num_annotations,
+                        int num_instrument_keys) {
+    for (int i = 0; i < num_annotations * num_instrument_keys; ++i) {
+        session.CreateFrameTimeHistogram(
+            MetricId::FrameTime(0, i % num_instrument_keys),
+            Settings::DefaultHistogram(i % num_instrument_keys));
+    }
+    session.SetInstrumentationKeys({0, 1, 2, 3});
+}
+
+// A large session serializes to one telemetry entry per annotation and reads
+// back into the same histograms.
+TEST(SerializationTest, LargeSessionRoundTrip) {
+    constexpr int kNumAnnotations = 1000;
+    constexpr int kNumInstrumentKeys = 4;
+    Session session{};
+    CreateLargeSession(session, kNumAnnotations, kNumInstrumentKeys);
+    for (int a = 0; a < kNumAnnotations; ++a) {
+        for (int k = 0; k < kNumInstrumentKeys; ++k) {
+            auto p = session.GetData<FrameTimeMetricData>(
+                MetricId::FrameTime(a, k));
+            ASSERT_NE(p, nullptr);
+            for (int i = 0; i <= a % 5; ++i) p->Record(milliseconds(10 + k));
+        }
+    }
+    AnnotationIdMap metric_map;
+    JsonSerializer serializer(session, &metric_map);
+    std::string evt_ser;
+    // The first pass grows the output buffer: later passes reuse it.
+    serializer.SerializeEvent(test_device_info, evt_ser);
+    auto first_ser = evt_ser;
+    auto capacity = evt_ser.capacity();
+    StartCountingAllocations();
+    serializer.SerializeEvent(test_device_info, evt_ser);
+    int allocations = StopCountingAllocations();
+    // Only the annotation index and encodings allocate, not the histograms.
+    EXPECT_LE(allocations, 8 * kNumAnnotations);
+    EXPECT_EQ(evt_ser, first_ser);
+    EXPECT_EQ(evt_ser.capacity(), capacity) << "Output buffer was not reused";
+
+    std::string err;
+    Json parsed = Json::parse(evt_ser, err);
+    ASSERT_TRUE(err.empty()) << err;
+    auto& telemetry = parsed["telemetry"].array_items();
+    EXPECT_EQ(telemetry.size(), kNumAnnotations);
+    for (auto& t : telemetry) {
+        EXPECT_EQ(
+            t["report"]["rendering"]["render_time_histogram"].array_items()
+                .size(),
+            kNumInstrumentKeys);
+    }
+
+    Session session1{};
+    CreateLargeSession(session1, kNumAnnotations, kNumInstrumentKeys);
+    ASSERT_EQ(
+        JsonSerializer::DeserializeAndMerge(evt_ser, metric_map, session1),
+        TUNINGFORK_ERROR_OK);
+    for (int a = 0; a < kNumAnnotations; ++a) {
+        for (int k = 0; k < kNumInstrumentKeys; ++k) {
+            auto id = MetricId::FrameTime(a, k);
+            auto p0 = session.GetData<FrameTimeMetricData>(id);
+            auto p1 = session1.GetData<FrameTimeMetricData>(id);
+            ASSERT_NE(p1, nullptr);
+            auto& buckets = p1->histogram_.buckets();
+            EXPECT_EQ(std::accumulate(buckets.begin(), buckets.end(), 0u),
+                      a % 5 + 1u);
+            EXPECT_EQ(buckets, p0->histogram_.buckets());
+        }
+    }
+}
+
+// An event with a histogram that the session has no room for is not merged at
+// all, so that it can be kept and merged again later.
+TEST(SerializationTest, DeserializeMergesAllOrNothing) {
+    constexpr int kNumAnnotations = 2;
+    Session session{};
+    CreateLargeSession(session, kNumAnnotations, 1);
+    for (int a = 0; a < kNumAnnotations; ++a) {
+        auto p =
+            session.GetData<FrameTimeMetricData>(MetricId::FrameTime(a, 0));
+        ASSERT_NE(p, nullptr);
+        p->Record(milliseconds(10));
+    }
+    AnnotationIdMap metric_map;
+    JsonSerializer serializer(session, &metric_map);
+    std::string evt_ser;
+    serializer.SerializeEvent(test_device_info, evt_ser);
+
+    Session session1{};
+    CreateLargeSession(session1, 1, 1);
+    EXPECT_EQ(
+        JsonSerializer::DeserializeAndMerge(evt_ser, metric_map, session1),
+        TUNINGFORK_ERROR_BAD_PARAMETER);
+    auto p = session1.GetData<FrameTimeMetricData>(MetricId::FrameTime(0, 0));
+    ASSERT_NE(p, nullptr);
+    auto& buckets = p->histogram_.buckets();
+    EXPECT_EQ(std::accumulate(buckets.begin(), buckets.end(), 0u), 0u);
+}
+
+// Frame time metrics are found through slots laid out by annotation and
+// instrumentation key index when these are set up, or by searching when not.
+TEST(SerializationTest, SessionFrameTimeSlots) {
+    constexpr int kNumAnnotations = 3;
+    constexpr int kNumInstrumentKeys = 2;
+    Session slotted{};
+    Session searched{};
+    for (auto session : {&slotted, &searched}) {
+        for (int k = 0; k < kNumInstrumentKeys; ++k) {
+            for (int a = 0; a < kNumAnnotations; ++a) {
+                session->CreateFrameTimeHistogram(
+                    MetricId::FrameTime(0, k), Settings::DefaultHistogram(k));
+            }
+        }
+    }
+    slotted.InitFrameTimeSlots(kNumAnnotations, kNumInstrumentKeys);
+    for (int pass = 0; pass < 2; ++pass) {
+        for (auto session : {&slotted, &searched}) {
+            std::vector<FrameTimeMetricData*> taken;
+            for (int a = 0; a < kNumAnnotations; ++a) {
+                for (int k = 0; k < kNumInstrumentKeys; ++k) {
+                    auto id = MetricId::FrameTime(a, k);
+                    auto p = session->GetData<FrameTimeMetricData>(id);
+                    ASSERT_NE(p, nullptr);
+                    EXPECT_EQ(p->metric_id_, id);
+                    EXPECT_EQ(session->GetData<FrameTimeMetricData>(id), p);
+                    EXPECT_EQ(std::count(taken.begin(), taken.end(), p), 0);
+                    taken.push_back(p);
+                }
+            }
+            // All the metrics for each key have been taken
+            EXPECT_EQ(session->GetData<FrameTimeMetricData>(
+                          MetricId::FrameTime(kNumAnnotations, 0)),
+                      nullptr);
+            session->ClearData();
+        }
+    }
+}
+
+// Annotation ids from AnnotationMap are dense, starting from 0 for the empty
+// annotation, so their frame time metrics are all found through the slots.
+TEST(SerializationTest, SessionFrameTimeAnnotationMapIds) {
+    constexpr int kNumAnnotations = 3;
+    constexpr int kNumInstrumentKeys = 2;
+    AnnotationMap annotation_map;
+    annotation_map.Init(kNumAnnotations + 1);
+    std::vector<AnnotationId> annotations;
+    for (int a = 0; a < kNumAnnotations; ++a) {
+        AnnotationId annotation;
+        ProtobufSerialization ser = {8, static_cast<uint8_t>(a + 1)};
+        ASSERT_EQ(annotation_map.GetOrInsert(ser, annotation),
+                  TUNINGFORK_ERROR_OK);
+        EXPECT_LE(annotation, kNumAnnotations);
+        annotations.push_back(annotation);
+    }
+    Session session{};
+    for (int k = 0; k < kNumInstrumentKeys; ++k) {
+        for (int a = 0; a < kNumAnnotations; ++a) {
+            session.CreateFrameTimeHistogram(MetricId::FrameTime(0, k),
+                                             Settings::DefaultHistogram(k));
+        }
+    }
+    session.InitFrameTimeSlots(kNumAnnotations + 1, kNumInstrumentKeys);
+    for (int pass = 0; pass < 2; ++pass) {
+        std::vector<FrameTimeMetricData*> taken;
+        for (AnnotationId annotation : annotations) {
+            for (int k = 0; k < kNumInstrumentKeys; ++k) {
+                auto id = MetricId::FrameTime(annotation, k);
+                auto p = session.GetData<FrameTimeMetricData>(id);
+                ASSERT_NE(p, nullptr);
+                EXPECT_EQ(p->metric_id_, id);
+                EXPECT_EQ(session.GetData<FrameTimeMetricData>(id), p);
+                EXPECT_EQ(std::count(taken.begin(), taken.end(), p), 0);
+                taken.push_back(p);
+            }
+        }
+        session.ClearData();
+    }
+}
+
 TEST(SerializationTest, DurationSerialization) {
     std::vector<double> ds = {1e19, 1e15, 1e10, 1e5,  1e0,   1e-1,
                               1e-3, 1e-5, 1e-8, 1e-9, 1e-10, 1e-15};
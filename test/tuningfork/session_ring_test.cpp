@@ -0,0 +1,177 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "core/session_ring.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace session_ring_test {
+
+using namespace tuningfork;
+using namespace std::chrono;
+
+static const MetricId kFrameTimeId = MetricId::FrameTime(0, 0);
+
+static void InitSessions(SessionRing& ring) {
+    for (uint32_t i = 0; i < ring.Size(); ++i) {
+        ring[i].CreateFrameTimeHistogram(kFrameTimeId,
+                                         Settings::DefaultHistogram(0));
+    }
+}
+
+// Record n frames into the current session.
+static void RecordFrames(SessionRing& ring, int n) {
+    auto data = ring.Current()->GetData<FrameTimeMetricData>(kFrameTimeId);
+    ASSERT_NE(data, nullptr);
+    for (int i = 0; i < n; ++i) data->Record(milliseconds(16));
+}
+
+static size_t NumFrames(const Session* session) {
+    size_t n = 0;
+    for (auto h : session->GetNonEmptyHistograms<FrameTimeMetricData>())
+        n += h->Count();
+    return n;
+}
+
+TEST(SessionRingTest, UploadsInOrder) {
+    SessionRing ring(3);
+    InitSessions(ring);
+    EXPECT_EQ(ring.Size(), 4);
+    TimePoint t{};
+    for (int i = 1; i <= 3; ++i) {
+        RecordFrames(ring, i);
+        EXPECT_TRUE(ring.Submit(i != 2, t + seconds(i)));
+        EXPECT_EQ(NumFrames(ring.Current()), 0);
+    }
+    auto stats = ring.GetStats(t + seconds(10));
+    EXPECT_EQ(stats.num_queued, 3);
+    EXPECT_EQ(stats.oldest_age, seconds(9));
+    EXPECT_EQ(stats.num_merges, 0);
+    for (int i = 1; i <= 3; ++i) {
+        bool upload;
+        auto session = ring.Acquire(upload);
+        ASSERT_NE(session, nullptr);
+        EXPECT_EQ(NumFrames(session), i);
+        EXPECT_EQ(upload, i != 2);
+        ring.Release(session);
+    }
+    bool upload;
+    EXPECT_EQ(ring.Acquire(upload), nullptr);
+    EXPECT_EQ(ring.GetStats(t).num_queued, 0);
+}
+
+TEST(SessionRingTest, MergesOldestWhenFull) {
+    SessionRing ring(2);
+    InitSessions(ring);
+    TimePoint t{};
+    for (int i = 1; i <= 4; ++i) {
+        RecordFrames(ring, i);
+        EXPECT_TRUE(ring.Submit(true, t + seconds(i)));
+    }
+    // The first two sessions were merged to make room for the third, then the
+    // third was merged into them to make room for the fourth.
+    auto stats = ring.GetStats(t + seconds(10));
+    EXPECT_EQ(stats.num_queued, 2);
+    EXPECT_EQ(stats.num_merges, 2);
+    std::vector<size_t> frames;
+    bool upload;
+    while (auto session = ring.Acquire(upload)) {
+        frames.push_back(NumFrames(session));
+        ring.Release(session);
+    }
+    EXPECT_EQ(frames, std::vector<size_t>({1 + 2 + 3, 4}));
+}
+
+TEST(SessionRingTest, SaveWinsWhenMerging) {
+    SessionRing ring(1);
+    InitSessions(ring);
+    TimePoint t{};
+    // With room for only one queued session, there's nothing to merge with.
+    EXPECT_TRUE(ring.Submit(true, t));
+    EXPECT_FALSE(ring.Submit(true, t));
+    SessionRing ring2(2);
+    InitSessions(ring2);
+    EXPECT_TRUE(ring2.Submit(false, t));
+    EXPECT_TRUE(ring2.Submit(true, t));
+    EXPECT_TRUE(ring2.Submit(true, t));
+    bool upload = true;
+    auto session = ring2.Acquire(upload);
+    ASSERT_NE(session, nullptr);
+    EXPECT_FALSE(upload);
+}
+
+TEST(SessionRingTest, DoesNotMergeSessionBeingUploaded) {
+    SessionRing ring(2);
+    InitSessions(ring);
+    TimePoint t{};
+    RecordFrames(ring, 1);
+    EXPECT_TRUE(ring.Submit(true, t));
+    bool upload;
+    auto uploading = ring.Acquire(upload);
+    ASSERT_NE(uploading, nullptr);
+    RecordFrames(ring, 2);
+    EXPECT_TRUE(ring.Submit(true, t));
+    // Only one queued session can be merged, so there is no room.
+    RecordFrames(ring, 3);
+    EXPECT_FALSE(ring.Submit(true, t));
+    EXPECT_EQ(NumFrames(ring.Current()), 3);
+    ring.Release(uploading);
+    EXPECT_TRUE(ring.Submit(true, t));
+    std::vector<size_t> frames;
+    while (auto session = ring.Acquire(upload)) {
+        frames.push_back(NumFrames(session));
+        ring.Release(session);
+    }
+    EXPECT_EQ(frames, std::vector<size_t>({2, 3}));
+}
+
+TEST(SessionRingTest, NoFramesLostAcrossThreads) {
+    constexpr int kNumSubmits = 2000;
+    SessionRing ring(2);
+    InitSessions(ring);
+    std::atomic<bool> done{false};
+    size_t uploaded = 0;
+    std::thread consumer([&]() {
+        bool upload;
+        while (true) {
+            bool finished = done.load();
+            while (auto session = ring.Acquire(upload)) {
+                uploaded += NumFrames(session);
+                ring.Release(session);
+            }
+            if (finished) break;
+            std::this_thread::yield();
+        }
+    });
+    TimePoint t{};
+    for (int i = 0; i < kNumSubmits; ++i) {
+        RecordFrames(ring, 1 + i % 5);
+        ring.Submit(true, t);
+    }
+    // Whatever couldn't be submitted is still in the current session.
+    size_t pending = NumFrames(ring.Current());
+    done = true;
+    consumer.join();
+    size_t total = 0;
+    for (int i = 0; i < kNumSubmits; ++i) total += 1 + i % 5;
+    EXPECT_EQ(uploaded + pending, total);
+}
+
+}  // namespace session_ring_test
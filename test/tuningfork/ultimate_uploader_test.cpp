@@ -0,0 +1,201 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "http_backend/ultimate_uploader.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "core/backend.h"
+#include "core/telemetry_journal.h"
+
+namespace ultimate_uploader_test {
+
+using namespace tuningfork;
+using namespace std::chrono;
+
+// In-memory stand-in for the file cache.
+class MemoryCache {
+    std::map<uint64_t, ProtobufSerialization> values_;
+
+    static TuningFork_ErrorCode Get(uint64_t key,
+                                    TuningFork_CProtobufSerialization* value,
+                                    void* self) {
+        auto& values = static_cast<MemoryCache*>(self)->values_;
+        auto it = values.find(key);
+        if (it == values.end()) return TUNINGFORK_ERROR_NO_SUCH_KEY;
+        ToCProtobufSerialization(it->second, *value);
+        return TUNINGFORK_ERROR_OK;
+    }
+    static TuningFork_ErrorCode Set(
+        uint64_t key, const TuningFork_CProtobufSerialization* value,
+        void* self) {
+        static_cast<MemoryCache*>(self)->values_[key] =
+            ToProtobufSerialization(*value);
+        return TUNINGFORK_ERROR_OK;
+    }
+    static TuningFork_ErrorCode Remove(uint64_t key, void* self) {
+        static_cast<MemoryCache*>(self)->values_.erase(key);
+        return TUNINGFORK_ERROR_OK;
+    }
+
+   public:
+    TuningFork_Cache c_cache{this, Set, Get, Remove};
+
+    void Queue(const std::string& evt) {
+        journal::Append(&c_cache, HISTOGRAMS_UPLOADING,
+                        (const uint8_t*)evt.data(), evt.size(),
+                        MAX_UPLOADING_SESSIONS);
+    }
+    std::vector<std::string> Queued() const {
+        std::vector<std::string> queued;
+        auto it = values_.find(HISTOGRAMS_UPLOADING);
+        if (it == values_.end()) return queued;
+        std::vector<journal::Record> records;
+        journal::ReadRecords(it->second.data(), it->second.size(), records);
+        for (auto& r : records) {
+            queued.push_back(std::string((const char*)r.data, r.size));
+        }
+        return queued;
+    }
+};
+
+struct TestResponse {
+    TuningFork_ErrorCode error;
+    int response_code;
+};
+
+// Records the requests made and replies with the given responses in turn.
+class TestRequest : public HttpRequest {
+    std::vector<TestResponse> responses_;
+
+   public:
+    std::vector<std::string> requests;
+
+    TestRequest(std::vector<TestResponse> responses)
+        : HttpRequest("https://test.google.com", "dummy_api_key",
+                      seconds(10)),
+          responses_(responses) {}
+    TuningFork_ErrorCode Send(const std::string& rpc_name,
+                              const std::string& request, int& response_code,
+                              std::string& response_body) override {
+        EXPECT_EQ(rpc_name, ":uploadTelemetry");
+        EXPECT_LT(requests.size(), responses_.size()) << "Unexpected request";
+        if (requests.size() >= responses_.size())
+            return TUNINGFORK_ERROR_BAD_PARAMETER;
+        auto& response = responses_[requests.size()];
+        requests.push_back(request);
+        response_code = response.response_code;
+        return response.error;
+    }
+};
+
+class TestTimeProvider : public ITimeProvider {
+   public:
+    TimePoint t;
+    TimePoint Now() override { return t; }
+    SystemTimePoint SystemNow() override { return SystemTimePoint(); }
+    Duration TimeSinceProcessStart() override { return Duration(0); }
+};
+
+const TestResponse kOk = {TUNINGFORK_ERROR_OK, 200};
+const TestResponse kUnavailable = {TUNINGFORK_ERROR_OK, 503};
+const TestResponse kBadRequest = {TUNINGFORK_ERROR_OK, 400};
+const TestResponse kMetered = {TUNINGFORK_ERROR_METERED_CONNECTION_DISALLOWED,
+                               -1};
+
+TEST(UltimateUploaderTest, UploadsQueueInOrder) {
+    MemoryCache cache;
+    auto request = std::make_shared<TestRequest>(
+        std::vector<TestResponse>{kOk, kOk, kOk});
+    TestTimeProvider time;
+    UltimateUploader uploader(&cache.c_cache, request, &time);
+    cache.Queue("a");
+    cache.Queue("b");
+    cache.Queue("c");
+    uploader.DoWork();
+    EXPECT_EQ(request->requests, (std::vector<std::string>{"a", "b", "c"}));
+    EXPECT_TRUE(cache.Queued().empty());
+    // Nothing more to send
+    uploader.DoWork();
+    EXPECT_EQ(request->requests.size(), 3);
+}
+
+TEST(UltimateUploaderTest, BacksOffOnServerError) {
+    MemoryCache cache;
+    auto request = std::make_shared<TestRequest>(
+        std::vector<TestResponse>{kUnavailable, kUnavailable, kOk, kOk});
+    TestTimeProvider time;
+    UltimateUploader uploader(&cache.c_cache, request, &time);
+    cache.Queue("a");
+    cache.Queue("b");
+
+    auto wait = uploader.DoWork();
+    EXPECT_GE(wait, seconds(1));
+    EXPECT_LE(wait, seconds(2));
+    EXPECT_EQ(request->requests.size(), 1);
+    EXPECT_EQ(cache.Queued(), (std::vector<std::string>{"a", "b"}));
+
+    // Waking early doesn't retry before the backoff is over
+    time.t += wait / 2;
+    EXPECT_EQ(uploader.DoWork(), wait - wait / 2);
+    EXPECT_EQ(request->requests.size(), 1);
+
+    time.t += wait - wait / 2;
+    wait = uploader.DoWork();
+    EXPECT_GE(wait, seconds(2));
+    EXPECT_LE(wait, seconds(4));
+    EXPECT_EQ(request->requests.size(), 2);
+
+    time.t += wait;
+    uploader.DoWork();
+    EXPECT_EQ(request->requests,
+              (std::vector<std::string>{"a", "a", "a", "b"}));
+    EXPECT_TRUE(cache.Queued().empty());
+}
+
+TEST(UltimateUploaderTest, DropsRejectedRequests) {
+    MemoryCache cache;
+    auto request = std::make_shared<TestRequest>(
+        std::vector<TestResponse>{kBadRequest, kOk});
+    TestTimeProvider time;
+    UltimateUploader uploader(&cache.c_cache, request, &time);
+    cache.Queue("a");
+    cache.Queue("b");
+    uploader.DoWork();
+    EXPECT_EQ(request->requests, (std::vector<std::string>{"a", "b"}));
+    EXPECT_TRUE(cache.Queued().empty());
+}
+
+TEST(UltimateUploaderTest, WaitsForUnmeteredConnection) {
+    MemoryCache cache;
+    auto request = std::make_shared<TestRequest>(
+        std::vector<TestResponse>{kMetered, kOk});
+    TestTimeProvider time;
+    UltimateUploader uploader(&cache.c_cache, request, &time);
+    cache.Queue("a");
+    EXPECT_EQ(uploader.DoWork(), minutes(5));
+    EXPECT_EQ(cache.Queued(), std::vector<std::string>{"a"});
+    // This is not a failure, so there is no backoff
+    uploader.DoWork();
+    EXPECT_EQ(request->requests, (std::vector<std::string>{"a", "a"}));
+    EXPECT_TRUE(cache.Queued().empty());
+}
+
+}  // namespace ultimate_uploader_test